@@ -0,0 +1,360 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+/// Puts concurrent load on the EventBus and reports how publishing and
+/// delivery scale with the number of threads.
+/// Usage: event_bus_benchmark [--channels=N] [--listeners=N]
+///                            [--max-threads=N] [--duration=S] [--churn]
+///                            [--seed=N]
+///
+/// Every step runs the same number of publishing and reading threads, from 1
+/// doubling up to --max-threads. Publishers publish to random channels as
+/// fast as they can. Every channel has --listeners Listeners that are spread
+/// over the readers, which read every event with ReadNext(). Every channel
+/// folds its events into a count, so read events are dropped as they would
+/// be in the application. With --churn another thread keeps subscribing to
+/// and registering Publishers on new channels, so Listeners are refreshed
+/// while the others are reading.
+///
+/// Per step it prints the publish and delivery throughput and the percentiles
+/// of the time spent in Publish() and of the time from publishing to reading
+/// an event. A step whose throughput falls below kCollapseFraction of the
+/// best step so far is reported as a collapse. Builds with
+/// HABITIFY_LOCK_STATS, e.g. bazel run --config=lockstats, also print how
+/// long every kind of lock was waited for and held.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/event_bus/lock_stats.h"
+#include "src/core/metrics/latency_histogram.h"
+#include "src/core/metrics/memory_tracking.h"
+
+namespace habitify_benchmark {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using habitify_core::LatencyHistogram;
+
+constexpr uint64_t kMaxLatencyNs = 10ull * 1000 * 1000 * 1000;
+/// A step is a collapse if its throughput is below this fraction of the best
+/// step before it.
+constexpr double kCollapseFraction = 0.8;
+/// Publishers pause while more events are undelivered, so that slow readers
+/// show up as lower throughput instead of unbounded memory.
+constexpr uint64_t kMaxBacklog = 1 << 18;
+/// The churn thread uses the channels from here on.
+constexpr habitify_core::ChannelIdType kChurnChannels = 1 << 20;
+constexpr std::chrono::microseconds kChurnInterval{100};
+
+struct Options {
+  int channels = 8;
+  int listeners = 2;
+  int max_threads =
+      std::max<int>(2, 2 * (int)std::thread::hardware_concurrency());
+  double duration_s = 1.0;
+  bool churn = false;
+  uint64_t seed = 1;
+};
+
+struct Sample {
+  uint64_t sent_ns;
+  uint32_t publisher;
+};
+
+struct StepResult {
+  int threads;
+  double seconds;
+  uint64_t published = 0;
+  uint64_t delivered = 0;
+  uint64_t churn_ops = 0;
+  LatencyHistogram publish{kMaxLatencyNs};
+  LatencyHistogram delivery{kMaxLatencyNs};
+  std::vector<habitify_core::LockSiteStats> locks;
+  size_t peak_bus_bytes = 0;
+};
+
+StepResult RunStep(const Options &options, int threads) {
+  auto event_bus = habitify_core::EventBus::Create();
+  std::vector<std::shared_ptr<habitify_core::Publisher<Sample>>> publishers;
+  for (int c = 0; c < options.channels; c++) {
+    publishers.push_back(event_bus->RegisterPublisher<Sample>(c));
+    publishers.back()->SetReducer<uint64_t>(
+        [](uint64_t &count, const Sample &) { count++; });
+  }
+  std::vector<std::vector<std::shared_ptr<habitify_core::Listener>>> readers(
+      threads);
+  for (int i = 0; i < options.channels * options.listeners; i++) {
+    readers[i % threads].push_back(
+        event_bus->SubscribeTo(i % options.channels));
+  }
+
+  const Clock::time_point start = Clock::now();
+  auto since_start = [start]() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now() - start)
+        .count();
+  };
+  const uint64_t end_ns = (uint64_t)(options.duration_s * 1e9);
+  habitify_core::ResetLockStats();
+
+  std::atomic<bool> publishing = true;
+  std::atomic<uint64_t> published = 0;
+  std::atomic<uint64_t> delivered = 0;
+  std::vector<StepResult> partial(2 * threads + 1);
+  std::vector<std::thread> workers;
+
+  for (int p = 0; p < threads; p++) {
+    workers.emplace_back([&, p]() {
+      StepResult &result = partial[p];
+      std::mt19937 random((uint32_t)(options.seed + p));
+      std::uniform_int_distribution<int> channel(0, options.channels - 1);
+      uint64_t now = since_start();
+      while (now < end_ns) {
+        // Every Listener reads every event.
+        if (published * options.listeners >
+            delivered + kMaxBacklog * options.listeners) {
+          std::this_thread::yield();
+          now = since_start();
+          continue;
+        }
+        auto sample = habitify_core::MakePayload<Sample>(
+            Sample{now, (uint32_t)p});
+        publishers[channel(random)]->Publish(
+            std::make_unique<const habitify_core::Event<Sample>>(
+                habitify_core::EventType::TEST, 0, std::move(sample)));
+        uint64_t done = since_start();
+        result.publish.Record(done - now);
+        result.published++;
+        published.fetch_add(1, std::memory_order_relaxed);
+        now = done;
+      }
+    });
+  }
+
+  for (int r = 0; r < threads; r++) {
+    workers.emplace_back([&, r]() {
+      StepResult &result = partial[threads + r];
+      // The last pass after the publishers stopped drains the rest.
+      bool last_pass = false;
+      while (true) {
+        bool finished = !publishing;
+        uint64_t read = 0;
+        for (auto &listener : readers[r]) {
+          while (auto event = listener->ReadNext<Sample>()) {
+            result.delivery.Record(since_start() -
+                                   event->GetData<Sample>()->sent_ns);
+            read++;
+          }
+        }
+        result.delivered += read;
+        delivered.fetch_add(read, std::memory_order_relaxed);
+        if (last_pass) break;
+        last_pass = finished;
+        if (read == 0) std::this_thread::yield();
+      }
+    });
+  }
+
+  std::thread churn;
+  if (options.churn) {
+    churn = std::thread([&]() {
+      StepResult &result = partial[2 * threads];
+      for (habitify_core::ChannelIdType id = kChurnChannels; publishing;
+           id++) {
+        auto early = event_bus->SubscribeTo(id);
+        auto publisher = event_bus->RegisterPublisher<Sample>(id);
+        auto late = event_bus->SubscribeTo(id);
+        publisher->Publish(std::make_unique<const habitify_core::Event<Sample>>(
+            habitify_core::EventType::TEST, id,
+            habitify_core::MakePayload<Sample>(Sample{since_start(), 0})));
+        early->ReadNext<Sample>();
+        late->ReadNext<Sample>();
+        result.churn_ops++;
+        std::this_thread::sleep_for(kChurnInterval);
+      }
+    });
+  }
+
+  for (int p = 0; p < threads; p++) workers[p].join();
+  publishing = false;
+  for (size_t w = threads; w < workers.size(); w++) workers[w].join();
+  if (churn.joinable()) churn.join();
+
+  StepResult result;
+  result.threads = threads;
+  result.seconds = since_start() / 1e9;
+  for (const StepResult &part : partial) {
+    result.published += part.published;
+    result.delivered += part.delivered;
+    result.churn_ops += part.churn_ops;
+    result.publish.Add(part.publish);
+    result.delivery.Add(part.delivery);
+  }
+  result.locks = habitify_core::GetLockStats();
+  result.peak_bus_bytes =
+      habitify_core::GetMemoryResource(habitify_core::MemoryTag::kEventBus)
+          ->GetStats()
+          .peak_bytes;
+  return result;
+}
+
+void PrintHeader() {
+  std::printf("%7s %11s %11s | %8s %8s %8s %8s | %8s %8s %8s %8s | %8s\n",
+              "threads", "publish/s", "deliver/s", "pub p50", "pub p99",
+              "p99.9", "max", "dlv p50", "dlv p99", "p99.9", "max",
+              "churn/s");
+}
+
+void PrintStep(const StepResult &result) {
+  auto us = [](uint64_t ns) { return ns / 1e3; };
+  std::printf(
+      "%7d %11.0f %11.0f | %8.2f %8.2f %8.2f %8.1f | %8.2f %8.2f %8.2f "
+      "%8.1f | %8.0f\n",
+      result.threads, result.published / result.seconds,
+      result.delivered / result.seconds,
+      us(result.publish.ValueAtPercentile(50.0)),
+      us(result.publish.ValueAtPercentile(99.0)),
+      us(result.publish.ValueAtPercentile(99.9)),
+      us(result.publish.get_max()),
+      us(result.delivery.ValueAtPercentile(50.0)),
+      us(result.delivery.ValueAtPercentile(99.0)),
+      us(result.delivery.ValueAtPercentile(99.9)),
+      us(result.delivery.get_max()), result.churn_ops / result.seconds);
+}
+
+void PrintLocks(const StepResult &result) {
+  for (const auto &lock : result.locks) {
+    if (lock.acquisitions == 0) continue;
+    std::printf(
+        "        %-10s %11.0f locks/s  hold mean %7.0f ns max %9.1f us  "
+        "wait mean %7.0f ns max %9.1f us\n",
+        lock.name, lock.acquisitions / result.seconds,
+        (double)lock.total_hold_ns / lock.acquisitions,
+        lock.max_hold_ns / 1e3,
+        (double)lock.total_wait_ns / lock.acquisitions,
+        lock.max_wait_ns / 1e3);
+  }
+}
+
+bool ParseOption(const char *arg, Options &options) {
+  auto value_of = [arg](const char *name) -> const char * {
+    size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=')
+      return nullptr;
+    return arg + length + 1;
+  };
+
+  const char *value;
+  if (std::strcmp(arg, "--churn") == 0) {
+    options.churn = true;
+  } else if ((value = value_of("--channels"))) {
+    options.channels = std::atoi(value);
+  } else if ((value = value_of("--listeners"))) {
+    options.listeners = std::atoi(value);
+  } else if ((value = value_of("--max-threads"))) {
+    options.max_threads = std::atoi(value);
+  } else if ((value = value_of("--duration"))) {
+    options.duration_s = std::strtod(value, nullptr);
+  } else if ((value = value_of("--seed"))) {
+    options.seed = std::strtoull(value, nullptr, 10);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool Validate(const Options &options) {
+  return options.channels > 0 && options.listeners > 0 &&
+         options.max_threads > 0 && options.duration_s > 0.0;
+}
+
+int Main(const Options &options) {
+  std::printf(
+      "channels: %d, listeners per channel: %d, duration: %.1f s, churn: "
+      "%s, lock stats: %s\n",
+      options.channels, options.listeners, options.duration_s,
+      options.churn ? "on" : "off",
+      habitify_core::kLockStatsEnabled ? "on" : "off");
+  std::printf("latencies in us\n");
+  PrintHeader();
+
+  double best_rate = 0.0;
+  int best_threads = 0;
+  int collapse_threads = 0;
+  for (int threads = 1; threads <= options.max_threads; threads *= 2) {
+    StepResult result = RunStep(options, threads);
+    PrintStep(result);
+    if (habitify_core::kLockStatsEnabled) PrintLocks(result);
+
+    double rate = result.delivered / result.seconds;
+    if (rate < kCollapseFraction * best_rate && collapse_threads == 0) {
+      collapse_threads = threads;
+      std::printf("throughput collapsed at %d threads: %.0f%% of the best\n",
+                  threads, 100.0 * rate / best_rate);
+    }
+    if (rate > best_rate) {
+      best_rate = rate;
+      best_threads = threads;
+    }
+  }
+
+  std::printf("best delivery throughput: %.0f/s with %d threads\n", best_rate,
+              best_threads);
+  if (collapse_threads == 0)
+    std::printf("no collapse up to %d threads\n", options.max_threads);
+  std::printf("peak eventbus memory: %.1f MiB\n",
+              habitify_core::GetMemoryResource(
+                  habitify_core::MemoryTag::kEventBus)
+                      ->GetStats()
+                      .peak_bytes /
+                  (1024.0 * 1024.0));
+  return 0;
+}
+
+}  // namespace
+}  // namespace habitify_benchmark
+
+int main(int argc, char **argv) {
+  habitify_benchmark::Options options;
+  for (int i = 1; i < argc; i++) {
+    if (!habitify_benchmark::ParseOption(argv[i], options)) {
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (!habitify_benchmark::Validate(options)) {
+    std::fprintf(stderr,
+                 "Usage: %s [--channels=N] [--listeners=N] [--max-threads=N] "
+                 "[--duration=S] [--churn] [--seed=N]\n",
+                 argv[0]);
+    return 1;
+  }
+  return habitify_benchmark::Main(options);
+}
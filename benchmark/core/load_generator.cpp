@@ -0,0 +1,405 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+/// Puts synthetic check-in load on the backend and reports the latency from
+/// publishing a request to a consumer reading its result.
+/// Usage: load_generator [--target=engine|bus] [--users=N] [--rate=R]
+///                       [--duration=S] [--burst=F] [--burst-period=S]
+///                       [--burst-duty=D] [--shards=N] [--slo-ms=MS]
+///                       [--sweep=R1,R2,...] [--max-rate=R] [--seed=N]
+///                       [--memory-json=PATH]
+///
+/// Requests follow a Poisson process of rate R per second over N users. With
+/// --burst every period starts with a burst of F times the rate for a duty
+/// fraction D of the period and the rest of the period is quieter, so the
+/// average rate stays R.
+///
+/// --target=engine publishes UserRequests on channels::kUserRequest and
+/// measures until the UserResponse of the ShardedEngine is read from
+/// channels::kUserResponse. --target=bus only measures the hop from the
+/// publisher to a listener of channels::kUserRequest.
+///
+/// The send times are fixed up front, so a generator that falls behind does
+/// not hide the queueing delay it caused: "corrected" latencies are measured
+/// from the intended send time, "raw" ones from the actual send time. The
+/// difference between the two is the coordinated omission error of a naive
+/// harness.
+///
+/// Every rate of --sweep, or the doubling rates from --rate up to --max-rate,
+/// gives one line of the throughput versus latency curve. The sweep stops at
+/// the first rate that is not sustained or misses the p99 SLO. The memory
+/// stats of every subsystem are written to --memory-json at the end, e.g.
+/// to spot what the bus retained.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/core/engine/sharded_engine.h"
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/metrics/latency_histogram.h"
+#include "src/core/metrics/memory_tracking.h"
+
+namespace habitify_benchmark {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using habitify_core::LatencyHistogram;
+
+constexpr uint64_t kMaxLatencyNs = 60ull * 1000 * 1000 * 1000;
+/// Time the consumer waits for outstanding results after the last send.
+constexpr std::chrono::seconds kDrainTimeout{5};
+/// Sleeping is too coarse for shorter gaps, the generator spins instead.
+constexpr std::chrono::microseconds kSpinThreshold{50};
+/// A rate counts as sustained if this fraction of it was received.
+constexpr double kSustainedFraction = 0.95;
+
+enum class Target { kEngine, kBus };
+
+struct Options {
+  Target target = Target::kEngine;
+  uint64_t users = 10000;
+  double rate = 10000.0;
+  double duration_s = 5.0;
+  double burst_factor = 1.0;
+  double burst_period_s = 1.0;
+  double burst_duty = 0.1;
+  size_t shards = std::max<size_t>(
+      1, habitify_core::ShardedEngine::DefaultShardCount() / 2);
+  double slo_ms = 10.0;
+  std::vector<double> sweep;
+  double max_rate = 0.0;
+  uint64_t seed = 1;
+  const char *memory_json = nullptr;
+};
+
+struct Request {
+  /// Offset of the intended send time from the start of the run.
+  uint64_t intended_ns;
+  habitify_core::UserRequest request;
+};
+
+struct RunResult {
+  double target_rate;
+  size_t sent;
+  size_t received;
+  double achieved_rate;
+  LatencyHistogram corrected{kMaxLatencyNs};
+  LatencyHistogram raw{kMaxLatencyNs};
+};
+
+/// Draws the arrivals of a Poisson process whose rate follows the burst
+/// pattern.
+std::vector<Request> MakeSchedule(const Options &options, double rate) {
+  std::mt19937_64 random(options.seed);
+  std::exponential_distribution<double> gap(1.0);
+  std::uniform_int_distribution<uint64_t> user(1, options.users);
+  std::uniform_int_distribution<habitify_core::HabitId> habit(0, 7);
+  std::uniform_int_distribution<habitify_core::Day> day_offset(0, 364);
+  const habitify_core::Day today = habitify_core::Today();
+
+  // The rate outside of the burst keeps the average at rate.
+  const double burst_rate = rate * options.burst_factor;
+  const double quiet_rate =
+      options.burst_duty < 1.0
+          ? rate * (1.0 - options.burst_duty * options.burst_factor) /
+                (1.0 - options.burst_duty)
+          : burst_rate;
+
+  std::vector<Request> schedule;
+  schedule.reserve((size_t)(rate * options.duration_s * 1.1));
+  double t = 0.0;
+  while (true) {
+    double phase = std::fmod(t, options.burst_period_s);
+    bool bursting = options.burst_factor != 1.0 &&
+                    phase < options.burst_duty * options.burst_period_s;
+    double current_rate = bursting ? burst_rate : quiet_rate;
+    t += current_rate > 0.0 ? gap(random) / current_rate
+                            : options.burst_period_s - phase;
+    if (t >= options.duration_s) break;
+
+    Request entry;
+    entry.intended_ns = (uint64_t)(t * 1e9);
+    entry.request.request_id = schedule.size() + 1;
+    entry.request.user_id = user(random);
+    entry.request.habit_id = habit(random);
+    entry.request.day = today - day_offset(random);
+    schedule.push_back(entry);
+  }
+  return schedule;
+}
+
+RunResult Run(const Options &options, double rate) {
+  std::vector<Request> schedule = MakeSchedule(options, rate);
+  std::vector<uint64_t> actual_ns(schedule.size(), 0);
+  RunResult result;
+  result.target_rate = rate;
+  result.sent = schedule.size();
+  result.received = 0;
+  result.achieved_rate = 0.0;
+  if (schedule.empty()) return result;
+
+  auto event_bus = habitify_core::EventBus::Create();
+  auto requests = event_bus->RegisterPublisher<habitify_core::UserRequest>(
+      habitify_core::channels::kUserRequest);
+
+  std::shared_ptr<habitify_core::ShardedEngine> engine;
+  std::unique_ptr<habitify_core::EngineBusBridge> bridge;
+  std::shared_ptr<habitify_core::Listener> results;
+  if (options.target == Target::kEngine) {
+    habitify_core::ShardedEngine::Options engine_options;
+    engine_options.shard_count = options.shards;
+    engine_options.pin_threads = false;
+    engine = std::make_shared<habitify_core::ShardedEngine>(engine_options);
+    engine->Start();
+    bridge = std::make_unique<habitify_core::EngineBusBridge>(event_bus,
+                                                              engine, 0);
+    bridge->Start();
+    results = event_bus->SubscribeTo(habitify_core::channels::kUserResponse);
+  } else {
+    results = event_bus->SubscribeTo(habitify_core::channels::kUserRequest);
+  }
+
+  const Clock::time_point start = Clock::now();
+  auto since_start = [start]() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now() - start)
+        .count();
+  };
+
+  // The consumer owns the histograms. The bus orders the writes of the
+  // generator to actual_ns before the reads here.
+  uint64_t last_received_ns = 0;
+  std::thread consumer([&]() {
+    Clock::time_point deadline = Clock::time_point::max();
+    while (result.received < schedule.size() && Clock::now() < deadline) {
+      if (!results->WaitForEvent(std::chrono::milliseconds(10))) {
+        if (deadline == Clock::time_point::max() &&
+            since_start() > schedule.back().intended_ns)
+          deadline = Clock::now() + kDrainTimeout;
+        continue;
+      }
+      auto read = [&](uint64_t request_id) {
+        uint64_t now = since_start();
+        size_t index = request_id - 1;
+        result.corrected.Record(now - schedule[index].intended_ns);
+        result.raw.Record(now - actual_ns[index]);
+        result.received++;
+        last_received_ns = now;
+      };
+      if (options.target == Target::kEngine) {
+        while (auto event = results->ReadNext<habitify_core::UserResponse>())
+          read(event->GetData<habitify_core::UserResponse>()->request_id);
+      } else {
+        while (auto event = results->ReadNext<habitify_core::UserRequest>())
+          read(event->GetData<habitify_core::UserRequest>()->request_id);
+      }
+    }
+  });
+
+  for (size_t i = 0; i < schedule.size(); i++) {
+    Clock::time_point send_at =
+        start + std::chrono::nanoseconds(schedule[i].intended_ns);
+    if (send_at - Clock::now() > kSpinThreshold)
+      std::this_thread::sleep_until(send_at - kSpinThreshold);
+    while (Clock::now() < send_at) {
+    }
+    // Behind schedule the request is sent right away but keeps its intended
+    // send time.
+    actual_ns[i] = since_start();
+    requests->Publish(std::make_unique<const habitify_core::Event<
+                          habitify_core::UserRequest>>(
+        habitify_core::EventType::USER_REQUEST,
+        habitify_core::channels::kUserRequest,
+        habitify_core::MakePayload<habitify_core::UserRequest>(
+            schedule[i].request)));
+  }
+  consumer.join();
+
+  if (bridge) bridge->Stop();
+  if (engine) engine->Stop();
+
+  result.achieved_rate =
+      last_received_ns > 0 ? result.received / (last_received_ns / 1e9) : 0.0;
+  return result;
+}
+
+void PrintHeader() {
+  std::printf(
+      "%10s %10s %9s | %9s %9s %9s %9s %9s | %9s %9s\n", "target/s",
+      "achieved/s", "lost", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms",
+      "max ms", "raw p99", "raw max");
+}
+
+void PrintResult(const RunResult &result) {
+  auto ms = [](uint64_t ns) { return ns / 1e6; };
+  std::printf(
+      "%10.0f %10.0f %9zu | %9.3f %9.3f %9.3f %9.3f %9.3f | %9.3f %9.3f\n",
+      result.target_rate, result.achieved_rate, result.sent - result.received,
+      ms(result.corrected.ValueAtPercentile(50.0)),
+      ms(result.corrected.ValueAtPercentile(90.0)),
+      ms(result.corrected.ValueAtPercentile(99.0)),
+      ms(result.corrected.ValueAtPercentile(99.9)),
+      ms(result.corrected.get_max()), ms(result.raw.ValueAtPercentile(99.0)),
+      ms(result.raw.get_max()));
+  std::fflush(stdout);
+}
+
+bool ParseOption(const char *arg, Options &options) {
+  auto value_of = [arg](const char *name) -> const char * {
+    size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=')
+      return nullptr;
+    return arg + length + 1;
+  };
+
+  const char *value;
+  if ((value = value_of("--target"))) {
+    if (std::strcmp(value, "engine") == 0)
+      options.target = Target::kEngine;
+    else if (std::strcmp(value, "bus") == 0)
+      options.target = Target::kBus;
+    else
+      return false;
+  } else if ((value = value_of("--users"))) {
+    options.users = std::strtoull(value, nullptr, 10);
+  } else if ((value = value_of("--rate"))) {
+    options.rate = std::strtod(value, nullptr);
+  } else if ((value = value_of("--duration"))) {
+    options.duration_s = std::strtod(value, nullptr);
+  } else if ((value = value_of("--burst"))) {
+    options.burst_factor = std::strtod(value, nullptr);
+  } else if ((value = value_of("--burst-period"))) {
+    options.burst_period_s = std::strtod(value, nullptr);
+  } else if ((value = value_of("--burst-duty"))) {
+    options.burst_duty = std::strtod(value, nullptr);
+  } else if ((value = value_of("--shards"))) {
+    options.shards = std::strtoull(value, nullptr, 10);
+  } else if ((value = value_of("--slo-ms"))) {
+    options.slo_ms = std::strtod(value, nullptr);
+  } else if ((value = value_of("--max-rate"))) {
+    options.max_rate = std::strtod(value, nullptr);
+  } else if ((value = value_of("--memory-json"))) {
+    options.memory_json = value;
+  } else if ((value = value_of("--seed"))) {
+    options.seed = std::strtoull(value, nullptr, 10);
+  } else if ((value = value_of("--sweep"))) {
+    char *end = const_cast<char *>(value);
+    while (*end) {
+      options.sweep.push_back(std::strtod(end, &end));
+      if (*end == ',') end++;
+      else if (*end) return false;
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool Validate(const Options &options) {
+  auto positive = [](double value) { return value > 0.0; };
+  if (options.users == 0 || options.shards == 0) return false;
+  if (!positive(options.rate) || !positive(options.duration_s)) return false;
+  if (!positive(options.burst_period_s) || options.burst_factor < 1.0)
+    return false;
+  if (options.burst_duty <= 0.0 || options.burst_duty > 1.0) return false;
+  // The burst alone must not exceed the average rate.
+  if (options.burst_duty * options.burst_factor > 1.0) return false;
+  return std::all_of(options.sweep.begin(), options.sweep.end(), positive);
+}
+
+int Main(const Options &options) {
+  std::vector<double> rates = options.sweep;
+  if (rates.empty()) {
+    rates.push_back(options.rate);
+    while (rates.back() * 2 <= options.max_rate)
+      rates.push_back(rates.back() * 2);
+  }
+
+  std::printf("target: %s, users: %llu, duration: %.1f s, burst: x%.1f\n",
+              options.target == Target::kEngine ? "engine" : "bus",
+              (unsigned long long)options.users, options.duration_s,
+              options.burst_factor);
+  PrintHeader();
+
+  double capacity = 0.0;
+  const uint64_t slo_ns = (uint64_t)(options.slo_ms * 1e6);
+  for (double rate : rates) {
+    RunResult result = Run(options, rate);
+    PrintResult(result);
+
+    bool sustained = result.received >= kSustainedFraction * result.sent &&
+                     result.achieved_rate >= kSustainedFraction * rate;
+    if (!sustained ||
+        result.corrected.ValueAtPercentile(99.0) > slo_ns) {
+      std::printf("saturated at %.0f/s\n", rate);
+      break;
+    }
+    capacity = rate;
+  }
+  std::printf("highest rate within the p99 SLO of %.1f ms: %.0f/s\n",
+              options.slo_ms, capacity);
+
+  if (options.memory_json) {
+    std::ofstream file(options.memory_json);
+    if (!file) {
+      std::fprintf(stderr, "Could not open %s\n", options.memory_json);
+      return 1;
+    }
+    habitify_core::WriteMemoryStatsJson(habitify_core::GetMemoryStats(), file);
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace habitify_benchmark
+
+int main(int argc, char **argv) {
+  habitify_benchmark::Options options;
+  for (int i = 1; i < argc; i++) {
+    if (!habitify_benchmark::ParseOption(argv[i], options)) {
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (!habitify_benchmark::Validate(options)) {
+    std::fprintf(stderr,
+                 "Usage: %s [--target=engine|bus] [--users=N] [--rate=R] "
+                 "[--duration=S] [--burst=F] [--burst-period=S] "
+                 "[--burst-duty=D] [--shards=N] [--slo-ms=MS] "
+                 "[--sweep=R1,R2,...] [--max-rate=R] [--seed=N] "
+                 "[--memory-json=PATH]\n",
+                 argv[0]);
+    return 1;
+  }
+  return habitify_benchmark::Main(options);
+}
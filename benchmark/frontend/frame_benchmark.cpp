@@ -0,0 +1,199 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+/// Renders the frontend layers headless and reports the cost of each frame.
+/// Usage: frame_benchmark [frames]
+/// The numbers are gathered after a short warm up and include CPU time per
+/// frame, heap allocations per frame (operator new and ImGui's allocator) and
+/// the size of the generated draw lists.
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/frontend/debug_gui/debug_gui.h"
+#include "src/frontend/headless_frontend.h"
+#include "src/frontend/ping/ping_gui.h"
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+
+void *CountingImGuiAlloc(size_t size, void *) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size);
+}
+void CountingImGuiFree(void *ptr, void *) { std::free(ptr); }
+}  // namespace
+
+void *operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace habitify_benchmark {
+namespace {
+
+constexpr size_t kWarmupFrames = 60;
+constexpr size_t kDefaultFrames = 2000;
+constexpr int kDisplayW = 445;
+constexpr int kDisplayH = 650;
+
+struct FrameSample {
+  double cpu_us;
+  double wall_us;
+  size_t allocations;
+  int vertices;
+  int indices;
+};
+
+template <typename F>
+double Percentile(std::vector<FrameSample> samples, double p, F field) {
+  std::sort(samples.begin(), samples.end(),
+            [&](const FrameSample &a, const FrameSample &b) {
+              return field(a) < field(b);
+            });
+  size_t idx = (size_t)(p * (samples.size() - 1));
+  return (double)field(samples[idx]);
+}
+
+template <typename F>
+void Report(const char *name, const std::vector<FrameSample> &samples,
+            F field) {
+  double sum = 0;
+  for (const auto &s : samples) sum += field(s);
+  std::printf("%-16s mean %10.2f  p50 %10.2f  p99 %10.2f  max %10.2f\n", name,
+              sum / samples.size(), Percentile(samples, 0.5, field),
+              Percentile(samples, 0.99, field),
+              Percentile(samples, 1.0, field));
+}
+
+/// Moves the mouse across the window every frame and clicks every two
+/// seconds so hover and active states of the layers are exercised.
+void ScriptInput(habitify_frontend::HeadlessFrontend &frontend, size_t frames) {
+  for (size_t frame = 0; frame < frames; frame++) {
+    float t = frame / 60.0f;
+    float x = kDisplayW * (0.5f + 0.45f * std::sin(t * 1.3f));
+    float y = kDisplayH * (0.5f + 0.45f * std::sin(t * 0.7f));
+    frontend.ScheduleInput(frame,
+                           [x, y](ImGuiIO &io) { io.AddMousePosEvent(x, y); });
+    if (frame % 120 == 0)
+      frontend.ScheduleInput(
+          frame, [](ImGuiIO &io) { io.AddMouseButtonEvent(0, true); });
+    if (frame % 120 == 1)
+      frontend.ScheduleInput(
+          frame, [](ImGuiIO &io) { io.AddMouseButtonEvent(0, false); });
+  }
+}
+
+/// Replays the backend side of the ping service: a ping every half second.
+void ScriptBusTraffic(habitify_frontend::HeadlessFrontend &frontend,
+                      std::shared_ptr<habitify_core::EventBus> event_bus,
+                      size_t frames) {
+  static int ping_count = 0;
+  auto publisher = event_bus->RegisterPublisher<int>(0);
+  for (size_t frame = 0; frame < frames; frame += 30) {
+    frontend.ScheduleBusTraffic(frame, [publisher](habitify_core::EventBus &) {
+      ping_count++;
+      habitify_core::Event<int> e(habitify_core::EventType::TEST, 0,
+                                  &ping_count);
+      publisher->Publish(std::make_unique<const habitify_core::Event<int>>(e));
+    });
+  }
+}
+
+int Run(size_t frames) {
+  ImGui::SetAllocatorFunctions(CountingImGuiAlloc, CountingImGuiFree);
+
+  auto event_bus = habitify_core::EventBus::Create();
+  habitify_frontend::HeadlessFrontend frontend;
+  frontend.SetEventBus(event_bus);
+  if (!frontend.Init(kDisplayW, kDisplayH)) {
+    std::fprintf(stderr, "Failed to initialize the headless frontend\n");
+    return 1;
+  }
+  frontend.get_layer_stack().PushLayer<habitify_debug::DebugGui>();
+  frontend.get_layer_stack().PushLayer<habitify_frontend::PingGui>(event_bus);
+
+  size_t total_frames = frames + kWarmupFrames;
+  ScriptInput(frontend, total_frames);
+  ScriptBusTraffic(frontend, event_bus, total_frames);
+
+  std::vector<FrameSample> samples;
+  samples.reserve(frames);
+  for (size_t frame = 0; frame < total_frames; frame++) {
+    size_t allocations = g_allocations.load(std::memory_order_relaxed);
+    std::clock_t cpu_start = std::clock();
+    auto wall_start = std::chrono::steady_clock::now();
+
+    ImDrawData *draw_data = frontend.RenderFrame();
+
+    auto wall_end = std::chrono::steady_clock::now();
+    std::clock_t cpu_end = std::clock();
+    if (frame < kWarmupFrames) continue;
+
+    samples.push_back(
+        {1e6 * (cpu_end - cpu_start) / CLOCKS_PER_SEC,
+         std::chrono::duration<double, std::micro>(wall_end - wall_start)
+             .count(),
+         g_allocations.load(std::memory_order_relaxed) - allocations,
+         draw_data->TotalVtxCount, draw_data->TotalIdxCount});
+  }
+
+  std::printf("frames: %zu (after %zu warm up frames)\n", frames,
+              kWarmupFrames);
+  Report("cpu us/frame", samples,
+         [](const FrameSample &s) { return s.cpu_us; });
+  Report("wall us/frame", samples,
+         [](const FrameSample &s) { return s.wall_us; });
+  Report("allocs/frame", samples,
+         [](const FrameSample &s) { return s.allocations; });
+  Report("vertices/frame", samples,
+         [](const FrameSample &s) { return s.vertices; });
+  Report("indices/frame", samples,
+         [](const FrameSample &s) { return s.indices; });
+
+  frontend.Shutdown();
+  return 0;
+}
+
+}  // namespace
+}  // namespace habitify_benchmark
+
+int main(int argc, char **argv) {
+  size_t frames = habitify_benchmark::kDefaultFrames;
+  if (argc > 1) frames = std::strtoul(argv[1], nullptr, 10);
+  if (frames == 0) {
+    std::fprintf(stderr, "Usage: %s [frames]\n", argv[0]);
+    return 1;
+  }
+  return habitify_benchmark::Run(frames);
+}
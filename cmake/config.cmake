@@ -17,4 +17,19 @@
 # Contact via <https://github.com/SPauly/Habitify>
 
 option(BUILD_TESTS OFF)
-option(DEBUG_BUILD OFF)
\ No newline at end of file
+option(BUILD_BENCHMARKS OFF)
+option(ENABLE_AVX2 "Compile the bitset kernels for AVX2 capable CPUs" OFF)
+option(DEBUG_BUILD OFF)
+option(ENABLE_LOCK_STATS "Measure the lock hold times of the EventBus" OFF)
+set(SANITIZER "" CACHE STRING
+    "Build everything with a sanitizer: address, thread or undefined")
+
+if(SANITIZER)
+    add_compile_options(-fsanitize=${SANITIZER} -fno-omit-frame-pointer -g)
+    string(APPEND CMAKE_EXE_LINKER_FLAGS " -fsanitize=${SANITIZER}")
+endif()
+
+if(ENABLE_LOCK_STATS)
+    # Has to be the same for every target that includes event_bus.h.
+    add_definitions(-DHABITIFY_LOCK_STATS)
+endif()
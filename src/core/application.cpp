@@ -1,43 +1,125 @@
 #include "src/core/application.h"
 
+#include <chrono>
 #include <iostream>
 
-#include "src/core/error_handler.h"
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
 #include "src/core/event_bus/event_bus.h"
 
 namespace habitify_core {
 
-Application::Application() : event_bus_(EventBus::Create()) {
+Application::Application()
+    : startup_timeline_(std::make_shared<StartupTimeline>()),
+      event_bus_(EventBus::Create()),
+      executor_(std::make_unique<Executor>()),
+      startup_(startup_timeline_),
+      habit_history_(std::make_shared<InMemoryHabitHistory>()) {
+  // Every service only depends on the bus, except for the statistics and the
+  // queries which read the store, and the queries also read the catalog.
+  startup_.AddStep("HabitHistoryService", [this]() {
+    habit_history_service_ =
+        std::make_unique<HabitHistoryService>(event_bus_, habit_history_);
+    habit_history_service_->Start(*executor_);
+  });
+  auto store = startup_.AddStep("HabitStore", [this]() {
+    habit_store_ = std::make_unique<HabitStore>(event_bus_);
+  });
+  startup_.AddStep(
+      "StatisticsService",
+      [this]() {
+        statistics_service_ =
+            std::make_unique<StatisticsService>(event_bus_, *habit_store_);
+        statistics_service_->Start(*executor_);
+      },
+      {store});
+  startup_.AddStep("ReminderScheduler", [this]() {
+    reminder_scheduler_ = std::make_unique<ReminderScheduler>(event_bus_);
+    reminder_scheduler_->Start(*executor_);
+  });
+  auto catalog = startup_.AddStep(
+      "HabitCatalog",
+      [this]() { habit_catalog_ = std::make_unique<HabitCatalog>(); });
+  startup_.AddStep(
+      "QueryService",
+      [this]() {
+        query_service_ = std::make_unique<QueryService>(
+            event_bus_, *habit_store_, *habit_catalog_, executor_.get());
+        query_service_->Start(*executor_);
+      },
+      {store, catalog});
+  startup_.AddStep(
+      "HistoryImportService",
+      [this]() {
+        history_import_service_ = std::make_unique<HistoryImportService>(
+            event_bus_, *habit_history_, *habit_store_);
+        history_import_service_->Start(*executor_);
+      },
+      {store});
+  startup_.Start(*executor_);
+
+  frontend_pings_ = event_bus_->SubscribeTo(channels::kFrontendPing);
+  backend_pings_ = event_bus_->RegisterPublisher<int>(channels::kBackendPing);
+  ping_task_ = std::make_unique<PollingTask>(
+      *executor_, [this]() { return EchoPings(); }, std::chrono::seconds(1));
+  ping_hook_ = event_bus_->AddPublishHook(channels::kFrontendPing,
+                                          ping_task_->GetNotifier());
+  ping_task_->Start();
+
   imgui_frontend_.SetEventBus(event_bus_);
-  frontend_thread_ = new (std::nothrow)
-      std::thread(&habitify_frontend::ImGuiFrontend::Run, &imgui_frontend_);
-  HAB_ASSERT(frontend_thread_);
+  imgui_frontend_.SetExecutor(executor_.get());
+  imgui_frontend_.SetStartupTimeline(startup_timeline_);
 }
 
 Application::~Application() {
-  if (frontend_thread_) {
-    frontend_thread_->join();
-    delete frontend_thread_;
-  }
+  // The services may still be starting if the window was closed right away.
+  startup_.Wait();
+  // Imports that wait for the HistoryImportService would keep the executor
+  // from shutting down once it stopped.
+  import_stop_.request_stop();
+  // Services stop their tasks before the executor drains the rest.
+  event_bus_->RemovePublishHook(channels::kFrontendPing, ping_hook_);
+  ping_task_->Stop();
+  history_import_service_->Stop();
+  query_service_->Stop();
+  reminder_scheduler_->Stop();
+  statistics_service_->Stop();
+  habit_history_service_->Stop();
+  executor_->Shutdown();
 }
 
-void Application::Run() {
-  std::shared_ptr<EventBus> event_bus = EventBus::Create();
-  std::shared_ptr<Publisher<int>> p = event_bus_->RegisterPublisher<int>(0);
-  std::shared_ptr<Listener> l = event_bus_->SubscribeTo(1);
+void Application::Run() { imgui_frontend_.Run(); }
 
-  int ping_count = 0;
-
-  Event<int> e(habitify_core::EventType::TEST, 0, &ping_count);
+void Application::ImportHistory(const std::string &path) {
+  HistoryFormat format = path.ends_with(".ndjson") ? HistoryFormat::kNdjson
+                                                   : HistoryFormat::kCsv;
+  executor_->Submit(
+      [this, path, format]() {
+        HistoryImporter importer(event_bus_, executor_.get(),
+                                 import_stop_.get_token());
+        ImportReport report = importer.ImportFile(path, format);
+        if (!report.opened) {
+          std::cerr << "Could not open " << path << std::endl;
+          return;
+        }
+        std::cerr << "Imported " << report.rows << " rows from " << path
+                  << ", skipped " << report.invalid_rows << std::endl;
+        for (const std::string &error : report.errors) {
+          std::cerr << "  " << error << std::endl;
+        }
+      },
+      Executor::Priority::kLow);
+}
 
-  while (std::cin.get()) {
-    ping_count++;
-    std::cout << "Sending Ping: " << ping_count << std::endl;
-    p->Publish(std::make_unique<const Event<int>>(e));
-    if (l->HasReceivedEvent())
-      std::cout << "Ping Received: " << *l->ReadLatest<int>()->GetData<int>()
-                << std::endl;
+bool Application::EchoPings() {
+  bool echoed = false;
+  while (auto event = frontend_pings_->ReadNext<int>()) {
+    backend_pings_->Publish(std::make_unique<const Event<int>>(
+        EventType::TEST, channels::kBackendPing,
+        MakePayload<int>(*event->GetData<int>())));
+    echoed = true;
   }
+  return echoed;
 }
 
-}  // namespace habitify_core
\ No newline at end of file
+}  // namespace habitify_core
@@ -1,24 +1,69 @@
 #ifndef HABITIFY_SRC_CORE_APPLICATION_H_
 #define HABITIFY_SRC_CORE_APPLICATION_H_
 
-#include <thread>
+#include <memory>
+#include <stop_token>
+#include <string>
 #include <vector>
 
+#include "src/core/habits/habit_history_service.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/statistics_service.h"
+#include "src/core/io/history_import.h"
+#include "src/core/query/habit_catalog.h"
+#include "src/core/query/query_service.h"
+#include "src/core/reminders/reminder_scheduler.h"
+#include "src/core/runtime/executor.h"
+#include "src/core/runtime/startup.h"
 #include "src/frontend/imgui_frontend.h"
 
 namespace habitify_core {
+/// Application wires the backend services to the frontend. The services run
+/// as tasks on a shared Executor while the frontend owns the main thread.
+/// They are initialized in parallel on the Executor so that the frontend can
+/// open its window in the meantime.
 class Application {
  public:
   Application();
   ~Application();
 
+  /// Runs the frontend on the calling thread until its window is closed.
   void Run();
 
+  /// Imports the history in path in the background. The format is chosen by
+  /// the extension, .csv or .ndjson.
+  void ImportHistory(const std::string &path);
+
  private:
-  habitify_frontend::ImGuiFrontend imgui_frontend_;
-  std::thread *frontend_thread_;
+  /// Answers every ping of the frontend with a ping of the backend.
+  bool EchoPings();
 
+ private:
+  /// Declared first so that the timeline starts with the Application.
+  std::shared_ptr<StartupTimeline> startup_timeline_;
   std::shared_ptr<EventBus> event_bus_;
+  /// Declared before the services so that it outlives their tasks.
+  std::unique_ptr<Executor> executor_;
+  StartupGraph startup_;
+
+  habitify_frontend::ImGuiFrontend imgui_frontend_;
+
+  // Backend services
+  std::shared_ptr<InMemoryHabitHistory> habit_history_;
+  std::unique_ptr<HabitHistoryService> habit_history_service_;
+  std::unique_ptr<HabitStore> habit_store_;
+  std::unique_ptr<StatisticsService> statistics_service_;
+  std::unique_ptr<ReminderScheduler> reminder_scheduler_;
+  std::unique_ptr<HabitCatalog> habit_catalog_;
+  std::unique_ptr<QueryService> query_service_;
+  std::unique_ptr<HistoryImportService> history_import_service_;
+  /// Cancels the running imports on shutdown.
+  std::stop_source import_stop_;
+
+  std::shared_ptr<Listener> frontend_pings_;
+  std::shared_ptr<Publisher<int>> backend_pings_;
+  std::unique_ptr<PollingTask> ping_task_;
+  PublishHookId ping_hook_ = 0;
 };
 }  // namespace habitify_core
 
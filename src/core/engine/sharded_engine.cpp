@@ -0,0 +1,326 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/engine/sharded_engine.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+
+namespace habitify_core {
+ShardedEngine::ShardedEngine(const Options &options) : options_(options) {
+  if (options_.shard_count == 0) options_.shard_count = 1;
+  size_t producers = options_.shard_count + options_.producer_slots;
+
+  shards_.reserve(options_.shard_count);
+  for (size_t i = 0; i < options_.shard_count; i++) {
+    auto shard = std::make_unique<Shard>();
+    shard->index = i;
+    for (size_t p = 0; p < producers; p++) {
+      shard->inbound.push_back(
+          std::make_unique<SpscQueue<UserRequest>>(options_.queue_capacity));
+    }
+    shard->outbound =
+        std::make_unique<SpscQueue<UserResponse>>(options_.queue_capacity);
+    shard->blocked_targets.resize(options_.shard_count);
+    shards_.push_back(std::move(shard));
+  }
+}
+
+ShardedEngine::~ShardedEngine() { Stop(); }
+
+void ShardedEngine::Start() {
+  if (running_.exchange(true)) return;
+  for (auto &shard : shards_) {
+    shard->thread = std::thread(&ShardedEngine::ShardLoop, this,
+                                std::ref(*shard));
+    if (options_.pin_threads) Pin(shard->thread, shard->index);
+  }
+}
+
+void ShardedEngine::Stop() {
+  if (!running_.exchange(false)) return;
+  for (auto &shard : shards_) {
+    shard->signal.fetch_add(1, std::memory_order_release);
+    shard->signal.notify_one();
+  }
+  for (auto &shard : shards_) {
+    if (shard->thread.joinable()) shard->thread.join();
+  }
+
+  // A shard exits as soon as it is idle, so a partner check-in it forwarded
+  // may still wait in its deferred list or in the queue of a shard that
+  // exited before. Those are finished here. Every shard drains in every
+  // round, so the deferred forwards find room eventually.
+  bool worked = true;
+  while (worked) {
+    worked = false;
+    for (auto &shard : shards_) {
+      if (Drain(*shard, true)) worked = true;
+    }
+  }
+}
+
+bool ShardedEngine::Submit(size_t producer_slot, const UserRequest &request) {
+  return Push(options_.shard_count + producer_slot, request);
+}
+
+bool ShardedEngine::PollResponse(size_t shard, UserResponse &response) {
+  if (!shards_[shard]->outbound->TryPop(response)) return false;
+  WakeIfWaiting(*shards_[shard]);
+  return true;
+}
+
+size_t ShardedEngine::ShardOf(UserId user_id) const {
+  // splitmix64 finalizer, sequential ids end up on different shards
+  uint64_t x = user_id + 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return (size_t)(x % shards_.size());
+}
+
+size_t ShardedEngine::DefaultShardCount() {
+  size_t cores = std::thread::hardware_concurrency();
+  return cores > 0 ? cores : 1;
+}
+
+void ShardedEngine::ShardLoop(Shard &shard) {
+  while (true) {
+    // Read the signal before draining, a push in between changes it and
+    // makes wait() return immediately.
+    uint32_t seen = shard.signal.load(std::memory_order_acquire);
+    bool worked = Drain(shard);
+    if (worked) continue;
+    if (!running_.load(std::memory_order_acquire)) break;
+
+    // Blocked on a full queue. Whoever pops from it signals once the flag
+    // is set, the retry afterwards catches a pop that came before.
+    if (!shard.unsent.empty() || !shard.deferred.empty()) {
+      shard.waiting_for_room.exchange(1, std::memory_order_acq_rel);
+      if (!Flush(shard)) shard.signal.wait(seen, std::memory_order_acquire);
+      shard.waiting_for_room.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    shard.signal.wait(seen, std::memory_order_acquire);
+  }
+}
+
+bool ShardedEngine::Drain(Shard &shard, bool stopping) {
+  bool worked = Flush(shard);
+
+  // Back pressure: answers nobody collects and forwards a busy shard cannot
+  // take stall the producers through their full queues instead of piling up
+  // here. Requests of other shards never forward, so they are still taken
+  // while forwards are deferred, which keeps two shards that forward to each
+  // other from blocking both.
+  size_t shard_count = shards_.size();
+  UserRequest request;
+  for (size_t producer = 0; producer < shard.inbound.size(); producer++) {
+    bool is_slot = producer >= shard_count;
+    size_t n = 0;
+    while (n < kDrainBatch &&
+           (stopping || (shard.unsent.empty() &&
+                         (!is_slot || shard.deferred.empty()))) &&
+           shard.inbound[producer]->TryPop(request)) {
+      Handle(shard, request);
+      n++;
+    }
+    if (n == 0) continue;
+    worked = true;
+    if (!is_slot) WakeIfWaiting(*shards_[producer]);
+  }
+  return worked;
+}
+
+bool ShardedEngine::Flush(Shard &shard) {
+  bool worked = false;
+
+  size_t sent = 0;
+  while (sent < shard.unsent.size() &&
+         shard.outbound->TryPush(shard.unsent[sent])) {
+    sent++;
+  }
+  if (sent > 0) {
+    shard.unsent.erase(shard.unsent.begin(), shard.unsent.begin() + sent);
+    worked = true;
+  }
+
+  if (shard.deferred.empty()) return worked;
+  // Once a forward does not fit, the later ones to the same shard wait as
+  // well so that they are applied in order.
+  std::fill(shard.blocked_targets.begin(), shard.blocked_targets.end(), false);
+  size_t kept = 0;
+  for (const auto &request : shard.deferred) {
+    size_t target = ShardOf(request.user_id);
+    if (!shard.blocked_targets[target] && Push(shard.index, request)) {
+      worked = true;
+      continue;
+    }
+    shard.blocked_targets[target] = true;
+    shard.deferred[kept++] = request;
+  }
+  shard.deferred.resize(kept);
+  return worked;
+}
+
+void ShardedEngine::Handle(Shard &shard, const UserRequest &request) {
+  HabitTable &habits = shard.users[request.user_id].habits;
+
+  UserResponse response;
+  response.request_id = request.request_id;
+  response.user_id = request.user_id;
+
+  switch (request.kind) {
+    case UserRequest::Kind::kCheckIn:
+      response.changed =
+          habits.Set(request.habit_id, request.day, request.completed);
+      if (request.partner_id != 0) {
+        // The partner usually lives on another shard.
+        UserRequest forward = request;
+        forward.user_id = request.partner_id;
+        forward.partner_id = 0;
+        // Nothing may overtake the forwards that wait already.
+        if (!shard.deferred.empty() || !Push(shard.index, forward)) {
+          shard.deferred.push_back(forward);
+        }
+      }
+      break;
+
+    case UserRequest::Kind::kQueryStats: {
+      HabitStats &stats = response.stats;
+      HabitId id = request.habit_id;
+      Day today = request.day;
+      int year;
+      unsigned month, day;
+      CivilFromDays(today, year, month, day);
+
+      stats.habit_id = id;
+      stats.day = today;
+      stats.total_completions = (uint32_t)habits.CountCompletions(id);
+      stats.current_streak = (uint32_t)habits.CurrentStreak(id, today);
+      stats.longest_streak = (uint32_t)habits.LongestStreak(id);
+      stats.last_7_days =
+          (uint32_t)habits.CountCompletions(id, today - 6, today + 1);
+      stats.last_30_days =
+          (uint32_t)habits.CountCompletions(id, today - 29, today + 1);
+      stats.this_week = (uint32_t)habits.CountCompletions(
+          id, today - Weekday(today), today + 1);
+      stats.this_month = (uint32_t)habits.CountCompletions(
+          id, DaysFromCivil(year, month, 1), today + 1);
+      break;
+    }
+  }
+
+  if (!shard.unsent.empty() || !shard.outbound->TryPush(response)) {
+    shard.unsent.push_back(response);
+  }
+}
+
+bool ShardedEngine::Push(size_t producer, const UserRequest &request) {
+  Shard &target = *shards_[ShardOf(request.user_id)];
+  if (!target.inbound[producer]->TryPush(request)) return false;
+
+  target.signal.fetch_add(1, std::memory_order_release);
+  target.signal.notify_one();
+  return true;
+}
+
+void ShardedEngine::WakeIfWaiting(Shard &shard) {
+  // Both sides use read-modify-writes on the flag, so they are ordered: if
+  // this comes first the exchange in ShardLoop() sees the pop and the retry
+  // finds the room, else this sees the flag.
+  if (shard.waiting_for_room.fetch_or(0, std::memory_order_acq_rel) == 0) {
+    return;
+  }
+  shard.signal.fetch_add(1, std::memory_order_release);
+  shard.signal.notify_one();
+}
+
+void ShardedEngine::Pin(std::thread &thread, size_t core) {
+#if defined(__linux__)
+  size_t cores = std::thread::hardware_concurrency();
+  if (cores == 0) return;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core % cores, &set);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+}
+
+EngineBusBridge::EngineBusBridge(std::shared_ptr<EventBus> event_bus,
+                                 std::shared_ptr<ShardedEngine> engine,
+                                 size_t producer_slot)
+    : event_bus_(event_bus), engine_(engine), producer_slot_(producer_slot) {
+  requests_ = event_bus_->SubscribeTo(channels::kUserRequest);
+  responses_ =
+      event_bus_->RegisterPublisher<UserResponse>(channels::kUserResponse);
+  // Answers nobody waits for are dropped right away.
+  responses_->SetTransient();
+}
+
+EngineBusBridge::~EngineBusBridge() { Stop(); }
+
+void EngineBusBridge::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread([this]() {
+    while (running_) {
+      if (!Poll()) requests_->WaitForEvent(kIdleTimeout);
+    }
+  });
+}
+
+void EngineBusBridge::Stop() {
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+}
+
+bool EngineBusBridge::Poll() {
+  bool worked = false;
+
+  while (true) {
+    if (!has_stalled_request_) {
+      auto event = requests_->ReadNext<UserRequest>();
+      if (!event) break;
+      stalled_request_ = *event->GetData<UserRequest>();
+      has_stalled_request_ = true;
+    }
+    // Back pressure: keep the request and stop reading until there is room.
+    if (!engine_->Submit(producer_slot_, stalled_request_)) break;
+    has_stalled_request_ = false;
+    worked = true;
+  }
+
+  UserResponse response;
+  for (size_t shard = 0; shard < engine_->get_shard_count(); shard++) {
+    while (engine_->PollResponse(shard, response)) {
+      responses_->Publish(std::make_unique<const Event<UserResponse>>(
+          EventType::USER_RESPONSE, channels::kUserResponse,
+          MakePayload<UserResponse>(response)));
+      worked = true;
+    }
+  }
+  return worked;
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,213 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_ENGINE_SHARDED_ENGINE_H_
+#define HABITIFY_SRC_CORE_ENGINE_SHARDED_ENGINE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/runtime/spsc_queue.h"
+
+namespace habitify_core {
+
+using UserId = uint64_t;
+
+/// A request for the habits of one user.
+struct UserRequest {
+  enum class Kind : uint8_t { kCheckIn, kQueryStats };
+
+  uint64_t request_id = 0;
+  UserId user_id = 0;
+  Kind kind = Kind::kCheckIn;
+  HabitId habit_id = 0;
+  /// The day of the check-in or the day the stats are computed for.
+  Day day = 0;
+  bool completed = true;
+  /// kCheckIn: if set the check-in is applied to the same habit of the
+  /// partner as well, e.g. for habits shared between users. The shard of the
+  /// partner answers separately.
+  UserId partner_id = 0;
+};
+
+/// The answer to a UserRequest. stats is only filled for kQueryStats.
+struct UserResponse {
+  uint64_t request_id = 0;
+  UserId user_id = 0;
+  /// kCheckIn: whether the check-in changed anything.
+  bool changed = false;
+  HabitStats stats;
+};
+
+/// ShardedEngine serves the habits of many users. Users are partitioned by
+/// hash onto one shard per core and every shard runs on its own thread,
+/// optionally pinned to a core. A shard owns the state of its users and is
+/// the only thread that touches it, so there are no locks on the request
+/// path.
+///
+/// Requests travel over single producer single consumer queues. Every shard
+/// has one inbound queue per producer: one per shard for cross-shard
+/// requests and one per external producer slot. Answers are pushed to one
+/// outbound queue per shard. Usage:
+///       ShardedEngine engine;
+///       engine.Start();
+///       engine.Submit(0, request);   // from the thread owning slot 0
+///       while (engine.PollResponse(shard, response)) ...
+/// A shard whose answers are not collected stops taking requests, so its
+/// queues fill up and Submit() fails until PollResponse() makes room.
+/// NOTE: Every producer slot and every PollResponse() shard must only be used
+/// by one thread at a time.
+class ShardedEngine {
+ public:
+  struct Options {
+    size_t shard_count = DefaultShardCount();
+    /// Number of threads outside of the engine that submit requests.
+    size_t producer_slots = 1;
+    size_t queue_capacity = 4096;
+    bool pin_threads = true;
+  };
+
+  ShardedEngine() : ShardedEngine(Options()) {}
+  explicit ShardedEngine(const Options &options);
+  ~ShardedEngine();
+
+  ShardedEngine(const ShardedEngine &) = delete;
+  const ShardedEngine &operator=(const ShardedEngine &) = delete;
+
+  void Start();
+  /// Finishes the requests that are already queued, including the partner
+  /// check-ins they forward, and joins the shards. Answers that do not fit
+  /// into the outbound queue of their shard are sent after the next Start().
+  void Stop();
+
+  /// Queues request on the shard of its user. Returns false if that queue is
+  /// full, the caller should retry later.
+  bool Submit(size_t producer_slot, const UserRequest &request);
+  /// Pops the next answer of shard. Returns false if there is none.
+  bool PollResponse(size_t shard, UserResponse &response);
+
+  size_t ShardOf(UserId user_id) const;
+  inline const size_t get_shard_count() const { return shards_.size(); }
+
+  static size_t DefaultShardCount();
+
+ private:
+  /// Requests handled per inbound queue before moving on to the next one, so
+  /// that one busy producer cannot starve the others.
+  static constexpr size_t kDrainBatch = 64;
+
+  struct UserState {
+    HabitTable habits;
+  };
+
+  /// Everything a shard thread touches, on its own cache lines.
+  struct alignas(64) Shard {
+    size_t index = 0;
+    /// inbound[p] is written by producer p: shards first, then the slots.
+    std::vector<std::unique_ptr<SpscQueue<UserRequest>>> inbound;
+    std::unique_ptr<SpscQueue<UserResponse>> outbound;
+    /// Bumped after every push so that an idle shard can wait on it.
+    std::atomic<uint32_t> signal{0};
+    /// 1 while the shard waits for room in a full queue, so that whoever
+    /// pops from that queue bumps signal. Only changed by read-modify-writes
+    /// except for the reset, see WakeIfWaiting().
+    std::atomic<uint32_t> waiting_for_room{0};
+
+    std::unordered_map<UserId, UserState> users;
+    /// Requests for other shards whose queue was full, in the order they
+    /// were forwarded.
+    std::vector<UserRequest> deferred;
+    /// Answers that did not fit into outbound. While there are any the shard
+    /// handles no new requests.
+    std::vector<UserResponse> unsent;
+    /// Scratch space of Flush(), one entry per shard.
+    std::vector<bool> blocked_targets;
+    std::thread thread;
+  };
+
+  void ShardLoop(Shard &shard);
+  /// Handles or forwards the queued requests. Unless stopping is set nothing
+  /// new is taken while answers are unsent, and no requests of the producer
+  /// slots while forwards are deferred. Returns true if it did work.
+  bool Drain(Shard &shard, bool stopping = false);
+  /// Retries the unsent answers and the deferred forwards in order. Returns
+  /// true if any of them was pushed.
+  bool Flush(Shard &shard);
+  void Handle(Shard &shard, const UserRequest &request);
+  bool Push(size_t producer, const UserRequest &request);
+  /// Wakes shard if it waits for room in a queue that was just popped from.
+  void WakeIfWaiting(Shard &shard);
+  static void Pin(std::thread &thread, size_t core);
+
+ private:
+  Options options_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<bool> running_ = false;
+};
+
+/// EngineBusBridge connects a ShardedEngine to the EventBus. It forwards
+/// every UserRequest published on channels::kUserRequest to the engine and
+/// publishes the answers on channels::kUserResponse. It uses one producer
+/// slot of the engine and is the only consumer of its answers. Usage:
+///       EngineBusBridge bridge(event_bus, engine, 0);
+///       bridge.Start();
+class EngineBusBridge {
+ public:
+  EngineBusBridge(std::shared_ptr<EventBus> event_bus,
+                  std::shared_ptr<ShardedEngine> engine, size_t producer_slot);
+  ~EngineBusBridge();
+
+  EngineBusBridge(const EngineBusBridge &) = delete;
+  const EngineBusBridge &operator=(const EngineBusBridge &) = delete;
+
+  /// Runs Poll() on a dedicated thread until Stop() is called.
+  void Start();
+  void Stop();
+
+  /// Forwards the new requests and publishes the available answers. Returns
+  /// true if anything was forwarded or published.
+  bool Poll();
+
+ private:
+  static constexpr std::chrono::milliseconds kIdleTimeout{1};
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<ShardedEngine> engine_;
+  size_t producer_slot_;
+  std::shared_ptr<Listener> requests_;
+  std::shared_ptr<Publisher<UserResponse>> responses_;
+  /// A request the engine could not take yet.
+  bool has_stalled_request_ = false;
+  UserRequest stalled_request_;
+
+  std::atomic<bool> running_ = false;
+  std::thread thread_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_ENGINE_SHARDED_ENGINE_H_
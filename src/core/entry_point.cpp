@@ -1,7 +1,9 @@
 #include "src/core/application.h"
 
-int main() {
+int main(int argc, char **argv) {
   habitify_core::Application app;
+  // Every argument is a history file to import.
+  for (int i = 1; i < argc; i++) app.ImportHistory(argv[i]);
   app.Run();
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+/// Well known channels of the EventBus together with the type of data that is
+/// published on them. Keeping them in one place avoids two compartments
+/// accidentally sharing a channel with different event types.
+
+#ifndef HABITIFY_SRC_CORE_EVENT_BUS_CHANNELS_H_
+#define HABITIFY_SRC_CORE_EVENT_BUS_CHANNELS_H_
+
+#include "src/core/event_bus/event.h"
+
+namespace habitify_core {
+namespace channels {
+
+/// int: pings sent by the backend to the frontend.
+constexpr ChannelIdType kBackendPing = 0;
+/// int: pings sent by the frontend to the backend.
+constexpr ChannelIdType kFrontendPing = 1;
+
+/// HistoryPageRequest: rows of the habit history the frontend wants to show.
+constexpr ChannelIdType kHabitHistoryRequest = 10;
+/// HistoryPage: rows answering a HistoryPageRequest.
+constexpr ChannelIdType kHabitHistoryPage = 11;
+/// HistoryImportBatch: rows of the habit history read from an import file.
+constexpr ChannelIdType kHistoryImport = 12;
+
+/// CheckIn: a habit was marked as completed or not completed on a day.
+/// Published by the HabitStore for every change it applied.
+constexpr ChannelIdType kHabitCheckIn = 20;
+/// HabitAggregates: daily completion counts over all habits.
+constexpr ChannelIdType kHabitAggregates = 21;
+/// HabitStats: statistics of one habit, published whenever they change.
+constexpr ChannelIdType kHabitStats = 22;
+/// HabitQuery: range queries over the completions of habits.
+constexpr ChannelIdType kHabitQuery = 23;
+/// HabitQueryResult: chunks of rows answering a HabitQuery.
+constexpr ChannelIdType kHabitQueryResult = 24;
+/// ResultCacheStats: counters of the ResultCache of the QueryService.
+constexpr ChannelIdType kResultCacheStats = 25;
+
+/// UserRequest: requests for the ShardedEngine.
+constexpr ChannelIdType kUserRequest = 30;
+/// UserResponse: answers of the ShardedEngine.
+constexpr ChannelIdType kUserResponse = 31;
+
+/// DueReminders: reminders of the ReminderScheduler that became due.
+constexpr ChannelIdType kRemindersDue = 40;
+
+}  // namespace channels
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_EVENT_BUS_CHANNELS_H_
@@ -19,14 +19,39 @@
 #ifndef HABITIFY_SRC_CORE_EVENT_BUS_EVENT_H_
 #define HABITIFY_SRC_CORE_EVENT_BUS_EVENT_H_
 
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+#include "src/core/metrics/memory_tracking.h"
+
 namespace habitify_core {
 
-enum EventType { TEST, TEST2 };
+enum EventType {
+  TEST,
+  TEST2,
+  HABIT_HISTORY_REQUEST,
+  HABIT_HISTORY_PAGE,
+  HABIT_CHECK_IN,
+  HABIT_AGGREGATES,
+  HABIT_STATS,
+  USER_REQUEST,
+  USER_RESPONSE,
+  REMINDERS_DUE,
+  HABIT_QUERY,
+  HABIT_QUERY_RESULT,
+  HISTORY_IMPORT,
+  RESULT_CACHE_STATS
+};
 
 using ChannelIdType = int;
+/// Identifies a publish hook, see EventBus::AddPublishHook(). 0 is never used.
+using PublishHookId = uint64_t;
 
 namespace internal {
-class EventBase {
+/// Events are allocated on the resource of MemoryTag::kEventBus.
+class EventBase : public TrackedObject<MemoryTag::kEventBus> {
  public:
   EventBase() = default;
   EventBase(EventType etype, ChannelIdType channel_id = 0)
@@ -63,11 +88,18 @@ class EventBase {
 };
 }  // namespace internal
 
+/// Event either points to data owned by the caller, which then has to outlive
+/// every reader, or shares ownership of its data. The latter should be used
+/// for everything that is not a long lived value like a counter.
 template <typename T>
 class Event : public internal::EventBase {
  public:
   Event(EventType etype, ChannelIdType channel_id, T *data)
       : internal::EventBase(etype, channel_id), data_(data) {}
+  Event(EventType etype, ChannelIdType channel_id, std::shared_ptr<T> data)
+      : internal::EventBase(etype, channel_id),
+        data_(data.get()),
+        owned_data_(std::move(data)) {}
   ~Event() {}
 
  protected:
@@ -76,8 +108,24 @@ class Event : public internal::EventBase {
 
  private:
   T *data_;
+  std::shared_ptr<T> owned_data_;
 };
 
+/// Creates the shared data of an Event on the resource of MemoryTag::kEventBus
+/// so that payloads are accounted to the bus. Payloads that declare an
+/// allocator_type, e.g. std::pmr::polymorphic_allocator<>, and take it as
+/// last constructor argument get it passed down, so that their std::pmr
+/// containers are accounted to the bus as well. Usage:
+///       Event<CheckIn>(EventType::HABIT_CHECK_IN, channel,
+///                      MakePayload<CheckIn>(check_in));
+template <typename T, typename... Args>
+std::shared_ptr<T> MakePayload(Args &&...args) {
+  return std::allocate_shared<T>(
+      std::pmr::polymorphic_allocator<T>(
+          GetMemoryResource(MemoryTag::kEventBus)),
+      std::forward<Args>(args)...);
+}
+
 }  // namespace habitify_core
 
 #endif  // HABITIFY_SRC_CORE_EVENT_BUS_EVENT_H_
\ No newline at end of file
@@ -18,7 +18,10 @@
 
 #include "src/core/event_bus/event_bus.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <thread>
 
 namespace habitify_core {
 namespace internal {
@@ -26,7 +29,7 @@ PublisherBase::PublisherBase()
     : cv_(std::make_shared<std::condition_variable_any>()) {}
 
 bool PublisherBase::RegisterPublisher(const std::shared_ptr<Channel> channel) {
-  std::unique_lock<std::shared_mutex> lock(mux_);
+  UniqueLock<LockSite::kPublisher> lock(mux_);
 
   channel_ = channel;
   channel_id_ = channel->get_channel_id();
@@ -38,17 +41,20 @@ Channel::Channel(const ChannelIdType& channel,
                  std::shared_ptr<PublisherBase> publisher)
     : channel_id_(channel), publisher_(publisher) {}
 
-void Channel::RegisterListener(std::shared_ptr<Listener> listener) {
-  std::unique_lock<std::shared_mutex> lock(mux_);
+void Channel::RegisterListener(std::shared_ptr<Listener> listener,
+                               SubscribeFrom from) {
+  UniqueLock<LockSite::kChannel> lock(mux_);
   if (std::find(listeners_.begin(), listeners_.end(), listener) !=
       listeners_.end())
     return;
+  // Done under the lock so that TrimEvents() sees the index.
+  if (publisher_) listener->set_read_index(publisher_->GetSubscribeIndex(from));
   listeners_.push_back(listener);
 }
 
 std::shared_ptr<PublisherBase> Channel::RegisterPublisher(
     std::shared_ptr<PublisherBase> publisher) {
-  std::unique_lock<std::shared_mutex> lock(mux_);
+  UniqueLock<LockSite::kChannel> lock(mux_);
   // If the channel already has a publisher we merge them by assigning the given
   // shared_ptr to the publisher_ in place.
   if (publisher_) {
@@ -67,45 +73,134 @@ std::shared_ptr<PublisherBase> Channel::RegisterPublisher(
   return publisher_;
 }
 
+PublishHookId Channel::AddPublishHook(std::function<void()> hook) {
+  UniqueLock<LockSite::kChannel> lock(mux_);
+  PublishHookId id = next_hook_id_++;
+  publish_hooks_.emplace_back(id, std::move(hook));
+  return id;
+}
+
+bool Channel::RemovePublishHook(PublishHookId id) {
+  // Waits for NotifyPublishHooks(), which holds the shared lock.
+  UniqueLock<LockSite::kChannel> lock(mux_);
+  auto it = std::find_if(publish_hooks_.begin(), publish_hooks_.end(),
+                         [id](const auto& hook) { return hook.first == id; });
+  if (it == publish_hooks_.end()) return false;
+  publish_hooks_.erase(it);
+  return true;
+}
+
+void Channel::NotifyPublishHooks() {
+  SharedLock<LockSite::kChannel> lock(mux_);
+  for (auto& [id, hook] : publish_hooks_) {
+    hook();
+  }
+}
+
+void Channel::TrimEvents() {
+  SharedLock<LockSite::kChannel> lock(mux_);
+  if (!publisher_) return;
+  if (listeners_.empty() && !publisher_->HasReducer() &&
+      !publisher_->IsTransient()) {
+    return;
+  }
+  size_t oldest_unread = SIZE_MAX;
+  for (auto& listener : listeners_) {
+    oldest_unread = std::min(oldest_unread, listener->get_read_index());
+  }
+  // Publish() trims every time, most often there is nothing to drop and the
+  // exclusive lock of the Publisher is not needed.
+  if (oldest_unread <= publisher_->GetFirstEvent()) return;
+  publisher_->DropEventsBefore(oldest_unread);
+}
+
+size_t Channel::GetUnreadEvents() {
+  SharedLock<LockSite::kChannel> lock(mux_);
+  if (!publisher_) return 0;
+  size_t oldest_unread = publisher_->GetFirstEvent();
+  if (!listeners_.empty()) {
+    oldest_unread = SIZE_MAX;
+    for (auto& listener : listeners_) {
+      oldest_unread = std::min(oldest_unread, listener->get_read_index());
+    }
+  }
+  size_t writer_index = publisher_->get_writer_index();
+  return writer_index > oldest_unread ? writer_index - oldest_unread : 0;
+}
+
 }  // namespace internal
 
 Listener::Listener(std::shared_ptr<EventBus> event_bus)
     : event_bus_(event_bus) {}
 
 void Listener::SubscribeTo(std::shared_ptr<internal::Channel> channel) {
-  std::unique_lock<std::shared_mutex> lock(mux_);
+  internal::UniqueLock<LockSite::kListener> lock(mux_);
   channel_ = channel;
   channel_id_ = channel->get_channel_id();
   publisher_ = channel->get_publisher();
+  latest_publisher_.store(publisher_.get(), std::memory_order_release);
   is_subscribed_ = true;
 }
 
+bool Listener::WaitForEvent(std::chrono::milliseconds timeout) {
+  std::shared_ptr<internal::PublisherBase> publisher;
+  size_t read_index;
+  {
+    internal::SharedLock<LockSite::kListener> lock(mux_);
+    publisher = publisher_;
+    read_index = read_index_;
+  }
+
+  if (!publisher) {
+    std::this_thread::sleep_for(timeout);
+    return HasReceivedEvent();
+  }
+  return publisher->WaitForEvent(read_index, timeout);
+}
+
 // EventBus
 std::shared_ptr<Listener> EventBus::SubscribeTo(
-    const ChannelIdType& channel_id) {
+    const ChannelIdType& channel_id, SubscribeFrom from) {
   auto channel = GetChannel(channel_id);
 
-  std::unique_lock<std::shared_mutex> lock(mux_);
+  internal::UniqueLock<LockSite::kEventBus> lock(mux_);
 
   if (channel) {
     auto listener = Listener::Create(shared_from_this());
     listener->SubscribeTo(channel);
-    channel->RegisterListener(listener);
+    channel->RegisterListener(listener, from);
     return listener;
   }
 
   return nullptr;
 }
 
+PublishHookId EventBus::AddPublishHook(const ChannelIdType& channel_id,
+                                       std::function<void()> hook) {
+  return GetChannel(channel_id)->AddPublishHook(std::move(hook));
+}
+
+bool EventBus::RemovePublishHook(const ChannelIdType& channel_id,
+                                 PublishHookId id) {
+  return GetChannel(channel_id)->RemovePublishHook(id);
+}
+
+size_t EventBus::GetUnreadEvents(const ChannelIdType& channel_id) {
+  return GetChannel(channel_id)->GetUnreadEvents();
+}
+
 std::shared_ptr<internal::Channel> EventBus::GetChannel(
     const ChannelIdType& channel) {
-  std::unique_lock<std::shared_mutex> lock(mux_);
+  internal::UniqueLock<LockSite::kEventBus> lock(mux_);
 
   auto it = channels_.find(channel);
   if (it != channels_.end()) return it->second;
 
   // If the channel does not exist yet we create it.
-  auto channel_ptr = std::make_shared<internal::Channel>(channel);
+  auto channel_ptr = std::allocate_shared<internal::Channel>(
+      std::pmr::polymorphic_allocator<internal::Channel>(
+          GetMemoryResource(MemoryTag::kEventBus)),
+      channel);
   channels_.emplace(std::make_pair(channel, channel_ptr));
 
   return channel_ptr;
@@ -34,22 +34,35 @@
 ///           NOTE: Listener and Publisher need to be created as shared_ptr to
 ///           ensure thread safety. The best practice is to use the
 ///           EventBus::SubscribeTo and EventBus::RegisterPublisher functions
+/// Locks are taken in the order EventBus, Channel, Listener, Publisher. Their
+/// hold times can be measured with HABITIFY_LOCK_STATS, see lock_stats.h.
 
 #ifndef HABITIFY_SRC_CORE_EVENT_BUS_EVENT_BUS_H_
 #define HABITIFY_SRC_CORE_EVENT_BUS_EVENT_BUS_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <shared_mutex>
 #include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include "src/core/event_bus/event.h"
+#include "src/core/event_bus/lock_stats.h"
+#include "src/core/metrics/memory_tracking.h"
+#include "src/core/runtime/seqlock.h"
 
 namespace habitify_core {
 
@@ -60,11 +73,23 @@ class Channel;
 class Listener;
 class EventBus;
 
+/// Where a new Listener starts reading.
+enum class SubscribeFrom {
+  /// The oldest event that is still stored. On channels with a reducer the
+  /// events before the latest snapshot may be gone already, call
+  /// Listener::ReadSnapshot() to start from the snapshot instead.
+  kOldestEvent,
+  /// The next event that is published, for Listeners that only care about
+  /// what happens after they subscribed.
+  kNextEvent,
+};
+
 namespace internal {
 /// PublisherBase is used as a way of storing Publisher in the EventBus. The
 /// actual functionality is implemented by the derived class. It needs to be
 /// inherated from. Use Publisher as the interface to EventBus!
-class PublisherBase : public std::enable_shared_from_this<PublisherBase> {
+class PublisherBase : public std::enable_shared_from_this<PublisherBase>,
+                      public TrackedObject<MemoryTag::kEventBus> {
  public:
   // The Listener needs to be a friend class to access the provided ReadFoo()
   // functions.
@@ -83,6 +108,9 @@ class PublisherBase : public std::enable_shared_from_this<PublisherBase> {
   // Getters and Setters:
   inline const ChannelIdType& get_channel_id() { return channel_id_; }
   inline const bool get_is_registered() { return is_registered_; }
+  inline const size_t get_writer_index() {
+    return writer_index_.load(std::memory_order_acquire);
+  }
   /// Returns a conditonal_variable_any that is notified by Publish().
   inline std::shared_ptr<std::condition_variable_any> get_cv() { return cv_; }
   /// Returns the latest Event as it's base class. This is mostly used for
@@ -99,10 +127,67 @@ class PublisherBase : public std::enable_shared_from_this<PublisherBase> {
     return true;
   }
 
+  /// Blocks until there is an unread event for the given index or the timeout
+  /// expired. Returns true if there is an unread event.
+  virtual bool WaitForEvent(size_t index, std::chrono::milliseconds timeout) {
+    assert(false && "WaitForEvent() not implemented");
+    return true;
+  }
+
+  /// Drops the stored events before index. Channels with a reducer never
+  /// drop the ones after the latest snapshot, the others always keep the
+  /// latest event for ReadLatest(). Called by the Channel with the lowest
+  /// read index of its Listeners.
+  virtual void DropEventsBefore(size_t index) {}
+
+  /// Index of the first event a new Listener reads, see SubscribeFrom.
+  size_t GetSubscribeIndex(SubscribeFrom from) {
+    SharedLock<LockSite::kPublisher> lock(mux_);
+    if (from == SubscribeFrom::kNextEvent) {
+      return writer_index_.load(std::memory_order_relaxed);
+    }
+    return first_event_.load(std::memory_order_relaxed);
+  }
+
+  /// Index of the oldest stored event. Does not take a lock, so that
+  /// TrimEvents() can skip DropEventsBefore() if nothing can be dropped.
+  inline size_t GetFirstEvent() const {
+    return first_event_.load(std::memory_order_acquire);
+  }
+
+  /// Returns true if the channel folds its events, see
+  /// Publisher::SetReducer().
+  bool HasReducer() {
+    SharedLock<LockSite::kPublisher> lock(mux_);
+    return snapshot_type_ != nullptr;
+  }
+
+  /// Without a Listener a channel keeps every event so that the first
+  /// Listener still reads them all. A transient channel, e.g. the answers to
+  /// requests that are worthless to later Listeners, keeps only the latest
+  /// one instead.
+  void SetTransient() {
+    UniqueLock<LockSite::kPublisher> lock(mux_);
+    is_transient_ = true;
+  }
+  bool IsTransient() {
+    SharedLock<LockSite::kPublisher> lock(mux_);
+    return is_transient_;
+  }
+
  protected:
+  /// This function is called by Listener::ReadNext and is implemented by the
+  /// derived class. Returns nullptr if there is no event with that index.
+  virtual const std::shared_ptr<const internal::EventBase> ReadAtImpl(
+      size_t index) {
+    return nullptr;
+  }
+
   /// This function is called by Listener::ReadLatest and is implemented by
-  /// the derived class.
-  virtual const std::shared_ptr<const internal::EventBase> ReadLatestImpl() {
+  /// the derived class. If index is set it receives the index of the returned
+  /// event.
+  virtual const std::shared_ptr<const internal::EventBase> ReadLatestImpl(
+      size_t* index = nullptr) {
     return nullptr;
   }
 
@@ -114,6 +199,20 @@ class PublisherBase : public std::enable_shared_from_this<PublisherBase> {
   mutable std::shared_mutex mux_;
   std::shared_ptr<std::condition_variable_any> cv_;
   std::shared_ptr<Channel> channel_;
+  /// Number of published events. Only written under mux_ but read without a
+  /// lock by polling Listeners, so it gets its own cache line.
+  alignas(64) std::atomic<size_t> writer_index_{0};
+
+  /// State of the reducer up to snapshot_index_, see
+  /// Publisher::SetReducer(). Guarded by mux_.
+  std::shared_ptr<const void> snapshot_;
+  const std::type_info* snapshot_type_ = nullptr;
+  size_t snapshot_index_ = 0;
+  /// Index of the oldest stored event, older ones were dropped. Only written
+  /// under mux_.
+  std::atomic<size_t> first_event_{0};
+  /// See SetTransient(). Guarded by mux_.
+  bool is_transient_ = false;
 
  private:
   bool is_registered_ = false;
@@ -124,7 +223,7 @@ class PublisherBase : public std::enable_shared_from_this<PublisherBase> {
 
 /// Channel is used to store the Publisher and Listener objects together.
 /// It is used internally by the EventBus and should not be used directly.
-class Channel {
+class Channel : public TrackedObject<MemoryTag::kEventBus> {
  public:
   Channel() = delete;
   Channel(const ChannelIdType& channel_id,
@@ -143,20 +242,47 @@ class Channel {
   inline const std::vector<std::shared_ptr<Listener>> get_listeners() {
     return listeners_;
   }
-  /// Adds a new Listener to the Channel.
-  void RegisterListener(std::shared_ptr<Listener> listener);
+  /// Adds a new Listener to the Channel, which starts reading at from.
+  void RegisterListener(std::shared_ptr<Listener> listener,
+                        SubscribeFrom from = SubscribeFrom::kOldestEvent);
 
   /// Registers the Publisher. TODO: We need to return a nullptr or break if the
   /// EvTyps of publisher do not match. When they do we can merge them.
   std::shared_ptr<PublisherBase> RegisterPublisher(
       std::shared_ptr<PublisherBase> publisher);
 
+  /// Adds a hook that is invoked on the publishing thread after every
+  /// successful Publish() on this Channel. Hooks must be cheap and must not
+  /// publish to the same Channel.
+  PublishHookId AddPublishHook(std::function<void()> hook);
+  /// Removes the hook. Once this returns the hook is not running and is not
+  /// invoked again, so it must not be called from a hook. Returns false if
+  /// there is no hook with that ID.
+  bool RemovePublishHook(PublishHookId id);
+  /// Called by the Publisher once an event was stored.
+  void NotifyPublishHooks();
+
+  /// Lets the Publisher drop the events that every Listener has read. On
+  /// channels with a reducer only the ones that are part of the latest
+  /// snapshot are dropped. Without a reducer nothing is dropped while no
+  /// Listener is subscribed, so the first one still reads every event, unless
+  /// the channel is transient. Called by the Publisher after every event, or
+  /// after every snapshot if it has a reducer.
+  void TrimEvents();
+
+  /// Number of events the slowest Listener did not read yet. Without a
+  /// Listener these are all stored events.
+  size_t GetUnreadEvents();
+
  private:
   std::shared_mutex mux_;
 
   ChannelIdType channel_id_;
   std::shared_ptr<PublisherBase> publisher_;
   std::vector<std::shared_ptr<Listener>> listeners_;
+  std::vector<std::pair<PublishHookId, std::function<void()>>>
+      publish_hooks_;
+  PublishHookId next_hook_id_ = 1;
 };
 }  // namespace internal
 
@@ -183,8 +309,16 @@ class Publisher : public internal::PublisherBase {
   /// Publisher::HasReceivedEvent(size_t index) checks if there are unread
   /// events for the Listener
   virtual bool HasReceivedEvent(size_t index) override {
-    std::shared_lock<std::shared_mutex> lock(mux_);
-    return index < writer_index_;
+    return index < writer_index_.load(std::memory_order_acquire);
+  }
+
+  /// See PublisherBase::WaitForEvent()
+  virtual bool WaitForEvent(size_t index,
+                            std::chrono::milliseconds timeout) override {
+    internal::SharedLock<LockSite::kPublisher> lock(mux_);
+    return cv_->wait_for(lock, timeout, [&]() {
+      return index < writer_index_.load(std::memory_order_relaxed);
+    });
   }
 
   /// Publisher<EvTyp>::Publish(std::unique_ptr< const internal::EventBase>)
@@ -193,33 +327,153 @@ class Publisher : public internal::PublisherBase {
   template <typename T>
   bool Publish(std::unique_ptr<const Event<T>> event) {
     if (!get_is_registered()) return false;
-    std::unique_lock<std::shared_mutex> lock(mux_);
-
-    auto shared_event =
-        std::shared_ptr<const internal::EventBase>(std::move(event));
-    event_storage_.emplace(writer_index_, shared_event);
+    bool trim = false;
+    {
+      internal::UniqueLock<LockSite::kPublisher> lock(mux_);
+
+      // The control block is accounted to the bus like the event itself.
+      auto shared_event = std::shared_ptr<const internal::EventBase>(
+          event.release(), std::default_delete<const internal::EventBase>(),
+          std::pmr::polymorphic_allocator<std::byte>(
+              GetMemoryResource(MemoryTag::kEventBus)));
+      size_t index = writer_index_.load(std::memory_order_relaxed);
+      event_storage_.emplace(index, shared_event);
+      const EvTyp* data = nullptr;
+      if constexpr (std::is_same_v<T, EvTyp>) {
+        data = shared_event->GetData<T>();
+        if (data && fold_) fold_(*data);
+      }
+      // Events without a value are recorded too, so that readers do not take
+      // an older value for the newest one.
+      if constexpr (kHasLatestValue) {
+        latest_value_.Store(LatestValue{data ? *data : EvTyp{}, index + 1,
+                                        data != nullptr});
+      }
+
+      writer_index_.store(index + 1, std::memory_order_release);
+      if (!fold_) {
+        trim = true;
+      } else if ((index + 1) % snapshot_interval_ == 0) {
+        TakeSnapshot(index + 1);
+        trim = true;
+      }
+      cv_->notify_all();
+    }
+    // Trimming needs the lock of the Channel, which is never taken while
+    // holding the lock of the Publisher.
+    if (trim) channel_->TrimEvents();
+    // The hooks are run without holding the lock so that they may read the
+    // event that was just published.
+    channel_->NotifyPublishHooks();
+    return true;
+  }
 
-    cv_->notify_all();
-    ++writer_index_;
+  /// Folds every event into a State with reducer so that new Listeners can
+  /// start from a snapshot of it instead of replaying the whole channel.
+  /// Every snapshot_interval events the State is copied into a new snapshot
+  /// and the events before it that all Listeners have read are dropped.
+  /// Listeners that subscribe afterwards start at the latest snapshot with
+  /// Listener::ReadSnapshot(). Events that were published already are
+  /// folded right away. A channel has at most one reducer, returns false if
+  /// it has one already. Usage:
+  ///       publisher->SetReducer<Counts>(
+  ///           [](Counts& counts, const CheckIn& check_in) { ... });
+  template <typename State>
+  bool SetReducer(std::function<void(State&, const EvTyp&)> reducer,
+                  size_t snapshot_interval = kSnapshotInterval) {
+    internal::UniqueLock<LockSite::kPublisher> lock(mux_);
+    if (fold_) return false;
+    auto state = std::make_shared<State>();
+    fold_ = [state, reducer](const EvTyp& event) { reducer(*state, event); };
+    take_snapshot_ = [state]() -> std::shared_ptr<const void> {
+      return std::allocate_shared<const State>(
+          std::pmr::polymorphic_allocator<State>(
+              GetMemoryResource(MemoryTag::kEventBus)),
+          *state);
+    };
+    snapshot_type_ = &typeid(State);
+    snapshot_interval_ = std::max<size_t>(snapshot_interval, 1);
+
+    size_t writer_index = writer_index_.load(std::memory_order_relaxed);
+    size_t first_event = first_event_.load(std::memory_order_relaxed);
+    for (size_t index = first_event; index < writer_index; index++) {
+      auto event = event_storage_.find(index);
+      if (event == event_storage_.end()) continue;
+      if (const EvTyp* data = event->second->template GetData<EvTyp>()) {
+        fold_(*data);
+      }
+    }
+    TakeSnapshot(writer_index);
     return true;
   }
 
-  inline const size_t get_writer_index() { return writer_index_; }
+  /// Copies the value of the newest event to out without taking a lock.
+  /// end_index receives the index after that event, 0 if nothing was
+  /// published yet. Returns false if nothing was published or the newest
+  /// event carries no EvTyp, e.g. because its data is null. Only available
+  /// for trivially copyable EvTyp.
+  bool TryReadLatestValue(EvTyp& out, size_t* end_index = nullptr) {
+    static_assert(kHasLatestValue,
+                  "TryReadLatestValue() needs a trivially copyable type");
+    LatestValue latest = latest_value_.Load();
+    if (end_index) *end_index = latest.end_index;
+    if (!latest.has_value) return false;
+    out = latest.value;
+    return true;
+  }
 
  protected:
+  /// See PublisherBase::DropEventsBefore()
+  virtual void DropEventsBefore(size_t index) override {
+    internal::UniqueLock<LockSite::kPublisher> lock(mux_);
+    if (fold_) {
+      index = std::min(index, snapshot_index_);
+    } else {
+      size_t writer_index = writer_index_.load(std::memory_order_relaxed);
+      if (writer_index == 0) return;
+      index = std::min(index, writer_index - 1);
+    }
+    size_t first_event = first_event_.load(std::memory_order_relaxed);
+    if (index <= first_event) return;
+    for (; first_event < index; first_event++) {
+      event_storage_.erase(first_event);
+    }
+    first_event_.store(first_event, std::memory_order_release);
+  }
+
+  /// See PublisherBase::ReadAtImpl()
+  virtual const std::shared_ptr<const internal::EventBase> ReadAtImpl(
+      size_t index) override {
+    internal::SharedLock<LockSite::kPublisher> lock(mux_);
+
+    auto event = event_storage_.find(index);
+    if (event == event_storage_.end()) return nullptr;
+
+    return event->second;
+  }
+
   /// See PublisherBase::ReadLatestImpl()
-  virtual const std::shared_ptr<const internal::EventBase> ReadLatestImpl()
-      override {
-    std::shared_lock<std::shared_mutex> lock(mux_);
+  virtual const std::shared_ptr<const internal::EventBase> ReadLatestImpl(
+      size_t* index = nullptr) override {
+    internal::SharedLock<LockSite::kPublisher> lock(mux_);
 
     if (event_storage_.empty()) return nullptr;
 
-    auto event = event_storage_.find(writer_index_ - 1);
+    size_t latest = writer_index_.load(std::memory_order_relaxed) - 1;
+    auto event = event_storage_.find(latest);
     if (event == event_storage_.end()) return nullptr;
 
+    if (index) *index = latest;
     return event->second;
   }
 
+ private:
+  /// Must be called with mux_ held.
+  void TakeSnapshot(size_t index) {
+    snapshot_ = take_snapshot_();
+    snapshot_index_ = index;
+  }
+
  private:
   Publisher() : PublisherBase() {}
   /// Publisher()::Create() was made private to ensure that it is only created
@@ -230,9 +484,31 @@ class Publisher : public internal::PublisherBase {
   }
 
  private:
-  std::unordered_map<int, std::shared_ptr<const internal::EventBase>>
-      event_storage_;
-  size_t writer_index_ = 0;
+  /// Small values are additionally kept in a SeqLock so that polling
+  /// Listeners can read the latest one without a lock.
+  static constexpr bool kHasLatestValue =
+      std::is_trivially_copyable_v<EvTyp> &&
+      std::is_default_constructible_v<EvTyp>;
+  struct LatestValue {
+    EvTyp value;
+    /// Index after the newest event, 0 before the first one.
+    size_t end_index;
+    /// False if the newest event carries no EvTyp.
+    bool has_value;
+  };
+
+  static constexpr size_t kSnapshotInterval = 1024;
+
+  std::pmr::unordered_map<int, std::shared_ptr<const internal::EventBase>>
+      event_storage_{GetMemoryResource(MemoryTag::kEventBus)};
+
+  // Set by SetReducer()
+  std::function<void(const EvTyp&)> fold_;
+  std::function<std::shared_ptr<const void>()> take_snapshot_;
+  size_t snapshot_interval_ = kSnapshotInterval;
+
+  [[no_unique_address]] std::conditional_t<
+      kHasLatestValue, SeqLock<LatestValue>, std::monostate> latest_value_;
 };
 
 /// Listener is used to read events from the Publisher. It is designed to be
@@ -240,7 +516,8 @@ class Publisher : public internal::PublisherBase {
 ///       std::shared_ptr<Listener> l = Listener::Create();
 ///       l->SubscribeTo(0);
 ///       if(l.HasReceivedEvent()) auto event = l.ReadLatest<int>();
-class Listener : public std::enable_shared_from_this<Listener> {
+class Listener : public std::enable_shared_from_this<Listener>,
+                 public TrackedObject<MemoryTag::kEventBus> {
  public:
   // EventBus needs access to the SubscribeTo() function to properly instantiate
   // the Listener object
@@ -263,40 +540,133 @@ class Listener : public std::enable_shared_from_this<Listener> {
 
   /// RefreshPublisher() is called by the Channel if a Publisher is added to it.
   inline void RefreshPublisher() {
-    std::unique_lock<std::shared_mutex> lock(mux_);
+    internal::UniqueLock<LockSite::kListener> lock(mux_);
     publisher_ = channel_->get_publisher();
+    latest_publisher_.store(publisher_.get(), std::memory_order_release);
   }
 
-  /// Returns the latest event published by the Publisher. If there are no
-  /// events it returns nullptr.
+  /// Returns the latest event published by the Publisher and marks all
+  /// events up to it as read. If there are no events it returns nullptr.
   template <typename EvTyp>
   const std::shared_ptr<const Event<EvTyp>> ReadLatest() {
-    std::shared_lock<std::shared_mutex> lock(mux_);
+    internal::UniqueLock<LockSite::kListener> lock(mux_);
 
     if (!ValidatePublisher()) return nullptr;
 
-    auto event = publisher_->ReadLatestImpl();
+    size_t index = 0;
+    auto event = publisher_->ReadLatestImpl(&index);
     if (event == nullptr) return nullptr;
 
     auto latest_converted = std::static_pointer_cast<const Event<EvTyp>>(event);
     if (!latest_converted)
       assert(false && "ReadLatest tried retrieving data of wrong format");
 
-    read_index_++;
+    read_index_ = index + 1;
     return latest_converted;
   }
 
+  /// Returns the oldest unread event and marks it as read. Use this instead
+  /// of ReadLatest() if every event matters. If there are no unread events it
+  /// returns nullptr. A Listener that caught up lets the Channel drop the
+  /// events that every Listener has read.
+  template <typename EvTyp>
+  const std::shared_ptr<const Event<EvTyp>> ReadNext() {
+    std::shared_ptr<internal::Channel> channel;
+    {
+      internal::UniqueLock<LockSite::kListener> lock(mux_);
+
+      if (!ValidatePublisher()) return nullptr;
+
+      auto event = publisher_->ReadAtImpl(read_index_);
+      if (event != nullptr) {
+        read_index_++;
+        return std::static_pointer_cast<const Event<EvTyp>>(event);
+      }
+      if (trimmed_index_ == read_index_) return nullptr;
+      trimmed_index_ = read_index_;
+      channel = channel_;
+    }
+    // Trimming needs the lock of the Channel, which is never taken while
+    // holding the lock of the Listener.
+    channel->TrimEvents();
+    return nullptr;
+  }
+
+  /// Returns the latest snapshot of the reducer of the channel, see
+  /// Publisher::SetReducer(), and makes the first event after it the next
+  /// one returned by ReadNext(). Returns nullptr if the channel has no
+  /// reducer. Usage:
+  ///       if (auto counts = l->ReadSnapshot<Counts>()) Show(*counts);
+  ///       while (auto event = l->ReadNext<CheckIn>()) Apply(*event);
+  template <typename State>
+  std::shared_ptr<const State> ReadSnapshot() {
+    internal::UniqueLock<LockSite::kListener> lock(mux_);
+    if (!ValidatePublisher()) return nullptr;
+
+    // The read index is moved back while the Publisher is locked, so that it
+    // cannot drop the events after the snapshot in the meantime.
+    internal::SharedLock<LockSite::kPublisher> publisher_lock(
+        publisher_->mux_);
+    if (!publisher_->snapshot_) return nullptr;
+    if (*publisher_->snapshot_type_ != typeid(State))
+      assert(false && "ReadSnapshot tried retrieving state of wrong format");
+
+    read_index_ = publisher_->snapshot_index_;
+    return std::static_pointer_cast<const State>(publisher_->snapshot_);
+  }
+
+  /// Lock free alternative to ReadLatest() for trivially copyable types,
+  /// meant for Listeners that poll every frame. Copies the latest value to
+  /// out and marks all events up to it as read. Returns false if nothing was
+  /// published yet or the newest event carries no value, which is marked as
+  /// read as well. Usage:
+  ///       int value;
+  ///       if (l->HasReceivedEvent() && l->TryReadLatestValue(value)) ...
+  template <typename EvTyp>
+  bool TryReadLatestValue(EvTyp& out) {
+    internal::PublisherBase* base =
+        latest_publisher_.load(std::memory_order_acquire);
+    if (base == nullptr) return false;
+    assert(dynamic_cast<Publisher<EvTyp>*>(base) &&
+           "TryReadLatestValue tried retrieving data of wrong format");
+
+    size_t end_index = 0;
+    bool has_value =
+        static_cast<Publisher<EvTyp>*>(base)->TryReadLatestValue(out,
+                                                                 &end_index);
+    if (end_index > 0) read_index_.store(end_index, std::memory_order_relaxed);
+    return has_value;
+  }
+
+  /// Does not take a lock, so it is cheap to poll.
   inline bool HasReceivedEvent() {
-    return ValidatePublisher() ? publisher_->HasReceivedEvent(read_index_)
-                               : false;
+    internal::PublisherBase* publisher =
+        latest_publisher_.load(std::memory_order_acquire);
+    return publisher != nullptr &&
+           read_index_.load(std::memory_order_relaxed) <
+               publisher->writer_index_.load(std::memory_order_acquire);
   }
 
+  /// Blocks until HasReceivedEvent() would return true or the timeout
+  /// expired. Without a Publisher this simply waits for the timeout.
+  bool WaitForEvent(std::chrono::milliseconds timeout);
+
   // Getters
   inline const bool get_is_subscribed() { return is_subscribed_; }
   inline const ChannelIdType get_channel_id() { return channel_id_; }
   inline const size_t get_read_index() { return read_index_; }
   inline const std::shared_ptr<EventBus> get_event_bus() { return event_bus_; }
 
+  /// Makes index the next event returned by ReadNext(), e.g. to replay the
+  /// events that are newer than a snapshot. Events that every Listener has
+  /// read may be gone: on channels with a reducer the ones before the latest
+  /// snapshot, use ReadSnapshot() there, and on the others all but the
+  /// latest one.
+  inline void set_read_index(size_t index) {
+    internal::UniqueLock<LockSite::kListener> lock(mux_);
+    read_index_ = index;
+  }
+
  protected:
   /// Listener() was made private to ensure that it is only created via the
   /// Create function. This way we can enforce that Listener is purely used as
@@ -307,7 +677,8 @@ class Listener : public std::enable_shared_from_this<Listener> {
   }
 
   /// Listener::SubscribeTo() is used
-  /// by the EventBus to assign the Listener to a specific channel
+  /// by the EventBus to assign the Listener to a specific channel. Where the
+  /// Listener starts reading is set by the Channel, see SubscribeFrom.
   void SubscribeTo(std::shared_ptr<internal::Channel> channel);
 
  private:
@@ -317,7 +688,10 @@ class Listener : public std::enable_shared_from_this<Listener> {
  private:
   mutable std::shared_mutex mux_;
   bool is_subscribed_ = false;
-  size_t read_index_ = 0;
+  /// Atomic so that the lock free reads can update it.
+  std::atomic<size_t> read_index_ = 0;
+  /// read_index_ of the last time ReadNext() caught up and trimmed.
+  size_t trimmed_index_ = 0;
 
   /// channel_id_ refers to a predefined ChannelId and is used to identify the
   /// Publisher.
@@ -326,6 +700,8 @@ class Listener : public std::enable_shared_from_this<Listener> {
 
   /// This might be nullptr if the Listener is not subscribed to a Publisher.
   std::shared_ptr<internal::PublisherBase> publisher_;
+  /// publisher_ for the lock free reads. The Channel keeps it alive.
+  std::atomic<internal::PublisherBase*> latest_publisher_ = nullptr;
   std::shared_ptr<EventBus> event_bus_;
 };
 
@@ -354,7 +730,11 @@ class EventBus : public std::enable_shared_from_this<EventBus> {
 
   /// Returns a shared_ptr to the Listener object that is subscribed to the
   /// specified channel. This is the only way to obtain a Listener object.
-  std::shared_ptr<Listener> SubscribeTo(const ChannelIdType& channel);
+  /// By default the Listener starts at the oldest stored event, see
+  /// SubscribeFrom.
+  std::shared_ptr<Listener> SubscribeTo(
+      const ChannelIdType& channel,
+      SubscribeFrom from = SubscribeFrom::kOldestEvent);
 
   /// Returns a shared_ptr to the Publisher object that publishes to the
   /// specified channel
@@ -363,7 +743,7 @@ class EventBus : public std::enable_shared_from_this<EventBus> {
       const ChannelIdType& channel) {
     auto channel_ptr = GetChannel(channel);
 
-    std::unique_lock<std::shared_mutex> lock(mux_);
+    internal::UniqueLock<LockSite::kEventBus> lock(mux_);
     // If the channel already has a publisher we avoid creating a new one. And
     // instead share the access to it.
     if (channel_ptr->get_publisher() != nullptr)
@@ -377,6 +757,20 @@ class EventBus : public std::enable_shared_from_this<EventBus> {
     return publisher;
   }
 
+  /// Invokes hook every time an event is published on the specified channel.
+  /// This allows consumers that sleep, like the frontend in its power saving
+  /// mode, to be woken up without polling. The hook stays until it is
+  /// removed with RemovePublishHook(), e.g. when its consumer stops.
+  PublishHookId AddPublishHook(const ChannelIdType& channel,
+                               std::function<void()> hook);
+  /// See Channel::RemovePublishHook().
+  bool RemovePublishHook(const ChannelIdType& channel, PublishHookId id);
+
+  /// Returns the number of events on the specified channel that are still
+  /// stored for a Listener, see Channel::GetUnreadEvents(). Publishers can
+  /// wait for it to drop instead of queueing events without bounds.
+  size_t GetUnreadEvents(const ChannelIdType& channel);
+
   // Getters
   inline const int GetChannelCount() { return channels_.size(); }
 
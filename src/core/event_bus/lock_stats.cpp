@@ -0,0 +1,101 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/event_bus/lock_stats.h"
+
+#include <array>
+#include <atomic>
+
+namespace habitify_core {
+namespace {
+/// Relaxed counters of one LockSite, on their own cache line since every
+/// lock of the site updates them.
+struct alignas(64) SiteCounters {
+  std::atomic<uint64_t> acquisitions = 0;
+  std::atomic<uint64_t> total_wait_ns = 0;
+  std::atomic<uint64_t> max_wait_ns = 0;
+  std::atomic<uint64_t> total_hold_ns = 0;
+  std::atomic<uint64_t> max_hold_ns = 0;
+};
+
+std::array<SiteCounters, (size_t)LockSite::kCount> site_counters;
+
+inline void StoreMax(std::atomic<uint64_t>& max, uint64_t value) {
+  uint64_t current = max.load(std::memory_order_relaxed);
+  while (value > current &&
+         !max.compare_exchange_weak(current, value,
+                                    std::memory_order_relaxed)) {
+  }
+}
+}  // namespace
+
+const char* LockSiteName(LockSite site) {
+  switch (site) {
+    case LockSite::kEventBus:
+      return "eventbus";
+    case LockSite::kChannel:
+      return "channel";
+    case LockSite::kListener:
+      return "listener";
+    case LockSite::kPublisher:
+      return "publisher";
+    default:
+      return "unknown";
+  }
+}
+
+std::vector<LockSiteStats> GetLockStats() {
+  std::vector<LockSiteStats> stats;
+  for (size_t site = 0; site < (size_t)LockSite::kCount; site++) {
+    const SiteCounters& counters = site_counters[site];
+    LockSiteStats entry;
+    entry.name = LockSiteName((LockSite)site);
+    entry.acquisitions = counters.acquisitions.load(std::memory_order_relaxed);
+    entry.total_wait_ns =
+        counters.total_wait_ns.load(std::memory_order_relaxed);
+    entry.max_wait_ns = counters.max_wait_ns.load(std::memory_order_relaxed);
+    entry.total_hold_ns =
+        counters.total_hold_ns.load(std::memory_order_relaxed);
+    entry.max_hold_ns = counters.max_hold_ns.load(std::memory_order_relaxed);
+    stats.push_back(entry);
+  }
+  return stats;
+}
+
+void ResetLockStats() {
+  for (SiteCounters& counters : site_counters) {
+    counters.acquisitions.store(0, std::memory_order_relaxed);
+    counters.total_wait_ns.store(0, std::memory_order_relaxed);
+    counters.max_wait_ns.store(0, std::memory_order_relaxed);
+    counters.total_hold_ns.store(0, std::memory_order_relaxed);
+    counters.max_hold_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+namespace internal {
+void RecordLockHold(LockSite site, uint64_t wait_ns, uint64_t hold_ns) {
+  SiteCounters& counters = site_counters[(size_t)site];
+  counters.acquisitions.fetch_add(1, std::memory_order_relaxed);
+  counters.total_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+  counters.total_hold_ns.fetch_add(hold_ns, std::memory_order_relaxed);
+  StoreMax(counters.max_wait_ns, wait_ns);
+  StoreMax(counters.max_hold_ns, hold_ns);
+}
+}  // namespace internal
+
+}  // namespace habitify_core
@@ -0,0 +1,124 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_EVENT_BUS_LOCK_STATS_H_
+#define HABITIFY_SRC_CORE_EVENT_BUS_LOCK_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace habitify_core {
+
+/// The locks of the EventBus, in the order they are taken.
+enum class LockSite : uint8_t {
+  kEventBus,
+  kChannel,
+  kListener,
+  kPublisher,
+  kCount
+};
+
+const char* LockSiteName(LockSite site);
+
+/// How long the locks of one LockSite were waited for and held, summed over
+/// all instances since the start or the last ResetLockStats().
+struct LockSiteStats {
+  const char* name = "";
+  uint64_t acquisitions = 0;
+  uint64_t total_wait_ns = 0;
+  uint64_t max_wait_ns = 0;
+  uint64_t total_hold_ns = 0;
+  uint64_t max_hold_ns = 0;
+};
+
+/// Lock stats are only recorded in builds with HABITIFY_LOCK_STATS defined,
+/// e.g. bazel build --config=lockstats. The define has to be the same for
+/// every translation unit that includes event_bus.h.
+#ifdef HABITIFY_LOCK_STATS
+constexpr bool kLockStatsEnabled = true;
+#else
+constexpr bool kLockStatsEnabled = false;
+#endif
+
+/// Stats of every LockSite, in the order of LockSite. All zero unless
+/// kLockStatsEnabled.
+std::vector<LockSiteStats> GetLockStats();
+void ResetLockStats();
+
+namespace internal {
+void RecordLockHold(LockSite site, uint64_t wait_ns, uint64_t hold_ns);
+
+#ifdef HABITIFY_LOCK_STATS
+/// Lock of mux that records how long it waited for and held mux. Also
+/// records the time until a condition variable releases it while waiting.
+template <LockSite site, typename Lock>
+class TimedLock : public Lock {
+ public:
+  explicit TimedLock(std::shared_mutex& mux) : Lock(mux, std::defer_lock) {
+    lock();
+  }
+  ~TimedLock() {
+    if (this->owns_lock()) Record();
+  }
+
+  TimedLock(const TimedLock&) = delete;
+  const TimedLock& operator=(const TimedLock&) = delete;
+
+  void lock() {
+    auto start = std::chrono::steady_clock::now();
+    Lock::lock();
+    acquired_ = std::chrono::steady_clock::now();
+    wait_ns_ = Nanoseconds(acquired_ - start);
+  }
+  void unlock() {
+    Record();
+    Lock::unlock();
+  }
+
+ private:
+  static inline uint64_t Nanoseconds(std::chrono::nanoseconds duration) {
+    return (uint64_t)duration.count();
+  }
+  void Record() {
+    RecordLockHold(site, wait_ns_,
+                   Nanoseconds(std::chrono::steady_clock::now() - acquired_));
+  }
+
+ private:
+  std::chrono::steady_clock::time_point acquired_;
+  uint64_t wait_ns_ = 0;
+};
+
+template <LockSite site>
+using UniqueLock = TimedLock<site, std::unique_lock<std::shared_mutex>>;
+template <LockSite site>
+using SharedLock = TimedLock<site, std::shared_lock<std::shared_mutex>>;
+#else
+template <LockSite site>
+using UniqueLock = std::unique_lock<std::shared_mutex>;
+template <LockSite site>
+using SharedLock = std::shared_lock<std::shared_mutex>;
+#endif
+}  // namespace internal
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_EVENT_BUS_LOCK_STATS_H_
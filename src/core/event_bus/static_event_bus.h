@@ -0,0 +1,348 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_EVENT_BUS_STATIC_EVENT_BUS_H_
+#define HABITIFY_SRC_CORE_EVENT_BUS_STATIC_EVENT_BUS_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "src/core/event_bus/event.h"
+#include "src/core/runtime/seqlock.h"
+
+namespace habitify_core {
+
+/// One channel of a StaticEventBus. Capacity is the number of events kept
+/// for Listeners that fall behind and must be a power of two.
+template <ChannelIdType Id, typename T, size_t Capacity = 64>
+struct StaticChannel {
+  static constexpr ChannelIdType kId = Id;
+  static constexpr size_t kCapacity = Capacity;
+  using Type = T;
+
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+};
+
+namespace internal {
+/// Storage of one StaticChannel. Publishers write the next slot of the ring
+/// under a unique lock, Listeners copy out of it under a shared lock. The
+/// writer index and, for trivially copyable types, the latest value can be
+/// read without a lock.
+template <typename Channel>
+class StaticChannelStorage {
+ public:
+  using T = typename Channel::Type;
+  static constexpr size_t kCapacity = Channel::kCapacity;
+  static constexpr bool kHasLatestValue =
+      std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>;
+
+  StaticChannelStorage() = default;
+  StaticChannelStorage(const StaticChannelStorage&) = delete;
+  const StaticChannelStorage& operator=(const StaticChannelStorage&) = delete;
+
+  void Publish(const T& value) {
+    {
+      std::unique_lock<std::shared_mutex> lock(mux_);
+      size_t index = writer_index_.load(std::memory_order_relaxed);
+      slots_[index & (kCapacity - 1)] = value;
+      if constexpr (kHasLatestValue) latest_value_.Store({value, index});
+      writer_index_.store(index + 1, std::memory_order_release);
+      // Waiters register under mux_, so none can be missed here.
+      if (waiters_.load(std::memory_order_relaxed) > 0) cv_.notify_all();
+    }
+    if (hook_count_.load(std::memory_order_acquire) == 0) return;
+    std::shared_lock<std::shared_mutex> lock(hook_mux_);
+    for (auto& [id, hook] : publish_hooks_) hook();
+  }
+
+  /// Copies the event at index to out. Moves index to the oldest event that
+  /// is still stored if it was overwritten. Returns false if the event was
+  /// not published yet.
+  bool ReadAt(size_t& index, T& out) {
+    std::shared_lock<std::shared_mutex> lock(mux_);
+    size_t writer_index = writer_index_.load(std::memory_order_relaxed);
+    if (index >= writer_index) return false;
+    if (writer_index - index > kCapacity) index = writer_index - kCapacity;
+    out = slots_[index & (kCapacity - 1)];
+    return true;
+  }
+
+  /// Copies the latest event to out and sets index to its index.
+  bool ReadLatest(size_t& index, T& out) {
+    std::shared_lock<std::shared_mutex> lock(mux_);
+    size_t writer_index = writer_index_.load(std::memory_order_relaxed);
+    if (writer_index == 0) return false;
+    index = writer_index - 1;
+    out = slots_[index & (kCapacity - 1)];
+    return true;
+  }
+
+  bool TryReadLatestValue(size_t& index, T& out) {
+    static_assert(kHasLatestValue,
+                  "TryReadLatestValue() needs a trivially copyable type");
+    if (writer_index_.load(std::memory_order_acquire) == 0) return false;
+    LatestValue latest = latest_value_.Load();
+    out = latest.value;
+    index = latest.index;
+    return true;
+  }
+
+  bool WaitForEvent(size_t index, std::chrono::milliseconds timeout) {
+    std::shared_lock<std::shared_mutex> lock(mux_);
+    waiters_.fetch_add(1, std::memory_order_relaxed);
+    bool received = cv_.wait_for(lock, timeout, [&]() {
+      return index < writer_index_.load(std::memory_order_relaxed);
+    });
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return received;
+  }
+
+  PublishHookId AddPublishHook(std::function<void()> hook) {
+    std::unique_lock<std::shared_mutex> lock(hook_mux_);
+    PublishHookId id = next_hook_id_++;
+    publish_hooks_.emplace_back(id, std::move(hook));
+    hook_count_.store(publish_hooks_.size(), std::memory_order_release);
+    return id;
+  }
+
+  /// Waits for Publish() to finish running the hooks, which holds hook_mux_
+  /// shared.
+  bool RemovePublishHook(PublishHookId id) {
+    std::unique_lock<std::shared_mutex> lock(hook_mux_);
+    auto it = std::find_if(publish_hooks_.begin(), publish_hooks_.end(),
+                           [id](const auto& hook) { return hook.first == id; });
+    if (it == publish_hooks_.end()) return false;
+    publish_hooks_.erase(it);
+    hook_count_.store(publish_hooks_.size(), std::memory_order_release);
+    return true;
+  }
+
+  inline const size_t get_writer_index() const {
+    return writer_index_.load(std::memory_order_acquire);
+  }
+
+ private:
+  struct LatestValue {
+    T value;
+    size_t index;
+  };
+
+  std::shared_mutex mux_;
+  std::condition_variable_any cv_;
+  /// Threads in WaitForEvent(), Publish() only notifies if there are any.
+  std::atomic<size_t> waiters_{0};
+  std::array<T, kCapacity> slots_{};
+  [[no_unique_address]] std::conditional_t<
+      kHasLatestValue, SeqLock<LatestValue>, std::monostate> latest_value_;
+  /// Read by polling Listeners without a lock, so it gets its own cache line.
+  alignas(64) std::atomic<size_t> writer_index_{0};
+
+  std::shared_mutex hook_mux_;
+  std::vector<std::pair<PublishHookId, std::function<void()>>>
+      publish_hooks_;
+  PublishHookId next_hook_id_ = 1;
+  std::atomic<size_t> hook_count_{0};
+};
+}  // namespace internal
+
+/// Publishes on one channel of a StaticEventBus. Cheap to copy, must not
+/// outlive the bus.
+template <typename Channel>
+class StaticPublisher {
+ public:
+  using T = typename Channel::Type;
+
+  explicit StaticPublisher(internal::StaticChannelStorage<Channel>& storage)
+      : storage_(&storage) {}
+
+  bool Publish(const T& value) {
+    storage_->Publish(value);
+    return true;
+  }
+  /// Same as Publish(const T&) for code written against Publisher<T>. The
+  /// data of the event is copied.
+  bool Publish(std::unique_ptr<const Event<T>> event) {
+    const T* data = event ? event->template GetData<T>() : nullptr;
+    if (data == nullptr) return false;
+    return Publish(*data);
+  }
+
+  inline const size_t get_writer_index() const {
+    return storage_->get_writer_index();
+  }
+  inline const ChannelIdType get_channel_id() const { return Channel::kId; }
+
+ private:
+  internal::StaticChannelStorage<Channel>* storage_;
+};
+
+/// Reads one channel of a StaticEventBus. Every StaticListener has its own
+/// read index, a Listener that falls behind by more than the capacity of the
+/// channel skips the events that were overwritten. Must not outlive the bus
+/// and must only be used by one thread at a time.
+template <typename Channel>
+class StaticListener {
+ public:
+  using T = typename Channel::Type;
+
+  explicit StaticListener(internal::StaticChannelStorage<Channel>& storage)
+      : storage_(&storage) {}
+
+  /// Copies the oldest unread event to out and marks it as read. Returns
+  /// false if there are no unread events.
+  bool ReadNext(T& out) {
+    if (!storage_->ReadAt(read_index_, out)) return false;
+    read_index_++;
+    return true;
+  }
+  /// Copies the latest event to out and marks all events up to it as read.
+  bool ReadLatest(T& out) {
+    if (!storage_->ReadLatest(read_index_, out)) return false;
+    read_index_++;
+    return true;
+  }
+  /// Lock free ReadLatest() for trivially copyable types.
+  bool TryReadLatestValue(T& out) {
+    size_t index;
+    if (!storage_->TryReadLatestValue(index, out)) return false;
+    read_index_ = index + 1;
+    return true;
+  }
+
+  inline bool HasReceivedEvent() const {
+    return read_index_ < storage_->get_writer_index();
+  }
+  /// Blocks until HasReceivedEvent() would return true or the timeout
+  /// expired.
+  bool WaitForEvent(std::chrono::milliseconds timeout) {
+    return storage_->WaitForEvent(read_index_, timeout);
+  }
+
+  // Getters and Setters
+  inline const size_t get_read_index() const { return read_index_; }
+  inline const ChannelIdType get_channel_id() const { return Channel::kId; }
+  inline void set_read_index(size_t index) { read_index_ = index; }
+
+ private:
+  internal::StaticChannelStorage<Channel>* storage_;
+  size_t read_index_ = 0;
+};
+
+/// StaticEventBus is the counterpart of EventBus for topologies that are
+/// known at compile time. The channels are a type list and their storage is
+/// a std::tuple inside the bus, so finding a channel is resolved by the
+/// compiler and publishing neither allocates nor looks anything up. Events
+/// are stored by value in a ring buffer of capacity events per channel.
+/// StaticPublisher and StaticListener mirror the interface of Publisher and
+/// Listener. Usage:
+///       using Bus = StaticEventBus<StaticChannel<channels::kBackendPing, int>,
+///                                  StaticChannel<channels::kHabitCheckIn,
+///                                                CheckIn, 1024>>;
+///       auto bus = std::make_unique<Bus>();
+///       auto publisher = bus->RegisterPublisher<channels::kHabitCheckIn>();
+///       auto listener = bus->SubscribeTo<channels::kHabitCheckIn>();
+///       publisher.Publish(CheckIn{habit, Today(), true});
+///       CheckIn check_in;
+///       while (listener.ReadNext(check_in)) ...
+/// NOTE: The bus is not movable since Publishers and Listeners point into it,
+/// allocate it once, e.g. with std::make_unique.
+template <typename... Channels>
+class StaticEventBus {
+ public:
+  StaticEventBus() = default;
+
+  StaticEventBus(const StaticEventBus&) = delete;
+  const StaticEventBus& operator=(const StaticEventBus&) = delete;
+
+  /// Position of the channel with Id in the type list.
+  template <ChannelIdType Id>
+  static constexpr size_t IndexOf() {
+    constexpr ChannelIdType ids[] = {Channels::kId...};
+    size_t index = 0;
+    while (index < sizeof...(Channels) && ids[index] != Id) index++;
+    return index;
+  }
+
+  template <ChannelIdType Id>
+  using ChannelOf =
+      std::tuple_element_t<IndexOf<Id>(), std::tuple<Channels...>>;
+
+  template <ChannelIdType Id>
+  StaticPublisher<ChannelOf<Id>> RegisterPublisher() {
+    return StaticPublisher<ChannelOf<Id>>(GetStorage<Id>());
+  }
+
+  template <ChannelIdType Id>
+  StaticListener<ChannelOf<Id>> SubscribeTo() {
+    return StaticListener<ChannelOf<Id>>(GetStorage<Id>());
+  }
+
+  /// See EventBus::AddPublishHook().
+  template <ChannelIdType Id>
+  PublishHookId AddPublishHook(std::function<void()> hook) {
+    return GetStorage<Id>().AddPublishHook(std::move(hook));
+  }
+  /// See EventBus::RemovePublishHook().
+  template <ChannelIdType Id>
+  bool RemovePublishHook(PublishHookId id) {
+    return GetStorage<Id>().RemovePublishHook(id);
+  }
+
+  static constexpr size_t GetChannelCount() { return sizeof...(Channels); }
+
+ private:
+  static constexpr bool HasUniqueIds() {
+    constexpr ChannelIdType ids[] = {Channels::kId...};
+    for (size_t i = 0; i < sizeof...(Channels); i++) {
+      for (size_t j = i + 1; j < sizeof...(Channels); j++) {
+        if (ids[i] == ids[j]) return false;
+      }
+    }
+    return true;
+  }
+  static_assert(sizeof...(Channels) > 0, "StaticEventBus needs a channel");
+  static_assert(HasUniqueIds(), "Channel ids must be unique");
+
+  template <ChannelIdType Id>
+  internal::StaticChannelStorage<ChannelOf<Id>>& GetStorage() {
+    static_assert(IndexOf<Id>() < sizeof...(Channels),
+                  "The StaticEventBus has no channel with this id");
+    return std::get<IndexOf<Id>()>(storage_);
+  }
+
+ private:
+  std::tuple<internal::StaticChannelStorage<Channels>...> storage_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_EVENT_BUS_STATIC_EVENT_BUS_H_
@@ -0,0 +1,184 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/habits/bitset_kernels.h"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace habitify_core::kernels {
+namespace {
+/// Returns the bits [first_bit, first_bit + count) of the bitset in the low
+/// bits of the result. count has to be at most 64.
+inline uint64_t ExtractBits(const uint64_t *words, size_t word_count,
+                            size_t first_bit, size_t count) {
+  if (count == 0) return 0;
+  size_t word = first_bit / 64, shift = first_bit % 64;
+  uint64_t low = word < word_count ? words[word] >> shift : 0;
+  uint64_t high = (shift != 0 && word + 1 < word_count)
+                      ? words[word + 1] << (64 - shift)
+                      : 0;
+  uint64_t mask = count == 64 ? ~0ull : (1ull << count) - 1;
+  return (low | high) & mask;
+}
+
+#if defined(__AVX2__)
+/// Counts nibbles with a shuffle lookup table and sums the bytes with SAD,
+/// see Mula et al., "Faster Population Counts Using AVX2 Instructions".
+size_t CountBitsAvx2(const uint64_t *words, size_t word_count) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for (; i + 4 <= word_count; i += 4) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+    __m256i low = _mm256_and_si256(v, low_mask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                    _mm256_shuffle_epi8(lookup, high));
+    total = _mm256_add_epi64(total,
+                             _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  }
+
+  size_t count = (size_t)_mm256_extract_epi64(total, 0) +
+                 (size_t)_mm256_extract_epi64(total, 1) +
+                 (size_t)_mm256_extract_epi64(total, 2) +
+                 (size_t)_mm256_extract_epi64(total, 3);
+  for (; i < word_count; i++) count += std::popcount(words[i]);
+  return count;
+}
+#endif
+}  // namespace
+
+size_t CountBits(const uint64_t *words, size_t word_count) {
+#if defined(__AVX2__)
+  return CountBitsAvx2(words, word_count);
+#else
+  // Compiles to popcnt where available and is vectorized by the compiler.
+  size_t count = 0;
+  for (size_t i = 0; i < word_count; i++) count += std::popcount(words[i]);
+  return count;
+#endif
+}
+
+size_t CountBitsInRange(const uint64_t *words, size_t word_count,
+                        size_t first_bit, size_t last_bit) {
+  last_bit = std::min(last_bit, word_count * 64);
+  if (first_bit >= last_bit) return 0;
+
+  size_t first_word = (first_bit + 63) / 64, last_word = last_bit / 64;
+  if (first_word >= last_word) {
+    // The range lies within one or two words.
+    size_t count = 0;
+    for (size_t bit = first_bit; bit < last_bit; bit += 64) {
+      count += std::popcount(ExtractBits(words, word_count, bit,
+                                         std::min<size_t>(64, last_bit - bit)));
+    }
+    return count;
+  }
+
+  return std::popcount(ExtractBits(words, word_count, first_bit,
+                                   first_word * 64 - first_bit)) +
+         CountBits(words + first_word, last_word - first_word) +
+         std::popcount(ExtractBits(words, word_count, last_word * 64,
+                                   last_bit - last_word * 64));
+}
+
+size_t RunEndingAt(const uint64_t *words, size_t word_count, size_t end_bit) {
+  // The bits after the stored words are zero, so no run can end there.
+  if (end_bit > word_count * 64) return 0;
+  size_t run = 0;
+
+  // Mask off the bits after end_bit in the first word, then go back in time
+  // one word at a time.
+  size_t word = end_bit / 64, used = end_bit % 64;
+  if (used != 0) {
+    uint64_t bits = words[word] << (64 - used);
+    size_t ones = std::countl_one(bits);
+    if (ones < used) return ones;
+    run = used;
+  }
+  while (word > 0) {
+    size_t ones = std::countl_one(words[--word]);
+    run += ones;
+    if (ones < 64) break;
+  }
+  return run;
+}
+
+size_t RunStartingAt(const uint64_t *words, size_t word_count,
+                     size_t first_bit) {
+  if (first_bit >= word_count * 64) return 0;
+  size_t run = 0;
+
+  // Skip the bits before first_bit in the first word, then go forward in
+  // time one word at a time.
+  size_t word = first_bit / 64, skipped = first_bit % 64;
+  if (skipped != 0) {
+    size_t ones = std::countr_one(words[word] >> skipped);
+    if (ones < 64 - skipped) return ones;
+    run = 64 - skipped;
+    word++;
+  }
+  for (; word < word_count; word++) {
+    size_t ones = std::countr_one(words[word]);
+    run += ones;
+    if (ones < 64) break;
+  }
+  return run;
+}
+
+size_t LongestRun(const uint64_t *words, size_t word_count) {
+  size_t longest = 0, run = 0;
+  for (size_t i = 0; i < word_count; i++) {
+    uint64_t word = words[i];
+
+    // A run may continue from the previous word into the low bits. For a full
+    // word this is a lower bound of the final run, which is fine.
+    longest = std::max(longest, run + std::countr_one(word));
+
+    // The longest run inside the word: every step shortens all runs by one.
+    // Only needed if the word has enough bits set to beat the longest run.
+    if ((size_t)std::popcount(word) > longest) {
+      uint64_t inner = word;
+      size_t inner_run = 0;
+      while (inner) {
+        inner &= inner << 1;
+        inner_run++;
+      }
+      longest = std::max(longest, inner_run);
+    }
+
+    // A full word extends the run, otherwise the run restarts at the high
+    // bits. Masked instead of branched, full words and gaps are equally
+    // likely.
+    size_t keep = (size_t)0 - (size_t)(word == ~0ull);
+    run = std::countl_one(word) + (run & keep);
+  }
+  return std::max(longest, run);
+}
+
+}  // namespace habitify_core::kernels
@@ -0,0 +1,49 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_HABITS_BITSET_KERNELS_H_
+#define HABITIFY_SRC_CORE_HABITS_BITSET_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/// Kernels over packed day bitsets. Bit i of a bitset is bit i % 64 of word
+/// i / 64, so later days are in higher bits. All ranges are half open and
+/// bits outside of [0, word_count * 64) count as zero.
+namespace habitify_core::kernels {
+
+/// Number of set bits. Uses AVX2 if the translation unit is compiled with it.
+size_t CountBits(const uint64_t *words, size_t word_count);
+
+/// Number of set bits in [first_bit, last_bit).
+size_t CountBitsInRange(const uint64_t *words, size_t word_count,
+                        size_t first_bit, size_t last_bit);
+
+/// Length of the run of set bits that ends with bit end_bit - 1.
+size_t RunEndingAt(const uint64_t *words, size_t word_count, size_t end_bit);
+
+/// Length of the run of set bits that starts with bit first_bit.
+size_t RunStartingAt(const uint64_t *words, size_t word_count,
+                     size_t first_bit);
+
+/// Length of the longest run of set bits.
+size_t LongestRun(const uint64_t *words, size_t word_count);
+
+}  // namespace habitify_core::kernels
+
+#endif  // HABITIFY_SRC_CORE_HABITS_BITSET_KERNELS_H_
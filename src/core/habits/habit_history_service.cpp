@@ -0,0 +1,120 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/habits/habit_history_service.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "src/core/event_bus/channels.h"
+
+namespace habitify_core {
+void InMemoryHabitHistory::Append(const HistoryRow &row) {
+  std::unique_lock<std::shared_mutex> lock(mux_);
+  rows_.push_back(row);
+}
+
+void InMemoryHabitHistory::Append(std::span<const HistoryRow> rows) {
+  std::unique_lock<std::shared_mutex> lock(mux_);
+  rows_.insert(rows_.end(), rows.begin(), rows.end());
+}
+
+size_t InMemoryHabitHistory::GetRowCount() const {
+  std::shared_lock<std::shared_mutex> lock(mux_);
+  return rows_.size();
+}
+
+void InMemoryHabitHistory::ReadRows(size_t first_row, size_t count,
+                                    std::pmr::vector<HistoryRow> &out) const {
+  std::shared_lock<std::shared_mutex> lock(mux_);
+  if (first_row >= rows_.size()) return;
+  size_t last_row = std::min(rows_.size(), first_row + count);
+  out.insert(out.end(), rows_.begin() + first_row, rows_.begin() + last_row);
+}
+
+HabitHistoryService::HabitHistoryService(
+    std::shared_ptr<EventBus> event_bus,
+    std::shared_ptr<const HabitHistorySource> source)
+    : event_bus_(event_bus), source_(source) {
+  requests_ = event_bus_->SubscribeTo(channels::kHabitHistoryRequest);
+  pages_ =
+      event_bus_->RegisterPublisher<HistoryPage>(channels::kHabitHistoryPage);
+}
+
+HabitHistoryService::~HabitHistoryService() { Stop(); }
+
+void HabitHistoryService::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread([this]() {
+    while (running_) {
+      if (!Poll()) requests_->WaitForEvent(kIdleTimeout);
+    }
+  });
+}
+
+void HabitHistoryService::Start(Executor &executor) {
+  if (running_.exchange(true)) return;
+  task_ = std::make_unique<PollingTask>(
+      executor, [this]() { return Poll(); }, kIdleTimeout);
+  hook_id_ = event_bus_->AddPublishHook(channels::kHabitHistoryRequest,
+                                        task_->GetNotifier());
+  task_->Start();
+}
+
+void HabitHistoryService::Stop() {
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+  if (task_) {
+    event_bus_->RemovePublishHook(channels::kHabitHistoryRequest, hook_id_);
+    task_->Stop();
+    task_.reset();
+  }
+}
+
+bool HabitHistoryService::Poll() {
+  bool published = false;
+
+  HistoryPageRequest request;
+  if (requests_->HasReceivedEvent() && requests_->TryReadLatestValue(request)) {
+    PublishPage(request.request_id, request.first_row,
+                std::min(request.row_count, kMaxPageRows));
+    published = true;
+  }
+
+  if (source_->GetRowCount() != announced_rows_) {
+    PublishPage(0, 0, 0);
+    published = true;
+  }
+  return published;
+}
+
+void HabitHistoryService::PublishPage(uint64_t request_id, size_t first_row,
+                                      size_t count) {
+  auto page = MakePayload<HistoryPage>();
+  page->request_id = request_id;
+  page->first_row = first_row;
+  page->rows.reserve(count);
+  source_->ReadRows(first_row, count, page->rows);
+  page->total_rows = source_->GetRowCount();
+  announced_rows_ = page->total_rows;
+
+  pages_->Publish(std::make_unique<const Event<HistoryPage>>(
+      EventType::HABIT_HISTORY_PAGE, channels::kHabitHistoryPage, page));
+}
+
+}  // namespace habitify_core
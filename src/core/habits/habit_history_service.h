@@ -0,0 +1,117 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_HABITS_HABIT_HISTORY_SERVICE_H_
+#define HABITIFY_SRC_CORE_HABITS_HABIT_HISTORY_SERVICE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+
+/// HabitHistorySource provides random access to the habit history. Rows are
+/// ordered oldest first. Implementations need to be thread safe.
+class HabitHistorySource {
+ public:
+  virtual ~HabitHistorySource() = default;
+
+  virtual size_t GetRowCount() const = 0;
+  /// Appends up to count rows starting at first_row to out.
+  virtual void ReadRows(size_t first_row, size_t count,
+                        std::pmr::vector<HistoryRow> &out) const = 0;
+};
+
+/// Append only HabitHistorySource that keeps every row in memory.
+class InMemoryHabitHistory : public HabitHistorySource {
+ public:
+  void Append(const HistoryRow &row);
+  /// Appends all rows under a single lock.
+  void Append(std::span<const HistoryRow> rows);
+
+  size_t GetRowCount() const override;
+  void ReadRows(size_t first_row, size_t count,
+                std::pmr::vector<HistoryRow> &out) const override;
+
+ private:
+  mutable std::shared_mutex mux_;
+  std::vector<HistoryRow> rows_;
+};
+
+/// HabitHistoryService serves pages of the habit history over the EventBus.
+/// It answers the latest HistoryPageRequest on channels::kHabitHistoryRequest
+/// with a HistoryPage on channels::kHabitHistoryPage. Requests that were
+/// superseded before they were handled are dropped, which is what a
+/// scrolling frontend wants. Changes of the total row count are announced
+/// with an unsolicited page. Usage:
+///       HabitHistoryService service(event_bus, history);
+///       service.Start();
+class HabitHistoryService {
+ public:
+  /// Upper bound for the rows of a single page to keep answers small.
+  static constexpr size_t kMaxPageRows = 4096;
+
+  HabitHistoryService(std::shared_ptr<EventBus> event_bus,
+                      std::shared_ptr<const HabitHistorySource> source);
+  ~HabitHistoryService();
+
+  HabitHistoryService(const HabitHistoryService &) = delete;
+  const HabitHistoryService &operator=(const HabitHistoryService &) = delete;
+
+  /// Runs Poll() on a dedicated thread until Stop() is called.
+  void Start();
+  /// Runs Poll() as a PollingTask on executor until Stop() is called. The
+  /// task is woken up by new requests and runs at least every kIdleTimeout.
+  void Start(Executor &executor);
+  void Stop();
+
+  /// Answers the latest pending request and announces a changed row count.
+  /// Returns true if anything was published.
+  bool Poll();
+
+ private:
+  void PublishPage(uint64_t request_id, size_t first_row, size_t count);
+
+ private:
+  static constexpr std::chrono::milliseconds kIdleTimeout{100};
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<const HabitHistorySource> source_;
+  std::shared_ptr<Listener> requests_;
+  std::shared_ptr<Publisher<HistoryPage>> pages_;
+  size_t announced_rows_ = 0;
+
+  std::atomic<bool> running_ = false;
+  std::thread thread_;
+  std::unique_ptr<PollingTask> task_;
+  PublishHookId hook_id_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_HABITS_HABIT_HISTORY_SERVICE_H_
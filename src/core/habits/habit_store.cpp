@@ -0,0 +1,252 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/habits/habit_store.h"
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/habits/bitset_kernels.h"
+
+namespace habitify_core {
+namespace {
+inline Day AlignDown(Day day) { return day - (((day % 64) + 64) % 64); }
+}  // namespace
+
+bool HabitTable::AddHabit(HabitId id) {
+  if (HasHabit(id)) return false;
+
+  index_.emplace(id, ids_.size());
+  ids_.push_back(id);
+  columns_.emplace_back(GetMemoryResource(MemoryTag::kStore));
+  completion_counts_.push_back(0);
+  return true;
+}
+
+bool HabitTable::Set(HabitId id, Day day, bool completed) {
+  AddHabit(id);
+  if (!has_base_day_) {
+    base_day_ = AlignDown(day);
+    has_base_day_ = true;
+  } else if (day < base_day_) {
+    Rebase(day);
+  }
+
+  size_t column = index_.at(id);
+  size_t bit = (size_t)(day - base_day_);
+  auto &words = columns_[column];
+  if (bit / 64 >= words.size()) {
+    if (!completed) return false;
+    words.resize(std::max(bit / 64 + 1, words.size() + kGrowthWords), 0);
+  }
+
+  uint64_t mask = 1ull << (bit % 64);
+  bool was_completed = (words[bit / 64] & mask) != 0;
+  if (was_completed == completed) return false;
+
+  words[bit / 64] ^= mask;
+  completed ? completion_counts_[column]++ : completion_counts_[column]--;
+  return true;
+}
+
+bool HabitTable::IsCompleted(HabitId id, Day day) const {
+  auto words = GetColumn(id);
+  if (day < base_day_) return false;
+
+  size_t bit = (size_t)(day - base_day_);
+  return bit / 64 < words.size() && (words[bit / 64] >> (bit % 64)) & 1;
+}
+
+size_t HabitTable::CountCompletions(HabitId id) const {
+  auto it = index_.find(id);
+  return it == index_.end() ? 0 : completion_counts_[it->second];
+}
+
+size_t HabitTable::CountCompletions(HabitId id, Day first_day,
+                                    Day last_day) const {
+  auto words = GetColumn(id);
+  return kernels::CountBitsInRange(words.data(), words.size(),
+                                   ClampedBit(first_day), ClampedBit(last_day));
+}
+
+size_t HabitTable::CurrentStreak(HabitId id, Day today) const {
+  auto words = GetColumn(id);
+  if (today < base_day_) return 0;
+
+  size_t end_bit = ClampedBit(today + 1);
+  if (!IsCompleted(id, today)) end_bit = ClampedBit(today);
+  return kernels::RunEndingAt(words.data(), words.size(), end_bit);
+}
+
+size_t HabitTable::LongestStreak(HabitId id) const {
+  auto words = GetColumn(id);
+  return kernels::LongestRun(words.data(), words.size());
+}
+
+void HabitTable::WeeklyRates(HabitId id, Day first_day, size_t weeks,
+                             std::vector<float> &out) const {
+  out.resize(weeks);
+  for (size_t week = 0; week < weeks; week++) {
+    Day begin = first_day + (Day)(week * 7);
+    out[week] = CountCompletions(id, begin, begin + 7) / 7.0f;
+  }
+}
+
+void HabitTable::MonthlyRates(HabitId id, int year, unsigned month,
+                              size_t months, std::vector<float> &out) const {
+  out.resize(months);
+  Day begin = DaysFromCivil(year, month, 1);
+  for (size_t i = 0; i < months; i++) {
+    if (++month > 12) {
+      month = 1;
+      year++;
+    }
+    Day end = DaysFromCivil(year, month, 1);
+    out[i] = (float)CountCompletions(id, begin, end) / (end - begin);
+    begin = end;
+  }
+}
+
+void HabitTable::BuildAggregates(HabitAggregates &out) const {
+  size_t word_count = 0;
+  for (const auto &words : columns_) {
+    word_count = std::max(word_count, words.size());
+  }
+
+  out.first_day = base_day_;
+  out.habit_count = (int)ids_.size();
+  out.completions.assign(word_count * 64, 0);
+  for (const auto &words : columns_) {
+    for (size_t i = 0; i < words.size(); i++) {
+      // Visit only the set bits, most days of most habits are empty.
+      for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+        out.completions[i * 64 + std::countr_zero(word)]++;
+      }
+    }
+  }
+
+  while (!out.completions.empty() && out.completions.back() == 0) {
+    out.completions.pop_back();
+  }
+}
+
+std::span<const uint64_t> HabitTable::GetColumn(HabitId id) const {
+  auto it = index_.find(id);
+  if (it == index_.end()) return {};
+  return columns_[it->second];
+}
+
+void HabitTable::Rebase(Day day) {
+  Day new_base = AlignDown(day);
+  size_t shift = (size_t)(base_day_ - new_base) / 64;
+  for (auto &words : columns_) {
+    if (!words.empty()) words.insert(words.begin(), shift, 0);
+  }
+  base_day_ = new_base;
+}
+
+size_t HabitTable::ClampedBit(Day day) const {
+  return day <= base_day_ ? 0 : (size_t)(day - base_day_);
+}
+
+void FoldCheckIn(CheckInSnapshot &snapshot, const CheckIn &check_in) {
+  HabitAggregates &aggregates = snapshot.aggregates;
+  std::vector<uint16_t> &completions = aggregates.completions;
+  if (completions.empty()) {
+    aggregates.first_day = check_in.day;
+  } else if (check_in.day < aggregates.first_day) {
+    completions.insert(completions.begin(),
+                       (size_t)(aggregates.first_day - check_in.day), 0);
+    aggregates.first_day = check_in.day;
+  }
+  size_t offset = (size_t)(check_in.day - aggregates.first_day);
+  if (offset >= completions.size()) completions.resize(offset + 1, 0);
+
+  if (check_in.completed) {
+    completions[offset]++;
+  } else if (completions[offset] > 0) {
+    completions[offset]--;
+  }
+  aggregates.checkin_count++;
+
+  auto habit = std::lower_bound(snapshot.habit_ids.begin(),
+                                snapshot.habit_ids.end(), check_in.habit_id);
+  if (habit == snapshot.habit_ids.end() || *habit != check_in.habit_id) {
+    snapshot.habit_ids.insert(habit, check_in.habit_id);
+    aggregates.habit_count = (int)snapshot.habit_ids.size();
+  }
+}
+
+HabitStore::HabitStore(std::shared_ptr<EventBus> event_bus)
+    : event_bus_(event_bus) {
+  checkins_ = event_bus_->RegisterPublisher<CheckIn>(channels::kHabitCheckIn);
+  checkins_->SetReducer<CheckInSnapshot>(FoldCheckIn);
+  aggregates_ = event_bus_->RegisterPublisher<HabitAggregates>(
+      channels::kHabitAggregates);
+}
+
+bool HabitStore::AddHabit(HabitId id) {
+  std::unique_lock<std::shared_mutex> lock(mux_);
+  return table_.AddHabit(id);
+}
+
+bool HabitStore::SetCompleted(HabitId id, Day day, bool completed) {
+  std::unique_lock<std::shared_mutex> lock(mux_);
+  if (!table_.Set(id, day, completed)) return false;
+
+  // Published under the lock so that the order of the check-ins matches the
+  // order of the changes.
+  auto check_in = MakePayload<CheckIn>();
+  check_in->habit_id = id;
+  check_in->day = day;
+  check_in->completed = completed;
+  checkins_->Publish(std::make_unique<const Event<CheckIn>>(
+      EventType::HABIT_CHECK_IN, channels::kHabitCheckIn, check_in));
+  return true;
+}
+
+size_t HabitStore::Apply(std::span<const CheckIn> check_ins) {
+  std::unique_lock<std::shared_mutex> lock(mux_);
+  size_t changes = 0;
+  for (const CheckIn &change : check_ins) {
+    if (!table_.Set(change.habit_id, change.day, change.completed)) continue;
+    auto check_in = MakePayload<CheckIn>(change);
+    checkins_->Publish(std::make_unique<const Event<CheckIn>>(
+        EventType::HABIT_CHECK_IN, channels::kHabitCheckIn, check_in));
+    changes++;
+  }
+  return changes;
+}
+
+void HabitStore::PublishAggregates() {
+  auto aggregates = MakePayload<HabitAggregates>();
+  {
+    // Check-ins are only published under the unique lock, so the count
+    // matches the table.
+    std::shared_lock<std::shared_mutex> lock(mux_);
+    table_.BuildAggregates(*aggregates);
+    aggregates->checkin_count = checkins_->get_writer_index();
+  }
+  aggregates_->Publish(std::make_unique<const Event<HabitAggregates>>(
+      EventType::HABIT_AGGREGATES, channels::kHabitAggregates, aggregates));
+}
+
+}  // namespace habitify_core
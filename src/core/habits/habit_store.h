@@ -0,0 +1,181 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_HABITS_HABIT_STORE_H_
+#define HABITIFY_SRC_CORE_HABITS_HABIT_STORE_H_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/metrics/memory_tracking.h"
+
+namespace habitify_core {
+
+/// HabitTable stores the completions of every habit as one bitset column per
+/// habit, one bit per day. All columns start at the same base day, which is
+/// a multiple of 64, so word i of every column covers the same days and
+/// columns can be combined word by word. Statistics run on the packed words
+/// through the kernels in bitset_kernels.h.
+/// NOTE: HabitTable is not thread safe. Use HabitStore to share it.
+class HabitTable {
+ public:
+  /// Columns grow by at least this many words (512 days) at a time.
+  static constexpr size_t kGrowthWords = 8;
+
+  /// Returns false if the habit already exists.
+  bool AddHabit(HabitId id);
+  bool HasHabit(HabitId id) const { return index_.count(id) != 0; }
+  size_t GetHabitCount() const { return ids_.size(); }
+
+  /// Marks day as completed or not completed and adds the habit if it does
+  /// not exist yet. Returns true if the state changed.
+  bool Set(HabitId id, Day day, bool completed);
+  bool IsCompleted(HabitId id, Day day) const;
+
+  /// Number of completed days over the whole history.
+  size_t CountCompletions(HabitId id) const;
+  /// Number of completed days in [first_day, last_day).
+  size_t CountCompletions(HabitId id, Day first_day, Day last_day) const;
+  /// Number of consecutive completed days up to today. If today is not
+  /// completed yet the streak up to yesterday is still current.
+  size_t CurrentStreak(HabitId id, Day today) const;
+  size_t LongestStreak(HabitId id) const;
+
+  /// Calls f(day) for every completed day in [first_day, last_day) in
+  /// order. Only the words that cover the range are read.
+  template <typename F>
+  void ForEachCompletion(HabitId id, Day first_day, Day last_day,
+                         F &&f) const {
+    auto words = GetColumn(id);
+    size_t first_bit = ClampedBit(first_day);
+    size_t last_bit = std::min(ClampedBit(last_day), words.size() * 64);
+    if (first_bit >= last_bit) return;
+
+    size_t first_word = first_bit / 64, last_word = (last_bit - 1) / 64;
+    for (size_t word = first_word; word <= last_word; word++) {
+      uint64_t bits = words[word];
+      if (word == first_word) bits &= ~uint64_t(0) << (first_bit % 64);
+      if (word == last_word) {
+        bits &= ~uint64_t(0) >> (63 - (last_bit - 1) % 64);
+      }
+      while (bits != 0) {
+        f(base_day_ + (Day)(word * 64 + (size_t)std::countr_zero(bits)));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  /// Completed days divided by the days of each period. Writes weeks rates
+  /// of consecutive weeks starting at first_day to out.
+  void WeeklyRates(HabitId id, Day first_day, size_t weeks,
+                   std::vector<float> &out) const;
+  /// Writes the rates of months consecutive calendar months starting at
+  /// year-month to out.
+  void MonthlyRates(HabitId id, int year, unsigned month, size_t months,
+                    std::vector<float> &out) const;
+
+  /// Sums up the completions of all habits per day.
+  void BuildAggregates(HabitAggregates &out) const;
+
+  /// The raw column of a habit. Bit i stands for get_base_day() + i. Empty if
+  /// the habit does not exist.
+  std::span<const uint64_t> GetColumn(HabitId id) const;
+
+  // Getters
+  inline const Day get_base_day() const { return base_day_; }
+  inline const std::vector<HabitId> &get_habit_ids() const { return ids_; }
+
+ private:
+  /// Moves base_day_ back so that day can be stored.
+  void Rebase(Day day);
+  /// Bit of day in the columns, clamped to [0, max) for range queries.
+  size_t ClampedBit(Day day) const;
+
+ private:
+  std::unordered_map<HabitId, size_t> index_;
+  std::vector<HabitId> ids_;
+  /// Allocated on the resource of MemoryTag::kStore.
+  std::vector<std::pmr::vector<uint64_t>> columns_;
+  std::vector<size_t> completion_counts_;
+  Day base_day_ = 0;
+  bool has_base_day_ = false;
+};
+
+/// Reducer of channels::kHabitCheckIn that HabitStore installs, so that new
+/// Listeners can start from a CheckInSnapshot instead of every check-in.
+void FoldCheckIn(CheckInSnapshot &snapshot, const CheckIn &check_in);
+
+/// HabitStore shares a HabitTable between threads and announces every change
+/// on the EventBus. Changes are published as CheckIn on
+/// channels::kHabitCheckIn in the order they were applied and folded into a
+/// CheckInSnapshot for Listeners that join later. Usage:
+///       HabitStore store(event_bus);
+///       store.SetCompleted(habit, Today(), true);
+///       size_t streak = store.Read([&](const HabitTable &table) {
+///         return table.CurrentStreak(habit, Today());
+///       });
+class HabitStore {
+ public:
+  explicit HabitStore(std::shared_ptr<EventBus> event_bus);
+  ~HabitStore() = default;
+
+  HabitStore(const HabitStore &) = delete;
+  const HabitStore &operator=(const HabitStore &) = delete;
+
+  bool AddHabit(HabitId id);
+  /// Publishes a CheckIn if the state changed. Returns true in that case.
+  bool SetCompleted(HabitId id, Day day, bool completed);
+  /// Applies all check_ins under a single lock, for example while importing
+  /// the history. Publishes a CheckIn for every change and returns their
+  /// number.
+  size_t Apply(std::span<const CheckIn> check_ins);
+
+  /// Runs reader with shared access to the table and returns its result.
+  template <typename Reader>
+  auto Read(Reader &&reader) const {
+    std::shared_lock<std::shared_mutex> lock(mux_);
+    return reader(static_cast<const HabitTable &>(table_));
+  }
+
+  /// Publishes the completions per day of all habits on
+  /// channels::kHabitAggregates. Listeners apply the check-ins after
+  /// HabitAggregates::checkin_count on top of it.
+  void PublishAggregates();
+
+ private:
+  mutable std::shared_mutex mux_;
+  HabitTable table_;
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Publisher<CheckIn>> checkins_;
+  std::shared_ptr<Publisher<HabitAggregates>> aggregates_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_HABITS_HABIT_STORE_H_
@@ -0,0 +1,300 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+/// Basic types shared by everything that stores, transports or displays
+/// habits.
+
+#ifndef HABITIFY_SRC_CORE_HABITS_HABIT_TYPES_H_
+#define HABITIFY_SRC_CORE_HABITS_HABIT_TYPES_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace habitify_core {
+
+using HabitId = int32_t;
+/// Days since 1970-01-01 as a calendar date, i.e. the date a check-in
+/// belongs to in the time zone of the user. See Today().
+using Day = int32_t;
+
+/// Returns 0 for Monday up to 6 for Sunday.
+inline int Weekday(Day day) { return ((day % 7) + 7 + 3) % 7; }
+
+/// Converts a Day into a calendar date. Based on Howard Hinnant's
+/// civil_from_days algorithm which is valid for the proleptic Gregorian
+/// calendar.
+inline void CivilFromDays(Day day, int &year, unsigned &month,
+                          unsigned &day_of_month) {
+  int z = day + 719468;
+  int era = (z >= 0 ? z : z - 146096) / 146097;
+  unsigned doe = (unsigned)(z - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp = (5 * doy + 2) / 153;
+  day_of_month = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = (int)yoe + era * 400 + (month <= 2);
+}
+
+/// Inverse of CivilFromDays().
+inline Day DaysFromCivil(int year, unsigned month, unsigned day_of_month) {
+  year -= month <= 2;
+  int era = (year >= 0 ? year : year - 399) / 400;
+  unsigned yoe = (unsigned)(year - era * 400);
+  unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                 day_of_month - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int)doe - 719468;
+}
+
+/// Returns the current Day in the local time zone of the system.
+inline Day Today() {
+  std::time_t now = std::time(nullptr);
+  std::tm local;
+#if defined(_WIN32)
+  localtime_s(&local, &now);
+#else
+  localtime_r(&now, &local);
+#endif
+  return DaysFromCivil(local.tm_year + 1900, (unsigned)local.tm_mon + 1,
+                       (unsigned)local.tm_mday);
+}
+
+/// A habit was marked as completed or as not completed on a day.
+struct CheckIn {
+  HabitId habit_id = 0;
+  Day day = 0;
+  bool completed = true;
+};
+
+/// Number of completed habits per day starting at first_day. Contains the
+/// first checkin_count events of the check-in channel, later check-ins have
+/// to be applied on top of it.
+struct HabitAggregates {
+  Day first_day = 0;
+  int habit_count = 0;
+  size_t checkin_count = 0;
+  std::vector<uint16_t> completions;
+};
+
+/// Reducer state of channels::kHabitCheckIn: all check-ins up to
+/// aggregates.checkin_count folded into daily completion counts.
+struct CheckInSnapshot {
+  HabitAggregates aggregates;
+  /// Ids of the habits that appeared in a check-in, sorted.
+  std::vector<HabitId> habit_ids;
+};
+
+/// Statistics of one habit as of day.
+struct HabitStats {
+  HabitId habit_id = 0;
+  Day day = 0;
+  uint32_t total_completions = 0;
+  /// Consecutive completed days up to day, or up to the day before if day is
+  /// not completed yet.
+  uint32_t current_streak = 0;
+  uint32_t longest_streak = 0;
+  /// Completed days in the last 7 and 30 days including day.
+  uint32_t last_7_days = 0;
+  uint32_t last_30_days = 0;
+  /// Completed days of the calendar week and month of day so far.
+  uint32_t this_week = 0;
+  uint32_t this_month = 0;
+};
+
+/// A reminder for a habit of a user that is due at due_at.
+struct Reminder {
+  uint64_t reminder_id = 0;
+  uint64_t user_id = 0;
+  HabitId habit_id = 0;
+  std::chrono::system_clock::time_point due_at;
+};
+
+/// Reminders that became due together.
+struct DueReminders {
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  DueReminders() = default;
+  explicit DueReminders(const allocator_type &allocator)
+      : reminders(allocator) {}
+  DueReminders(const DueReminders &other, const allocator_type &allocator)
+      : reminders(other.reminders, allocator) {}
+  DueReminders(DueReminders &&other, const allocator_type &allocator)
+      : reminders(std::move(other.reminders), allocator) {}
+  DueReminders(const DueReminders &) = default;
+  DueReminders(DueReminders &&) = default;
+  DueReminders &operator=(const DueReminders &) = default;
+  DueReminders &operator=(DueReminders &&) = default;
+
+  std::pmr::vector<Reminder> reminders;
+};
+
+/// One entry of the habit history as it is shown to the user.
+struct HistoryRow {
+  Day day = 0;
+  HabitId habit_id = 0;
+  int32_t value = 0;
+};
+
+/// Rows of the habit history read by the HistoryImporter, in file order.
+/// Every import ends with a batch that has last set, which may be empty.
+struct HistoryImportBatch {
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  HistoryImportBatch() = default;
+  explicit HistoryImportBatch(const allocator_type &allocator)
+      : rows(allocator) {}
+  HistoryImportBatch(const HistoryImportBatch &other,
+                     const allocator_type &allocator)
+      : import_id(other.import_id),
+        rows(other.rows, allocator),
+        last(other.last) {}
+  HistoryImportBatch(HistoryImportBatch &&other,
+                     const allocator_type &allocator)
+      : import_id(other.import_id),
+        rows(std::move(other.rows), allocator),
+        last(other.last) {}
+  HistoryImportBatch(const HistoryImportBatch &) = default;
+  HistoryImportBatch(HistoryImportBatch &&) = default;
+  HistoryImportBatch &operator=(const HistoryImportBatch &) = default;
+  HistoryImportBatch &operator=(HistoryImportBatch &&) = default;
+
+  uint64_t import_id = 0;
+  std::pmr::vector<HistoryRow> rows;
+  bool last = false;
+};
+
+/// Asks for row_count rows of the history starting at first_row. Rows are
+/// ordered oldest first so that new entries never move existing ones.
+struct HistoryPageRequest {
+  uint64_t request_id = 0;
+  size_t first_row = 0;
+  size_t row_count = 0;
+};
+
+/// Answer to a HistoryPageRequest. Pages with request_id 0 are unsolicited and
+/// only announce a changed total_rows.
+struct HistoryPage {
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  HistoryPage() = default;
+  explicit HistoryPage(const allocator_type &allocator)
+      : rows(allocator) {}
+  HistoryPage(const HistoryPage &other, const allocator_type &allocator)
+      : request_id(other.request_id),
+        first_row(other.first_row),
+        total_rows(other.total_rows),
+        rows(other.rows, allocator) {}
+  HistoryPage(HistoryPage &&other, const allocator_type &allocator)
+      : request_id(other.request_id),
+        first_row(other.first_row),
+        total_rows(other.total_rows),
+        rows(std::move(other.rows), allocator) {}
+  HistoryPage(const HistoryPage &) = default;
+  HistoryPage(HistoryPage &&) = default;
+  HistoryPage &operator=(const HistoryPage &) = default;
+  HistoryPage &operator=(HistoryPage &&) = default;
+
+  uint64_t request_id = 0;
+  size_t first_row = 0;
+  size_t total_rows = 0;
+  std::pmr::vector<HistoryRow> rows;
+};
+
+/// Owner and tags of a habit.
+struct HabitInfo {
+  HabitId habit_id = 0;
+  uint64_t user_id = 0;
+  std::vector<std::string> tags;
+};
+
+/// Asks for all completed days in [first_day, last_day) of the habits that
+/// belong to user_id, if set, and carry all of tags.
+struct HabitQuery {
+  uint64_t query_id = 0;
+  std::optional<uint64_t> user_id;
+  std::vector<std::string> tags;
+  Day first_day = 0;
+  Day last_day = 0;
+};
+
+/// A completed day of a habit that matched a HabitQuery.
+struct QueryRow {
+  HabitId habit_id = 0;
+  Day day = 0;
+};
+
+/// One chunk of the answer to a HabitQuery. Chunks of different habits
+/// arrive in any order, the rows of one habit are sorted by day. The last
+/// chunk of a query has last set and carries the total number of rows.
+struct HabitQueryResult {
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  HabitQueryResult() = default;
+  explicit HabitQueryResult(const allocator_type &allocator)
+      : rows(allocator) {}
+  HabitQueryResult(const HabitQueryResult &other,
+                   const allocator_type &allocator)
+      : query_id(other.query_id),
+        sequence(other.sequence),
+        last(other.last),
+        total_rows(other.total_rows),
+        rows(other.rows, allocator) {}
+  HabitQueryResult(HabitQueryResult &&other,
+                   const allocator_type &allocator)
+      : query_id(other.query_id),
+        sequence(other.sequence),
+        last(other.last),
+        total_rows(other.total_rows),
+        rows(std::move(other.rows), allocator) {}
+  HabitQueryResult(const HabitQueryResult &) = default;
+  HabitQueryResult(HabitQueryResult &&) = default;
+  HabitQueryResult &operator=(const HabitQueryResult &) = default;
+  HabitQueryResult &operator=(HabitQueryResult &&) = default;
+
+  uint64_t query_id = 0;
+  uint32_t sequence = 0;
+  bool last = false;
+  size_t total_rows = 0;
+  std::pmr::vector<QueryRow> rows;
+};
+
+/// Counters of the ResultCache. Hits and misses count since the start, the
+/// other fields are the state at the time of publishing.
+struct ResultCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  /// Entries removed because a check-in changed their habit and range.
+  uint64_t invalidations = 0;
+  /// Entries removed to stay within the capacity.
+  uint64_t evictions = 0;
+  size_t entries = 0;
+  size_t bytes = 0;
+  size_t capacity_bytes = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_HABITS_HABIT_TYPES_H_
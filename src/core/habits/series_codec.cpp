@@ -0,0 +1,219 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/habits/series_codec.h"
+
+namespace habitify_core {
+namespace {
+constexpr uint8_t kMagic[4] = {'H', 'T', 'S', '1'};
+
+void WriteVarint(std::vector<uint8_t> &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((uint8_t)v);
+}
+
+bool ReadVarint(const uint8_t *data, size_t size, size_t &offset,
+                uint64_t &v) {
+  v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (offset >= size) return false;
+    uint8_t byte = data[offset++];
+    v |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+/// Writes bits most significant first, counterpart of internal::BitReader.
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out_(out) {}
+  ~BitWriter() { Flush(); }
+
+  void Write(uint64_t bits, int count) {
+    while (count > 0) {
+      int take = std::min(count, 8 - used_);
+      count -= take;
+      uint8_t chunk = (uint8_t)((bits >> count) & ((1u << take) - 1));
+      buffer_ = (uint8_t)(buffer_ | (chunk << (8 - used_ - take)));
+      used_ += take;
+      if (used_ == 8) Flush();
+    }
+  }
+
+  /// Prefix coded buckets: 0 | 10 + 7 bits | 110 + 12 bits | 1110 + 20 bits |
+  /// 1111 + 64 bits of the zigzag encoded value.
+  void WriteBucketed(int64_t v) {
+    uint64_t zz = internal::ZigZag(v);
+    if (zz == 0) {
+      Write(0b0, 1);
+    } else if (zz < (1ull << 7)) {
+      Write(0b10, 2);
+      Write(zz, 7);
+    } else if (zz < (1ull << 12)) {
+      Write(0b110, 3);
+      Write(zz, 12);
+    } else if (zz < (1ull << 20)) {
+      Write(0b1110, 4);
+      Write(zz, 20);
+    } else {
+      Write(0b1111, 4);
+      Write(zz, 64);
+    }
+  }
+
+  void Flush() {
+    if (used_ == 0) return;
+    out_.push_back(buffer_);
+    buffer_ = 0;
+    used_ = 0;
+  }
+
+ private:
+  std::vector<uint8_t> &out_;
+  uint8_t buffer_ = 0;
+  int used_ = 0;
+};
+}  // namespace
+
+void EncodedSeries::DecodeRange(int64_t from, int64_t to,
+                                std::vector<SeriesPoint> &out) const {
+  ForEachInRange(from, to, [&out](const SeriesPoint &p) { out.push_back(p); });
+}
+
+void EncodedSeries::Serialize(std::vector<uint8_t> &out) const {
+  out.insert(out.end(), kMagic, kMagic + sizeof(kMagic));
+  WriteVarint(out, point_count_);
+  WriteVarint(out, bytes_.size());
+  out.insert(out.end(), bytes_.begin(), bytes_.end());
+}
+
+bool EncodedSeries::Deserialize(const uint8_t *data, size_t size,
+                                EncodedSeries &out) {
+  if (size < sizeof(kMagic) ||
+      !std::equal(kMagic, kMagic + sizeof(kMagic), data)) {
+    return false;
+  }
+
+  size_t offset = sizeof(kMagic);
+  uint64_t point_count, byte_count;
+  if (!ReadVarint(data, size, offset, point_count) ||
+      !ReadVarint(data, size, offset, byte_count) ||
+      byte_count > size - offset) {
+    return false;
+  }
+
+  EncodedSeries series;
+  series.bytes_.assign(data + offset, data + offset + byte_count);
+  series.point_count_ = point_count;
+
+  size_t block_offset = 0, points = 0;
+  while (block_offset < series.bytes_.size()) {
+    BlockInfo info;
+    if (!series.ParseBlock(block_offset, info, block_offset)) return false;
+    points += info.count;
+    series.blocks_.push_back(info);
+  }
+  if (points != point_count) return false;
+
+  out = std::move(series);
+  return true;
+}
+
+bool EncodedSeries::ParseBlock(size_t offset, BlockInfo &info,
+                               size_t &next) const {
+  const uint8_t *data = bytes_.data();
+  size_t size = bytes_.size();
+  uint64_t count, first_timestamp, first_value, range, payload_size;
+  if (!ReadVarint(data, size, offset, count) ||
+      !ReadVarint(data, size, offset, first_timestamp) ||
+      !ReadVarint(data, size, offset, first_value) ||
+      !ReadVarint(data, size, offset, range) ||
+      !ReadVarint(data, size, offset, payload_size) || count == 0 ||
+      count > kBlockPoints || payload_size > size - offset) {
+    return false;
+  }
+
+  info.count = (uint32_t)count;
+  info.first_timestamp = internal::UnZigZag(first_timestamp);
+  info.last_timestamp = internal::WrappingAdd(info.first_timestamp, range);
+  info.first_value = internal::UnZigZag(first_value);
+  info.payload_offset = offset;
+  info.payload_size = payload_size;
+  next = offset + payload_size;
+  return true;
+}
+
+bool SeriesEncoder::Append(int64_t timestamp, int64_t value) {
+  if (!pending_.empty() && timestamp < pending_.back().timestamp) return false;
+  if (pending_.empty() && !series_.blocks_.empty() &&
+      timestamp < series_.blocks_.back().last_timestamp) {
+    return false;
+  }
+
+  pending_.push_back({timestamp, value});
+  if (pending_.size() == EncodedSeries::kBlockPoints) FlushBlock();
+  return true;
+}
+
+EncodedSeries SeriesEncoder::Finish() {
+  FlushBlock();
+  EncodedSeries series = std::move(series_);
+  series_ = EncodedSeries();
+  return series;
+}
+
+void SeriesEncoder::FlushBlock() {
+  if (pending_.empty()) return;
+
+  payload_.clear();
+  {
+    BitWriter writer(payload_);
+    int64_t delta = 0;
+    for (size_t i = 1; i < pending_.size(); i++) {
+      int64_t next_delta = internal::WrappingSub(pending_[i].timestamp,
+                                                 pending_[i - 1].timestamp);
+      writer.WriteBucketed(internal::WrappingSub(next_delta, delta));
+      writer.WriteBucketed(
+          internal::WrappingSub(pending_[i].value, pending_[i - 1].value));
+      delta = next_delta;
+    }
+  }
+
+  std::vector<uint8_t> &bytes = series_.bytes_;
+  size_t header = bytes.size();
+  WriteVarint(bytes, pending_.size());
+  WriteVarint(bytes, internal::ZigZag(pending_.front().timestamp));
+  WriteVarint(bytes, internal::ZigZag(pending_.front().value));
+  WriteVarint(bytes, (uint64_t)pending_.back().timestamp -
+                        (uint64_t)pending_.front().timestamp);
+  WriteVarint(bytes, payload_.size());
+  bytes.insert(bytes.end(), payload_.begin(), payload_.end());
+
+  EncodedSeries::BlockInfo info;
+  size_t next;
+  series_.ParseBlock(header, info, next);
+  series_.blocks_.push_back(info);
+  series_.point_count_ += pending_.size();
+  pending_.clear();
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,222 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_HABITS_SERIES_CODEC_H_
+#define HABITIFY_SRC_CORE_HABITS_SERIES_CODEC_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace habitify_core {
+
+/// One sample of a habit series, e.g. a check-in and its value. The unit of
+/// timestamp is up to the caller, days compress best.
+struct SeriesPoint {
+  int64_t timestamp = 0;
+  int64_t value = 0;
+};
+
+namespace internal {
+inline uint64_t ZigZag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+inline int64_t UnZigZag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+/// Deltas wrap around instead of overflowing, so any int64_t round trips.
+inline int64_t WrappingSub(int64_t a, int64_t b) {
+  return (int64_t)((uint64_t)a - (uint64_t)b);
+}
+inline int64_t WrappingAdd(int64_t a, int64_t b) {
+  return (int64_t)((uint64_t)a + (uint64_t)b);
+}
+
+/// Reads bits most significant first. Reading past the end yields zeros.
+class BitReader {
+ public:
+  BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  inline uint64_t Read(int count) {
+    uint64_t result = 0;
+    while (count > 0) {
+      if (available_ == 0) {
+        buffer_ = position_ < size_ ? data_[position_] : 0;
+        position_++;
+        available_ = 8;
+      }
+      int take = std::min(count, available_);
+      available_ -= take;
+      result =
+          (result << take) | ((buffer_ >> available_) & ((1u << take) - 1));
+      count -= take;
+    }
+    return result;
+  }
+
+  /// Reads a value written by BitWriter::WriteBucketed().
+  inline int64_t ReadBucketed() {
+    if (Read(1) == 0) return 0;
+    if (Read(1) == 0) return UnZigZag(Read(7));
+    if (Read(1) == 0) return UnZigZag(Read(12));
+    if (Read(1) == 0) return UnZigZag(Read(20));
+    return UnZigZag(Read(64));
+  }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t position_ = 0;
+  uint32_t buffer_ = 0;
+  int available_ = 0;
+};
+
+/// Decodes the points of one block in order.
+class BlockDecoder {
+ public:
+  /// data points to the payload of a block whose first point is first.
+  BlockDecoder(const uint8_t *data, size_t size, SeriesPoint first,
+               uint32_t count)
+      : reader_(data, size), point_(first), remaining_(count) {}
+
+  inline bool Next(SeriesPoint &point) {
+    if (remaining_ == 0) return false;
+    if (!started_) {
+      started_ = true;
+    } else {
+      delta_ = WrappingAdd(delta_, reader_.ReadBucketed());
+      point_.timestamp = WrappingAdd(point_.timestamp, delta_);
+      point_.value = WrappingAdd(point_.value, reader_.ReadBucketed());
+    }
+    remaining_--;
+    point = point_;
+    return true;
+  }
+
+ private:
+  BitReader reader_;
+  SeriesPoint point_;
+  int64_t delta_ = 0;
+  uint32_t remaining_;
+  bool started_ = false;
+};
+}  // namespace internal
+
+/// EncodedSeries is a compressed series of points with non decreasing
+/// timestamps, in the spirit of Facebook's Gorilla:
+///   - Points are grouped into blocks of up to kBlockPoints. A block header
+///     holds the first point, the time range and the payload size, which is
+///     the index used for seeking.
+///   - Timestamps are stored as delta of delta and values as delta, both
+///     zigzag encoded into buckets of 1, 9, 15, 24 or 68 bits. A daily habit
+///     costs 2 bits per day.
+/// Serialize() writes the blocks as they are, so a serialized series can be
+/// searched again without re-encoding it. Nothing stores or sends series yet;
+/// the codec is meant for a persistent history. Usage:
+///       SeriesEncoder encoder;
+///       for (auto &check_in : check_ins) encoder.Append(day, value);
+///       EncodedSeries series = encoder.Finish();
+///       series.ForEachInRange(first_day, last_day, [&](SeriesPoint p) {
+///         table.Set(habit, (Day)p.timestamp, p.value != 0);
+///       });
+class EncodedSeries {
+ public:
+  static constexpr size_t kBlockPoints = 128;
+
+  struct BlockInfo {
+    int64_t first_timestamp = 0;
+    int64_t last_timestamp = 0;
+    int64_t first_value = 0;
+    uint32_t count = 0;
+    /// Position and size of the payload in the encoded bytes.
+    size_t payload_offset = 0;
+    size_t payload_size = 0;
+  };
+
+  /// Calls f(SeriesPoint) for every point with from <= timestamp < to in
+  /// order. Only the blocks overlapping the range are decoded.
+  template <typename F>
+  void ForEachInRange(int64_t from, int64_t to, F &&f) const {
+    auto block = std::lower_bound(blocks_.begin(), blocks_.end(), from,
+                                  [](const BlockInfo &info, int64_t t) {
+                                    return info.last_timestamp < t;
+                                  });
+
+    for (; block != blocks_.end() && block->first_timestamp < to; ++block) {
+      internal::BlockDecoder decoder(
+          bytes_.data() + block->payload_offset, block->payload_size,
+          {block->first_timestamp, block->first_value}, block->count);
+      SeriesPoint point;
+      while (decoder.Next(point)) {
+        if (point.timestamp >= to) return;
+        if (point.timestamp >= from) f(point);
+      }
+    }
+  }
+  /// Appends the points with from <= timestamp < to to out.
+  void DecodeRange(int64_t from, int64_t to,
+                   std::vector<SeriesPoint> &out) const;
+
+  /// Writes a short header and the encoded blocks to out.
+  void Serialize(std::vector<uint8_t> &out) const;
+  /// Reads a series written by Serialize() and rebuilds the block index from
+  /// the headers. Returns false if the data is malformed.
+  static bool Deserialize(const uint8_t *data, size_t size, EncodedSeries &out);
+
+  // Getters
+  inline const size_t get_point_count() const { return point_count_; }
+  inline const std::vector<BlockInfo> &get_blocks() const { return blocks_; }
+  /// Size of the encoded blocks in bytes.
+  inline const size_t get_encoded_size() const { return bytes_.size(); }
+
+ private:
+  friend class SeriesEncoder;
+
+  /// Parses the block header at offset. Returns false if it is malformed.
+  bool ParseBlock(size_t offset, BlockInfo &info, size_t &next) const;
+
+ private:
+  std::vector<uint8_t> bytes_;
+  std::vector<BlockInfo> blocks_;
+  size_t point_count_ = 0;
+};
+
+/// Builds an EncodedSeries one point at a time. Points are buffered until a
+/// block is full.
+class SeriesEncoder {
+ public:
+  /// Returns false and ignores the point if timestamp is smaller than the
+  /// previous one.
+  bool Append(int64_t timestamp, int64_t value);
+  /// Encodes the buffered points and hands out the series. The encoder starts
+  /// a new series afterwards.
+  EncodedSeries Finish();
+
+ private:
+  void FlushBlock();
+
+ private:
+  EncodedSeries series_;
+  std::vector<SeriesPoint> pending_;
+  std::vector<uint8_t> payload_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_HABITS_SERIES_CODEC_H_
@@ -0,0 +1,196 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/habits/statistics_service.h"
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/habits/bitset_kernels.h"
+
+namespace habitify_core {
+namespace {
+inline bool InRange(Day day, Day first_day, Day last_day) {
+  return day >= first_day && day <= last_day;
+}
+}  // namespace
+
+StatisticsService::StatisticsService(std::shared_ptr<EventBus> event_bus,
+                                     const HabitStore &store, DayClock today)
+    : event_bus_(event_bus), clock_(today) {
+  // The store publishes its check-ins under its unique lock, so the next
+  // check-in after subscribing is the first one that is not in the table.
+  store.Read([this](const HabitTable &table) {
+    checkins_ = event_bus_->SubscribeTo(channels::kHabitCheckIn,
+                                        SubscribeFrom::kNextEvent);
+    for (HabitId id : table.get_habit_ids()) {
+      Day end_day = table.get_base_day() + (Day)table.GetColumn(id).size() * 64;
+      table.ForEachCompletion(id, table.get_base_day(), end_day,
+                              [this, id](Day day) { Apply({id, day, true}); });
+    }
+  });
+  stats_ = event_bus_->RegisterPublisher<HabitStats>(channels::kHabitStats);
+}
+
+StatisticsService::~StatisticsService() { Stop(); }
+
+void StatisticsService::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread([this]() {
+    while (running_) {
+      if (!Poll()) checkins_->WaitForEvent(kIdleTimeout);
+    }
+  });
+}
+
+void StatisticsService::Start(Executor &executor) {
+  if (running_.exchange(true)) return;
+  task_ = std::make_unique<PollingTask>(
+      executor, [this]() { return Poll(); }, kIdleTimeout);
+  hook_id_ =
+      event_bus_->AddPublishHook(channels::kHabitCheckIn, task_->GetNotifier());
+  task_->Start();
+}
+
+void StatisticsService::Stop() {
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+  if (task_) {
+    event_bus_->RemovePublishHook(channels::kHabitCheckIn, hook_id_);
+    task_->Stop();
+    task_.reset();
+  }
+}
+
+bool StatisticsService::Poll() {
+  Day today = clock_();
+  if (today != today_) {
+    today_ = today;
+    week_start_ = today - Weekday(today);
+    int year;
+    unsigned month, day;
+    CivilFromDays(today, year, month, day);
+    month_start_ = DaysFromCivil(year, month, 1);
+
+    for (auto &[id, state] : states_) RefreshWindows(state);
+  }
+
+  while (auto event = checkins_->ReadNext<CheckIn>()) {
+    Apply(*event->GetData<CheckIn>());
+  }
+
+  if (dirty_.empty()) return false;
+  for (HabitId id : dirty_) {
+    HabitState &state = states_[id];
+    state.dirty = false;
+    PublishStats(state.stats);
+  }
+  dirty_.clear();
+  return true;
+}
+
+void StatisticsService::Apply(const CheckIn &check_in) {
+  bool is_new = !table_.HasHabit(check_in.habit_id);
+  HabitState &state = states_[check_in.habit_id];
+  HabitStats &stats = state.stats;
+  if (is_new) {
+    stats.habit_id = check_in.habit_id;
+    stats.day = today_;
+  }
+
+  // Duplicates change nothing.
+  if (!table_.Set(check_in.habit_id, check_in.day, check_in.completed)) {
+    return;
+  }
+
+  // The runs directly before and after the day. Set() may have moved the base
+  // day, so the bit is computed afterwards.
+  auto words = table_.GetColumn(check_in.habit_id);
+  size_t bit = (size_t)(check_in.day - table_.get_base_day());
+  uint32_t before =
+      (uint32_t)kernels::RunEndingAt(words.data(), words.size(), bit);
+  uint32_t after =
+      (uint32_t)kernels::RunStartingAt(words.data(), words.size(), bit + 1);
+
+  int delta = check_in.completed ? 1 : -1;
+  if (check_in.completed) {
+    RemoveRun(state, before);
+    RemoveRun(state, after);
+    AddRun(state, before + 1 + after);
+  } else {
+    RemoveRun(state, before + 1 + after);
+    AddRun(state, before);
+    AddRun(state, after);
+  }
+
+  stats.total_completions += delta;
+  stats.longest_streak = state.runs.empty() ? 0 : state.runs.rbegin()->first;
+  if (InRange(check_in.day, today_ - 6, today_)) stats.last_7_days += delta;
+  if (InRange(check_in.day, today_ - 29, today_)) stats.last_30_days += delta;
+  if (InRange(check_in.day, week_start_, today_)) stats.this_week += delta;
+  if (InRange(check_in.day, month_start_, today_)) stats.this_month += delta;
+
+  // Only a check-in next to the current streak can change it.
+  if (InRange(check_in.day, today_ - (Day)stats.current_streak - 1, today_)) {
+    stats.current_streak =
+        (uint32_t)table_.CurrentStreak(check_in.habit_id, today_);
+  }
+
+  if (!state.dirty) {
+    state.dirty = true;
+    dirty_.push_back(check_in.habit_id);
+  }
+}
+
+void StatisticsService::RefreshWindows(HabitState &state) {
+  HabitStats &stats = state.stats;
+  HabitId id = stats.habit_id;
+
+  stats.day = today_;
+  stats.last_7_days =
+      (uint32_t)table_.CountCompletions(id, today_ - 6, today_ + 1);
+  stats.last_30_days =
+      (uint32_t)table_.CountCompletions(id, today_ - 29, today_ + 1);
+  stats.this_week =
+      (uint32_t)table_.CountCompletions(id, week_start_, today_ + 1);
+  stats.this_month =
+      (uint32_t)table_.CountCompletions(id, month_start_, today_ + 1);
+  stats.current_streak = (uint32_t)table_.CurrentStreak(id, today_);
+
+  if (!state.dirty) {
+    state.dirty = true;
+    dirty_.push_back(id);
+  }
+}
+
+void StatisticsService::PublishStats(const HabitStats &stats) {
+  stats_->Publish(std::make_unique<const Event<HabitStats>>(
+      EventType::HABIT_STATS, channels::kHabitStats,
+      MakePayload<HabitStats>(stats)));
+}
+
+void StatisticsService::AddRun(HabitState &state, uint32_t length) {
+  if (length > 0) state.runs[length]++;
+}
+
+void StatisticsService::RemoveRun(HabitState &state, uint32_t length) {
+  if (length == 0) return;
+  auto it = state.runs.find(length);
+  if (it != state.runs.end() && --it->second == 0) state.runs.erase(it);
+}
+
+}  // namespace habitify_core
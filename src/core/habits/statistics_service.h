@@ -0,0 +1,118 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_HABITS_STATISTICS_SERVICE_H_
+#define HABITIFY_SRC_CORE_HABITS_STATISTICS_SERVICE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+
+/// StatisticsService keeps the HabitStats of every habit up to date from the
+/// check-ins on channels::kHabitCheckIn and publishes them on
+/// channels::kHabitStats whenever they change. Nothing is recomputed from the
+/// full history:
+///   - Windows like the last 7 days or the current month change by one per
+///     check-in and are recounted over at most a month when the day changes.
+///   - Streaks are kept as a histogram of run lengths. A check-in merges or
+///     splits the run around its day, so late and corrected check-ins only
+///     scan the runs they touch.
+/// The cost of a check-in therefore depends on the streak lengths around it
+/// but not on the length of the history. The service starts from the
+/// completions that are in the HabitStore when it is created, so it does not
+/// depend on the check-ins the bus still stores. Usage:
+///       StatisticsService statistics(event_bus, store);
+///       statistics.Start();
+class StatisticsService {
+ public:
+  using DayClock = std::function<Day()>;
+
+  StatisticsService(std::shared_ptr<EventBus> event_bus,
+                    const HabitStore &store, DayClock today = Today);
+  ~StatisticsService();
+
+  StatisticsService(const StatisticsService &) = delete;
+  const StatisticsService &operator=(const StatisticsService &) = delete;
+
+  /// Runs Poll() on a dedicated thread until Stop() is called.
+  void Start();
+  /// Runs Poll() as a PollingTask on executor until Stop() is called. The
+  /// task is woken up by new check-ins and runs at least every kIdleTimeout.
+  void Start(Executor &executor);
+  void Stop();
+
+  /// Applies all new check-ins, moves the windows if the day changed and
+  /// publishes the stats that changed. Returns true if anything was
+  /// published.
+  bool Poll();
+
+ private:
+  struct HabitState {
+    HabitStats stats;
+    /// Number of runs of completed days per run length.
+    std::map<uint32_t, uint32_t> runs;
+    bool dirty = false;
+  };
+
+  void Apply(const CheckIn &check_in);
+  /// Recounts the windows and the current streak for today_. Touches at most
+  /// a month of days.
+  void RefreshWindows(HabitState &state);
+  void PublishStats(const HabitStats &stats);
+
+  static void AddRun(HabitState &state, uint32_t length);
+  static void RemoveRun(HabitState &state, uint32_t length);
+
+ private:
+  static constexpr std::chrono::milliseconds kIdleTimeout{100};
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Listener> checkins_;
+  std::shared_ptr<Publisher<HabitStats>> stats_;
+  DayClock clock_;
+
+  /// Mirror of the completions, only used to find the runs around a day.
+  HabitTable table_;
+  std::unordered_map<HabitId, HabitState> states_;
+  std::vector<HabitId> dirty_;
+  Day today_ = 0;
+  Day week_start_ = 0;
+  Day month_start_ = 0;
+
+  std::atomic<bool> running_ = false;
+  std::thread thread_;
+  std::unique_ptr<PollingTask> task_;
+  PublishHookId hook_id_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_HABITS_STATISTICS_SERVICE_H_
@@ -0,0 +1,86 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/io/history_export.h"
+
+#include <algorithm>
+#include <charconv>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/core/io/text_scan.h"
+
+namespace habitify_core {
+namespace {
+/// Rows read from the source at a time.
+constexpr size_t kPageRows = 4096;
+/// Longest formatted row: the NDJSON keys plus a date and two int32_t.
+constexpr size_t kMaxRowBytes = 64;
+
+char *AppendRow(const HistoryRow &row, HistoryFormat format, char *out) {
+  auto append = [&](std::string_view text) {
+    out = std::copy(text.begin(), text.end(), out);
+  };
+  auto append_int = [&](int32_t value) {
+    out = std::to_chars(out, out + 11, value).ptr;
+  };
+
+  if (format == HistoryFormat::kCsv) {
+    out = scan::FormatDate(row.day, out);
+    *out++ = ',';
+    append_int(row.habit_id);
+    *out++ = ',';
+    append_int(row.value);
+  } else {
+    append("{\"day\":\"");
+    out = scan::FormatDate(row.day, out);
+    append("\",\"habit_id\":");
+    append_int(row.habit_id);
+    append(",\"value\":");
+    append_int(row.value);
+    *out++ = '}';
+  }
+  *out++ = '\n';
+  return out;
+}
+}  // namespace
+
+size_t ExportHistory(const HabitHistorySource &source, std::ostream &out,
+                     HistoryFormat format) {
+  if (format == HistoryFormat::kCsv) out << "day,habit_id,value\n";
+
+  std::pmr::vector<HistoryRow> rows;
+  rows.reserve(kPageRows);
+  std::string buffer(kPageRows * kMaxRowBytes, '\0');
+  size_t written = 0;
+  while (true) {
+    rows.clear();
+    source.ReadRows(written, kPageRows, rows);
+    if (rows.empty()) break;
+
+    char *end = buffer.data();
+    for (const HistoryRow &row : rows) end = AppendRow(row, format, end);
+    out.write(buffer.data(), end - buffer.data());
+    written += rows.size();
+  }
+  return written;
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,39 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_IO_HISTORY_EXPORT_H_
+#define HABITIFY_SRC_CORE_IO_HISTORY_EXPORT_H_
+
+#include <cstddef>
+#include <ostream>
+
+#include "src/core/habits/habit_history_service.h"
+#include "src/core/io/history_import.h"
+
+namespace habitify_core {
+
+/// Writes the whole history of source to out in a format HistoryImporter
+/// reads back. Rows are read and formatted a page at a time, so the history
+/// is never copied as a whole. CSV output starts with a header line. Returns
+/// the number of rows written.
+size_t ExportHistory(const HabitHistorySource &source, std::ostream &out,
+                     HistoryFormat format);
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_IO_HISTORY_EXPORT_H_
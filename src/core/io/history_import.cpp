@@ -0,0 +1,415 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/io/history_import.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/io/mapped_file.h"
+#include "src/core/io/text_scan.h"
+
+namespace habitify_core {
+namespace {
+/// Validation that applies to both formats.
+const char *ValidateRow(const HistoryRow &row) {
+  if (row.habit_id < 0) return "negative habit_id";
+  return nullptr;
+}
+
+std::string_view TrimLine(std::string_view line) {
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+  return line;
+}
+
+/// Converts the fields of a CSV line.
+const char *ParseCsvFields(std::string_view day, std::string_view habit_id,
+                           std::string_view value, HistoryRow &row) {
+  if (!scan::ParseDate(day, row.day)) return "invalid day";
+  if (!scan::ParseInt32(habit_id, row.habit_id)) return "invalid habit_id";
+  if (!scan::ParseInt32(value, row.value)) return "invalid value";
+  return ValidateRow(row);
+}
+
+bool IsBlank(std::string_view line) {
+  return std::all_of(line.begin(), line.end(),
+                     [](char c) { return c == ' ' || c == '\t'; });
+}
+
+/// Minimal reader for the flat objects of the NDJSON format.
+class JsonCursor {
+ public:
+  explicit JsonCursor(std::string_view text) : text_(text) {}
+
+  void SkipSpace() {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == ' ' || text_[pos_] == '\t')) {
+      pos_++;
+    }
+  }
+  bool Consume(char c) {
+    SkipSpace();
+    if (pos_ >= text_.size() || text_[pos_] != c) return false;
+    pos_++;
+    return true;
+  }
+  bool Peek(char c) {
+    SkipSpace();
+    return pos_ < text_.size() && text_[pos_] == c;
+  }
+  bool AtEnd() {
+    SkipSpace();
+    return pos_ >= text_.size();
+  }
+  /// Reads a string without escapes.
+  bool String(std::string_view &out) {
+    if (!Consume('"')) return false;
+    size_t end = text_.find('"', pos_);
+    if (end == std::string_view::npos) return false;
+    out = text_.substr(pos_, end - pos_);
+    if (out.find('\\') != std::string_view::npos) return false;
+    pos_ = end + 1;
+    return true;
+  }
+  /// Reads a number or literal up to the next delimiter.
+  std::string_view Token() {
+    SkipSpace();
+    size_t begin = pos_;
+    while (pos_ < text_.size() && text_[pos_] != ',' && text_[pos_] != '}' &&
+           text_[pos_] != ' ' && text_[pos_] != '\t') {
+      pos_++;
+    }
+    return text_.substr(begin, pos_ - begin);
+  }
+
+ private:
+  std::string_view text_;
+  size_t pos_ = 0;
+};
+}  // namespace
+
+const char *ParseCsvRow(std::string_view line, HistoryRow &row) {
+  line = TrimLine(line);
+  std::string_view fields[3];
+  size_t count = 0, field_begin = 0;
+  for (size_t i = 0; i <= line.size(); i++) {
+    if (i < line.size() && line[i] != ',') continue;
+    if (count == 3) return "expected 3 fields";
+    fields[count++] = line.substr(field_begin, i - field_begin);
+    field_begin = i + 1;
+  }
+  if (count != 3) return "expected 3 fields";
+  return ParseCsvFields(fields[0], fields[1], fields[2], row);
+}
+
+const char *ParseNdjsonRow(std::string_view line, HistoryRow &row) {
+  JsonCursor cursor(TrimLine(line));
+  if (!cursor.Consume('{')) return "expected object";
+  bool has_day = false, has_habit = false, has_value = false;
+  if (!cursor.Peek('}')) {
+    do {
+      std::string_view key;
+      if (!cursor.String(key) || !cursor.Consume(':')) return "invalid key";
+      if (key == "day") {
+        std::string_view day;
+        if (!cursor.String(day) || !scan::ParseDate(day, row.day))
+          return "invalid day";
+        has_day = true;
+      } else if (cursor.Peek('"')) {
+        std::string_view ignored;
+        if (!cursor.String(ignored)) return "invalid string";
+      } else {
+        std::string_view token = cursor.Token();
+        if (key == "habit_id") {
+          if (!scan::ParseInt32(token, row.habit_id))
+            return "invalid habit_id";
+          has_habit = true;
+        } else if (key == "value") {
+          if (!scan::ParseInt32(token, row.value)) return "invalid value";
+          has_value = true;
+        } else if (token.empty()) {
+          // Nested objects and arrays are not part of the format.
+          return "unsupported value";
+        }
+      }
+    } while (cursor.Consume(','));
+  }
+  if (!cursor.Consume('}') || !cursor.AtEnd()) return "expected end of object";
+  if (!has_day || !has_habit || !has_value) return "missing key";
+  return ValidateRow(row);
+}
+
+HistoryImporter::HistoryImporter(std::shared_ptr<EventBus> event_bus,
+                                 Executor *executor, std::stop_token stop)
+    : event_bus_(event_bus), executor_(executor), stop_(std::move(stop)) {
+  batches_ = event_bus_->RegisterPublisher<HistoryImportBatch>(
+      channels::kHistoryImport);
+}
+
+ImportReport HistoryImporter::ImportFile(const std::string &path,
+                                         HistoryFormat format) {
+  MappedFile file;
+  if (!file.Open(path)) return ImportReport{};
+  return Run(file.get_data(), format, [&](size_t offset, size_t length) {
+    file.Release(offset, length);
+  });
+}
+
+ImportReport HistoryImporter::Import(std::string_view data,
+                                     HistoryFormat format) {
+  return Run(data, format, [](size_t, size_t) {});
+}
+
+template <typename Release>
+ImportReport HistoryImporter::Run(std::string_view data, HistoryFormat format,
+                                  Release &&release) {
+  ImportReport report;
+  report.opened = true;
+  uint64_t import_id = next_import_id_++;
+
+  // Enough chunks per window to keep every thread busy while one is slow.
+  const size_t window_chunks =
+      2 * ((executor_ ? executor_->get_thread_count() : 0) + 1);
+  std::vector<Chunk> window(window_chunks);
+
+  size_t position = 0;
+  // Skips the header of CSV files.
+  if (format == HistoryFormat::kCsv && !data.empty() &&
+      !std::isdigit((unsigned char)data.front())) {
+    const char *newline =
+        scan::FindNewline(data.data(), data.data() + data.size());
+    position = (size_t)(newline - data.data());
+    if (position < data.size()) position++;
+  }
+
+  auto batch = MakePayload<HistoryImportBatch>();
+  batch->import_id = import_id;
+  batch->rows.reserve(kBatchRows);
+
+  while (position < data.size()) {
+    if (const char *reason = WaitForListeners()) {
+      report.cancelled = true;
+      report.errors.push_back(reason);
+      break;
+    }
+    size_t window_begin = position;
+    size_t chunk_count = 0;
+    for (; chunk_count < window_chunks && position < data.size();
+         chunk_count++) {
+      Chunk &chunk = window[chunk_count];
+      chunk.begin = position;
+      size_t end = std::min(data.size(), position + kChunkBytes);
+      const char *newline =
+          scan::FindNewline(data.data() + end, data.data() + data.size());
+      position = (size_t)(newline - data.data());
+      if (position < data.size()) position++;
+      chunk.end = position;
+    }
+
+    auto parse = [&](size_t i) { ParseChunk(data, format, window[i]); };
+    if (executor_) {
+      executor_->ParallelFor(chunk_count, parse);
+    } else {
+      for (size_t i = 0; i < chunk_count; i++) parse(i);
+    }
+
+    // Published in file order.
+    for (size_t i = 0; i < chunk_count; i++) {
+      Chunk &chunk = window[i];
+      report.rows += chunk.rows.size();
+      report.invalid_rows += chunk.invalid_rows;
+      for (std::string &error : chunk.errors) {
+        if (report.errors.size() == kMaxReportedErrors) break;
+        report.errors.push_back(std::move(error));
+      }
+
+      std::span<const HistoryRow> rows(chunk.rows);
+      while (!rows.empty()) {
+        size_t count =
+            std::min(rows.size(), kBatchRows - batch->rows.size());
+        batch->rows.insert(batch->rows.end(), rows.begin(),
+                           rows.begin() + count);
+        rows = rows.subspan(count);
+        if (batch->rows.size() == kBatchRows) {
+          PublishBatch(std::move(batch));
+          report.batches++;
+          batch = MakePayload<HistoryImportBatch>();
+          batch->import_id = import_id;
+          batch->rows.reserve(kBatchRows);
+        }
+      }
+    }
+    release(window_begin, position - window_begin);
+  }
+
+  batch->last = true;
+  PublishBatch(std::move(batch));
+  report.batches++;
+  return report;
+}
+
+void HistoryImporter::ParseChunk(std::string_view data, HistoryFormat format,
+                                 Chunk &chunk) {
+  chunk.rows.clear();
+  chunk.invalid_rows = 0;
+  chunk.errors.clear();
+
+  auto add_row = [&](size_t offset, std::string_view line,
+                     const char *error, const HistoryRow &row) {
+    if (error == nullptr) {
+      chunk.rows.push_back(row);
+      return;
+    }
+    if (IsBlank(TrimLine(line))) return;
+    chunk.invalid_rows++;
+    if (chunk.errors.size() < kMaxReportedErrors) {
+      chunk.errors.push_back("offset " + std::to_string(offset) + ": " +
+                             error);
+    }
+  };
+
+  const char *begin = data.data() + chunk.begin;
+  const char *end = data.data() + chunk.end;
+  if (format == HistoryFormat::kNdjson) {
+    for (const char *line = begin; line < end;) {
+      const char *newline = scan::FindNewline(line, end);
+      std::string_view text(line, (size_t)(newline - line));
+      HistoryRow row;
+      add_row((size_t)(line - data.data()), text, ParseNdjsonRow(text, row),
+              row);
+      line = newline + 1;
+    }
+    return;
+  }
+
+  // CSV: a single pass over the chunk finds both delimiters, the fields of
+  // a line are converted once its newline is reached.
+  std::string_view fields[2];
+  size_t field_count = 0;
+  const char *line = begin, *field = begin;
+  auto finish_line = [&](const char *line_end) {
+    std::string_view text(line, (size_t)(line_end - line));
+    HistoryRow row;
+    const char *error = "expected 3 fields";
+    if (field_count == 2) {
+      std::string_view value(field, (size_t)(line_end - field));
+      error = ParseCsvFields(fields[0], fields[1], TrimLine(value), row);
+    }
+    add_row((size_t)(line - data.data()), text, error, row);
+    line = field = line_end + 1;
+    field_count = 0;
+  };
+  scan::ForEachOf(begin, end, ',', '\n', [&](const char *delimiter) {
+    if (*delimiter == '\n') {
+      finish_line(delimiter);
+      return;
+    }
+    if (field_count < 2) {
+      fields[field_count] =
+          std::string_view(field, (size_t)(delimiter - field));
+    }
+    field_count++;
+    field = delimiter + 1;
+  });
+  if (line < end) finish_line(end);
+}
+
+void HistoryImporter::PublishBatch(std::shared_ptr<HistoryImportBatch> batch) {
+  batches_->Publish(std::make_unique<const Event<HistoryImportBatch>>(
+      EventType::HISTORY_IMPORT, channels::kHistoryImport, batch));
+}
+
+const char *HistoryImporter::WaitForListeners() {
+  size_t unread = event_bus_->GetUnreadEvents(channels::kHistoryImport);
+  auto read_at = std::chrono::steady_clock::now();
+  while (true) {
+    if (stop_.stop_requested()) return "import cancelled";
+    if (unread <= kMaxUnreadBatches) return nullptr;
+
+    // The HistoryImportService may need this worker to catch up.
+    if (!executor_ || !executor_->RunPendingTask()) {
+      std::this_thread::sleep_for(kListenerPollInterval);
+    }
+    size_t now_unread = event_bus_->GetUnreadEvents(channels::kHistoryImport);
+    auto now = std::chrono::steady_clock::now();
+    if (now_unread < unread) {
+      read_at = now;
+    } else if (now - read_at > kListenerTimeout) {
+      return "no Listener reads the import";
+    }
+    unread = now_unread;
+  }
+}
+
+HistoryImportService::HistoryImportService(
+    std::shared_ptr<EventBus> event_bus, InMemoryHabitHistory &history,
+    HabitStore &store)
+    : event_bus_(event_bus), history_(history), store_(store) {
+  batches_ = event_bus_->SubscribeTo(channels::kHistoryImport);
+}
+
+HistoryImportService::~HistoryImportService() { Stop(); }
+
+void HistoryImportService::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread([this]() {
+    while (running_) {
+      if (!Poll()) batches_->WaitForEvent(kIdleTimeout);
+    }
+  });
+}
+
+void HistoryImportService::Start(Executor &executor) {
+  if (running_.exchange(true)) return;
+  task_ = std::make_unique<PollingTask>(
+      executor, [this]() { return Poll(); }, kIdleTimeout);
+  hook_id_ = event_bus_->AddPublishHook(channels::kHistoryImport,
+                                        task_->GetNotifier());
+  task_->Start();
+}
+
+void HistoryImportService::Stop() {
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+  if (task_) {
+    event_bus_->RemovePublishHook(channels::kHistoryImport, hook_id_);
+    task_->Stop();
+    task_.reset();
+  }
+}
+
+bool HistoryImportService::Poll() {
+  bool applied = false;
+  while (auto event = batches_->ReadNext<HistoryImportBatch>()) {
+    const HistoryImportBatch *batch = event->GetData<HistoryImportBatch>();
+    history_.Append(batch->rows);
+
+    check_ins_.clear();
+    for (const HistoryRow &row : batch->rows) {
+      check_ins_.push_back(CheckIn{row.habit_id, row.day, row.value > 0});
+    }
+    store_.Apply(check_ins_);
+    applied_rows_ += batch->rows.size();
+    applied = true;
+  }
+  return applied;
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,183 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_IO_HISTORY_IMPORT_H_
+#define HABITIFY_SRC_CORE_IO_HISTORY_IMPORT_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_history_service.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+
+/// Text formats of the habit history. Both have one row per line:
+///   - kCsv: day,habit_id,value with the day as YYYY-MM-DD. A first line
+///     that does not start with a digit is treated as header. Quoted fields
+///     are not supported.
+///   - kNdjson: {"day":"YYYY-MM-DD","habit_id":1,"value":1} with the keys in
+///     any order. Other keys are ignored, escaped strings are rejected.
+enum class HistoryFormat { kCsv, kNdjson };
+
+/// Outcome of an import. Invalid rows are skipped and the first
+/// kMaxReportedErrors of them are described in errors. An import that was
+/// cancelled, or whose batches no Listener read, stops early with cancelled
+/// set and the reason as last error.
+struct ImportReport {
+  bool opened = false;
+  bool cancelled = false;
+  size_t rows = 0;
+  size_t invalid_rows = 0;
+  size_t batches = 0;
+  std::vector<std::string> errors;
+};
+
+/// HistoryImporter reads the habit history from a file and publishes it as
+/// HistoryImportBatch on channels::kHistoryImport. The file is mapped instead
+/// of read and split into chunks at line boundaries. A window of chunks is
+/// parsed in parallel on the Executor, published in file order and released
+/// again, so the mapped file does not stay resident. The bus keeps every
+/// batch until all Listeners of the channel have read it, so before the next
+/// window is parsed the importer waits until at most kMaxUnreadBatches are
+/// unread. A HistoryImportService that falls behind therefore slows the
+/// import down instead of piling up rows. If the unread batches do not drop
+/// for kListenerTimeout, e.g. because there is no Listener or it stopped
+/// reading, the import is cancelled, as it is once stop is requested. Usage:
+///       HistoryImporter importer(event_bus, &executor);
+///       ImportReport report = importer.ImportFile(path, HistoryFormat::kCsv);
+/// NOTE: HistoryImporter runs one import at a time.
+class HistoryImporter {
+ public:
+  /// Chunks end at the first newline after this many bytes.
+  static constexpr size_t kChunkBytes = 1 << 20;
+  /// Upper bound for the rows of one HistoryImportBatch.
+  static constexpr size_t kBatchRows = 4096;
+  static constexpr size_t kMaxReportedErrors = 16;
+  /// Batches that may wait for the slowest Listener before the importer
+  /// stops parsing.
+  static constexpr size_t kMaxUnreadBatches = 64;
+  static constexpr std::chrono::seconds kListenerTimeout{5};
+
+  /// executor must outlive the importer. Without one the chunks are parsed
+  /// on the calling thread. Once stop is requested the import ends before
+  /// the next window of chunks.
+  explicit HistoryImporter(std::shared_ptr<EventBus> event_bus,
+                           Executor *executor = nullptr,
+                           std::stop_token stop = {});
+
+  HistoryImporter(const HistoryImporter &) = delete;
+  const HistoryImporter &operator=(const HistoryImporter &) = delete;
+
+  ImportReport ImportFile(const std::string &path, HistoryFormat format);
+  /// Imports data that is already in memory.
+  ImportReport Import(std::string_view data, HistoryFormat format);
+
+ private:
+  struct Chunk {
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<HistoryRow> rows;
+    size_t invalid_rows = 0;
+    std::vector<std::string> errors;
+  };
+
+  /// Release is called with every range of data that was published.
+  template <typename Release>
+  ImportReport Run(std::string_view data, HistoryFormat format,
+                   Release &&release);
+  void ParseChunk(std::string_view data, HistoryFormat format, Chunk &chunk);
+  void PublishBatch(std::shared_ptr<HistoryImportBatch> batch);
+  /// Blocks until at most kMaxUnreadBatches are unread. Runs other tasks of
+  /// the Executor in the meantime if called from one of its workers. Returns
+  /// the reason if the import has to stop instead and nullptr otherwise.
+  const char *WaitForListeners();
+
+ private:
+  static constexpr std::chrono::milliseconds kListenerPollInterval{1};
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Publisher<HistoryImportBatch>> batches_;
+  Executor *executor_;
+  std::stop_token stop_;
+  uint64_t next_import_id_ = 1;
+};
+
+/// Parses one line of the format. Exposed for testing. Returns the reason if
+/// the line is invalid and nullptr otherwise.
+const char *ParseCsvRow(std::string_view line, HistoryRow &row);
+const char *ParseNdjsonRow(std::string_view line, HistoryRow &row);
+
+/// HistoryImportService applies the batches on channels::kHistoryImport.
+/// The rows are appended to the history and rows with a value above zero
+/// mark their day as completed in the store. Usage:
+///       HistoryImportService imports(event_bus, *history, store);
+///       imports.Start();
+class HistoryImportService {
+ public:
+  /// history and store must outlive the service.
+  HistoryImportService(std::shared_ptr<EventBus> event_bus,
+                       InMemoryHabitHistory &history, HabitStore &store);
+  ~HistoryImportService();
+
+  HistoryImportService(const HistoryImportService &) = delete;
+  const HistoryImportService &operator=(const HistoryImportService &) = delete;
+
+  /// Runs Poll() on a dedicated thread until Stop() is called.
+  void Start();
+  /// Runs Poll() as a PollingTask on executor until Stop() is called. The
+  /// task is woken up by new batches and runs at least every kIdleTimeout.
+  void Start(Executor &executor);
+  void Stop();
+
+  /// Applies all new batches. Returns true if any batch was applied.
+  bool Poll();
+
+  // Getters
+  inline const size_t get_applied_rows() const { return applied_rows_; }
+
+ private:
+  static constexpr std::chrono::milliseconds kIdleTimeout{100};
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Listener> batches_;
+  InMemoryHabitHistory &history_;
+  HabitStore &store_;
+  std::vector<CheckIn> check_ins_;
+  std::atomic<size_t> applied_rows_ = 0;
+
+  std::atomic<bool> running_ = false;
+  std::thread thread_;
+  std::unique_ptr<PollingTask> task_;
+  PublishHookId hook_id_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_IO_HISTORY_IMPORT_H_
@@ -0,0 +1,105 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/io/mapped_file.h"
+
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HABITIFY_HAS_MMAP 1
+#else
+#include <fstream>
+#endif
+
+namespace habitify_core {
+
+MappedFile::~MappedFile() { Close(); }
+
+#if defined(HABITIFY_HAS_MMAP)
+bool MappedFile::Open(const std::string &path) {
+  Close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_ = (size_t)info.st_size;
+  if (size_ > 0) {
+    void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      size_ = 0;
+      return false;
+    }
+    ::madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(data);
+    is_mapped_ = true;
+  }
+  // The mapping stays valid without the descriptor.
+  ::close(fd);
+  return is_open_ = true;
+}
+
+void MappedFile::Close() {
+  if (is_mapped_) ::munmap(const_cast<char *>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+  is_open_ = is_mapped_ = false;
+}
+
+void MappedFile::Release(size_t offset, size_t length) {
+  if (!is_mapped_ || offset >= size_) return;
+  // madvise works on whole pages, partially used pages are kept.
+  size_t page = (size_t)::sysconf(_SC_PAGESIZE);
+  size_t first = (offset + page - 1) / page * page;
+  size_t last = std::min(offset + length, size_) / page * page;
+  if (first < last) {
+    ::madvise(const_cast<char *>(data_) + first, last - first, MADV_DONTNEED);
+  }
+}
+#else
+bool MappedFile::Open(const std::string &path) {
+  Close();
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) return false;
+  buffer_.resize((size_t)file.tellg());
+  file.seekg(0);
+  if (!file.read(buffer_.data(), buffer_.size())) return false;
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  return is_open_ = true;
+}
+
+void MappedFile::Close() {
+  buffer_ = {};
+  data_ = nullptr;
+  size_ = 0;
+  is_open_ = false;
+}
+
+void MappedFile::Release(size_t offset, size_t length) {}
+#endif
+
+}  // namespace habitify_core
@@ -0,0 +1,67 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_IO_MAPPED_FILE_H_
+#define HABITIFY_SRC_CORE_IO_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace habitify_core {
+
+/// MappedFile maps a file read only into memory. The pages are backed by the
+/// file, so reading a large file only costs the pages that are currently in
+/// use and Release() gives processed ranges back. On platforms without mmap
+/// the file is read into memory instead. Usage:
+///       MappedFile file;
+///       if (!file.Open(path)) return;
+///       Process(file.get_data());
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  const MappedFile &operator=(const MappedFile &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+
+  /// Tells the kernel that [offset, offset + length) is not needed anymore.
+  /// The data stays readable, it is read from the file again if touched.
+  void Release(size_t offset, size_t length);
+
+  inline const std::string_view get_data() const {
+    return std::string_view(data_, size_);
+  }
+  inline const bool is_open() const { return is_open_; }
+
+ private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  bool is_open_ = false;
+  bool is_mapped_ = false;
+  /// Only used without mmap.
+  std::vector<char> buffer_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_IO_MAPPED_FILE_H_
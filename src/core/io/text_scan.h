@@ -0,0 +1,186 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_IO_TEXT_SCAN_H_
+#define HABITIFY_SRC_CORE_IO_TEXT_SCAN_H_
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "src/core/habits/habit_types.h"
+
+/// Scanning and number parsing for the text formats of the habit history.
+/// Delimiters are found 16 bytes at a time with SSE2 and numbers of up to
+/// eight digits are converted in a handful of multiplications (SWAR) instead
+/// of one per digit. Both have scalar fallbacks.
+namespace habitify_core::scan {
+
+/// Calls f(position) for every byte in [begin, end) that equals a or b, in
+/// order.
+template <typename F>
+inline void ForEachOf(const char *begin, const char *end, char a, char b,
+                      F &&f) {
+  const char *p = begin;
+#if defined(__SSE2__)
+  const __m128i match_a = _mm_set1_epi8(a);
+  const __m128i match_b = _mm_set1_epi8(b);
+  for (; p + 16 <= end; p += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(v, match_a), _mm_cmpeq_epi8(v, match_b)));
+    while (mask != 0) {
+      f(p + std::countr_zero(mask));
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == a || *p == b) f(p);
+  }
+}
+
+/// Returns the first newline in [begin, end) or end.
+inline const char *FindNewline(const char *begin, const char *end) {
+  const void *newline = std::memchr(begin, '\n', (size_t)(end - begin));
+  return newline ? static_cast<const char *>(newline) : end;
+}
+
+namespace internal {
+/// True if all eight bytes of chunk are ASCII digits.
+inline bool AllDigits(uint64_t chunk) {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+          (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+/// Converts eight ASCII digits, the first one in the lowest byte, see
+/// Lemire, "Quickly parsing eight digits".
+inline uint32_t ParseEightDigits(uint64_t chunk) {
+  chunk -= 0x3030303030303030;
+  chunk = (chunk * 10) + (chunk >> 8);
+  chunk = (((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+           (((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >>
+          32;
+  return (uint32_t)chunk;
+}
+}  // namespace internal
+
+/// Parses up to eight digits. Returns false for anything else, including an
+/// empty field.
+inline bool ParseDigits(std::string_view digits, uint32_t &out) {
+  if (digits.empty() || digits.size() > 8) return false;
+  if constexpr (std::endian::native == std::endian::little) {
+    // Left pad with zeros so that the number ends in the highest byte.
+    char buffer[8] = {'0', '0', '0', '0', '0', '0', '0', '0'};
+    std::memcpy(buffer + 8 - digits.size(), digits.data(), digits.size());
+    uint64_t chunk;
+    std::memcpy(&chunk, buffer, 8);
+    if (!internal::AllDigits(chunk)) return false;
+    out = internal::ParseEightDigits(chunk);
+    return true;
+  } else {
+    uint32_t value = 0;
+    for (char c : digits) {
+      if (c < '0' || c > '9') return false;
+      value = value * 10 + (uint32_t)(c - '0');
+    }
+    out = value;
+    return true;
+  }
+}
+
+/// Parses an optionally signed integer that fits into int32_t.
+inline bool ParseInt32(std::string_view field, int32_t &out) {
+  bool negative = !field.empty() && field.front() == '-';
+  if (negative) field.remove_prefix(1);
+
+  uint64_t value;
+  uint32_t low;
+  if (field.size() <= 8) {
+    if (!ParseDigits(field, low)) return false;
+    value = low;
+  } else if (field.size() <= 10) {
+    uint32_t high;
+    size_t split = field.size() - 8;
+    if (!ParseDigits(field.substr(0, split), high) ||
+        !ParseDigits(field.substr(split), low))
+      return false;
+    value = (uint64_t)high * 100000000 + low;
+  } else {
+    return false;
+  }
+  if (value > (uint64_t)INT32_MAX + negative) return false;
+  out = negative ? (int32_t)(-(int64_t)value) : (int32_t)value;
+  return true;
+}
+
+/// Parses a calendar date in the form YYYY-MM-DD and rejects dates that do
+/// not exist.
+inline bool ParseDate(std::string_view field, Day &out) {
+  if (field.size() != 10 || field[4] != '-' || field[7] != '-') return false;
+  // YYYYMMDD as one eight digit number
+  char digits[8];
+  std::memcpy(digits, field.data(), 4);
+  std::memcpy(digits + 4, field.data() + 5, 2);
+  std::memcpy(digits + 6, field.data() + 8, 2);
+  uint32_t value;
+  if (!ParseDigits(std::string_view(digits, 8), value)) return false;
+
+  int year = (int)(value / 10000);
+  unsigned month = value / 100 % 100, day_of_month = value % 100;
+  if (month < 1 || month > 12 || day_of_month < 1 || day_of_month > 31)
+    return false;
+  Day day = DaysFromCivil(year, month, day_of_month);
+  // Catches the 31st of short months and the 29th of February.
+  int check_year;
+  unsigned check_month, check_day;
+  CivilFromDays(day, check_year, check_month, check_day);
+  if (check_month != month) return false;
+  out = day;
+  return true;
+}
+
+/// Writes day as YYYY-MM-DD. out needs room for 10 characters.
+inline char *FormatDate(Day day, char *out) {
+  int year;
+  unsigned month, day_of_month;
+  CivilFromDays(day, year, month, day_of_month);
+  unsigned y = (unsigned)year % 10000;
+  out[0] = (char)('0' + y / 1000);
+  out[1] = (char)('0' + y / 100 % 10);
+  out[2] = (char)('0' + y / 10 % 10);
+  out[3] = (char)('0' + y % 10);
+  out[4] = '-';
+  out[5] = (char)('0' + month / 10);
+  out[6] = (char)('0' + month % 10);
+  out[7] = '-';
+  out[8] = (char)('0' + day_of_month / 10);
+  out[9] = (char)('0' + day_of_month % 10);
+  return out + 10;
+}
+
+}  // namespace habitify_core::scan
+
+#endif  // HABITIFY_SRC_CORE_IO_TEXT_SCAN_H_
@@ -0,0 +1,150 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/metrics/latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+namespace habitify_core {
+
+LatencyHistogram::LatencyHistogram(uint64_t max_value, int significant_digits)
+    : max_value_(std::max<uint64_t>(max_value, 2)) {
+  assert(significant_digits >= 1 && significant_digits <= 5);
+  significant_digits = std::clamp(significant_digits, 1, 5);
+
+  // Two sub buckets per unit of the last significant digit, e.g. 2048 for
+  // three digits, keep the error below one part in 10^significant_digits.
+  uint64_t largest_single_unit = 2;
+  for (int i = 0; i < significant_digits; i++) largest_single_unit *= 10;
+  int sub_bucket_count_magnitude = std::bit_width(largest_single_unit - 1);
+  sub_bucket_half_count_magnitude_ = sub_bucket_count_magnitude - 1;
+  sub_bucket_half_count_ = uint64_t(1) << sub_bucket_half_count_magnitude_;
+  sub_bucket_mask_ = (uint64_t(1) << sub_bucket_count_magnitude) - 1;
+
+  // The first bucket covers [0, sub_bucket_count), every further one doubles
+  // the range with half of the sub buckets.
+  size_t bucket_count = 1;
+  uint64_t smallest_untrackable = uint64_t(1) << sub_bucket_count_magnitude;
+  while (smallest_untrackable <= max_value_) {
+    bucket_count++;
+    if (smallest_untrackable > UINT64_MAX / 2) break;
+    smallest_untrackable <<= 1;
+  }
+  counts_.assign((bucket_count + 1) * sub_bucket_half_count_, 0);
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count) {
+  value = std::min(value, max_value_);
+  counts_[CountsIndexOf(value)] += count;
+  total_count_ += count;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::RecordCorrected(uint64_t value,
+                                       uint64_t expected_interval) {
+  Record(value);
+  if (expected_interval == 0) return;
+  for (uint64_t missed = value; missed > expected_interval;) {
+    missed -= expected_interval;
+    Record(missed);
+  }
+}
+
+void LatencyHistogram::Add(const LatencyHistogram &other) {
+  assert(counts_.size() == other.counts_.size() &&
+         sub_bucket_mask_ == other.sub_bucket_mask_ &&
+         "Histograms must have the same layout");
+  for (size_t i = 0; i < counts_.size(); i++) counts_[i] += other.counts_[i];
+  total_count_ += other.total_count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  total_count_ = 0;
+  min_ = UINT64_MAX;
+  max_ = 0;
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+  if (total_count_ == 0) return 0;
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  // Rounded rather than ceiled so that 99.9 of 100000 is not 99901.
+  uint64_t rank = (uint64_t)(percentile / 100.0 * total_count_ + 0.5);
+  rank = std::clamp<uint64_t>(rank, 1, total_count_);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(HighestEquivalentValue(ValueAtIndex(i)), max_);
+    }
+  }
+  return max_;
+}
+
+double LatencyHistogram::Mean() const {
+  if (total_count_ == 0) return 0.0;
+  double sum = 0.0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    if (counts_[i] == 0) continue;
+    // The middle of the bucket is the best guess for its values.
+    uint64_t lowest = ValueAtIndex(i);
+    sum += counts_[i] * (lowest + EquivalentRange(lowest) / 2.0);
+  }
+  return sum / total_count_;
+}
+
+uint64_t LatencyHistogram::HighestEquivalentValue(uint64_t value) const {
+  uint64_t lowest = ValueAtIndex(CountsIndexOf(std::min(value, max_value_)));
+  return lowest + EquivalentRange(lowest) - 1;
+}
+
+uint64_t LatencyHistogram::EquivalentRange(uint64_t value) const {
+  int bucket_index = std::bit_width(value | sub_bucket_mask_) -
+                     (sub_bucket_half_count_magnitude_ + 1);
+  return uint64_t(1) << bucket_index;
+}
+
+size_t LatencyHistogram::CountsIndexOf(uint64_t value) const {
+  // The bucket is the power of two range above the sub bucket resolution, the
+  // sub bucket the remaining top bits of value.
+  int bucket_index = std::bit_width(value | sub_bucket_mask_) -
+                     (sub_bucket_half_count_magnitude_ + 1);
+  uint64_t sub_bucket_index = value >> bucket_index;
+  return ((size_t)(bucket_index + 1) << sub_bucket_half_count_magnitude_) +
+         (size_t)(sub_bucket_index - sub_bucket_half_count_);
+}
+
+uint64_t LatencyHistogram::ValueAtIndex(size_t index) const {
+  int bucket_index = (int)(index >> sub_bucket_half_count_magnitude_) - 1;
+  uint64_t sub_bucket_index =
+      (index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+  if (bucket_index < 0) {
+    sub_bucket_index -= sub_bucket_half_count_;
+    bucket_index = 0;
+  }
+  return sub_bucket_index << bucket_index;
+}
+
+}  // namespace habitify_core
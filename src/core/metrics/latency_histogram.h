@@ -0,0 +1,92 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_METRICS_LATENCY_HISTOGRAM_H_
+#define HABITIFY_SRC_CORE_METRICS_LATENCY_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace habitify_core {
+
+/// LatencyHistogram records integer values, e.g. nanoseconds, with a fixed
+/// relative precision in the layout of an HdrHistogram: every power of two
+/// range is split into the same number of linear sub buckets. Recording is a
+/// couple of shifts and an increment, the memory does not depend on how many
+/// values are recorded and two histograms with the same layout can be added
+/// up. Not thread safe, every recording thread should own a histogram and
+/// they are merged at the end. Usage:
+///       LatencyHistogram histogram(kMaxLatencyNs, 3);
+///       histogram.Record(latency_ns);
+///       histogram.ValueAtPercentile(99.9);
+class LatencyHistogram {
+ public:
+  /// Values up to max_value are recorded with significant_digits (1 to 5)
+  /// decimal digits of precision. Larger values are clamped to max_value.
+  explicit LatencyHistogram(uint64_t max_value, int significant_digits = 3);
+
+  void Record(uint64_t value, uint64_t count = 1);
+  /// Records value and compensates for coordinated omission: if a measurement
+  /// that should have been taken every expected_interval stalled for value,
+  /// the samples that would have been taken meanwhile are recorded as well,
+  /// i.e. value - expected_interval, value - 2 * expected_interval, ...
+  void RecordCorrected(uint64_t value, uint64_t expected_interval);
+  /// Adds all values of other, which must have the same layout.
+  void Add(const LatencyHistogram &other);
+  void Reset();
+
+  /// Smallest recorded value v such that percentile percent of all values are
+  /// less than or equal to v, within the precision of the histogram. Returns
+  /// 0 if the histogram is empty.
+  uint64_t ValueAtPercentile(double percentile) const;
+  double Mean() const;
+
+  inline const uint64_t get_total_count() const { return total_count_; }
+  /// Exact smallest and largest recorded value.
+  inline const uint64_t get_min() const {
+    return total_count_ ? min_ : 0;
+  }
+  inline const uint64_t get_max() const { return max_; }
+  inline const uint64_t get_max_trackable() const { return max_value_; }
+
+  /// Largest value that is recorded into the same bucket as value.
+  uint64_t HighestEquivalentValue(uint64_t value) const;
+  /// Largest difference between a value and the value it is reported as.
+  uint64_t EquivalentRange(uint64_t value) const;
+
+ private:
+  size_t CountsIndexOf(uint64_t value) const;
+  uint64_t ValueAtIndex(size_t index) const;
+
+ private:
+  uint64_t max_value_;
+  /// log2 of half the number of sub buckets per power of two range.
+  int sub_bucket_half_count_magnitude_;
+  uint64_t sub_bucket_half_count_;
+  uint64_t sub_bucket_mask_;
+
+  std::vector<uint64_t> counts_;
+  uint64_t total_count_ = 0;
+  uint64_t min_ = UINT64_MAX;
+  uint64_t max_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_METRICS_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,151 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/metrics/memory_tracking.h"
+
+#include <algorithm>
+#include <array>
+
+namespace habitify_core {
+
+const char *MemoryTagName(MemoryTag tag) {
+  switch (tag) {
+    case MemoryTag::kEventBus:
+      return "eventbus";
+    case MemoryTag::kFrontend:
+      return "frontend";
+    case MemoryTag::kStore:
+      return "store";
+    case MemoryTag::kCache:
+      return "cache";
+    default:
+      return "unknown";
+  }
+}
+
+MemoryStats TrackingMemoryResource::GetStats() const {
+  MemoryStats stats;
+  stats.name = name_;
+  // Read deallocations first so that live_allocations cannot underflow.
+  uint64_t deallocations = 0;
+  for (const Shard &shard : shards_) {
+    deallocations += shard.deallocations.load(std::memory_order_relaxed);
+  }
+  int64_t live = live_bytes_.load(std::memory_order_relaxed);
+  for (const Shard &shard : shards_) {
+    stats.allocations += shard.allocations.load(std::memory_order_relaxed);
+    stats.allocated_bytes +=
+        shard.allocated_bytes.load(std::memory_order_relaxed);
+    live += shard.pending_bytes.load(std::memory_order_relaxed);
+  }
+  stats.live_allocations =
+      stats.allocations > deallocations ? stats.allocations - deallocations
+                                        : 0;
+  stats.live_bytes = live > 0 ? (size_t)live : 0;
+  stats.peak_bytes = std::max(peak_bytes_.load(std::memory_order_relaxed),
+                              stats.live_bytes);
+  return stats;
+}
+
+void *TrackingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+  void *p = upstream_->allocate(bytes, alignment);
+  Shard &shard = GetShard();
+  shard.allocations.fetch_add(1, std::memory_order_relaxed);
+  shard.allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  int64_t pending =
+      shard.pending_bytes.fetch_add((int64_t)bytes, std::memory_order_relaxed) +
+      (int64_t)bytes;
+
+  // Only a possible new peak or a full shard pays for touching the shared
+  // counters.
+  if (pending >= kFlushBytes ||
+      live_bytes_.load(std::memory_order_relaxed) + pending >
+          (int64_t)peak_bytes_.load(std::memory_order_relaxed)) {
+    Flush(shard);
+  }
+  return p;
+}
+
+void TrackingMemoryResource::do_deallocate(void *p, size_t bytes,
+                                           size_t alignment) {
+  Shard &shard = GetShard();
+  shard.deallocations.fetch_add(1, std::memory_order_relaxed);
+  int64_t pending =
+      shard.pending_bytes.fetch_sub((int64_t)bytes, std::memory_order_relaxed) -
+      (int64_t)bytes;
+  if (pending <= -kFlushBytes) Flush(shard);
+  upstream_->deallocate(p, bytes, alignment);
+}
+
+TrackingMemoryResource::Shard &TrackingMemoryResource::GetShard() {
+  // Threads are spread over the shards in the order they first allocate.
+  static std::atomic<size_t> next_thread = 0;
+  thread_local size_t index =
+      next_thread.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return shards_[index];
+}
+
+void TrackingMemoryResource::Flush(Shard &shard) {
+  int64_t pending = shard.pending_bytes.exchange(0, std::memory_order_relaxed);
+  int64_t live =
+      live_bytes_.fetch_add(pending, std::memory_order_relaxed) + pending;
+  if (live <= 0) return;
+
+  size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+  while ((size_t)live > peak &&
+         !peak_bytes_.compare_exchange_weak(peak, (size_t)live,
+                                            std::memory_order_relaxed)) {
+  }
+}
+
+TrackingMemoryResource *GetMemoryResource(MemoryTag tag) {
+  // Never destroyed, objects with static storage may free memory during exit.
+  static auto *resources = new std::array<TrackingMemoryResource,
+                                          (size_t)MemoryTag::kCount>{
+      TrackingMemoryResource(MemoryTagName(MemoryTag::kEventBus)),
+      TrackingMemoryResource(MemoryTagName(MemoryTag::kFrontend)),
+      TrackingMemoryResource(MemoryTagName(MemoryTag::kStore)),
+      TrackingMemoryResource(MemoryTagName(MemoryTag::kCache)),
+  };
+  return &(*resources)[(size_t)tag];
+}
+
+std::vector<MemoryStats> GetMemoryStats() {
+  std::vector<MemoryStats> stats;
+  for (size_t tag = 0; tag < (size_t)MemoryTag::kCount; tag++) {
+    stats.push_back(GetMemoryResource((MemoryTag)tag)->GetStats());
+  }
+  return stats;
+}
+
+void WriteMemoryStatsJson(const std::vector<MemoryStats> &stats,
+                          std::ostream &out) {
+  out << "[";
+  for (size_t i = 0; i < stats.size(); i++) {
+    const MemoryStats &s = stats[i];
+    out << (i ? ",\n " : "\n ") << "{\"name\": \"" << s.name
+        << "\", \"live_bytes\": " << s.live_bytes
+        << ", \"peak_bytes\": " << s.peak_bytes
+        << ", \"live_allocations\": " << s.live_allocations
+        << ", \"allocations\": " << s.allocations
+        << ", \"allocated_bytes\": " << s.allocated_bytes << "}";
+  }
+  out << "\n]\n";
+}
+
+}  // namespace habitify_core
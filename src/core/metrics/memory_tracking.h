@@ -0,0 +1,148 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_METRICS_MEMORY_TRACKING_H_
+#define HABITIFY_SRC_CORE_METRICS_MEMORY_TRACKING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <ostream>
+#include <vector>
+
+namespace habitify_core {
+
+/// Subsystems whose memory is accounted separately.
+enum class MemoryTag : uint8_t {
+  kEventBus,
+  kFrontend,
+  kStore,
+  kCache,
+  kCount
+};
+
+const char *MemoryTagName(MemoryTag tag);
+
+/// Counters of a TrackingMemoryResource at one point in time.
+struct MemoryStats {
+  const char *name = "";
+  size_t live_bytes = 0;
+  size_t peak_bytes = 0;
+  /// Allocations that were not freed yet.
+  size_t live_allocations = 0;
+  /// Totals since the start of the process. Rates are the difference of two
+  /// samples.
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+};
+
+/// TrackingMemoryResource forwards to its upstream resource and counts live
+/// bytes, peak usage and the number of allocations. Every thread counts on
+/// one of kShards cache lines and GetStats() sums them up, so threads that
+/// allocate concurrently do not contend on the counters. Live bytes are only
+/// moved to the shared total once a shard collected kFlushBytes or a new peak
+/// is reached. The peak is exact for a single thread and may be off by up to
+/// kShards * kFlushBytes while several threads allocate. Usage:
+///       std::pmr::vector<int> v(GetMemoryResource(MemoryTag::kStore));
+///       GetMemoryResource(MemoryTag::kStore)->GetStats().live_bytes;
+class alignas(64) TrackingMemoryResource : public std::pmr::memory_resource {
+ public:
+  explicit TrackingMemoryResource(
+      const char *name,
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : name_(name), upstream_(upstream) {}
+
+  TrackingMemoryResource(const TrackingMemoryResource &) = delete;
+  const TrackingMemoryResource &operator=(const TrackingMemoryResource &) =
+      delete;
+
+  MemoryStats GetStats() const;
+
+ protected:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+  bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+ private:
+  static constexpr size_t kShards = 16;
+  static constexpr int64_t kFlushBytes = 64 * 1024;
+
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> allocations = 0;
+    std::atomic<uint64_t> deallocations = 0;
+    std::atomic<uint64_t> allocated_bytes = 0;
+    /// Live bytes not yet moved to live_bytes_. Negative if this shard freed
+    /// more than it allocated, e.g. memory of another thread.
+    std::atomic<int64_t> pending_bytes = 0;
+  };
+
+  /// The shard of the calling thread.
+  Shard &GetShard();
+  /// Moves the pending bytes of shard to live_bytes_ and updates the peak.
+  void Flush(Shard &shard);
+
+ private:
+  const char *name_;
+  std::pmr::memory_resource *upstream_;
+
+  Shard shards_[kShards];
+  /// Only written by Flush(), so reading them is cheap.
+  alignas(64) std::atomic<int64_t> live_bytes_ = 0;
+  std::atomic<size_t> peak_bytes_ = 0;
+};
+
+/// The resource of a subsystem. It lives until the end of the process, so
+/// objects with static storage may use it as well.
+TrackingMemoryResource *GetMemoryResource(MemoryTag tag);
+
+/// Stats of every subsystem, in the order of MemoryTag.
+std::vector<MemoryStats> GetMemoryStats();
+/// Writes stats as a JSON array of objects, one per subsystem.
+void WriteMemoryStatsJson(const std::vector<MemoryStats> &stats,
+                          std::ostream &out);
+
+/// Base class that places every object of the derived class created with new
+/// on the resource of tag. Derived classes that are deleted through a base
+/// pointer need a virtual destructor so that the right size is freed.
+template <MemoryTag tag>
+class TrackedObject {
+ public:
+  static void *operator new(size_t size) {
+    return GetMemoryResource(tag)->allocate(size,
+                                            alignof(std::max_align_t));
+  }
+  static void *operator new(size_t size, std::align_val_t alignment) {
+    return GetMemoryResource(tag)->allocate(size, (size_t)alignment);
+  }
+  static void operator delete(void *p, size_t size) {
+    GetMemoryResource(tag)->deallocate(p, size, alignof(std::max_align_t));
+  }
+  static void operator delete(void *p, size_t size,
+                              std::align_val_t alignment) {
+    GetMemoryResource(tag)->deallocate(p, size, (size_t)alignment);
+  }
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_METRICS_MEMORY_TRACKING_H_
@@ -0,0 +1,120 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/query/habit_catalog.h"
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+
+namespace habitify_core {
+
+void HabitCatalog::PostingList::Add(uint32_t ordinal) {
+  // Ordinals only grow, so a repeated tag is always the last entry.
+  if (!ordinals.empty() && ordinals.back() == ordinal) return;
+  ordinals.push_back(ordinal);
+  if (bits.size() <= ordinal / 64) bits.resize(ordinal / 64 + 1, 0);
+  bits[ordinal / 64] |= uint64_t(1) << (ordinal % 64);
+}
+
+bool HabitCatalog::AddHabit(const HabitInfo &info) {
+  std::unique_lock<std::shared_mutex> lock(mux_);
+  uint32_t ordinal = (uint32_t)habits_.size();
+  if (!ordinals_.emplace(info.habit_id, ordinal).second) return false;
+
+  habits_.push_back(info);
+  users_[info.user_id].Add(ordinal);
+  for (const std::string &tag : info.tags) tags_[tag].Add(ordinal);
+  return true;
+}
+
+std::optional<HabitInfo> HabitCatalog::GetHabit(HabitId id) const {
+  std::shared_lock<std::shared_mutex> lock(mux_);
+  auto it = ordinals_.find(id);
+  if (it == ordinals_.end()) return std::nullopt;
+  return habits_[it->second];
+}
+
+size_t HabitCatalog::GetHabitCount() const {
+  std::shared_lock<std::shared_mutex> lock(mux_);
+  return habits_.size();
+}
+
+std::vector<HabitId> HabitCatalog::SelectHabits(
+    const std::optional<uint64_t> &user_id,
+    const std::vector<std::string> &tags, Access *access) const {
+  std::shared_lock<std::shared_mutex> lock(mux_);
+  std::vector<HabitId> result;
+
+  std::vector<const PostingList *> lists;
+  if (user_id) {
+    auto it = users_.find(*user_id);
+    if (it == users_.end()) return result;
+    lists.push_back(&it->second);
+  }
+  for (const std::string &tag : tags) {
+    auto it = tags_.find(tag);
+    if (it == tags_.end()) return result;
+    lists.push_back(&it->second);
+  }
+
+  if (lists.empty()) {
+    if (access) *access = Access::kFullScan;
+    result.reserve(habits_.size());
+    for (const HabitInfo &info : habits_) result.push_back(info.habit_id);
+    return result;
+  }
+
+  // Walking the shortest list probes every other list once per entry, the
+  // intersection touches every word of every bitset. Selective predicates
+  // favour the walk, broad ones the intersection.
+  std::sort(lists.begin(), lists.end(),
+            [](const PostingList *a, const PostingList *b) {
+              return a->ordinals.size() < b->ordinals.size();
+            });
+  size_t scan_cost = lists[0]->ordinals.size() * (lists.size() - 1);
+  size_t intersect_cost = lists[0]->bits.size() * lists.size();
+
+  if (scan_cost <= intersect_cost) {
+    if (access) *access = Access::kIndexScan;
+    for (uint32_t ordinal : lists[0]->ordinals) {
+      bool match = std::all_of(
+          lists.begin() + 1, lists.end(),
+          [&](const PostingList *list) { return list->Contains(ordinal); });
+      if (match) result.push_back(habits_[ordinal].habit_id);
+    }
+    return result;
+  }
+
+  if (access) *access = Access::kBitsetIntersection;
+  // Words past the end of the shortest list cannot contain a match.
+  for (size_t word = 0; word < lists[0]->bits.size(); word++) {
+    uint64_t bits = lists[0]->bits[word];
+    for (size_t i = 1; i < lists.size() && bits != 0; i++) {
+      bits &= lists[i]->GetWord(word);
+    }
+    while (bits != 0) {
+      size_t ordinal = word * 64 + (size_t)std::countr_zero(bits);
+      result.push_back(habits_[ordinal].habit_id);
+      bits &= bits - 1;
+    }
+  }
+  return result;
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,97 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_QUERY_HABIT_CATALOG_H_
+#define HABITIFY_SRC_CORE_QUERY_HABIT_CATALOG_H_
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/core/habits/habit_types.h"
+
+namespace habitify_core {
+
+/// HabitCatalog stores the HabitInfo of every habit together with secondary
+/// indexes from users and tags to their habits. Every index entry is kept
+/// both as a sorted list and as a bitset over the habits, which lets
+/// SelectHabits() pick the cheaper way to combine several predicates.
+/// Thread safe. Usage:
+///       HabitCatalog catalog;
+///       catalog.AddHabit({habit, user, {"health"}});
+///       auto habits = catalog.SelectHabits(user, {"health"});
+class HabitCatalog {
+ public:
+  /// How SelectHabits() found the matching habits.
+  enum class Access {
+    /// No predicate, every habit matches.
+    kFullScan,
+    /// Walked the shortest list and probed the bitsets of the others.
+    kIndexScan,
+    /// Intersected the bitsets of all predicates word by word.
+    kBitsetIntersection,
+  };
+
+  HabitCatalog() = default;
+  ~HabitCatalog() = default;
+
+  HabitCatalog(const HabitCatalog &) = delete;
+  const HabitCatalog &operator=(const HabitCatalog &) = delete;
+
+  /// Returns false if the habit already exists.
+  bool AddHabit(const HabitInfo &info);
+  std::optional<HabitInfo> GetHabit(HabitId id) const;
+  size_t GetHabitCount() const;
+
+  /// Returns the habits of user_id, if set, that carry all of tags in the
+  /// order they were added. The strategy that was used is written to access
+  /// if it is not null.
+  std::vector<HabitId> SelectHabits(const std::optional<uint64_t> &user_id,
+                                    const std::vector<std::string> &tags,
+                                    Access *access = nullptr) const;
+
+ private:
+  /// Habits of one user or tag by their position in habits_.
+  struct PostingList {
+    std::vector<uint32_t> ordinals;
+    std::vector<uint64_t> bits;
+
+    void Add(uint32_t ordinal);
+    inline bool Contains(uint32_t ordinal) const {
+      size_t word = ordinal / 64;
+      return word < bits.size() && (bits[word] >> (ordinal % 64)) & 1;
+    }
+    inline uint64_t GetWord(size_t word) const {
+      return word < bits.size() ? bits[word] : 0;
+    }
+  };
+
+ private:
+  mutable std::shared_mutex mux_;
+  std::vector<HabitInfo> habits_;
+  std::unordered_map<HabitId, uint32_t> ordinals_;
+  std::unordered_map<uint64_t, PostingList> users_;
+  std::unordered_map<std::string, PostingList> tags_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_QUERY_HABIT_CATALOG_H_
@@ -0,0 +1,175 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/query/query_service.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+
+namespace habitify_core {
+
+QueryService::QueryService(std::shared_ptr<EventBus> event_bus,
+                           const HabitStore &store,
+                           const HabitCatalog &catalog, Executor *executor,
+                           size_t cache_bytes)
+    : event_bus_(event_bus),
+      store_(store),
+      catalog_(catalog),
+      executor_(executor),
+      cache_(event_bus, cache_bytes) {
+  queries_ = event_bus_->SubscribeTo(channels::kHabitQuery);
+  results_ = event_bus_->RegisterPublisher<HabitQueryResult>(
+      channels::kHabitQueryResult);
+}
+
+QueryService::~QueryService() { Stop(); }
+
+void QueryService::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread([this]() {
+    while (running_) {
+      if (!Poll()) queries_->WaitForEvent(kIdleTimeout);
+    }
+  });
+}
+
+void QueryService::Start(Executor &executor) {
+  if (running_.exchange(true)) return;
+  task_ = std::make_unique<PollingTask>(
+      executor, [this]() { return Poll(); }, kIdleTimeout);
+  hook_id_ =
+      event_bus_->AddPublishHook(channels::kHabitQuery, task_->GetNotifier());
+  task_->Start();
+}
+
+void QueryService::Stop() {
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+  if (task_) {
+    event_bus_->RemovePublishHook(channels::kHabitQuery, hook_id_);
+    task_->Stop();
+    task_.reset();
+  }
+}
+
+bool QueryService::Poll() {
+  // Also keeps the cache from holding back old check-ins while idle.
+  cache_.Sync();
+  bool answered = false;
+  while (auto event = queries_->ReadNext<HabitQuery>()) {
+    Execute(*event->GetData<HabitQuery>());
+    answered = true;
+  }
+  if (answered) cache_.PublishStats();
+  return answered;
+}
+
+QueryService::Plan QueryService::MakePlan(const HabitQuery &query) const {
+  Plan plan;
+  plan.first_day = query.first_day;
+  plan.last_day = query.last_day;
+  if (query.first_day < query.last_day) {
+    plan.habits =
+        catalog_.SelectHabits(query.user_id, query.tags, &plan.access);
+  }
+  return plan;
+}
+
+size_t QueryService::Execute(const HabitQuery &query) {
+  Plan plan = MakePlan(query);
+  uint64_t version = cache_.Sync();
+  std::atomic<uint32_t> sequence = 0;
+  std::atomic<size_t> total_rows = 0;
+
+  size_t job_count = (plan.habits.size() + kHabitsPerJob - 1) / kHabitsPerJob;
+  auto scan = [&](size_t job) {
+    size_t begin = job * kHabitsPerJob;
+    size_t end = std::min(begin + kHabitsPerJob, plan.habits.size());
+
+    std::vector<QueryRow> rows;
+    std::vector<size_t> misses;
+    for (size_t i = begin; i < end; i++) {
+      auto cached = cache_.Find<std::vector<QueryRow>>(
+          {plan.habits[i], kRowsKind, plan.first_day, plan.last_day});
+      if (cached) {
+        rows.insert(rows.end(), cached->begin(), cached->end());
+      } else {
+        misses.push_back(i);
+      }
+    }
+
+    // Only the habits that are not cached are read from the store.
+    std::vector<std::shared_ptr<std::vector<QueryRow>>> computed;
+    if (!misses.empty()) {
+      store_.Read([&](const HabitTable &table) {
+        for (size_t i : misses) {
+          HabitId id = plan.habits[i];
+          auto habit_rows = std::make_shared<std::vector<QueryRow>>();
+          table.ForEachCompletion(
+              id, plan.first_day, plan.last_day,
+              [&](Day day) { habit_rows->push_back({id, day}); });
+          computed.push_back(std::move(habit_rows));
+        }
+      });
+    }
+    for (size_t miss = 0; miss < misses.size(); miss++) {
+      const auto &habit_rows = computed[miss];
+      rows.insert(rows.end(), habit_rows->begin(), habit_rows->end());
+      cache_.Insert<std::vector<QueryRow>>(
+          {plan.habits[misses[miss]], kRowsKind, plan.first_day,
+           plan.last_day},
+          habit_rows, habit_rows->capacity() * sizeof(QueryRow), version);
+    }
+    total_rows += rows.size();
+
+    // Published outside of the store lock so that listeners may write to
+    // the store from a publish hook.
+    for (size_t first = 0; first < rows.size(); first += kMaxChunkRows) {
+      size_t last = std::min(first + kMaxChunkRows, rows.size());
+      PublishChunk(query, sequence++,
+                   std::span<const QueryRow>(rows).subspan(first, last - first),
+                   false, 0);
+    }
+  };
+  if (executor_) {
+    executor_->ParallelFor(job_count, scan);
+  } else {
+    for (size_t job = 0; job < job_count; job++) scan(job);
+  }
+
+  PublishChunk(query, sequence++, {}, true, total_rows);
+  return total_rows;
+}
+
+void QueryService::PublishChunk(const HabitQuery &query, uint32_t sequence,
+                                std::span<const QueryRow> rows, bool last,
+                                size_t total_rows) {
+  auto result = MakePayload<HabitQueryResult>();
+  result->query_id = query.query_id;
+  result->sequence = sequence;
+  result->last = last;
+  result->total_rows = total_rows;
+  result->rows.assign(rows.begin(), rows.end());
+  results_->Publish(std::make_unique<const Event<HabitQueryResult>>(
+      EventType::HABIT_QUERY_RESULT, channels::kHabitQueryResult, result));
+}
+
+}  // namespace habitify_core
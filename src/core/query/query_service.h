@@ -0,0 +1,123 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_QUERY_QUERY_SERVICE_H_
+#define HABITIFY_SRC_CORE_QUERY_QUERY_SERVICE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/query/habit_catalog.h"
+#include "src/core/query/result_cache.h"
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+
+/// QueryService answers HabitQuery requests from channels::kHabitQuery with
+/// chunks of HabitQueryResult on channels::kHabitQueryResult. A query is
+/// answered in two steps:
+///   - The HabitCatalog indexes select the habits of the user and tags,
+///     either by walking the shortest index list or by intersecting bitsets.
+///   - The completion columns of the selected habits are read only for the
+///     words that cover the date range. Groups of habits are scanned in
+///     parallel on the Executor and every group publishes its chunks as soon
+///     as it is done.
+/// Neither step reads habits that do not match or days outside of the range.
+/// The rows of every habit and range are kept in a ResultCache, so a view
+/// that is opened again only reads the habits that changed since. Usage:
+///       QueryService queries(event_bus, store, catalog, &executor);
+///       queries.Start(executor);
+class QueryService {
+ public:
+  /// Number of habits scanned by one job.
+  static constexpr size_t kHabitsPerJob = 32;
+  /// Upper bound for the rows of one HabitQueryResult.
+  static constexpr size_t kMaxChunkRows = 4096;
+
+  /// The habits and days a query has to read.
+  struct Plan {
+    HabitCatalog::Access access = HabitCatalog::Access::kFullScan;
+    std::vector<HabitId> habits;
+    Day first_day = 0;
+    Day last_day = 0;
+  };
+
+  /// store, catalog and executor must outlive the service. Without an
+  /// executor the groups of habits are scanned on the calling thread.
+  QueryService(std::shared_ptr<EventBus> event_bus, const HabitStore &store,
+               const HabitCatalog &catalog, Executor *executor = nullptr,
+               size_t cache_bytes = ResultCache::kDefaultCapacityBytes);
+  ~QueryService();
+
+  QueryService(const QueryService &) = delete;
+  const QueryService &operator=(const QueryService &) = delete;
+
+  /// Runs Poll() on a dedicated thread until Stop() is called.
+  void Start();
+  /// Runs Poll() as a PollingTask on executor until Stop() is called. The
+  /// task is woken up by new queries and runs at least every kIdleTimeout.
+  void Start(Executor &executor);
+  void Stop();
+
+  /// Answers all new queries and publishes the stats of the cache. Returns
+  /// true if any query was answered.
+  bool Poll();
+
+  Plan MakePlan(const HabitQuery &query) const;
+  /// Runs query and publishes its result. Returns the number of rows.
+  size_t Execute(const HabitQuery &query);
+
+  // Getters
+  inline ResultCache &get_cache() { return cache_; }
+
+ private:
+  void PublishChunk(const HabitQuery &query, uint32_t sequence,
+                    std::span<const QueryRow> rows, bool last,
+                    size_t total_rows);
+
+ private:
+  static constexpr std::chrono::milliseconds kIdleTimeout{100};
+  /// ResultCache::Key::kind of the rows of a habit within a range.
+  static constexpr uint32_t kRowsKind = 1;
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Listener> queries_;
+  std::shared_ptr<Publisher<HabitQueryResult>> results_;
+  const HabitStore &store_;
+  const HabitCatalog &catalog_;
+  Executor *executor_;
+  ResultCache cache_;
+
+  std::atomic<bool> running_ = false;
+  std::thread thread_;
+  std::unique_ptr<PollingTask> task_;
+  PublishHookId hook_id_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_QUERY_QUERY_SERVICE_H_
@@ -0,0 +1,127 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/query/result_cache.h"
+
+#include <limits>
+#include <utility>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+
+namespace habitify_core {
+
+ResultCache::ResultCache(std::shared_ptr<EventBus> event_bus,
+                         size_t capacity_bytes)
+    : event_bus_(event_bus), shard_capacity_(capacity_bytes / kShardCount) {
+  checkins_ = event_bus_->SubscribeTo(channels::kHabitCheckIn);
+  stats_ = event_bus_->RegisterPublisher<ResultCacheStats>(
+      channels::kResultCacheStats);
+}
+
+uint64_t ResultCache::Sync() {
+  std::lock_guard<std::mutex> lock(sync_mux_);
+  while (auto event = checkins_->ReadNext<CheckIn>()) {
+    Invalidate(*event->GetData<CheckIn>(), checkins_->get_read_index());
+  }
+  return checkins_->get_read_index();
+}
+
+std::shared_ptr<const void> ResultCache::FindImpl(const Key &key) {
+  Shard &shard = ShardOf(key.habit_id);
+  std::lock_guard<std::mutex> lock(shard.mux);
+  auto entry = shard.index.find(key);
+  if (entry == shard.index.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, entry->second);
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return entry->second->value;
+}
+
+void ResultCache::InsertImpl(const Key &key, std::shared_ptr<const void> value,
+                             size_t bytes, uint64_t version) {
+  bytes += kEntryOverhead;
+  if (bytes > shard_capacity_) return;
+
+  Shard &shard = ShardOf(key.habit_id);
+  std::lock_guard<std::mutex> lock(shard.mux);
+  auto changed = shard.changed_at.find(key.habit_id);
+  if (changed != shard.changed_at.end() && changed->second > version) return;
+
+  auto entry = shard.index.find(key);
+  if (entry != shard.index.end()) Erase(shard, entry);
+  while (shard.bytes + bytes > shard_capacity_) {
+    Erase(shard, shard.index.find(shard.lru.back().key));
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  shard.lru.push_front(Entry{key, std::move(value), bytes});
+  shard.index.emplace(key, shard.lru.begin());
+  shard.bytes += bytes;
+}
+
+void ResultCache::Invalidate(const CheckIn &check_in, uint64_t version) {
+  Shard &shard = ShardOf(check_in.habit_id);
+  std::lock_guard<std::mutex> lock(shard.mux);
+  shard.changed_at[check_in.habit_id] = version;
+
+  constexpr Day kMinDay = std::numeric_limits<Day>::min();
+  auto entry = shard.index.lower_bound(
+      Key{check_in.habit_id, 0, kMinDay, kMinDay});
+  while (entry != shard.index.end() &&
+         entry->first.habit_id == check_in.habit_id) {
+    if (check_in.day >= entry->first.first_day &&
+        check_in.day < entry->first.last_day) {
+      entry = Erase(shard, entry);
+      invalidations_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      ++entry;
+    }
+  }
+}
+
+ResultCache::Index::iterator ResultCache::Erase(Shard &shard,
+                                                Index::iterator entry) {
+  shard.bytes -= entry->second->bytes;
+  shard.lru.erase(entry->second);
+  return shard.index.erase(entry);
+}
+
+ResultCacheStats ResultCache::GetStats() const {
+  ResultCacheStats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.invalidations = invalidations_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  for (const Shard &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mux);
+    stats.entries += shard.index.size();
+    stats.bytes += shard.bytes;
+  }
+  stats.capacity_bytes = shard_capacity_ * kShardCount;
+  return stats;
+}
+
+void ResultCache::PublishStats() {
+  stats_->Publish(std::make_unique<const Event<ResultCacheStats>>(
+      EventType::RESULT_CACHE_STATS, channels::kResultCacheStats,
+      MakePayload<ResultCacheStats>(GetStats())));
+}
+
+}  // namespace habitify_core
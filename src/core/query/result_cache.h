@@ -0,0 +1,168 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_QUERY_RESULT_CACHE_H_
+#define HABITIFY_SRC_CORE_QUERY_RESULT_CACHE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/metrics/memory_tracking.h"
+
+namespace habitify_core {
+
+/// ResultCache keeps computed responses per habit, e.g. the completed days of
+/// a habit within a date range, so that repeated views are answered without
+/// reading the store again. It listens to channels::kHabitCheckIn and a
+/// check-in only removes the entries of its habit whose range contains its
+/// day. The entries are spread over kShardCount shards by habit, each with
+/// its own lock and an LRU list that is evicted to stay within its share of
+/// the capacity. Thread safe.
+/// NOTE: Only QueryService caches its rows here. Streaks and weekly rates are
+/// kept incrementally by StatisticsService and the heatmap aggregates are the
+/// reducer state of the check-in channel, so neither is recomputed per view.
+/// Usage:
+///       uint64_t version = cache.Sync();
+///       auto rows = cache.Find<Rows>(key);
+///       if (!rows) {
+///         rows = Compute(key);
+///         cache.Insert(key, rows, bytes, version);
+///       }
+class ResultCache {
+ public:
+  static constexpr size_t kShardCount = 16;
+  static constexpr size_t kDefaultCapacityBytes = 16 << 20;
+
+  /// Identifies a response over the days [first_day, last_day). kind tells
+  /// the callers apart that cache different responses for the same habit
+  /// and range.
+  struct Key {
+    HabitId habit_id = 0;
+    uint32_t kind = 0;
+    Day first_day = 0;
+    Day last_day = 0;
+
+    inline bool operator<(const Key &other) const {
+      return std::tie(habit_id, kind, first_day, last_day) <
+             std::tie(other.habit_id, other.kind, other.first_day,
+                      other.last_day);
+    }
+  };
+
+  explicit ResultCache(std::shared_ptr<EventBus> event_bus,
+                       size_t capacity_bytes = kDefaultCapacityBytes);
+  ~ResultCache() = default;
+
+  ResultCache(const ResultCache &) = delete;
+  const ResultCache &operator=(const ResultCache &) = delete;
+
+  /// Removes the entries that the new check-ins changed. Returns the version
+  /// to pass to Insert() for responses computed afterwards.
+  uint64_t Sync();
+
+  /// Returns the cached response of key or nullptr. T must be the type it
+  /// was inserted with.
+  template <typename T>
+  std::shared_ptr<const T> Find(const Key &key) {
+    return std::static_pointer_cast<const T>(FindImpl(key));
+  }
+
+  /// Caches value, which takes about bytes of memory, as the response of
+  /// key. version is the result of the Sync() before value was computed. If
+  /// a check-in changed the habit since then value may be stale and is
+  /// dropped.
+  template <typename T>
+  void Insert(const Key &key, std::shared_ptr<const T> value, size_t bytes,
+              uint64_t version) {
+    InsertImpl(key, std::move(value), bytes, version);
+  }
+
+  ResultCacheStats GetStats() const;
+  /// Publishes GetStats() on channels::kResultCacheStats.
+  void PublishStats();
+
+ private:
+  struct Entry {
+    Key key;
+    std::shared_ptr<const void> value;
+    size_t bytes;
+  };
+  using Lru = std::pmr::list<Entry>;
+  using Index = std::pmr::map<Key, Lru::iterator>;
+
+  /// Aligned so that threads working on different shards do not share a
+  /// cache line.
+  struct alignas(64) Shard {
+    mutable std::mutex mux;
+    /// Most recently used first.
+    Lru lru{GetMemoryResource(MemoryTag::kCache)};
+    /// Ordered by habit first, so the entries of a habit are adjacent.
+    Index index{GetMemoryResource(MemoryTag::kCache)};
+    /// Version after the latest check-in of every habit.
+    std::pmr::unordered_map<HabitId, uint64_t> changed_at{
+        GetMemoryResource(MemoryTag::kCache)};
+    size_t bytes = 0;
+  };
+
+  std::shared_ptr<const void> FindImpl(const Key &key);
+  void InsertImpl(const Key &key, std::shared_ptr<const void> value,
+                  size_t bytes, uint64_t version);
+  void Invalidate(const CheckIn &check_in, uint64_t version);
+  /// Must be called with the lock of shard held. Returns the next entry.
+  Index::iterator Erase(Shard &shard, Index::iterator entry);
+
+  inline Shard &ShardOf(HabitId id) {
+    static_assert(kShardCount == 16);
+    // Fibonacci hashing, ids are often sequential.
+    return shards_[(id * 0x9E3779B97F4A7C15ull) >> 60];
+  }
+
+ private:
+  /// Rough size of an entry in the list and the index.
+  static constexpr size_t kEntryOverhead = 128;
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Listener> checkins_;
+  std::shared_ptr<Publisher<ResultCacheStats>> stats_;
+  /// Serializes Sync() so that the returned version covers every check-in
+  /// it read.
+  std::mutex sync_mux_;
+
+  size_t shard_capacity_;
+  std::array<Shard, kShardCount> shards_;
+
+  std::atomic<uint64_t> hits_ = 0;
+  std::atomic<uint64_t> misses_ = 0;
+  std::atomic<uint64_t> invalidations_ = 0;
+  std::atomic<uint64_t> evictions_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_QUERY_RESULT_CACHE_H_
@@ -0,0 +1,175 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/reminders/reminder_scheduler.h"
+
+#include <utility>
+#include <vector>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+
+namespace habitify_core {
+
+ReminderScheduler::ReminderScheduler(std::shared_ptr<EventBus> event_bus)
+    : ReminderScheduler(event_bus, Options()) {}
+
+ReminderScheduler::ReminderScheduler(std::shared_ptr<EventBus> event_bus,
+                                     Options options)
+    : event_bus_(event_bus), options_(options), epoch_(Clock::now()) {
+  publisher_ =
+      event_bus_->RegisterPublisher<DueReminders>(channels::kRemindersDue);
+}
+
+ReminderScheduler::~ReminderScheduler() { Stop(); }
+
+void ReminderScheduler::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread([this]() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+      wake_tick_ = wheel_.NextExpiry();
+      if (wake_tick_ == TimerWheel<Reminder>::kNever) {
+        wake_.wait(lock);
+      } else {
+        wake_.wait_until(lock, epoch_ + wake_tick_ * options_.resolution);
+      }
+      wake_tick_ = TimerWheel<Reminder>::kNever;
+
+      lock.unlock();
+      Poll(Clock::now());
+      lock.lock();
+    }
+  });
+}
+
+void ReminderScheduler::Start(Executor &executor) {
+  if (running_.exchange(true)) return;
+  // The interval only guards against the system clock jumping backwards
+  // while the timer waits.
+  task_ = std::make_unique<PollingTask>(
+      executor,
+      [this]() {
+        Poll(Clock::now());
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_tick_ = TimerWheel<Reminder>::kNever;
+        ArmExecutorTimer();
+        return false;
+      },
+      std::chrono::seconds(1), Executor::Priority::kHigh);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  executor_ = &executor;
+  task_->Start();
+}
+
+void ReminderScheduler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) thread_.join();
+
+  if (task_) {
+    task_->Stop();
+    std::lock_guard<std::mutex> lock(mutex_);
+    executor_->CancelTimer(executor_timer_);
+    executor_ = nullptr;
+    task_.reset();
+  }
+}
+
+TimerHandle ReminderScheduler::Schedule(const Reminder &reminder) {
+  uint64_t tick = DeadlineTick(reminder.due_at);
+  std::lock_guard<std::mutex> lock(mutex_);
+  TimerHandle handle = wheel_.Schedule(tick, reminder);
+  if (tick < wake_tick_) {
+    if (executor_) {
+      ArmExecutorTimer();
+    } else {
+      wake_.notify_one();
+    }
+  }
+  return handle;
+}
+
+bool ReminderScheduler::Cancel(TimerHandle handle) {
+  // A cancelled reminder never wakes the thread early, it just finds nothing
+  // to publish when it wakes up.
+  std::lock_guard<std::mutex> lock(mutex_);
+  return wheel_.Cancel(handle);
+}
+
+size_t ReminderScheduler::Poll(Clock::time_point now) {
+  std::vector<std::shared_ptr<DueReminders>> batches;
+  size_t fired;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fired = wheel_.Advance(CurrentTick(now), [&](Reminder &reminder) {
+      if (batches.empty() ||
+          batches.back()->reminders.size() >= options_.max_batch) {
+        batches.push_back(MakePayload<DueReminders>());
+      }
+      batches.back()->reminders.push_back(std::move(reminder));
+    });
+  }
+
+  // Publishing happens outside of the lock so that listeners can schedule
+  // follow-up reminders from their publish hooks.
+  for (auto &due : batches) Publish(std::move(due));
+  return fired;
+}
+
+size_t ReminderScheduler::get_pending_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return wheel_.get_size();
+}
+
+uint64_t ReminderScheduler::DeadlineTick(Clock::time_point time) const {
+  if (time <= epoch_) return 0;
+  auto resolution = std::chrono::duration_cast<Clock::duration>(
+      options_.resolution);
+  return (uint64_t)((time - epoch_ + resolution - Clock::duration(1)) /
+                    resolution);
+}
+
+uint64_t ReminderScheduler::CurrentTick(Clock::time_point time) const {
+  if (time <= epoch_) return 0;
+  return (uint64_t)((time - epoch_) / options_.resolution);
+}
+
+void ReminderScheduler::ArmExecutorTimer() {
+  uint64_t next = wheel_.NextExpiry();
+  if (next == wake_tick_) return;
+  executor_->CancelTimer(executor_timer_);
+  wake_tick_ = next;
+  if (next == TimerWheel<Reminder>::kNever) return;
+
+  // The timer only notifies the task, so it may fire after Stop().
+  Clock::duration delay = epoch_ + next * options_.resolution - Clock::now();
+  executor_timer_ = executor_->SubmitAfter(delay, task_->GetNotifier(),
+                                          Executor::Priority::kHigh);
+}
+
+void ReminderScheduler::Publish(std::shared_ptr<DueReminders> due) {
+  publisher_->Publish(std::make_unique<const Event<DueReminders>>(
+      EventType::REMINDERS_DUE, channels::kRemindersDue, std::move(due)));
+}
+
+}  // namespace habitify_core
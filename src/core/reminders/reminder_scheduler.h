@@ -0,0 +1,121 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_REMINDERS_REMINDER_SCHEDULER_H_
+#define HABITIFY_SRC_CORE_REMINDERS_REMINDER_SCHEDULER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/runtime/executor.h"
+#include "src/core/runtime/timer_wheel.h"
+
+namespace habitify_core {
+
+/// ReminderScheduler holds the pending reminders in a TimerWheel and
+/// publishes the ones that became due as DueReminders on
+/// channels::kRemindersDue. Its thread sleeps until the tick of the earliest
+/// reminder and publishes everything that is due at once, so a burst of
+/// reminders for the same minute becomes a handful of events. Scheduling and
+/// cancelling are O(1) and cost one wheel node per reminder, no matter how
+/// many are pending. Usage:
+///       ReminderScheduler scheduler(event_bus);
+///       scheduler.Start();
+///       TimerHandle handle = scheduler.Schedule(reminder);
+///       scheduler.Cancel(handle);
+class ReminderScheduler {
+ public:
+  using Clock = std::chrono::system_clock;
+
+  struct Options {
+    /// Length of a tick. Reminders fire at most one tick late.
+    std::chrono::milliseconds resolution{10};
+    /// Maximum number of reminders per published DueReminders.
+    size_t max_batch = 4096;
+  };
+
+  explicit ReminderScheduler(std::shared_ptr<EventBus> event_bus);
+  ReminderScheduler(std::shared_ptr<EventBus> event_bus, Options options);
+  ~ReminderScheduler();
+
+  ReminderScheduler(const ReminderScheduler &) = delete;
+  const ReminderScheduler &operator=(const ReminderScheduler &) = delete;
+
+  /// Runs the scheduler on a dedicated thread until Stop() is called.
+  void Start();
+  /// Runs the scheduler as a PollingTask on executor until Stop() is
+  /// called. An executor timer wakes the task at the tick of the earliest
+  /// reminder.
+  void Start(Executor &executor);
+  void Stop();
+
+  /// Thread safe. Reminders that are already due fire on the next tick.
+  TimerHandle Schedule(const Reminder &reminder);
+  /// Thread safe. Returns false if the reminder already fired or was
+  /// cancelled.
+  bool Cancel(TimerHandle handle);
+
+  /// Publishes all reminders that are due at now. Returns the number of
+  /// reminders that were published.
+  size_t Poll(Clock::time_point now);
+
+  size_t get_pending_count() const;
+
+ private:
+  /// Ticks are counted from the construction of the scheduler. Deadlines are
+  /// rounded up so that no reminder fires early.
+  uint64_t DeadlineTick(Clock::time_point time) const;
+  uint64_t CurrentTick(Clock::time_point time) const;
+  /// Moves the executor timer to the next tick of the wheel. Must be called
+  /// with mutex_ held.
+  void ArmExecutorTimer();
+  void Publish(std::shared_ptr<DueReminders> due);
+
+ private:
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Publisher<DueReminders>> publisher_;
+  const Options options_;
+  const Clock::time_point epoch_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  TimerWheel<Reminder> wheel_;
+  /// Tick the thread sleeps until. Schedule() only wakes it for earlier
+  /// reminders.
+  uint64_t wake_tick_ = TimerWheel<Reminder>::kNever;
+
+  std::atomic<bool> running_ = false;
+  std::thread thread_;
+
+  // Only used when running on an Executor.
+  Executor *executor_ = nullptr;
+  std::unique_ptr<PollingTask> task_;
+  TimerHandle executor_timer_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_REMINDERS_REMINDER_SCHEDULER_H_
@@ -0,0 +1,409 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/runtime/executor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace habitify_core {
+namespace {
+// Executor and worker index of the current thread.
+thread_local const Executor* current_executor = nullptr;
+thread_local size_t current_worker = 0;
+}  // namespace
+
+Executor::Executor(size_t thread_count) : epoch_(Clock::now()) {
+  thread_count = std::max<size_t>(thread_count, 1);
+  for (size_t i = 0; i < thread_count; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < thread_count; i++) {
+    workers_[i]->thread = std::thread(&Executor::WorkerLoop, this, i);
+  }
+  timer_thread_ = std::thread(&Executor::TimerLoop, this);
+}
+
+Executor::~Executor() { Shutdown(); }
+
+size_t Executor::DefaultThreadCount() {
+  size_t cores = std::thread::hardware_concurrency();
+  return cores > 0 ? cores : 1;
+}
+
+bool Executor::Submit(Task task, Priority priority) {
+  // During shutdown only running tasks may add work, their worker is
+  // guaranteed to pick it up before it exits.
+  bool is_worker = IsWorkerThread();
+  if (!is_worker && stop_.load(std::memory_order_acquire)) return false;
+
+  size_t index = is_worker
+                     ? current_worker
+                     : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                           workers_.size();
+  Worker& worker = *workers_[index];
+  size_t queue = (size_t)priority;
+
+  // Counted before the push so that pending_ never drops below the number of
+  // queued tasks. Either a worker that goes to sleep sees the increment or
+  // this thread sees the sleeping worker and wakes it up.
+  pending_.fetch_add(1, std::memory_order_seq_cst);
+  {
+    std::lock_guard<std::mutex> lock(worker.mux);
+    worker.queues[queue].push_back(std::move(task));
+    worker.sizes[queue].fetch_add(1, std::memory_order_relaxed);
+  }
+  if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+    { std::lock_guard<std::mutex> lock(sleep_mux_); }
+    sleep_cv_.notify_one();
+  }
+  return true;
+}
+
+TimerHandle Executor::SubmitAfter(Clock::duration delay, Task task,
+                                  Priority priority) {
+  return SubmitAt(Clock::now() + delay, std::move(task), priority);
+}
+
+TimerHandle Executor::SubmitAt(Clock::time_point time, Task task,
+                               Priority priority) {
+  // Rounded up so that timers never fire early.
+  uint64_t tick = 0;
+  if (time > epoch_) {
+    tick = (uint64_t)std::chrono::ceil<std::chrono::milliseconds>(time -
+                                                                  epoch_)
+               .count();
+  }
+
+  std::lock_guard<std::mutex> lock(timer_mux_);
+  if (timers_stopped_) return TimerHandle();
+  TimerHandle handle =
+      timers_.Schedule(tick, TimerTask{std::move(task), priority});
+  if (tick < timer_wake_tick_) timer_cv_.notify_one();
+  return handle;
+}
+
+bool Executor::CancelTimer(TimerHandle handle) {
+  std::lock_guard<std::mutex> lock(timer_mux_);
+  return timers_.Cancel(handle);
+}
+
+void Executor::Shutdown() {
+  std::lock_guard<std::mutex> shutdown_lock(shutdown_mux_);
+  if (stopped_) return;
+
+  {
+    std::lock_guard<std::mutex> lock(timer_mux_);
+    timers_stopped_ = true;
+  }
+  timer_cv_.notify_one();
+  timer_thread_.join();
+
+  // Workers only exit once all deques are empty, so tasks that are queued
+  // or submitted by running tasks still run.
+  {
+    std::lock_guard<std::mutex> lock(sleep_mux_);
+    stop_ = true;
+  }
+  sleep_cv_.notify_all();
+  for (auto& worker : workers_) worker->thread.join();
+  stopped_ = true;
+}
+
+bool Executor::IsWorkerThread() const { return current_executor == this; }
+
+bool Executor::RunPendingTask() {
+  return IsWorkerThread() && RunTask(current_worker);
+}
+
+void Executor::WorkerLoop(size_t index) {
+  current_executor = this;
+  current_worker = index;
+
+  while (true) {
+    if (RunTask(index)) continue;
+
+    std::unique_lock<std::mutex> lock(sleep_mux_);
+    sleeping_.fetch_add(1, std::memory_order_seq_cst);
+    sleep_cv_.wait(lock, [this]() {
+      return pending_.load(std::memory_order_seq_cst) > 0 || stop_;
+    });
+    sleeping_.fetch_sub(1, std::memory_order_relaxed);
+    if (stop_ && pending_.load(std::memory_order_seq_cst) == 0) return;
+  }
+}
+
+bool Executor::RunTask(size_t index) {
+  Task task;
+  if (!FindTask(index, task)) return false;
+  pending_.fetch_sub(1, std::memory_order_relaxed);
+  task();
+  executed_count_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool Executor::FindTask(size_t index, Task& task) {
+  size_t count = workers_.size();
+  for (size_t priority = 0; priority < kPriorityCount; priority++) {
+    if (PopBack(*workers_[index], priority, task)) return true;
+    for (size_t offset = 1; offset < count; offset++) {
+      if (PopFront(*workers_[(index + offset) % count], priority, task)) {
+        stolen_count_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool Executor::PopBack(Worker& worker, size_t priority, Task& task) {
+  if (worker.sizes[priority].load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(worker.mux);
+  auto& queue = worker.queues[priority];
+  if (queue.empty()) return false;
+  task = std::move(queue.back());
+  queue.pop_back();
+  worker.sizes[priority].fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool Executor::PopFront(Worker& worker, size_t priority, Task& task) {
+  if (worker.sizes[priority].load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(worker.mux);
+  auto& queue = worker.queues[priority];
+  if (queue.empty()) return false;
+  task = std::move(queue.front());
+  queue.pop_front();
+  worker.sizes[priority].fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+void Executor::TimerLoop() {
+  std::vector<TimerTask> due;
+  std::unique_lock<std::mutex> lock(timer_mux_);
+  while (!timers_stopped_) {
+    timer_wake_tick_ = timers_.NextExpiry();
+    if (timer_wake_tick_ == TimerWheel<TimerTask>::kNever) {
+      timer_cv_.wait(lock);
+    } else {
+      timer_cv_.wait_until(
+          lock, epoch_ + std::chrono::milliseconds(timer_wake_tick_));
+    }
+    timer_wake_tick_ = TimerWheel<TimerTask>::kNever;
+    if (timers_stopped_) break;
+
+    uint64_t now = (uint64_t)std::chrono::floor<std::chrono::milliseconds>(
+                       Clock::now() - epoch_)
+                       .count();
+    timers_.Advance(now,
+                    [&](TimerTask& timer) { due.push_back(std::move(timer)); });
+
+    // Submitting wakes workers, which is done without holding the lock.
+    lock.unlock();
+    for (TimerTask& timer : due) Submit(std::move(timer.task), timer.priority);
+    due.clear();
+    lock.lock();
+  }
+}
+
+/// Shared with the tasks of a Batch, which may start after it completed.
+struct Executor::Batch::State {
+  std::function<void(size_t)> body;
+  size_t count = 0;
+  std::atomic<size_t> next = 0;
+  std::atomic<size_t> done = 0;
+  std::mutex mux;
+  std::condition_variable done_cv;
+
+  /// Runs indices until none is left.
+  void Run() {
+    size_t index;
+    while ((index = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+      body(index);
+      if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+        std::lock_guard<std::mutex> lock(mux);
+        done_cv.notify_all();
+      }
+    }
+  }
+};
+
+bool Executor::Batch::IsDone() const {
+  return !state_ ||
+         state_->done.load(std::memory_order_acquire) == state_->count;
+}
+
+void Executor::Dispatch(Batch& batch, size_t count,
+                        std::function<void(size_t)> body, Priority priority) {
+  // Tasks of a former batch may still hold its state.
+  if (!batch.state_ || batch.state_.use_count() > 1) {
+    batch.state_ = std::make_shared<Batch::State>();
+  }
+  auto state = batch.state_;
+  state->body = std::move(body);
+  state->count = count;
+  state->next.store(0, std::memory_order_relaxed);
+  state->done.store(0, std::memory_order_release);
+
+  size_t helpers = std::min(count, workers_.size());
+  for (size_t i = 0; i < helpers; i++) {
+    if (!Submit([state]() { state->Run(); }, priority)) break;
+  }
+}
+
+void Executor::Wait(Batch& batch) {
+  if (!batch.state_) return;
+  Batch::State& state = *batch.state_;
+  state.Run();
+  while (!batch.IsDone()) {
+    if (RunPendingTask()) continue;
+    std::unique_lock<std::mutex> lock(state.mux);
+    state.done_cv.wait(lock, [&batch]() { return batch.IsDone(); });
+  }
+  // Drops the body, and what it captured, right away.
+  state.body = nullptr;
+}
+
+void Executor::ParallelFor(size_t count, std::function<void(size_t)> body,
+                           Priority priority) {
+  Batch batch;
+  Dispatch(batch, count, std::move(body), priority);
+  Wait(batch);
+}
+
+/// Shared with the tasks and hooks of a PollingTask so that they stay valid
+/// after it was destroyed.
+struct PollingTask::State {
+  enum Status { kIdle, kQueued, kRunning, kRunningNotified };
+
+  State(Executor& executor, std::function<bool()> poll,
+        Executor::Clock::duration interval, Executor::Priority priority)
+      : executor(executor),
+        poll(std::move(poll)),
+        interval(interval),
+        priority(priority) {}
+
+  void Notify(const std::shared_ptr<State>& self) {
+    if (stopped.load(std::memory_order_acquire)) return;
+    int expected = status.load(std::memory_order_acquire);
+    while (true) {
+      int next = expected == kIdle      ? kQueued
+                 : expected == kRunning ? kRunningNotified
+                                        : expected;
+      if (next == expected) return;
+      if (status.compare_exchange_weak(expected, next,
+                                       std::memory_order_acq_rel)) {
+        if (next == kQueued) Submit(self);
+        return;
+      }
+    }
+  }
+
+  void Submit(const std::shared_ptr<State>& self) {
+    executor.Submit([self]() { self->Run(self); }, priority);
+  }
+
+  void Run(const std::shared_ptr<State>& self) {
+    {
+      std::lock_guard<std::mutex> lock(mux);
+      if (stopped) {
+        status = kIdle;
+        return;
+      }
+      status = kRunning;
+    }
+
+    bool more = poll();
+
+    std::lock_guard<std::mutex> lock(mux);
+    int expected = kRunning;
+    if (!more && status.compare_exchange_strong(expected, kIdle)) {
+      idle_cv.notify_all();
+      return;
+    }
+    // poll() has more work or was notified while it ran.
+    status = stopped ? kIdle : kQueued;
+    idle_cv.notify_all();
+    if (!stopped) Submit(self);
+  }
+
+  void ArmTimer(const std::shared_ptr<State>& self) {
+    std::weak_ptr<State> weak = self;
+    timer = executor.SubmitAfter(interval, [weak]() {
+      if (auto state = weak.lock()) {
+        state->Notify(state);
+        std::lock_guard<std::mutex> lock(state->mux);
+        if (!state->stopped) state->ArmTimer(state);
+      }
+    });
+  }
+
+  Executor& executor;
+  std::function<bool()> poll;
+  const Executor::Clock::duration interval;
+  const Executor::Priority priority;
+
+  std::atomic<int> status = kIdle;
+  std::atomic<bool> stopped = true;
+  std::mutex mux;
+  std::condition_variable idle_cv;
+  TimerHandle timer;
+};
+
+PollingTask::PollingTask(Executor& executor, std::function<bool()> poll,
+                         Executor::Clock::duration interval,
+                         Executor::Priority priority)
+    : state_(std::make_shared<State>(executor, std::move(poll), interval,
+                                     priority)) {}
+
+PollingTask::~PollingTask() { Stop(); }
+
+void PollingTask::Start() {
+  {
+    std::lock_guard<std::mutex> lock(state_->mux);
+    if (!state_->stopped) return;
+    state_->stopped = false;
+    state_->ArmTimer(state_);
+  }
+  Notify();
+}
+
+void PollingTask::Stop() {
+  std::unique_lock<std::mutex> lock(state_->mux);
+  state_->stopped = true;
+  state_->executor.CancelTimer(state_->timer);
+  state_->idle_cv.wait(lock, [this]() {
+    int status = state_->status.load();
+    return status != State::kRunning && status != State::kRunningNotified;
+  });
+}
+
+void PollingTask::Notify() { state_->Notify(state_); }
+
+std::function<void()> PollingTask::GetNotifier() const {
+  std::weak_ptr<State> weak = state_;
+  return [weak]() {
+    if (auto state = weak.lock()) state->Notify(state);
+  };
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,224 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_RUNTIME_EXECUTOR_H_
+#define HABITIFY_SRC_CORE_RUNTIME_EXECUTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "src/core/runtime/timer_wheel.h"
+
+namespace habitify_core {
+
+/// Executor runs the background work of the application as short tasks on
+/// one worker per core. Every worker owns a deque per priority: it pushes
+/// and pops its own tasks at the back and steals from the front of the other
+/// workers' deques when it runs out of work, so tasks that spawn tasks stay
+/// on their core until someone else is idle. Higher priorities always run
+/// first, locally and when stealing. Delayed tasks are kept in a TimerWheel
+/// that a dedicated thread drives. Fork-join work, e.g. scanning groups of
+/// habits in parallel, runs as a Batch on the same workers. Usage:
+///       Executor executor;
+///       executor.Submit([]() { ... }, Executor::Priority::kHigh);
+///       executor.SubmitAfter(std::chrono::seconds(1), []() { ... });
+///       executor.ParallelFor(items.size(), [&](size_t i) { Work(items[i]); });
+///       executor.Shutdown();
+class Executor {
+ public:
+  using Task = std::function<void()>;
+  using Clock = std::chrono::steady_clock;
+
+  enum class Priority { kHigh = 0, kNormal = 1, kLow = 2 };
+
+  /// Tracks the indices of one Dispatch(). It must outlive the batch and may
+  /// only be reused once the batch completed.
+  class Batch {
+   public:
+    Batch() = default;
+    Batch(const Batch&) = delete;
+    const Batch& operator=(const Batch&) = delete;
+
+    bool IsDone() const;
+
+   private:
+    friend class Executor;
+    struct State;
+    std::shared_ptr<State> state_;
+  };
+
+  explicit Executor(size_t thread_count = DefaultThreadCount());
+  /// Calls Shutdown().
+  ~Executor();
+
+  Executor(const Executor&) = delete;
+  const Executor& operator=(const Executor&) = delete;
+
+  /// Queues task. Tasks submitted from a worker go to its own deque, others
+  /// are spread over the workers. Once Shutdown() started only running tasks
+  /// may submit, for everyone else this returns false.
+  bool Submit(Task task, Priority priority = Priority::kNormal);
+  /// Submits task once delay passed. Timers have a resolution of one
+  /// millisecond and no longer fire once Shutdown() started.
+  TimerHandle SubmitAfter(Clock::duration delay, Task task,
+                          Priority priority = Priority::kNormal);
+  TimerHandle SubmitAt(Clock::time_point time, Task task,
+                       Priority priority = Priority::kNormal);
+  /// Returns false if the timer already fired or was cancelled.
+  bool CancelTimer(TimerHandle handle);
+
+  /// Runs body(i) for every i in [0, count) on the workers and returns right
+  /// away. Indices are handed out one at a time to whoever asks next, so
+  /// Wait() runs the ones no worker took yet and a batch completes even if
+  /// every worker is busy or the Executor shuts down.
+  void Dispatch(Batch& batch, size_t count, std::function<void(size_t)> body,
+                Priority priority = Priority::kHigh);
+  /// Blocks until every index of batch ran. A worker that waits for indices
+  /// that other workers run executes other tasks in the meantime.
+  void Wait(Batch& batch);
+  /// Dispatch() followed by Wait().
+  void ParallelFor(size_t count, std::function<void(size_t)> body,
+                   Priority priority = Priority::kHigh);
+
+  /// Drops all pending timers, runs every queued task including the ones
+  /// they submit and joins the workers. Blocks until all of that is done.
+  void Shutdown();
+
+  /// True if called from one of the workers of this Executor.
+  bool IsWorkerThread() const;
+  /// Runs one queued task if called from a worker, so that a task that waits
+  /// for other tasks helps instead of blocking its worker. Returns false if
+  /// nothing ran.
+  bool RunPendingTask();
+
+  inline const size_t get_thread_count() const { return workers_.size(); }
+  inline const uint64_t get_executed_count() const {
+    return executed_count_.load(std::memory_order_relaxed);
+  }
+  inline const uint64_t get_stolen_count() const {
+    return stolen_count_.load(std::memory_order_relaxed);
+  }
+
+  static size_t DefaultThreadCount();
+
+ private:
+  static constexpr size_t kPriorityCount = 3;
+
+  struct alignas(64) Worker {
+    std::mutex mux;
+    std::deque<Task> queues[kPriorityCount];
+    /// Size of each queue, readable without the lock by thieves.
+    std::atomic<size_t> sizes[kPriorityCount] = {};
+    std::thread thread;
+  };
+
+  struct TimerTask {
+    Task task;
+    Priority priority = Priority::kNormal;
+  };
+
+  void WorkerLoop(size_t index);
+  /// Runs the most important task that worker index can find. Returns false
+  /// if there is none.
+  bool RunTask(size_t index);
+  /// Pops the most important task of the own deques or steals one.
+  bool FindTask(size_t index, Task& task);
+  bool PopBack(Worker& worker, size_t priority, Task& task);
+  bool PopFront(Worker& worker, size_t priority, Task& task);
+  void TimerLoop();
+
+ private:
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_ = 0;
+
+  // Workers sleep once all deques are empty.
+  std::mutex sleep_mux_;
+  std::condition_variable sleep_cv_;
+  std::atomic<size_t> pending_ = 0;
+  std::atomic<size_t> sleeping_ = 0;
+  std::atomic<bool> stop_ = false;
+  bool stopped_ = false;
+
+  // Timers use ticks of one millisecond since epoch_.
+  std::mutex timer_mux_;
+  std::condition_variable timer_cv_;
+  TimerWheel<TimerTask> timers_;
+  const Clock::time_point epoch_;
+  uint64_t timer_wake_tick_ = TimerWheel<TimerTask>::kNever;
+  bool timers_stopped_ = false;
+  std::thread timer_thread_;
+
+  std::mutex shutdown_mux_;
+
+  std::atomic<uint64_t> executed_count_ = 0;
+  std::atomic<uint64_t> stolen_count_ = 0;
+};
+
+/// PollingTask runs poll() on an Executor whenever Notify() is called, or at
+/// least once per interval. Notifications that arrive while poll() is
+/// queued are merged and poll() never runs concurrently with itself. If
+/// poll() returns true it is run again right away. This turns the Poll()
+/// loop of a service into a task that only occupies a worker while it has
+/// work. Usage:
+///       PollingTask task(executor, [&]() { return service.Poll(); },
+///                        std::chrono::milliseconds(100));
+///       PublishHookId hook =
+///           event_bus->AddPublishHook(channel, task.GetNotifier());
+///       task.Start();
+///       ...
+///       event_bus->RemovePublishHook(channel, hook);
+///       task.Stop();
+class PollingTask {
+ public:
+  PollingTask(Executor& executor, std::function<bool()> poll,
+              Executor::Clock::duration interval,
+              Executor::Priority priority = Executor::Priority::kNormal);
+  /// Calls Stop().
+  ~PollingTask();
+
+  PollingTask(const PollingTask&) = delete;
+  const PollingTask& operator=(const PollingTask&) = delete;
+
+  void Start();
+  /// Blocks until a running poll() returned. poll() is not run afterwards,
+  /// even if the task is notified. Must not be called from poll().
+  void Stop();
+
+  /// Thread safe and cheap enough for publish hooks.
+  void Notify();
+  /// A callable that notifies the task and stays safe to call after the
+  /// task was destroyed, e.g. for EventBus publish hooks.
+  std::function<void()> GetNotifier() const;
+
+ private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_RUNTIME_EXECUTOR_H_
@@ -0,0 +1,92 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_RUNTIME_SEQLOCK_H_
+#define HABITIFY_SRC_CORE_RUNTIME_SEQLOCK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace habitify_core {
+
+/// SeqLock holds a value that one writer replaces and any number of readers
+/// copy without taking a lock or writing to shared memory. The writer makes
+/// the sequence odd while it writes, readers retry if the sequence was odd
+/// or changed while they copied. Readers therefore never slow down the
+/// writer, but may spin while it writes. The value is stored as atomic words
+/// so that torn reads are detected instead of being data races. On x86 the
+/// word accesses compile to plain moves.
+/// Usage:
+///       SeqLock<Position> position;
+///       position.Store(p);                   // single writer
+///       Position p = position.Load();         // any thread
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SeqLock copies the value byte wise");
+
+ public:
+  /// Holds T{} until the first Store().
+  SeqLock() { Store(T{}); }
+
+  SeqLock(const SeqLock&) = delete;
+  const SeqLock& operator=(const SeqLock&) = delete;
+
+  /// Must not be called concurrently with another Store().
+  void Store(const T& value) {
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    // A reader that sees any of the new words also sees the odd sequence.
+    for (size_t i = 0; i < kWords; i++) {
+      words_[i].store(words[i], std::memory_order_release);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  T Load() const {
+    uint64_t words[kWords];
+    while (true) {
+      uint64_t before = sequence_.load(std::memory_order_acquire);
+      if (before & 1) continue;
+      for (size_t i = 0; i < kWords; i++) {
+        words[i] = words_[i].load(std::memory_order_acquire);
+      }
+      if (sequence_.load(std::memory_order_relaxed) == before) break;
+    }
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr size_t kCacheLine = 64;
+  static constexpr size_t kWords = (sizeof(T) + 7) / 8;
+
+  alignas(kCacheLine) std::atomic<uint64_t> sequence_{0};
+  std::atomic<uint64_t> words_[kWords];
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_RUNTIME_SEQLOCK_H_
@@ -0,0 +1,100 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_RUNTIME_SPSC_QUEUE_H_
+#define HABITIFY_SRC_CORE_RUNTIME_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace habitify_core {
+
+/// SpscQueue is a bounded lock-free ring buffer for exactly one producer and
+/// one consumer thread. Head and tail live on separate cache lines and each
+/// side caches the other side's index, so the shared indices are only read
+/// when the cached one says the queue looks full or empty. Usage:
+///       SpscQueue<Request> queue(1024);
+///       queue.TryPush(request);            // producer thread
+///       while (queue.TryPop(request)) ...  // consumer thread
+template <typename T>
+class SpscQueue {
+ public:
+  /// capacity is rounded up to a power of two.
+  explicit SpscQueue(size_t capacity) {
+    capacity_ = 2;
+    while (capacity_ < capacity) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    slots_ = std::make_unique<T[]>(capacity_);
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  const SpscQueue& operator=(const SpscQueue&) = delete;
+
+  /// Producer only. Returns false if the queue is full.
+  bool TryPush(const T& value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == capacity_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == capacity_) return false;
+    }
+    slots_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer only. Returns false if the queue is empty.
+  bool TryPop(T& value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) return false;
+    }
+    value = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Approximate when called while the other side is active.
+  inline bool IsEmpty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+  inline const size_t get_capacity() const { return capacity_; }
+
+ private:
+  static constexpr size_t kCacheLine = 64;
+
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+  // Written by the consumer
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+
+  // Written by the producer
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_RUNTIME_SPSC_QUEUE_H_
@@ -0,0 +1,135 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/runtime/startup.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <utility>
+
+namespace habitify_core {
+
+void StartupTimeline::Record(std::string name, Clock::time_point begin,
+                             Clock::time_point end) {
+  std::lock_guard<std::mutex> lock(mux_);
+  spans_.push_back({std::move(name), begin - origin_, end - origin_});
+}
+
+void StartupTimeline::Mark(std::string name) {
+  Clock::time_point now = Clock::now();
+  Record(std::move(name), now, now);
+}
+
+std::optional<StartupTimeline::Clock::duration> StartupTimeline::Find(
+    std::string_view name) const {
+  std::lock_guard<std::mutex> lock(mux_);
+  for (const Span& span : spans_) {
+    if (span.name == name) return span.end;
+  }
+  return std::nullopt;
+}
+
+std::vector<StartupTimeline::Span> StartupTimeline::GetSpans() const {
+  std::vector<Span> spans;
+  {
+    std::lock_guard<std::mutex> lock(mux_);
+    spans = spans_;
+  }
+  std::stable_sort(spans.begin(), spans.end(),
+                   [](const Span& a, const Span& b) {
+                     return a.begin < b.begin;
+                   });
+  return spans;
+}
+
+std::string StartupTimeline::ToString() const {
+  std::string result;
+  char line[160];
+  for (const Span& span : GetSpans()) {
+    using Ms = std::chrono::duration<double, std::milli>;
+    std::snprintf(line, sizeof(line), "%9.2f ms %9.2f ms  %s\n",
+                  Ms(span.begin).count(), Ms(span.end - span.begin).count(),
+                  span.name.c_str());
+    result += line;
+  }
+  return result;
+}
+
+StartupGraph::StartupGraph(std::shared_ptr<StartupTimeline> timeline)
+    : timeline_(timeline) {}
+
+StartupGraph::StepId StartupGraph::AddStep(std::string name,
+                                           std::function<void()> init,
+                                           std::vector<StepId> dependencies) {
+  StepId id = steps_.size();
+  auto step = std::make_unique<Step>();
+  step->name = std::move(name);
+  step->init = std::move(init);
+  step->dependency_count = dependencies.size();
+  for (StepId dependency : dependencies) {
+    assert(dependency < id && "Dependencies must be added first");
+    steps_[dependency]->dependents.push_back(id);
+  }
+  steps_.push_back(std::move(step));
+  return id;
+}
+
+void StartupGraph::Start(Executor& executor) {
+  {
+    std::lock_guard<std::mutex> lock(mux_);
+    unfinished_ = steps_.size();
+  }
+  for (auto& step : steps_) step->remaining = step->dependency_count;
+  for (StepId id = 0; id < steps_.size(); id++) {
+    if (steps_[id]->dependency_count > 0) continue;
+    executor.Submit([this, &executor, id]() { RunStep(executor, id); },
+                    Executor::Priority::kHigh);
+  }
+}
+
+void StartupGraph::Wait() {
+  std::unique_lock<std::mutex> lock(mux_);
+  done_cv_.wait(lock, [this]() { return unfinished_ == 0; });
+}
+
+bool StartupGraph::IsDone() const {
+  std::lock_guard<std::mutex> lock(mux_);
+  return unfinished_ == 0;
+}
+
+void StartupGraph::RunStep(Executor& executor, StepId id) {
+  Step& step = *steps_[id];
+  {
+    StartupScope scope(timeline_.get(), step.name.c_str());
+    step.init();
+  }
+
+  for (StepId dependent : step.dependents) {
+    if (steps_[dependent]->remaining.fetch_sub(1) == 1) {
+      executor.Submit(
+          [this, &executor, dependent]() { RunStep(executor, dependent); },
+          Executor::Priority::kHigh);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mux_);
+  if (--unfinished_ == 0) done_cv_.notify_all();
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,152 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_RUNTIME_STARTUP_H_
+#define HABITIFY_SRC_CORE_RUNTIME_STARTUP_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+
+/// StartupTimeline collects what happened during startup relative to its
+/// construction, which should be the first thing the application does.
+/// Thread safe. Usage:
+///       StartupTimeline timeline;
+///       { StartupScope scope(&timeline, "CreateWindow"); ... }
+///       timeline.Mark("FirstFrame");
+class StartupTimeline {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Span {
+    std::string name;
+    Clock::duration begin;
+    Clock::duration end;
+  };
+
+  StartupTimeline() : origin_(Clock::now()) {}
+
+  void Record(std::string name, Clock::time_point begin,
+              Clock::time_point end);
+  /// Records a span of length zero at the current time.
+  void Mark(std::string name);
+
+  /// End of the first span called name.
+  std::optional<Clock::duration> Find(std::string_view name) const;
+  /// All spans ordered by their begin.
+  std::vector<Span> GetSpans() const;
+  /// One line per span, for logs.
+  std::string ToString() const;
+
+  inline const Clock::time_point get_origin() const { return origin_; }
+
+ private:
+  const Clock::time_point origin_;
+  mutable std::mutex mux_;
+  std::vector<Span> spans_;
+};
+
+/// Records the lifetime of the scope on a StartupTimeline. Does nothing if
+/// timeline is null.
+class StartupScope {
+ public:
+  StartupScope(StartupTimeline* timeline, const char* name)
+      : timeline_(timeline),
+        name_(name),
+        begin_(StartupTimeline::Clock::now()) {}
+  ~StartupScope() {
+    if (timeline_) {
+      timeline_->Record(name_, begin_, StartupTimeline::Clock::now());
+    }
+  }
+
+  StartupScope(const StartupScope&) = delete;
+  const StartupScope& operator=(const StartupScope&) = delete;
+
+ private:
+  StartupTimeline* timeline_;
+  const char* name_;
+  StartupTimeline::Clock::time_point begin_;
+};
+
+/// StartupGraph initializes the parts of the application as a dependency
+/// graph. Every step runs on the Executor as soon as all of its dependencies
+/// finished, so independent services start in parallel and the caller is
+/// free to bring up the frontend meanwhile. Each step is recorded on the
+/// timeline. Usage:
+///       StartupGraph startup(timeline);
+///       auto store = startup.AddStep("HabitStore", [&]() { ... });
+///       startup.AddStep("Queries", [&]() { ... }, {store});
+///       startup.Start(executor);
+///       ...
+///       startup.Wait();
+class StartupGraph {
+ public:
+  using StepId = size_t;
+
+  explicit StartupGraph(std::shared_ptr<StartupTimeline> timeline = nullptr);
+
+  StartupGraph(const StartupGraph&) = delete;
+  const StartupGraph& operator=(const StartupGraph&) = delete;
+
+  /// dependencies must be steps that were added before, which keeps the
+  /// graph acyclic. Must not be called after Start().
+  StepId AddStep(std::string name, std::function<void()> init,
+                 std::vector<StepId> dependencies = {});
+
+  /// Queues all steps without dependencies and returns immediately.
+  void Start(Executor& executor);
+  /// Blocks until every step finished.
+  void Wait();
+  bool IsDone() const;
+
+ private:
+  struct Step {
+    std::string name;
+    std::function<void()> init;
+    std::vector<StepId> dependents;
+    size_t dependency_count = 0;
+    std::atomic<size_t> remaining = 0;
+  };
+
+  void RunStep(Executor& executor, StepId id);
+
+ private:
+  std::shared_ptr<StartupTimeline> timeline_;
+  std::vector<std::unique_ptr<Step>> steps_;
+
+  mutable std::mutex mux_;
+  std::condition_variable done_cv_;
+  size_t unfinished_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_RUNTIME_STARTUP_H_
@@ -0,0 +1,280 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_RUNTIME_TIMER_WHEEL_H_
+#define HABITIFY_SRC_CORE_RUNTIME_TIMER_WHEEL_H_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace habitify_core {
+
+/// Identifies a timer of a TimerWheel. Handles of fired or cancelled timers
+/// become stale and are ignored by Cancel(), even if their node was reused.
+struct TimerHandle {
+  uint32_t index = std::numeric_limits<uint32_t>::max();
+  uint32_t generation = 0;
+};
+
+/// TimerWheel is a hierarchical timing wheel over integer ticks. Level l has
+/// 64 slots that are 64^l ticks wide. A timer is placed on the lowest level
+/// on which its deadline and the current tick share all higher digits, and
+/// moves down one or more levels whenever the wheel reaches its slot. Timers
+/// live in a pool of nodes that are linked into their slot by index:
+///   - Schedule() and Cancel() are O(1) and never search.
+///   - Memory per timer is one node, independent of the number of timers.
+///   - Advance() jumps straight to the next non-empty slot using a bitmap
+///     per level, so idle ticks cost nothing.
+/// Not thread safe. Usage:
+///       TimerWheel<Reminder> wheel;
+///       TimerHandle handle = wheel.Schedule(deadline, reminder);
+///       wheel.Cancel(handle);
+///       wheel.Advance(now, [](Reminder& reminder) { ... });
+template <typename T>
+class TimerWheel {
+ public:
+  static constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+
+  /// Timers with deadlines before start fire on the first Advance().
+  explicit TimerWheel(uint64_t start = 0) : current_(start) {
+    std::fill(std::begin(heads_), std::end(heads_), kNil);
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  const TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /// Fires payload once Advance() reaches deadline. Deadlines that Advance()
+  /// already passed fire on the next Advance(), before all other timers.
+  TimerHandle Schedule(uint64_t deadline, T payload) {
+    uint32_t index;
+    if (free_ != kNil) {
+      index = free_;
+      free_ = nodes_[index].next;
+    } else {
+      index = (uint32_t)nodes_.size();
+      nodes_.emplace_back();
+    }
+    Node& node = nodes_[index];
+    node.deadline = deadline;
+    node.payload = std::move(payload);
+    Link(index);
+    size_++;
+    return TimerHandle{index, node.generation};
+  }
+
+  /// Returns false if the timer already fired or was cancelled. May be
+  /// called from on_expired, timers that are due in the same Advance() but
+  /// did not fire yet are cancelled as well.
+  bool Cancel(TimerHandle handle) {
+    if (handle.index >= nodes_.size()) return false;
+    Node& node = nodes_[handle.index];
+    if (node.generation != handle.generation || node.slot == kFreeSlot) {
+      return false;
+    }
+    Unlink(handle.index);
+    Release(handle.index);
+    return true;
+  }
+
+  /// Fires every timer with a deadline up to and including now by calling
+  /// on_expired(T&) in deadline order. on_expired may schedule new timers;
+  /// deadlines up to now fire in the same call. now must be less than kNever.
+  /// Returns the number of timers that fired.
+  template <typename F>
+  size_t Advance(uint64_t now, F&& on_expired) {
+    size_t fired = 0;
+    while (true) {
+      if (heads_[kOverdueSlot] != kNil) {
+        fired += Fire(kOverdueSlot, on_expired);
+        continue;
+      }
+      if (current_ > now) break;
+
+      uint64_t tick = NextExpiry();
+      if (tick > now) {
+        current_ = now + 1;
+        break;
+      }
+      current_ = tick;
+
+      // Move the timers of every slot that starts at tick one level down.
+      // Higher levels first, since they may refill the lower ones.
+      for (int level = kLevels - 1; level > 0; level--) {
+        int shift = level * kSlotBits;
+        if ((tick & ((uint64_t(1) << shift) - 1)) != 0) continue;
+        uint32_t slot = SlotIndex(level, (tick >> shift) & kSlotMask);
+        uint32_t index = Detach(slot);
+        while (index != kNil) {
+          uint32_t next = nodes_[index].next;
+          Link(index);
+          index = next;
+        }
+      }
+
+      // Timers scheduled by on_expired must not land in the fired slot.
+      current_ = tick + 1;
+      fired += Fire(SlotIndex(0, tick & kSlotMask), on_expired);
+    }
+    return fired;
+  }
+
+  /// Tick at which Advance() has work to do next, which is either the
+  /// earliest deadline or the tick at which a higher level slot moves down.
+  /// Returns kNever if no timer is pending.
+  uint64_t NextExpiry() const {
+    if (heads_[kOverdueSlot] != kNil) return current_ - 1;
+    uint64_t next = kNever;
+    for (int level = 0; level < kLevels; level++) {
+      if (occupied_[level] == 0) continue;
+      int shift = level * kSlotBits;
+      uint64_t digit = (current_ >> shift) & kSlotMask;
+      uint64_t pending = occupied_[level] & (~uint64_t(0) << digit);
+      if (pending == 0) continue;
+      uint64_t slot = (uint64_t)std::countr_zero(pending);
+      uint64_t above = level + 1 < kLevels
+                           ? current_ & ~((uint64_t(1) << (shift + 6)) - 1)
+                           : 0;
+      next = std::min(next, std::max(current_, above | (slot << shift)));
+    }
+    return next;
+  }
+
+  inline const size_t get_size() const { return size_; }
+  inline const uint64_t get_current_tick() const { return current_; }
+  /// Number of nodes in the pool, including the free ones.
+  inline const size_t get_capacity() const { return nodes_.size(); }
+
+ private:
+  static constexpr int kSlotBits = 6;
+  static constexpr uint64_t kSlotMask = (1 << kSlotBits) - 1;
+  static constexpr int kLevels = (64 + kSlotBits - 1) / kSlotBits;
+  static constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+  static constexpr uint16_t kFreeSlot = std::numeric_limits<uint16_t>::max();
+  /// Extra slot after the wheel for timers whose deadline already passed.
+  static constexpr uint32_t kOverdueSlot = kLevels << kSlotBits;
+  /// Holds the timers of the slot that is being fired, so that Cancel() can
+  /// still unlink them from on_expired.
+  static constexpr uint32_t kFiringSlot = kOverdueSlot + 1;
+
+  struct Node {
+    uint64_t deadline = 0;
+    uint32_t prev = kNil;
+    uint32_t next = kNil;
+    uint32_t generation = 1;
+    uint16_t slot = kFreeSlot;
+    T payload{};
+  };
+
+  static inline uint32_t SlotIndex(int level, uint64_t digit) {
+    return (uint32_t)(level << kSlotBits) + (uint32_t)digit;
+  }
+
+  /// Inserts the node into the slot given by the highest digit in which its
+  /// deadline differs from the current tick.
+  void Link(uint32_t index) {
+    Node& node = nodes_[index];
+    uint32_t slot = kOverdueSlot;
+    if (node.deadline >= current_) {
+      uint64_t diff = node.deadline ^ current_;
+      int level = diff == 0 ? 0 : (63 - std::countl_zero(diff)) / kSlotBits;
+      uint64_t digit = (node.deadline >> (level * kSlotBits)) & kSlotMask;
+      slot = SlotIndex(level, digit);
+      occupied_[level] |= uint64_t(1) << digit;
+    }
+
+    node.slot = (uint16_t)slot;
+    node.prev = kNil;
+    node.next = heads_[slot];
+    if (node.next != kNil) nodes_[node.next].prev = index;
+    heads_[slot] = index;
+  }
+
+  void Unlink(uint32_t index) {
+    Node& node = nodes_[index];
+    if (node.prev != kNil) {
+      nodes_[node.prev].next = node.next;
+    } else {
+      heads_[node.slot] = node.next;
+    }
+    if (node.next != kNil) nodes_[node.next].prev = node.prev;
+    if (heads_[node.slot] == kNil) ClearOccupied(node.slot);
+  }
+
+  /// Empties a slot and returns the first node of its list.
+  uint32_t Detach(uint32_t slot) {
+    uint32_t head = heads_[slot];
+    heads_[slot] = kNil;
+    ClearOccupied(slot);
+    return head;
+  }
+
+  inline void ClearOccupied(uint32_t slot) {
+    if (slot >= kOverdueSlot) return;
+    occupied_[slot >> kSlotBits] &= ~(uint64_t(1) << (slot & kSlotMask));
+  }
+
+  /// Empties a slot and hands the payloads of its timers to on_expired. The
+  /// timers wait in kFiringSlot and are unlinked one at a time, so
+  /// on_expired may cancel the ones that did not fire yet.
+  template <typename F>
+  size_t Fire(uint32_t slot, F& on_expired) {
+    uint32_t head = Detach(slot);
+    for (uint32_t index = head; index != kNil; index = nodes_[index].next) {
+      nodes_[index].slot = (uint16_t)kFiringSlot;
+    }
+    heads_[kFiringSlot] = head;
+
+    size_t fired = 0;
+    while (heads_[kFiringSlot] != kNil) {
+      uint32_t index = heads_[kFiringSlot];
+      Unlink(index);
+      T payload = std::move(nodes_[index].payload);
+      Release(index);
+      on_expired(payload);
+      fired++;
+    }
+    return fired;
+  }
+
+  void Release(uint32_t index) {
+    Node& node = nodes_[index];
+    node.slot = kFreeSlot;
+    node.generation++;
+    node.payload = T{};
+    node.next = free_;
+    free_ = index;
+    size_--;
+  }
+
+ private:
+  uint64_t current_;
+  std::vector<Node> nodes_;
+  uint32_t free_ = kNil;
+  size_t size_ = 0;
+  uint32_t heads_[kFiringSlot + 1];
+  uint64_t occupied_[kLevels] = {};
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_RUNTIME_TIMER_WHEEL_H_
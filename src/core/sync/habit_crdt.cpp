@@ -0,0 +1,103 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/sync/habit_crdt.h"
+
+#include <algorithm>
+
+namespace habitify_core {
+uint64_t VersionVector::Get(ReplicaId replica) const {
+  auto it = counters_.find(replica);
+  return it == counters_.end() ? 0 : it->second;
+}
+
+void VersionVector::Set(ReplicaId replica, uint64_t counter) {
+  counters_[replica] = counter;
+}
+
+bool HabitReplica::SetCompleted(HabitId id, Day day, bool completed) {
+  if (IsCompleted(id, day) == completed) return false;
+
+  SyncOp op;
+  op.dot = Dot{id_, version_.Get(id_) + 1};
+  op.habit_id = id;
+  op.day = day;
+  op.completed = completed;
+  if (!completed) op.removed = dots_[Key(id, day)];
+
+  Apply(op);
+  version_.Set(id_, op.dot.counter);
+  log_[id_].push_back(std::move(op));
+  return true;
+}
+
+bool HabitReplica::IsCompleted(HabitId id, Day day) const {
+  return dots_.count(Key(id, day)) != 0;
+}
+
+HabitDelta HabitReplica::MakeDelta(const VersionVector &since) const {
+  HabitDelta delta;
+  for (const auto &[origin, ops] : log_) {
+    size_t known = (size_t)std::min<uint64_t>(since.Get(origin), ops.size());
+    delta.ops.insert(delta.ops.end(), ops.begin() + known, ops.end());
+  }
+  return delta;
+}
+
+size_t HabitReplica::Merge(const HabitDelta &delta,
+                           std::vector<Change> *changes) {
+  size_t applied = 0;
+  for (const SyncOp &op : delta.ops) {
+    uint64_t known = version_.Get(op.dot.replica);
+    if (op.dot.counter != known + 1) continue;
+
+    if (Apply(op) && changes) {
+      changes->push_back(
+          Change{op.habit_id, op.day, IsCompleted(op.habit_id, op.day)});
+    }
+    version_.Set(op.dot.replica, op.dot.counter);
+    log_[op.dot.replica].push_back(op);
+    applied++;
+  }
+  return applied;
+}
+
+bool HabitReplica::Apply(const SyncOp &op) {
+  uint64_t key = Key(op.habit_id, op.day);
+  auto it = dots_.find(key);
+  bool was_completed = it != dots_.end();
+
+  std::vector<Dot> dots;
+  if (was_completed) dots = std::move(it->second);
+  for (const Dot &dot : op.removed) {
+    removed_.insert(dot);
+    dots.erase(std::remove(dots.begin(), dots.end(), dot), dots.end());
+  }
+  // The add may arrive after a remove that observed it at another replica.
+  if (op.completed && removed_.count(op.dot) == 0) dots.push_back(op.dot);
+
+  bool completed = !dots.empty();
+  if (completed) {
+    dots_[key] = std::move(dots);
+  } else if (was_completed) {
+    dots_.erase(key);
+  }
+  return completed != was_completed;
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,139 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_SYNC_HABIT_CRDT_H_
+#define HABITIFY_SRC_CORE_SYNC_HABIT_CRDT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/core/habits/habit_types.h"
+
+namespace habitify_core {
+
+using ReplicaId = uint32_t;
+
+/// Identifies one operation: the counter-th operation of replica.
+struct Dot {
+  ReplicaId replica = 0;
+  uint64_t counter = 0;
+
+  bool operator==(const Dot &other) const = default;
+};
+
+struct DotHash {
+  size_t operator()(const Dot &dot) const {
+    return std::hash<uint64_t>()(dot.counter * 0x9E3779B97F4A7C15 ^
+                                 dot.replica);
+  }
+};
+
+/// Number of operations seen from every replica. Operations of a replica
+/// are applied in order, so a counter covers all operations up to it.
+class VersionVector {
+ public:
+  uint64_t Get(ReplicaId replica) const;
+  void Set(ReplicaId replica, uint64_t counter);
+  inline bool Contains(const Dot &dot) const {
+    return dot.counter <= Get(dot.replica);
+  }
+
+  // Getters
+  inline const std::unordered_map<ReplicaId, uint64_t> &get_counters() const {
+    return counters_;
+  }
+
+ private:
+  std::unordered_map<ReplicaId, uint64_t> counters_;
+};
+
+/// One change of a completion. Adding creates a new dot for the day,
+/// removing drops the dots that were observed at the origin. Concurrent
+/// adds survive a remove, so an add wins over a concurrent remove.
+struct SyncOp {
+  Dot dot;
+  HabitId habit_id = 0;
+  Day day = 0;
+  bool completed = true;
+  std::vector<Dot> removed;
+};
+
+/// Operations a replica has not seen yet, in the order of their origin.
+struct HabitDelta {
+  std::vector<SyncOp> ops;
+};
+
+/// HabitReplica keeps the completions of all habits as an observed-remove
+/// set of days per habit. Every change is logged per origin replica so that
+/// the delta for a peer is read from the end of the logs: its cost depends
+/// on the number of operations the peer is missing, not on the length of
+/// the history. Merging is commutative and idempotent, replicas that saw the
+/// same operations hold the same completions. Usage:
+///       HabitReplica phone(1), laptop(2);
+///       phone.SetCompleted(habit, Today(), true);
+///       laptop.Merge(phone.MakeDelta(laptop.get_version()));
+/// NOTE: HabitReplica is not thread safe and the logs are never compacted.
+class HabitReplica {
+ public:
+  /// Change of a completion caused by Merge().
+  using Change = CheckIn;
+
+  explicit HabitReplica(ReplicaId id) : id_(id) {}
+
+  /// Records a local change. Returns false if the state already matched.
+  bool SetCompleted(HabitId id, Day day, bool completed);
+  bool IsCompleted(HabitId id, Day day) const;
+
+  /// All operations that are not covered by since.
+  HabitDelta MakeDelta(const VersionVector &since) const;
+  /// Applies the operations of delta that are new and appends the resulting
+  /// changes of completions to changes. Operations that do not directly
+  /// follow the known ones of their origin are skipped, they are part of
+  /// the next delta again. Returns the number of applied operations.
+  size_t Merge(const HabitDelta &delta, std::vector<Change> *changes = nullptr);
+
+  // Getters
+  inline const ReplicaId get_id() const { return id_; }
+  inline const VersionVector &get_version() const { return version_; }
+
+ private:
+  static inline uint64_t Key(HabitId id, Day day) {
+    return (uint64_t)(uint32_t)id << 32 | (uint32_t)day;
+  }
+
+  /// Applies op to the set. Returns true if the completion changed.
+  bool Apply(const SyncOp &op);
+
+ private:
+  ReplicaId id_;
+  VersionVector version_;
+  /// Operations by origin, the operation with counter c at index c - 1.
+  std::unordered_map<ReplicaId, std::vector<SyncOp>> log_;
+  /// Dots of the days that are currently completed.
+  std::unordered_map<uint64_t, std::vector<Dot>> dots_;
+  /// Dots that were removed, so that a late add with one of them is ignored.
+  std::unordered_set<Dot, DotHash> removed_;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_SYNC_HABIT_CRDT_H_
@@ -0,0 +1,110 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#include "src/core/sync/sync_engine.h"
+
+#include "src/core/event_bus/channels.h"
+
+namespace habitify_core {
+SyncEngine::SyncEngine(std::shared_ptr<EventBus> event_bus, HabitStore &store,
+                       ReplicaId replica)
+    : event_bus_(event_bus), store_(store), replica_(replica) {
+  checkins_ = event_bus_->SubscribeTo(channels::kHabitCheckIn,
+                                      SubscribeFrom::kNextEvent);
+}
+
+SyncEngine::~SyncEngine() { Stop(); }
+
+void SyncEngine::Start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread([this]() {
+    while (running_) {
+      if (!Poll()) checkins_->WaitForEvent(kIdleTimeout);
+    }
+  });
+}
+
+void SyncEngine::Start(Executor &executor) {
+  if (running_.exchange(true)) return;
+  task_ = std::make_unique<PollingTask>(
+      executor, [this]() { return Poll(); }, kIdleTimeout);
+  hook_id_ =
+      event_bus_->AddPublishHook(channels::kHabitCheckIn, task_->GetNotifier());
+  task_->Start();
+}
+
+void SyncEngine::Stop() {
+  running_ = false;
+  if (thread_.joinable()) thread_.join();
+  if (task_) {
+    event_bus_->RemovePublishHook(channels::kHabitCheckIn, hook_id_);
+    task_->Stop();
+    task_.reset();
+  }
+}
+
+bool SyncEngine::Poll() {
+  std::lock_guard<std::mutex> lock(mux_);
+  return RecordCheckIns();
+}
+
+HabitDelta SyncEngine::MakeDelta(const VersionVector &since) {
+  std::lock_guard<std::mutex> lock(mux_);
+  RecordCheckIns();
+  return replica_.MakeDelta(since);
+}
+
+size_t SyncEngine::Merge(const HabitDelta &delta) {
+  // A concurrent Merge() must not apply its changes to the store in between,
+  // else the store ends in a different state than the replica and the echo is
+  // recorded as a local change. The publish hooks of the store only notify,
+  // so the lock is not held while waiting for other work.
+  std::lock_guard<std::mutex> merge_lock(merge_mux_);
+  std::vector<HabitReplica::Change> changes;
+  size_t applied;
+  {
+    std::lock_guard<std::mutex> lock(mux_);
+    // Local changes are recorded first so that they are not mistaken for
+    // the echo of a merged change.
+    RecordCheckIns();
+    applied = replica_.Merge(delta, &changes);
+  }
+  // The CheckIns published by the store match the replica already and are
+  // not recorded again.
+  for (const HabitReplica::Change &change : changes) {
+    store_.SetCompleted(change.habit_id, change.day, change.completed);
+  }
+  return applied;
+}
+
+VersionVector SyncEngine::GetVersion() const {
+  std::lock_guard<std::mutex> lock(mux_);
+  return replica_.get_version();
+}
+
+bool SyncEngine::RecordCheckIns() {
+  bool recorded = false;
+  while (auto event = checkins_->ReadNext<CheckIn>()) {
+    const CheckIn *check_in = event->GetData<CheckIn>();
+    recorded |= replica_.SetCompleted(check_in->habit_id, check_in->day,
+                                      check_in->completed);
+  }
+  return recorded;
+}
+
+}  // namespace habitify_core
@@ -0,0 +1,101 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+
+#ifndef HABITIFY_SRC_CORE_SYNC_SYNC_ENGINE_H_
+#define HABITIFY_SRC_CORE_SYNC_SYNC_ENGINE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/runtime/executor.h"
+#include "src/core/sync/habit_crdt.h"
+
+namespace habitify_core {
+
+/// SyncEngine keeps the HabitStore of this device in sync with other devices
+/// through a HabitReplica. Local check-ins on channels::kHabitCheckIn are
+/// recorded as operations of the replica. Deltas of other devices are merged
+/// into the replica and the changes that result are applied to the store,
+/// so they show up as ordinary CheckIn events. Devices exchange deltas with
+/// MakeDelta() and Merge() over any transport. Usage:
+///       SyncEngine sync(event_bus, store, device_id);
+///       sync.Start();
+///       peer.Merge(sync.MakeDelta(peer.GetVersion()));
+/// NOTE: Only check-ins published after the SyncEngine was created are
+/// synced and the replica is not persisted.
+class SyncEngine {
+ public:
+  /// store must outlive the engine.
+  SyncEngine(std::shared_ptr<EventBus> event_bus, HabitStore &store,
+             ReplicaId replica);
+  ~SyncEngine();
+
+  SyncEngine(const SyncEngine &) = delete;
+  const SyncEngine &operator=(const SyncEngine &) = delete;
+
+  /// Runs Poll() on a dedicated thread until Stop() is called.
+  void Start();
+  /// Runs Poll() as a PollingTask on executor until Stop() is called. The
+  /// task is woken up by new check-ins and runs at least every kIdleTimeout.
+  void Start(Executor &executor);
+  void Stop();
+
+  /// Records all new local check-ins. Returns true if any was recorded.
+  bool Poll();
+
+  /// The operations a device with version since is missing. Thread safe.
+  HabitDelta MakeDelta(const VersionVector &since);
+  /// Merges delta and applies the changes to the store. Returns the number
+  /// of new operations. Thread safe.
+  size_t Merge(const HabitDelta &delta);
+  VersionVector GetVersion() const;
+
+ private:
+  /// Must be called with mux_ held.
+  bool RecordCheckIns();
+
+ private:
+  static constexpr std::chrono::milliseconds kIdleTimeout{100};
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Listener> checkins_;
+  HabitStore &store_;
+
+  /// Held through a whole Merge() so that the store sees the changes in the
+  /// order of the replica. Taken before mux_.
+  std::mutex merge_mux_;
+  mutable std::mutex mux_;
+  HabitReplica replica_;
+
+  std::atomic<bool> running_ = false;
+  std::thread thread_;
+  std::unique_ptr<PollingTask> task_;
+  PublishHookId hook_id_ = 0;
+};
+
+}  // namespace habitify_core
+
+#endif  // HABITIFY_SRC_CORE_SYNC_SYNC_ENGINE_H_
@@ -2,13 +2,281 @@
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "src/core/event_bus/channels.h"
+
 namespace habitify_debug {
+namespace {
+ImU32 ZoneColor(const char *name) {
+  static const ImU32 kPalette[] = {
+      IM_COL32(86, 156, 214, 255), IM_COL32(78, 201, 176, 255),
+      IM_COL32(220, 220, 170, 255), IM_COL32(206, 145, 120, 255),
+      IM_COL32(197, 134, 192, 255), IM_COL32(156, 220, 254, 255),
+  };
+  size_t hash = 0;
+  for (const char *c = name; *c; ++c) hash = hash * 31 + *c;
+  return kPalette[hash % IM_ARRAYSIZE(kPalette)];
+}
+}  // namespace
+
+DebugGui::DebugGui(
+    std::shared_ptr<FrameProfiler> profiler,
+    std::shared_ptr<::habitify_core::StartupTimeline> timeline,
+    std::shared_ptr<::habitify_core::EventBus> event_bus)
+    : profiler_(profiler), startup_timeline_(timeline) {
+  if (event_bus) {
+    cache_stats_listener_ = event_bus->SubscribeTo(
+        ::habitify_core::channels::kResultCacheStats);
+  }
+  frames_.reserve(FrameProfiler::kFrameCapacity);
+  durations_.reserve(FrameProfiler::kFrameCapacity);
+}
 
-void DebugGui::OnUIRender() {
+void DebugGui::OnUIRender(habitify_frontend::FrameArena &arena) {
   ImGui::Begin("DebugGui");
   ImGui::Text("Window width: %.1f Window Height: %.1f", ImGui::GetWindowWidth(),
               ImGui::GetWindowHeight());
+  ImGui::Text("Frame arena: %zu KiB, %zu heap blocks",
+              arena.get_capacity() / 1024, arena.get_heap_allocations());
+  if (profiler_ && ImGui::CollapsingHeader("Frame Profiler")) RenderProfiler();
+  if (startup_timeline_ && ImGui::CollapsingHeader("Startup")) RenderStartup();
+  if (ImGui::CollapsingHeader("Memory")) RenderMemory();
+  // Read every frame, even while the header is closed, so that the bus
+  // does not keep the stats for this Listener.
+  if (cache_stats_listener_) {
+    cache_stats_listener_->TryReadLatestValue(cache_stats_);
+    if (ImGui::CollapsingHeader("Result Cache")) RenderResultCache();
+  }
   ImGui::End();
 }
 
+void DebugGui::RenderStartup() {
+  using Ms = std::chrono::duration<double, std::milli>;
+  auto spans = startup_timeline_->GetSpans();
+  double total_ms = 0.0;
+  for (const auto &span : spans) {
+    total_ms = std::max(total_ms, Ms(span.end).count());
+  }
+  if (total_ms <= 0.0) return;
+
+  // One bar per step, placed on a shared time axis so that parallel steps
+  // overlap.
+  ImDrawList *draw_list = ImGui::GetWindowDrawList();
+  const float width = ImGui::GetContentRegionAvail().x;
+  const float row_height = ImGui::GetTextLineHeightWithSpacing();
+  for (const auto &span : spans) {
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float x0 = origin.x + (float)(Ms(span.begin).count() / total_ms) * width;
+    float x1 = origin.x + (float)(Ms(span.end).count() / total_ms) * width;
+    draw_list->AddRectFilled(ImVec2(x0, origin.y),
+                             ImVec2(std::max(x1, x0 + 1.0f),
+                                    origin.y + row_height - 2.0f),
+                             ZoneColor(span.name.c_str()));
+    ImGui::Text("%s  %.2f ms (at %.2f ms)", span.name.c_str(),
+                Ms(span.end - span.begin).count(), Ms(span.begin).count());
+  }
+}
+
+void DebugGui::RenderMemory() {
+  auto now = std::chrono::steady_clock::now();
+  if (memory_stats_.empty() ||
+      now - memory_sampled_at_ >= kMemorySampleInterval) {
+    previous_memory_stats_.swap(memory_stats_);
+    memory_stats_ = ::habitify_core::GetMemoryStats();
+    memory_sample_seconds_ =
+        std::chrono::duration<double>(now - memory_sampled_at_).count();
+    memory_sampled_at_ = now;
+  }
+  // Rates need two samples of the same subsystems.
+  bool has_rates = previous_memory_stats_.size() == memory_stats_.size();
+
+  if (ImGui::BeginTable("memory", 6,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Subsystem");
+    ImGui::TableSetupColumn("Live KiB");
+    ImGui::TableSetupColumn("Peak KiB");
+    ImGui::TableSetupColumn("Live allocs");
+    ImGui::TableSetupColumn("Allocs/s");
+    ImGui::TableSetupColumn("KiB/s");
+    ImGui::TableHeadersRow();
+    for (size_t i = 0; i < memory_stats_.size(); i++) {
+      const auto &stats = memory_stats_[i];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(stats.name);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", stats.live_bytes / 1024.0);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", stats.peak_bytes / 1024.0);
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu", stats.live_allocations);
+      if (!has_rates) continue;
+      const auto &previous = previous_memory_stats_[i];
+      ImGui::TableNextColumn();
+      ImGui::Text("%.0f", (stats.allocations - previous.allocations) /
+                              memory_sample_seconds_);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f",
+                  (stats.allocated_bytes - previous.allocated_bytes) /
+                      1024.0 / memory_sample_seconds_);
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Dump memory stats")) {
+    std::ofstream file("habitify_memory.json");
+    if (file) {
+      ::habitify_core::WriteMemoryStatsJson(memory_stats_, file);
+      memory_dump_status_ = "Written to habitify_memory.json";
+    } else {
+      memory_dump_status_ = "Could not open habitify_memory.json";
+    }
+  }
+  ImGui::SameLine();
+  ImGui::TextUnformatted(memory_dump_status_);
+}
+
+void DebugGui::RenderResultCache() {
+  const auto &stats = cache_stats_;
+  uint64_t lookups = stats.hits + stats.misses;
+  if (lookups == 0) {
+    ImGui::TextDisabled("No queries answered yet");
+    return;
+  }
+
+  ImGui::Text("Hit rate: %.1f%% (%llu hits, %llu misses)",
+              100.0 * stats.hits / lookups, (unsigned long long)stats.hits,
+              (unsigned long long)stats.misses);
+  ImGui::Text("Entries: %zu  Size: %.1f / %.1f KiB", stats.entries,
+              stats.bytes / 1024.0, stats.capacity_bytes / 1024.0);
+  ImGui::ProgressBar(
+      stats.capacity_bytes ? (float)stats.bytes / stats.capacity_bytes : 0.0f);
+  ImGui::Text("Invalidations: %llu  Evictions: %llu",
+              (unsigned long long)stats.invalidations,
+              (unsigned long long)stats.evictions);
+}
+
+void DebugGui::RenderProfiler() {
+  ImGui::Checkbox("Pause", &paused_);
+  if (!paused_) profiler_->ReadFrames(frames_);
+  if (frames_.empty()) {
+    ImGui::TextDisabled("No frames recorded yet");
+    return;
+  }
+
+  auto stats = FrameProfiler::ComputeStats(frames_);
+  ImGui::Text("Frame time over %zu frames (ms):", stats.frame_count);
+  ImGui::Text("mean %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f",
+              stats.mean_ms, stats.p50_ms, stats.p90_ms, stats.p99_ms,
+              stats.max_ms);
+
+  // Show the slowest frame so budget violations are not missed.
+  const FrameProfiler::Frame *slowest = &frames_.back();
+  for (const auto &frame : frames_) {
+    if (frame.DurationMs() > slowest->DurationMs()) slowest = &frame;
+  }
+  ImGui::Separator();
+  ImGui::Text("Latest frame #%llu: %.2f ms",
+              (unsigned long long)frames_.back().index,
+              frames_.back().DurationMs());
+  RenderTimeline(frames_.back());
+  ImGui::Text("Slowest frame #%llu: %.2f ms",
+              (unsigned long long)slowest->index, slowest->DurationMs());
+  RenderTimeline(*slowest);
+
+  ImGui::Separator();
+  RenderZoneHistograms(frames_.back());
+
+  ImGui::Separator();
+  if (ImGui::Button("Export Chrome trace")) {
+    std::ofstream file("habitify_trace.json");
+    if (file) {
+      FrameProfiler::ExportChromeTrace(frames_, file);
+      export_status_ = "Written to habitify_trace.json";
+    } else {
+      export_status_ = "Could not open habitify_trace.json";
+    }
+  }
+  ImGui::SameLine();
+  ImGui::TextUnformatted(export_status_);
+}
+
+void DebugGui::RenderTimeline(const FrameProfiler::Frame &frame) {
+  ImDrawList *draw_list = ImGui::GetWindowDrawList();
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+  const float row_height = ImGui::GetTextLineHeightWithSpacing();
+
+  // Scale to at least the frame budget so that overruns stand out.
+  const double span_ns =
+      std::max<double>(frame.end_ns - frame.start_ns, kFrameBudgetMs * 1e6);
+  auto to_x = [&](int64_t ns) {
+    return origin.x + (float)((ns - frame.start_ns) / span_ns) * width;
+  };
+
+  int rows = 1;
+  for (size_t i = 0; i < frame.zone_count; i++) {
+    const auto &zone = frame.zones[i];
+    rows = std::max(rows, zone.depth + 1);
+
+    ImVec2 min(to_x(zone.start_ns), origin.y + zone.depth * row_height);
+    ImVec2 max(std::max(to_x(zone.end_ns), min.x + 1.0f),
+               min.y + row_height - 1.0f);
+    draw_list->AddRectFilled(min, max, ZoneColor(zone.name));
+    if (ImGui::CalcTextSize(zone.name).x < max.x - min.x)
+      draw_list->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(0, 0, 0, 255),
+                         zone.name);
+    if (ImGui::IsMouseHoveringRect(min, max))
+      ImGui::SetTooltip("%s: %.3f ms", zone.name,
+                        (zone.end_ns - zone.start_ns) * 1e-6);
+  }
+
+  float budget_x = to_x(frame.start_ns + (int64_t)(kFrameBudgetMs * 1e6));
+  draw_list->AddLine(ImVec2(budget_x, origin.y),
+                     ImVec2(budget_x, origin.y + rows * row_height),
+                     IM_COL32(255, 64, 64, 255), 2.0f);
+  ImGui::Dummy(ImVec2(width, rows * row_height));
+}
+
+void DebugGui::RenderZoneHistograms(const FrameProfiler::Frame &frame) {
+  for (size_t i = 0; i < frame.zone_count; i++) {
+    const char *name = frame.zones[i].name;
+
+    durations_.clear();
+    for (const auto &recorded : frames_) {
+      for (size_t j = 0; j < recorded.zone_count; j++) {
+        const auto &zone = recorded.zones[j];
+        if (zone.name == name || std::strcmp(zone.name, name) == 0)
+          durations_.push_back((zone.end_ns - zone.start_ns) * 1e-6f);
+      }
+    }
+    if (durations_.empty()) continue;
+
+    std::sort(durations_.begin(), durations_.end());
+    float max_ms = std::max(durations_.back(), 1e-3f);
+    buckets_.fill(0.0f);
+    for (float duration : durations_) {
+      size_t bucket = std::min<size_t>(
+          (size_t)(duration / max_ms * kHistogramBuckets),
+          kHistogramBuckets - 1);
+      buckets_[bucket] += 1.0f;
+    }
+
+    char overlay[96];
+    std::snprintf(overlay, sizeof(overlay), "%s p50 %.3f p99 %.3f max %.3f ms",
+                  name, durations_[durations_.size() / 2],
+                  durations_[(size_t)(0.99f * (durations_.size() - 1))],
+                  max_ms);
+    ImGui::PushID((int)i);
+    ImGui::PlotHistogram("##zone", buckets_.data(), (int)buckets_.size(), 0,
+                         overlay, 0.0f, 3.4e38f, ImVec2(0, 40));
+    ImGui::PopID();
+  }
+}
+
 }  // namespace habitify_debug
@@ -1,14 +1,72 @@
 #ifndef HABITIFY_SRC_FRONTEND_DEBUG_GUI_DEBUG_GUI_H_
 #define HABITIFY_SRC_FRONTEND_DEBUG_GUI_DEBUG_GUI_H_
 
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/metrics/memory_tracking.h"
+#include "src/core/runtime/startup.h"
+#include "src/frontend/debug_gui/frame_profiler.h"
 #include "src/frontend/layer.h"
 
 namespace habitify_debug {
 class DebugGui : public habitify_frontend::Layer {
  public:
-  void OnUIRender() override;
+  DebugGui() = default;
+  /// The profiler is optional. If set DebugGui shows its frame timeline,
+  /// per zone histograms and frame time percentiles.
+  /// The startup timeline is optional as well and shown with the duration of
+  /// every startup step. With an event bus the hit rate of the result cache
+  /// is shown.
+  DebugGui(std::shared_ptr<FrameProfiler> profiler,
+           std::shared_ptr<::habitify_core::StartupTimeline> timeline =
+               nullptr,
+           std::shared_ptr<::habitify_core::EventBus> event_bus = nullptr);
+
+  void OnUIRender(habitify_frontend::FrameArena &arena) override;
+  const char *GetName() const override { return "DebugGui"; }
+
+ private:
+  void RenderProfiler();
+  void RenderStartup();
+  /// Live and peak bytes per subsystem and the allocation rates since the
+  /// previous sample.
+  void RenderMemory();
+  /// Hit rate, size and invalidations of the result cache. cache_stats_ is
+  /// read by OnUIRender().
+  void RenderResultCache();
+  void RenderTimeline(const FrameProfiler::Frame &frame);
+  void RenderZoneHistograms(const FrameProfiler::Frame &frame);
+
+ private:
+  static constexpr double kFrameBudgetMs = 1000.0 / 60.0;
+  static constexpr size_t kHistogramBuckets = 24;
+  static constexpr std::chrono::milliseconds kMemorySampleInterval{500};
+
+  std::shared_ptr<FrameProfiler> profiler_;
+  std::shared_ptr<::habitify_core::StartupTimeline> startup_timeline_;
+  bool paused_ = false;
+  const char *export_status_ = "";
+  const char *memory_dump_status_ = "";
+
+  std::shared_ptr<::habitify_core::Listener> cache_stats_listener_;
+  ::habitify_core::ResultCacheStats cache_stats_;
+
+  std::vector<::habitify_core::MemoryStats> memory_stats_;
+  std::vector<::habitify_core::MemoryStats> previous_memory_stats_;
+  std::chrono::steady_clock::time_point memory_sampled_at_;
+  double memory_sample_seconds_ = 0.0;
+
+  // Reused every frame to avoid allocations.
+  std::vector<FrameProfiler::Frame> frames_;
+  std::vector<float> durations_;
+  std::array<float, kHistogramBuckets> buckets_;
 };
 
 }  // namespace habitify_debug
 
-#endif  // HABITIFY_SRC_FRONTEND_DEBUG_GUI_DEBUG_GUI_H_
\ No newline at end of file
+#endif  // HABITIFY_SRC_FRONTEND_DEBUG_GUI_DEBUG_GUI_H_
@@ -0,0 +1,132 @@
+#include "src/frontend/debug_gui/frame_profiler.h"
+
+#include <algorithm>
+
+namespace habitify_debug {
+FrameProfiler::FrameProfiler()
+    : epoch_(std::chrono::steady_clock::now()), ring_(kFrameCapacity) {}
+
+int64_t FrameProfiler::Now() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch_)
+      .count();
+}
+
+void FrameProfiler::BeginFrame() {
+  if (!enabled_) return;
+  current_.index = frames_written_.load(std::memory_order_relaxed);
+  current_.start_ns = Now();
+  current_.zone_count = 0;
+  depth_ = 0;
+  in_frame_ = true;
+}
+
+void FrameProfiler::EndFrame() {
+  if (!in_frame_) return;
+  // Close zones that were left open, e.g. by an early return. EndZone()
+  // ignores calls outside of a frame, so this happens before in_frame_ is
+  // cleared.
+  while (depth_ > 0) EndZone();
+  in_frame_ = false;
+  current_.end_ns = Now();
+
+  uint64_t index = current_.index;
+  ring_[index % kFrameCapacity].Store(current_);
+  frames_written_.store(index + 1, std::memory_order_release);
+}
+
+void FrameProfiler::BeginZone(const char *name) {
+  if (!in_frame_) return;
+  // Zones beyond the capacity are dropped but still tracked for nesting.
+  if (current_.zone_count < kMaxZones && depth_ < (int)kMaxZones) {
+    open_zones_[depth_] = current_.zone_count;
+    current_.zones[current_.zone_count++] = {name, depth_, Now(), 0};
+  } else if (depth_ < (int)kMaxZones) {
+    open_zones_[depth_] = kMaxZones;
+  }
+  ++depth_;
+}
+
+void FrameProfiler::EndZone() {
+  if (!in_frame_ || depth_ == 0) return;
+  --depth_;
+  if (depth_ < (int)kMaxZones && open_zones_[depth_] < kMaxZones)
+    current_.zones[open_zones_[depth_]].end_ns = Now();
+}
+
+void FrameProfiler::ReadFrames(std::vector<Frame> &out,
+                               size_t max_frames) const {
+  out.clear();
+  uint64_t written = frames_written_.load(std::memory_order_acquire);
+  uint64_t count = std::min<uint64_t>(
+      {written, (uint64_t)max_frames, (uint64_t)kFrameCapacity});
+
+  for (uint64_t index = written - count; index < written; index++) {
+    out.push_back(ring_[index % kFrameCapacity].Load());
+    // The writer may have moved on to a newer frame in this slot.
+    if (out.back().index != index) out.pop_back();
+  }
+}
+
+FrameProfiler::FrameStats FrameProfiler::ComputeStats(
+    const std::vector<Frame> &frames) {
+  FrameStats stats;
+  if (frames.empty()) return stats;
+
+  std::vector<double> durations;
+  durations.reserve(frames.size());
+  double sum = 0.0;
+  for (const auto &frame : frames) {
+    durations.push_back(frame.DurationMs());
+    sum += durations.back();
+  }
+  std::sort(durations.begin(), durations.end());
+
+  auto percentile = [&](double p) {
+    return durations[(size_t)(p * (durations.size() - 1))];
+  };
+  stats.frame_count = frames.size();
+  stats.mean_ms = sum / frames.size();
+  stats.p50_ms = percentile(0.5);
+  stats.p90_ms = percentile(0.9);
+  stats.p99_ms = percentile(0.99);
+  stats.max_ms = durations.back();
+  return stats;
+}
+
+void FrameProfiler::ExportChromeTrace(const std::vector<Frame> &frames,
+                                      std::ostream &out) {
+  // Zone names are identifiers chosen in code so only quotes and backslashes
+  // need escaping.
+  auto write_name = [&out](const char *name) {
+    out << '"';
+    for (const char *c = name; *c; ++c) {
+      if (*c == '"' || *c == '\\') out << '\\';
+      out << *c;
+    }
+    out << '"';
+  };
+  auto write_event = [&](const char *name, const char *category,
+                         int64_t start_ns, int64_t end_ns, bool first) {
+    if (!first) out << ",\n";
+    out << "{\"name\":";
+    write_name(name);
+    out << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+        << ",\"ts\":" << start_ns / 1000.0
+        << ",\"dur\":" << (end_ns - start_ns) / 1000.0 << "}";
+  };
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for (const auto &frame : frames) {
+    write_event("Frame", "frame", frame.start_ns, frame.end_ns, first);
+    first = false;
+    for (size_t i = 0; i < frame.zone_count; i++) {
+      const Zone &zone = frame.zones[i];
+      write_event(zone.name, "zone", zone.start_ns, zone.end_ns, false);
+    }
+  }
+  out << "\n]}\n";
+}
+
+}  // namespace habitify_debug
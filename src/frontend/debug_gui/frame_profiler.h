@@ -0,0 +1,132 @@
+#ifndef HABITIFY_SRC_FRONTEND_DEBUG_GUI_FRAME_PROFILER_H_
+#define HABITIFY_SRC_FRONTEND_DEBUG_GUI_FRAME_PROFILER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "src/core/runtime/seqlock.h"
+
+namespace habitify_debug {
+
+/// FrameProfiler records the duration of named, nested zones within a frame.
+/// Frames are written by a single thread (the render thread) into a ring of
+/// SeqLocks and can be read concurrently from any thread. Zone names must be
+/// string literals or otherwise outlive the profiler. Usage:
+///       profiler.BeginFrame();
+///       {
+///         HAB_PROFILE_SCOPE(&profiler, "Render");
+///         ImGui::Render();
+///       }
+///       profiler.EndFrame();
+class FrameProfiler {
+ public:
+  static constexpr size_t kMaxZones = 64;
+  static constexpr size_t kFrameCapacity = 256;
+
+  struct Zone {
+    const char *name;
+    int depth;
+    int64_t start_ns;
+    int64_t end_ns;
+  };
+
+  struct Frame {
+    uint64_t index = 0;
+    int64_t start_ns = 0;
+    int64_t end_ns = 0;
+    size_t zone_count = 0;
+    std::array<Zone, kMaxZones> zones;
+
+    inline double DurationMs() const { return (end_ns - start_ns) * 1e-6; }
+  };
+
+  /// Frame time statistics in milliseconds.
+  struct FrameStats {
+    size_t frame_count = 0;
+    double mean_ms = 0.0;
+    double p50_ms = 0.0;
+    double p90_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+  };
+
+  FrameProfiler();
+  ~FrameProfiler() = default;
+
+  // FrameProfiler is not copyable due to the use of std::atomic
+  FrameProfiler(const FrameProfiler &) = delete;
+  const FrameProfiler &operator=(const FrameProfiler &) = delete;
+
+  // Writer interface, only to be called from the render thread.
+  void BeginFrame();
+  void EndFrame();
+  void BeginZone(const char *name);
+  void EndZone();
+
+  /// Copies up to max_frames of the most recent complete frames into out,
+  /// oldest first. Frames that were overwritten before they were copied are
+  /// skipped.
+  void ReadFrames(std::vector<Frame> &out,
+                  size_t max_frames = kFrameCapacity) const;
+
+  /// Computes frame time percentiles over the given frames.
+  static FrameStats ComputeStats(const std::vector<Frame> &frames);
+
+  /// Writes the frames in the Chrome trace event format which can be loaded
+  /// into chrome://tracing or https://ui.perfetto.dev.
+  static void ExportChromeTrace(const std::vector<Frame> &frames,
+                                std::ostream &out);
+
+  inline void set_enabled(bool enabled) { enabled_ = enabled; }
+  inline const bool get_enabled() const { return enabled_; }
+
+ private:
+  int64_t Now() const;
+
+ private:
+  bool enabled_ = true;
+  std::chrono::steady_clock::time_point epoch_;
+
+  // Writer state
+  Frame current_;
+  int depth_ = 0;
+  std::array<size_t, kMaxZones> open_zones_;
+  bool in_frame_ = false;
+
+  std::atomic<uint64_t> frames_written_{0};
+  /// Frame index i is stored at i % kFrameCapacity.
+  std::vector<::habitify_core::SeqLock<Frame>> ring_;
+};
+
+/// ScopedZone times the enclosing scope. A nullptr profiler is allowed and
+/// results in a no-op.
+class ScopedZone {
+ public:
+  ScopedZone(FrameProfiler *profiler, const char *name) : profiler_(profiler) {
+    if (profiler_) profiler_->BeginZone(name);
+  }
+  ~ScopedZone() {
+    if (profiler_) profiler_->EndZone();
+  }
+
+  ScopedZone(const ScopedZone &) = delete;
+  const ScopedZone &operator=(const ScopedZone &) = delete;
+
+ private:
+  FrameProfiler *profiler_;
+};
+
+}  // namespace habitify_debug
+
+#define HAB_PROFILE_CONCAT_IMPL(_A, _B) _A##_B
+#define HAB_PROFILE_CONCAT(_A, _B) HAB_PROFILE_CONCAT_IMPL(_A, _B)
+#define HAB_PROFILE_SCOPE(_PROFILER, _NAME)                            \
+  ::habitify_debug::ScopedZone HAB_PROFILE_CONCAT(hab_profile_zone_, \
+                                                  __LINE__)(_PROFILER, _NAME)
+
+#endif  // HABITIFY_SRC_FRONTEND_DEBUG_GUI_FRAME_PROFILER_H_
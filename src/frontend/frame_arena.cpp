@@ -0,0 +1,90 @@
+#include "src/frontend/frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+namespace habitify_frontend {
+FrameArena::FrameArena(size_t block_size,
+                       std::pmr::memory_resource *upstream)
+    : upstream_(upstream) {
+  AddBlock(block_size);
+}
+
+void FrameArena::Reset() {
+  // Everything that was needed this frame will fit into one block next frame.
+  if (blocks_.size() > 1) {
+    size_t total = capacity_;
+    blocks_.clear();
+    capacity_ = 0;
+    AddBlock(total);
+  }
+  current_block_ = 0;
+  offset_ = 0;
+  bytes_used_ = 0;
+}
+
+const char *FrameArena::Format(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  const char *result = FormatV(fmt, args);
+  va_end(args);
+  return result;
+}
+
+const char *FrameArena::FormatV(const char *fmt, va_list args) {
+  // Try to print into the rest of the current block first, most strings fit.
+  Block &block = blocks_[current_block_];
+  size_t available = block.size - offset_;
+  char *buffer = reinterpret_cast<char *>(block.data.get() + offset_);
+
+  va_list copy;
+  va_copy(copy, args);
+  int length = vsnprintf(buffer, available, fmt, copy);
+  va_end(copy);
+  if (length < 0) return "";
+
+  if ((size_t)length < available) {
+    offset_ += length + 1;
+    bytes_used_ += length + 1;
+    return buffer;
+  }
+
+  buffer = static_cast<char *>(allocate(length + 1, 1));
+  vsnprintf(buffer, length + 1, fmt, args);
+  return buffer;
+}
+
+void *FrameArena::do_allocate(size_t bytes, size_t alignment) {
+  while (true) {
+    Block &block = blocks_[current_block_];
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    uintptr_t aligned = (base + offset_ + alignment - 1) & ~(alignment - 1);
+    size_t end = (aligned - base) + bytes;
+
+    if (end <= block.size) {
+      bytes_used_ += end - offset_;
+      offset_ = end;
+      return reinterpret_cast<void *>(aligned);
+    }
+
+    if (current_block_ + 1 == blocks_.size()) {
+      AddBlock(std::max(block.size * 2, bytes + alignment));
+    }
+    current_block_++;
+    offset_ = 0;
+  }
+}
+
+void FrameArena::AddBlock(size_t min_size) {
+  Block block;
+  block.size = min_size;
+  block.data = std::unique_ptr<std::byte[], BlockDeleter>(
+      static_cast<std::byte *>(
+          upstream_->allocate(block.size, alignof(std::max_align_t))),
+      BlockDeleter{upstream_, block.size});
+  capacity_ += block.size;
+  heap_allocations_++;
+  blocks_.push_back(std::move(block));
+}
+}  // namespace habitify_frontend
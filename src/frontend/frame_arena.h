@@ -0,0 +1,104 @@
+#ifndef HABITIFY_SRC_FRONTEND_FRAME_ARENA_H_
+#define HABITIFY_SRC_FRONTEND_FRAME_ARENA_H_
+
+#include <cstdarg>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "src/core/metrics/memory_tracking.h"
+
+namespace habitify_frontend {
+
+/// FrameArena is a linear allocator for data that only lives for one frame,
+/// like the strings a Layer formats in OnUIRender(). The frontend resets it
+/// at the start of every frame, which frees everything at once. Allocating is
+/// a pointer bump and deallocating does nothing. Usage:
+///       void OnUIRender(FrameArena &arena) override {
+///         ImGui::TextUnformatted(arena.Format("%d done", done_));
+///         auto names = arena.MakeVector<const char *>();
+///         ...
+///       }
+/// NOTE: If a frame needs more than the current block another block is taken
+/// from the heap. Reset() then merges all blocks into one, so after a few
+/// frames the arena stops allocating.
+class FrameArena : public std::pmr::memory_resource {
+ public:
+  static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+  /// Blocks are taken from upstream, by default the resource of the
+  /// frontend.
+  explicit FrameArena(size_t block_size = kDefaultBlockSize,
+                      std::pmr::memory_resource *upstream =
+                          ::habitify_core::GetMemoryResource(
+                              ::habitify_core::MemoryTag::kFrontend));
+  ~FrameArena() = default;
+
+  FrameArena(const FrameArena &) = delete;
+  const FrameArena &operator=(const FrameArena &) = delete;
+
+  /// Invalidates everything allocated since the last Reset().
+  void Reset();
+
+  /// printf into the arena. The string is valid until the next Reset().
+  const char *Format(const char *fmt, ...)
+#if defined(__GNUC__) || defined(__clang__)
+      __attribute__((format(printf, 2, 3)))
+#endif
+      ;
+  const char *FormatV(const char *fmt, va_list args);
+
+  /// Containers that allocate from the arena. They must not outlive the
+  /// frame.
+  template <typename T>
+  inline std::pmr::vector<T> MakeVector() {
+    return std::pmr::vector<T>(this);
+  }
+  inline std::pmr::string MakeString() { return std::pmr::string(this); }
+
+  // Getters
+  inline const size_t get_bytes_used() const { return bytes_used_; }
+  inline const size_t get_capacity() const { return capacity_; }
+  /// Number of blocks taken from the heap since construction.
+  inline const size_t get_heap_allocations() const {
+    return heap_allocations_;
+  }
+
+ protected:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override {}
+  bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+ private:
+  struct BlockDeleter {
+    std::pmr::memory_resource *upstream;
+    size_t size;
+    void operator()(std::byte *data) const {
+      upstream->deallocate(data, size, alignof(std::max_align_t));
+    }
+  };
+  struct Block {
+    std::unique_ptr<std::byte[], BlockDeleter> data;
+    size_t size = 0;
+  };
+
+  void AddBlock(size_t min_size);
+
+ private:
+  std::pmr::memory_resource *upstream_;
+  std::vector<Block> blocks_;
+  size_t current_block_ = 0;
+  size_t offset_ = 0;
+
+  size_t bytes_used_ = 0;
+  size_t capacity_ = 0;
+  size_t heap_allocations_ = 0;
+};
+}  // namespace habitify_frontend
+
+#endif  // HABITIFY_SRC_FRONTEND_FRAME_ARENA_H_
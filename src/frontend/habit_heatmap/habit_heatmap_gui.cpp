@@ -0,0 +1,210 @@
+#include "src/frontend/habit_heatmap/habit_heatmap_gui.h"
+
+#include <algorithm>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+
+namespace habitify_frontend {
+
+namespace {
+const ImU32 kLevelColors[HeatmapData::kLevels] = {
+    IM_COL32(45, 51, 59, 255),  IM_COL32(14, 68, 41, 255),
+    IM_COL32(0, 109, 50, 255),  IM_COL32(38, 166, 65, 255),
+    IM_COL32(57, 211, 83, 255),
+};
+}  // namespace
+
+HabitHeatmapGui::HabitHeatmapGui(
+    std::shared_ptr<::habitify_core::EventBus> event_bus, ImVec2 position,
+    ImVec2 size)
+    : position_(position), size_(size), model_(event_bus) {
+  WakeOnChannel(::habitify_core::channels::kHabitAggregates);
+  WakeOnChannel(::habitify_core::channels::kHabitCheckIn);
+}
+
+void HabitHeatmapGui::OnAttach() {
+  chunk_indices_.resize(kChunkCells * 6);
+  for (size_t cell = 0; cell < kChunkCells; cell++) {
+    ImDrawIdx first = (ImDrawIdx)(cell * 4);
+    ImDrawIdx *idx = &chunk_indices_[cell * 6];
+    idx[0] = first;
+    idx[1] = first + 1;
+    idx[2] = first + 2;
+    idx[3] = first;
+    idx[4] = first + 2;
+    idx[5] = first + 3;
+  }
+
+  // The first OnUpdate() commits the initial data.
+  model_.Attach(::habitify_core::Today());
+}
+
+void HabitHeatmapGui::OnUpdate(float dt) {
+  if (!model_.Update(::habitify_core::Today())) return;
+  const HeatmapData &data = model_.get_data();
+  HeatmapData &out = data_.Write();
+
+  // The buffer is two commits old, so it misses the cells of the previous
+  // commit and of this one. Everything else is the same unless either of
+  // them refreshed all cells.
+  if (data.refresh_all || last_refresh_all_ ||
+      out.levels.size() != data.levels.size()) {
+    // Copying reuses the buffers once they reached full size.
+    out = data;
+  } else {
+    CopyCells(data, last_dirty_cells_, out);
+    CopyCells(data, data.dirty_cells, out);
+    out.version = data.version;
+    out.today = data.today;
+    out.dirty_cells = data.dirty_cells;
+    out.refresh_all = false;
+  }
+  last_dirty_cells_ = data.dirty_cells;
+  last_refresh_all_ = data.refresh_all;
+  data_.Commit();
+}
+
+void HabitHeatmapGui::OnUIRender(FrameArena &arena) {
+  ImGuiViewport *viewport = ImGui::GetMainViewport();
+  ImGui::SetNextWindowPos(
+      ImVec2(viewport->Pos.x + position_.x, viewport->Pos.y + position_.y),
+      ImGuiCond_FirstUseEver);
+  ImGui::SetNextWindowSize(size_, ImGuiCond_FirstUseEver);
+  ImGui::Begin("Habit Heatmap");
+
+  const HeatmapData &data = data_.Read();
+  RefreshGeometry(data);
+
+  float grid_width = data.week_count * kCellStep;
+  float grid_height = 7 * kCellStep;
+  float visible_width = 0.0f;
+  size_t first_week = 0, last_week = 0;
+
+  ImGui::BeginChild("calendar",
+                    ImVec2(0, grid_height + ImGui::GetStyle().ScrollbarSize),
+                    false, ImGuiWindowFlags_HorizontalScrollbar);
+  {
+    // The cursor already contains the scroll offset.
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::Dummy(ImVec2(grid_width, grid_height));
+    // Waits for the first snapshot, the grid is empty before.
+    if (scroll_to_end_ && data.week_count > 0) {
+      ImGui::SetScrollX(grid_width);
+      scroll_to_end_ = false;
+    }
+
+    visible_width = ImGui::GetWindowWidth();
+    first_week = (size_t)(ImGui::GetScrollX() / kCellStep);
+    last_week = std::min(data.week_count,
+                         first_week + (size_t)(visible_width / kCellStep) + 2);
+    DrawCells(ImGui::GetWindowDrawList(), origin, first_week * 7,
+              last_week * 7);
+
+    if (ImGui::IsItemHovered()) {
+      ImVec2 mouse = ImGui::GetMousePos();
+      size_t week = (size_t)((mouse.x - origin.x) / kCellStep);
+      size_t weekday = (size_t)((mouse.y - origin.y) / kCellStep);
+      size_t cell = week * 7 + std::min<size_t>(weekday, 6);
+      if (cell < data.completions.size() && data.DayOf(cell) <= data.today) {
+        int year;
+        unsigned month, day;
+        ::habitify_core::CivilFromDays(data.DayOf(cell), year, month, day);
+        ImGui::SetTooltip("%04d-%02u-%02u: %u completed", year, month, day,
+                          (unsigned)data.completions[cell]);
+      }
+    }
+  }
+  ImGui::EndChild();
+
+  // The trend follows the visible part of the calendar.
+  if (last_week > first_week) {
+    float latest = data.week_rates[last_week - 1] * 100.0f;
+    ImGui::TextUnformatted("Weekly completion rate");
+    ImGui::PlotLines("##trend", data.week_rates.data() + first_week,
+                     (int)(last_week - first_week), 0,
+                     arena.Format("%.0f%% this week", latest), 0.0f, 1.0f,
+                     ImVec2(-1.0f, kTrendHeight));
+  }
+
+  ImGui::End();
+}
+
+void HabitHeatmapGui::RefreshGeometry(const HeatmapData &data) {
+  if (data.version == geometry_version_) return;
+  bool recolor_all =
+      data.refresh_all || data.version != geometry_version_ + 1;
+  geometry_version_ = data.version;
+
+  // The positions only depend on the number of cells, a grid that grew to
+  // the past moves the existing cells to other indices.
+  size_t cells = data.levels.size();
+  if (vertices_.size() != cells * 4) {
+    recolor_all = true;
+    ImVec2 uv = ImGui::GetFontTexUvWhitePixel();
+    vertices_.resize(cells * 4);
+    for (size_t cell = 0; cell < cells; cell++) {
+      float x = (cell / 7) * kCellStep;
+      float y = (cell % 7) * kCellStep;
+      ImDrawVert *vtx = &vertices_[cell * 4];
+      vtx[0].pos = ImVec2(x, y);
+      vtx[1].pos = ImVec2(x + kCellSize, y);
+      vtx[2].pos = ImVec2(x + kCellSize, y + kCellSize);
+      vtx[3].pos = ImVec2(x, y + kCellSize);
+      for (int i = 0; i < 4; i++) vtx[i].uv = uv;
+    }
+  }
+
+  if (!recolor_all) {
+    for (uint32_t cell : data.dirty_cells) RecolorCell(data, cell);
+    return;
+  }
+  for (size_t cell = 0; cell < cells; cell++) RecolorCell(data, cell);
+}
+
+void HabitHeatmapGui::RecolorCell(const HeatmapData &data, size_t cell) {
+  uint8_t level = data.levels[cell];
+  ImU32 color = level == HeatmapData::kFuture ? 0 : kLevelColors[level];
+  ImDrawVert *vtx = &vertices_[cell * 4];
+  for (int i = 0; i < 4; i++) vtx[i].col = color;
+}
+
+void HabitHeatmapGui::CopyCells(const HeatmapData &from,
+                                const std::vector<uint32_t> &cells,
+                                HeatmapData &to) {
+  for (uint32_t cell : cells) {
+    to.completions[cell] = from.completions[cell];
+    to.levels[cell] = from.levels[cell];
+    to.week_rates[cell / 7] = from.week_rates[cell / 7];
+  }
+}
+
+void HabitHeatmapGui::DrawCells(ImDrawList *draw_list, ImVec2 origin,
+                                size_t first_cell, size_t last_cell) const {
+  for (size_t chunk = first_cell; chunk < last_cell; chunk += kChunkCells) {
+    size_t cells = std::min(kChunkCells, last_cell - chunk);
+    size_t vtx_count = cells * 4, idx_count = cells * 6;
+
+    // PrimReserve may start a new draw command, so the base index is only
+    // known afterwards.
+    draw_list->PrimReserve((int)idx_count, (int)vtx_count);
+    unsigned int base = draw_list->_VtxCurrentIdx;
+
+    const ImDrawVert *src = &vertices_[chunk * 4];
+    ImDrawVert *dst = draw_list->_VtxWritePtr;
+    for (size_t i = 0; i < vtx_count; i++) {
+      dst[i] = src[i];
+      dst[i].pos.x += origin.x;
+      dst[i].pos.y += origin.y;
+    }
+    ImDrawIdx *idx = draw_list->_IdxWritePtr;
+    for (size_t i = 0; i < idx_count; i++) {
+      idx[i] = (ImDrawIdx)(base + chunk_indices_[i]);
+    }
+
+    draw_list->_VtxWritePtr += vtx_count;
+    draw_list->_IdxWritePtr += idx_count;
+    draw_list->_VtxCurrentIdx += (unsigned int)vtx_count;
+  }
+}
+}  // namespace habitify_frontend
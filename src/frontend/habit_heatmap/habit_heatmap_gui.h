@@ -0,0 +1,84 @@
+#ifndef HABITIFY_SRC_FRONTEND_HABIT_HEATMAP_HABIT_HEATMAP_GUI_H_
+#define HABITIFY_SRC_FRONTEND_HABIT_HEATMAP_HABIT_HEATMAP_GUI_H_
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/frontend/habit_heatmap/heatmap_model.h"
+#include "src/frontend/layer.h"
+#include "src/frontend/snapshot.h"
+
+namespace habitify_frontend {
+
+/// HabitHeatmapGui fills the graph panel with a contribution calendar of all
+/// habits and the weekly completion rate below it. The HeatmapModel follows
+/// the check-ins in OnUpdate() and hands its data to OnUIRender() through a
+/// Snapshot. The vertices of the calendar are kept in a cache in which only
+/// the cells a new snapshot changed are recolored, and every frame the
+/// visible columns are copied into the ImDrawList in one reservation, so the
+/// frame time does not depend on how many years are shown.
+class HabitHeatmapGui : public Layer {
+ public:
+  HabitHeatmapGui() = delete;
+  /// position is relative to the main viewport.
+  HabitHeatmapGui(std::shared_ptr<::habitify_core::EventBus> event_bus,
+                  ImVec2 position, ImVec2 size);
+  ~HabitHeatmapGui() = default;
+
+  /// Builds the index buffer and starts the model from the latest check-in
+  /// snapshot. Kept out of the constructor so that a lazily pushed heatmap
+  /// costs nothing until shown.
+  void OnAttach() override;
+  void OnUpdate(float dt) override;
+  void OnUIRender(FrameArena &arena) override;
+  const char *GetName() const override { return "HabitHeatmapGui"; }
+
+ private:
+  static constexpr float kCellSize = 11.0f;
+  static constexpr float kCellStep = kCellSize + 2.0f;
+  static constexpr float kTrendHeight = 80.0f;
+  /// Cells copied per reservation. Keeps the indices of a chunk within the
+  /// range of a 16 bit ImDrawIdx.
+  static constexpr size_t kChunkCells = 8192;
+
+  /// Brings the vertex cache up to date with data. Only the dirty cells are
+  /// recolored unless the grid changed or a version was skipped.
+  void RefreshGeometry(const HeatmapData &data);
+  void RecolorCell(const HeatmapData &data, size_t cell);
+  /// Copies the dirty cells of from into to, which holds an older version
+  /// of the same grid.
+  static void CopyCells(const HeatmapData &from,
+                        const std::vector<uint32_t> &cells, HeatmapData &to);
+  /// Copies the cached vertices of the cells [first_cell, last_cell) into
+  /// draw_list, moved by origin.
+  void DrawCells(ImDrawList *draw_list, ImVec2 origin, size_t first_cell,
+                 size_t last_cell) const;
+
+ private:
+  ImVec2 position_, size_;
+
+  /// Only used by OnAttach() and OnUpdate().
+  HeatmapModel model_;
+  Snapshot<HeatmapData> data_{this};
+  /// What the previous commit changed. Write() returns the buffer of two
+  /// commits ago, which misses those changes as well.
+  std::vector<uint32_t> last_dirty_cells_;
+  bool last_refresh_all_ = true;
+
+  bool scroll_to_end_ = true;
+  /// Version of the HeatmapData the vertices were colored for.
+  uint64_t geometry_version_ = 0;
+  /// Four vertices per cell relative to the top left corner of the grid.
+  std::vector<ImDrawVert> vertices_;
+  /// Indices of one chunk relative to its first vertex.
+  std::vector<ImDrawIdx> chunk_indices_;
+};
+}  // namespace habitify_frontend
+
+#endif  // HABITIFY_SRC_FRONTEND_HABIT_HEATMAP_HABIT_HEATMAP_GUI_H_
@@ -0,0 +1,184 @@
+#include "src/frontend/habit_heatmap/heatmap_model.h"
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+
+namespace habitify_frontend {
+using ::habitify_core::CheckIn;
+using ::habitify_core::CheckInSnapshot;
+using ::habitify_core::Day;
+using ::habitify_core::HabitAggregates;
+
+namespace {
+inline Day MondayOf(Day day) { return day - ::habitify_core::Weekday(day); }
+}  // namespace
+
+HeatmapModel::HeatmapModel(
+    std::shared_ptr<::habitify_core::EventBus> event_bus)
+    : event_bus_(event_bus) {
+  aggregates_listener_ =
+      event_bus_->SubscribeTo(::habitify_core::channels::kHabitAggregates);
+}
+
+void HeatmapModel::Attach(Day today) {
+  data_.today = today;
+  EnsureRange(today - (Day)(kMinWeeks * 7) + 1, today);
+
+  // Subscribed only now, a Listener that is never read keeps the bus from
+  // dropping old check-ins.
+  checkin_listener_ =
+      event_bus_->SubscribeTo(::habitify_core::channels::kHabitCheckIn);
+  if (auto snapshot = checkin_listener_->ReadSnapshot<CheckInSnapshot>()) {
+    ApplyAggregates(snapshot->aggregates);
+  }
+  refresh_all_ = true;
+}
+
+bool HeatmapModel::Update(Day today) {
+  // Every call that changes something returns true, so the dirty cells of
+  // the previous version were handed out already.
+  data_.dirty_cells.clear();
+  data_.refresh_all = false;
+
+  // Past midnight the new day becomes visible.
+  if (today != data_.today) {
+    data_.today = today;
+    EnsureRange(today, today);
+    refresh_all_ = true;
+  }
+  ReceiveAggregates();
+  ReceiveCheckIns();
+  if (refresh_all_) {
+    RefreshAll();
+    refresh_all_ = false;
+    changed_ = true;
+  }
+
+  if (!changed_) return false;
+  changed_ = false;
+  data_.version++;
+  return true;
+}
+
+void HeatmapModel::ReceiveAggregates() {
+  if (!aggregates_listener_->HasReceivedEvent()) return;
+
+  auto event = aggregates_listener_->ReadLatest<HabitAggregates>();
+  const HabitAggregates *aggregates = event->GetData<HabitAggregates>();
+  // Older aggregates add nothing and their check-ins may be dropped already.
+  if (aggregates->checkin_count < checkin_listener_->get_read_index()) return;
+  ApplyAggregates(*aggregates);
+
+  // Check-ins that are part of the aggregates were applied already, newer ones
+  // are replayed on top of them.
+  checkin_listener_->set_read_index(aggregates->checkin_count);
+}
+
+void HeatmapModel::ApplyAggregates(const HabitAggregates &aggregates) {
+  if (!aggregates.completions.empty()) {
+    Day last_day =
+        aggregates.first_day + (Day)aggregates.completions.size() - 1;
+    EnsureRange(aggregates.first_day, std::max(last_day, data_.today));
+  }
+  std::fill(data_.completions.begin(), data_.completions.end(), 0);
+  max_completions_ = 0;
+  for (size_t i = 0; i < aggregates.completions.size(); i++) {
+    uint16_t count = aggregates.completions[i];
+    data_.completions[aggregates.first_day - data_.grid_start + i] = count;
+    max_completions_ = std::max(max_completions_, count);
+  }
+  habit_count_ = aggregates.habit_count;
+  refresh_all_ = true;
+}
+
+void HeatmapModel::ReceiveCheckIns() {
+  int scale = Scale();
+
+  while (auto event = checkin_listener_->ReadNext<CheckIn>()) {
+    const CheckIn *check_in = event->GetData<CheckIn>();
+    EnsureRange(check_in->day, check_in->day);
+
+    size_t cell = check_in->day - data_.grid_start;
+    uint16_t &count = data_.completions[cell];
+    if (check_in->completed) {
+      count++;
+    } else if (count > 0) {
+      count--;
+    }
+    max_completions_ = std::max(max_completions_, count);
+    changed_ = true;
+
+    if (!refresh_all_ && Scale() == scale) {
+      RefreshCell(cell);
+      RefreshWeekRate(cell / 7);
+      data_.dirty_cells.push_back((uint32_t)cell);
+    }
+  }
+
+  if (Scale() != scale) refresh_all_ = true;
+  // A burst of check-ins is cheaper to handle as a whole.
+  if (data_.dirty_cells.size() > data_.levels.size() / 4) refresh_all_ = true;
+}
+
+void HeatmapModel::EnsureRange(Day first_day, Day last_day) {
+  Day grid_end = data_.grid_start + (Day)(data_.week_count * 7);
+  if (data_.week_count > 0 && first_day >= data_.grid_start &&
+      last_day < grid_end) {
+    return;
+  }
+
+  Day new_start = MondayOf(first_day);
+  Day new_end = MondayOf(last_day) + 7;
+  if (data_.week_count > 0) {
+    new_start = std::min(new_start, data_.grid_start);
+    new_end = std::max(new_end, grid_end);
+  }
+
+  std::vector<uint16_t> completions((size_t)(new_end - new_start), 0);
+  if (data_.week_count > 0) {
+    std::copy(data_.completions.begin(), data_.completions.end(),
+              completions.begin() + (data_.grid_start - new_start));
+  }
+  data_.completions = std::move(completions);
+  data_.grid_start = new_start;
+  data_.week_count = data_.completions.size() / 7;
+  data_.levels.assign(data_.completions.size(), 0);
+  data_.week_rates.assign(data_.week_count, 0.0f);
+  refresh_all_ = true;
+}
+
+void HeatmapModel::RefreshAll() {
+  data_.dirty_cells.clear();
+  data_.refresh_all = true;
+  for (size_t cell = 0; cell < data_.completions.size(); cell++) {
+    RefreshCell(cell);
+  }
+  for (size_t week = 0; week < data_.week_count; week++) {
+    RefreshWeekRate(week);
+  }
+}
+
+void HeatmapModel::RefreshCell(size_t cell) {
+  if (data_.DayOf(cell) > data_.today) {
+    data_.levels[cell] = HeatmapData::kFuture;
+    return;
+  }
+  uint16_t completions = data_.completions[cell];
+  int level = completions == 0
+                  ? 0
+                  : 1 + (completions * (HeatmapData::kLevels - 1) - 1) /
+                            Scale();
+  data_.levels[cell] = (uint8_t)std::min(level, HeatmapData::kLevels - 1);
+}
+
+void HeatmapModel::RefreshWeekRate(size_t week) {
+  int days = 0, completed = 0;
+  for (size_t cell = week * 7; cell < week * 7 + 7; cell++) {
+    if (data_.DayOf(cell) > data_.today) break;
+    days++;
+    completed += data_.completions[cell];
+  }
+  data_.week_rates[week] =
+      days > 0 ? std::min(1.0f, (float)completed / (days * Scale())) : 0.0f;
+}
+}  // namespace habitify_frontend
@@ -0,0 +1,96 @@
+#ifndef HABITIFY_SRC_FRONTEND_HABIT_HEATMAP_HEATMAP_MODEL_H_
+#define HABITIFY_SRC_FRONTEND_HABIT_HEATMAP_HEATMAP_MODEL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+
+namespace habitify_frontend {
+
+/// Everything HabitHeatmapGui displays. The grid starts on a Monday and holds
+/// one cell per day, column major so that the visible weeks are a contiguous
+/// range of cells.
+struct HeatmapData {
+  /// Color level of a cell, 0 for no completions up to kLevels - 1.
+  static constexpr int kLevels = 5;
+  /// Level of the cells after today, which are not drawn.
+  static constexpr uint8_t kFuture = 0xff;
+
+  /// Increased whenever the data changes.
+  uint64_t version = 0;
+  ::habitify_core::Day grid_start = 0;
+  ::habitify_core::Day today = 0;
+  size_t week_count = 0;
+  std::vector<uint16_t> completions;
+  std::vector<uint8_t> levels;
+  std::vector<float> week_rates;
+  /// Cells whose count or level changed since the previous version, together
+  /// with the rate of their week. Only meaningful if refresh_all is false,
+  /// else every cell may have changed, e.g. because the grid grew.
+  std::vector<uint32_t> dirty_cells;
+  bool refresh_all = true;
+
+  inline ::habitify_core::Day DayOf(size_t cell) const {
+    return grid_start + (::habitify_core::Day)cell;
+  }
+};
+
+/// HeatmapModel keeps the completion counts of the heatmap up to date with
+/// the bus. It starts from the latest HabitAggregates and applies every
+/// check-in on top of them, so a check-in only recomputes the level of its
+/// cell and the rate of its week. It does not use ImGui and runs in the
+/// OnUpdate() phase of HabitHeatmapGui. Usage:
+///       HeatmapModel model(event_bus);
+///       model.Attach(Today());
+///       if (model.Update(Today())) Show(model.get_data());
+class HeatmapModel {
+ public:
+  /// Weeks shown before the first check-in arrives.
+  static constexpr size_t kMinWeeks = 53;
+
+  explicit HeatmapModel(std::shared_ptr<::habitify_core::EventBus> event_bus);
+
+  /// Subscribes to the check-ins and starts from their latest snapshot.
+  void Attach(::habitify_core::Day today);
+  /// Applies new aggregates and check-ins. Returns true if the data changed
+  /// since the last call, HeatmapData::dirty_cells then lists what changed.
+  bool Update(::habitify_core::Day today);
+
+  inline const HeatmapData &get_data() const { return data_; }
+
+ private:
+  void ReceiveAggregates();
+  /// Replaces all completion counts with the ones of aggregates.
+  void ApplyAggregates(const ::habitify_core::HabitAggregates &aggregates);
+  void ReceiveCheckIns();
+  /// Grows the grid so that it covers [first_day, last_day].
+  void EnsureRange(::habitify_core::Day first_day,
+                   ::habitify_core::Day last_day);
+  /// Recomputes all levels and weekly rates, e.g. after the scale changed.
+  void RefreshAll();
+  void RefreshCell(size_t cell);
+  void RefreshWeekRate(size_t week);
+
+  inline int Scale() const {
+    return std::max(1, std::max(habit_count_, (int)max_completions_));
+  }
+
+ private:
+  std::shared_ptr<::habitify_core::EventBus> event_bus_;
+  std::shared_ptr<::habitify_core::Listener> aggregates_listener_;
+  std::shared_ptr<::habitify_core::Listener> checkin_listener_;
+
+  HeatmapData data_;
+  int habit_count_ = 0;
+  uint16_t max_completions_ = 0;
+  bool changed_ = false;
+  bool refresh_all_ = false;
+};
+}  // namespace habitify_frontend
+
+#endif  // HABITIFY_SRC_FRONTEND_HABIT_HEATMAP_HEATMAP_MODEL_H_
@@ -0,0 +1,184 @@
+#include "src/frontend/habit_history/habit_history_gui.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+
+namespace habitify_frontend {
+using ::habitify_core::HistoryPage;
+using ::habitify_core::HistoryPageRequest;
+using ::habitify_core::HistoryRow;
+
+HabitHistoryGui::HabitHistoryGui(
+    std::shared_ptr<::habitify_core::EventBus> event_bus)
+    : event_bus_(event_bus) {
+  listener_ =
+      event_bus_->SubscribeTo(::habitify_core::channels::kHabitHistoryPage);
+  publisher_ = event_bus_->RegisterPublisher<HistoryPageRequest>(
+      ::habitify_core::channels::kHabitHistoryRequest);
+  WakeOnChannel(::habitify_core::channels::kHabitHistoryPage);
+
+  // Reserve once so that storing pages never allocates.
+  for (auto &slot : cache_) {
+    slot.rows.reserve(kPageRows);
+  }
+}
+
+void HabitHistoryGui::OnUIRender(FrameArena &arena) {
+  ImGui::Begin("Habit History");
+  ReceivePages();
+
+  if (!knows_total_rows_) {
+    RequestWindow(0, 0);
+    ImGui::TextDisabled("Loading...");
+    ImGui::End();
+    return;
+  }
+  if (total_rows_ == 0) {
+    ImGui::TextDisabled("No check-ins yet");
+    ImGui::End();
+    return;
+  }
+
+  ImGui::Text("%zu entries", total_rows_);
+  if (ImGui::BeginTable("history", 3,
+                        ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Date");
+    ImGui::TableSetupColumn("Habit");
+    ImGui::TableSetupColumn("Value");
+    ImGui::TableHeadersRow();
+
+    // The clipper may step through extra rows, e.g. to measure the row height,
+    // so only the largest step is used to decide what to stream.
+    size_t first_visible = 0, last_visible = 0, widest_step = 0;
+
+    ImGuiListClipper clipper;
+    clipper.Begin((int)total_rows_);
+    while (clipper.Step()) {
+      size_t step = clipper.DisplayEnd - clipper.DisplayStart;
+      if (step > widest_step) {
+        widest_step = step;
+        // Newest first: display index 0 is the last row.
+        first_visible = total_rows_ - clipper.DisplayEnd;
+        last_visible = total_rows_ - 1 - clipper.DisplayStart;
+      }
+
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        const HistoryRow *row = FindRow(total_rows_ - 1 - i);
+        if (!row) {
+          ImGui::TextDisabled("...");
+          continue;
+        }
+
+        int year;
+        unsigned month, day;
+        ::habitify_core::CivilFromDays(row->day, year, month, day);
+        ImGui::Text("%04d-%02u-%02u", year, month, day);
+        ImGui::TableNextColumn();
+        ImGui::Text("%d", row->habit_id);
+        ImGui::TableNextColumn();
+        ImGui::Text("%d", row->value);
+      }
+    }
+    ImGui::EndTable();
+
+    if (widest_step > 0) RequestWindow(first_visible, last_visible);
+  }
+  ImGui::End();
+}
+
+void HabitHistoryGui::ReceivePages() {
+  if (!listener_->HasReceivedEvent()) return;
+  // Every page is read so that no answer is lost behind an announcement and
+  // the bus can drop the pages right away.
+  while (auto event = listener_->ReadNext<HistoryPage>()) {
+    const HistoryPage *page = event->GetData<HistoryPage>();
+    if (page->request_id == pending_request_) pending_request_ = 0;
+    StorePage(*page);
+  }
+}
+
+void HabitHistoryGui::StorePage(const HistoryPage &page) {
+  if (knows_total_rows_ && page.total_rows != total_rows_) {
+    // Rows are only ever appended, so only the formerly last page changed.
+    if (total_rows_ > 0) {
+      size_t last_page = (total_rows_ - 1) / kPageRows;
+      if (SlotFor(last_page).page == last_page)
+        SlotFor(last_page).page = kNoPage;
+    }
+  }
+  total_rows_ = page.total_rows;
+  knows_total_rows_ = true;
+
+  // Requests are page aligned, anything else is not cached.
+  if (page.first_row % kPageRows != 0) return;
+  for (size_t offset = 0; offset < page.rows.size(); offset += kPageRows) {
+    size_t count = std::min(kPageRows, page.rows.size() - offset);
+    size_t index = (page.first_row + offset) / kPageRows;
+    // Partial pages are only complete at the end of the history.
+    if (count < kPageRows && page.first_row + offset + count < total_rows_)
+      break;
+
+    CachedPage &slot = SlotFor(index);
+    slot.page = index;
+    slot.rows.assign(page.rows.begin() + offset,
+                     page.rows.begin() + offset + count);
+  }
+}
+
+void HabitHistoryGui::RequestWindow(size_t first_row, size_t last_row) {
+  auto now = Clock::now();
+  if (pending_request_ != 0 && now - pending_since_ < kRequestTimeout) return;
+
+  size_t page_count =
+      std::max<size_t>(1, (total_rows_ + kPageRows - 1) / kPageRows);
+  size_t first_page = first_row / kPageRows;
+  size_t last_page = std::min(last_row / kPageRows, page_count - 1);
+  // Prefetch as much as fits into the cache next to the visible pages.
+  size_t budget =
+      kCachedPages - std::min(kCachedPages, last_page - first_page + 1);
+  size_t before = std::min({kPrefetchPages, first_page, budget / 2});
+  size_t after = std::min({kPrefetchPages, page_count - 1 - last_page,
+                           budget - before});
+  first_page -= before;
+  last_page += after;
+
+  size_t first_missing = kNoPage, last_missing = 0;
+  for (size_t page = first_page; page <= last_page; page++) {
+    if (SlotFor(page).page == page) continue;
+    first_missing = std::min(first_missing, page);
+    last_missing = page;
+  }
+  if (knows_total_rows_ && first_missing == kNoPage) return;
+  if (first_missing == kNoPage) first_missing = last_missing = 0;
+
+  auto request = ::habitify_core::MakePayload<HistoryPageRequest>();
+  request->request_id = next_request_id_++;
+  request->first_row = first_missing * kPageRows;
+  request->row_count = (last_missing - first_missing + 1) * kPageRows;
+
+  pending_request_ = request->request_id;
+  pending_since_ = now;
+  publisher_->Publish(
+      std::make_unique<const ::habitify_core::Event<HistoryPageRequest>>(
+          ::habitify_core::EventType::HABIT_HISTORY_REQUEST,
+          ::habitify_core::channels::kHabitHistoryRequest, request));
+}
+
+const HistoryRow *HabitHistoryGui::FindRow(size_t row) const {
+  size_t page = row / kPageRows;
+  const CachedPage &slot = SlotFor(page);
+  if (slot.page != page) return nullptr;
+
+  size_t offset = row % kPageRows;
+  return offset < slot.rows.size() ? &slot.rows[offset] : nullptr;
+}
+
+}  // namespace habitify_frontend
@@ -0,0 +1,75 @@
+#ifndef HABITIFY_SRC_FRONTEND_HABIT_HISTORY_HABIT_HISTORY_GUI_H_
+#define HABITIFY_SRC_FRONTEND_HABIT_HISTORY_HABIT_HISTORY_GUI_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/frontend/layer.h"
+
+namespace habitify_frontend {
+
+/// HabitHistoryGui shows the complete habit history, newest entry first. Only
+/// the visible rows are submitted to ImGui through an ImGuiListClipper. Rows
+/// are streamed from the HabitHistoryService in page aligned windows around
+/// the visible range and kept in a fixed number of cached pages, so memory
+/// and frame time do not depend on the length of the history.
+class HabitHistoryGui : public Layer {
+ public:
+  HabitHistoryGui() = delete;
+  HabitHistoryGui(std::shared_ptr<::habitify_core::EventBus> event_bus);
+  ~HabitHistoryGui() = default;
+
+  void OnUIRender(FrameArena &arena) override;
+  const char *GetName() const override { return "HabitHistoryGui"; }
+
+ private:
+  static constexpr size_t kPageRows = 256;
+  static constexpr size_t kCachedPages = 16;
+  /// Pages requested before and after the visible ones.
+  static constexpr size_t kPrefetchPages = 2;
+  static constexpr std::chrono::milliseconds kRequestTimeout{1000};
+  static constexpr size_t kNoPage = SIZE_MAX;
+
+  struct CachedPage {
+    size_t page = kNoPage;
+    std::vector<::habitify_core::HistoryRow> rows;
+  };
+
+  void ReceivePages();
+  void StorePage(const ::habitify_core::HistoryPage &page);
+  /// Requests the missing pages around the rows [first_row, last_row].
+  void RequestWindow(size_t first_row, size_t last_row);
+  const ::habitify_core::HistoryRow *FindRow(size_t row) const;
+
+  /// A page can only live in one slot so the row index is plain arithmetic.
+  inline CachedPage &SlotFor(size_t page) {
+    return cache_[page % kCachedPages];
+  }
+  inline const CachedPage &SlotFor(size_t page) const {
+    return cache_[page % kCachedPages];
+  }
+
+ private:
+  std::shared_ptr<::habitify_core::EventBus> event_bus_;
+  std::shared_ptr<::habitify_core::Listener> listener_;
+  std::shared_ptr<
+      ::habitify_core::Publisher<::habitify_core::HistoryPageRequest>>
+      publisher_;
+
+  std::array<CachedPage, kCachedPages> cache_;
+  size_t total_rows_ = 0;
+  bool knows_total_rows_ = false;
+
+  uint64_t next_request_id_ = 1;
+  uint64_t pending_request_ = 0;
+  Clock::time_point pending_since_;
+};
+}  // namespace habitify_frontend
+
+#endif  // HABITIFY_SRC_FRONTEND_HABIT_HISTORY_HABIT_HISTORY_GUI_H_
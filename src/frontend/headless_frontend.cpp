@@ -0,0 +1,88 @@
+#include "src/frontend/headless_frontend.h"
+
+namespace habitify_frontend {
+HeadlessFrontend::~HeadlessFrontend() {
+  if (is_initialized_) Shutdown();
+}
+
+bool HeadlessFrontend::Init(int display_w, int display_h) {
+  if (!event_bus_) return is_initialized_ = false;
+
+  IMGUI_CHECKVERSION();
+  ImGui::CreateContext();
+
+  io_ = &ImGui::GetIO();
+  io_->ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+  io_->ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+  // Viewports need a platform backend so they stay disabled here.
+  io_->IniFilename = nullptr;
+  io_->LogFilename = nullptr;
+  io_->DisplaySize = ImVec2((float)display_w, (float)display_h);
+
+  // The atlas is normally built by the renderer backend. Nothing uploads it
+  // here but ImGui::NewFrame() requires it to be built.
+  unsigned char *pixels;
+  int width, height;
+  io_->Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+  return is_initialized_ = true;
+}
+
+void HeadlessFrontend::Shutdown() {
+  // Detach the layers while the context still exists
+  layer_stack_.clear();
+  ImGui::DestroyContext();
+  io_ = nullptr;
+  is_initialized_ = false;
+}
+
+void HeadlessFrontend::ScheduleInput(size_t frame, InputScript input) {
+  input_scripts_.emplace(frame, std::move(input));
+}
+
+void HeadlessFrontend::ScheduleBusTraffic(size_t frame, BusScript traffic) {
+  bus_scripts_.emplace(frame, std::move(traffic));
+}
+
+ImDrawData *HeadlessFrontend::RenderFrame(float delta_time) {
+  if (!is_initialized_) return nullptr;
+  frame_arena_.Reset();
+
+  auto traffic = bus_scripts_.equal_range(frame_count_);
+  for (auto it = traffic.first; it != traffic.second; ++it) {
+    it->second(*event_bus_);
+  }
+
+  io_->DeltaTime = delta_time;
+  auto input = input_scripts_.equal_range(frame_count_);
+  for (auto it = input.first; it != input.second; ++it) {
+    it->second(*io_);
+  }
+
+  // Unlike ImGuiFrontend the OnUpdate() phase does not overlap with the
+  // previous frame so that each measured frame contains its own updates.
+  updating_layers_.assign(layer_stack_.begin(), layer_stack_.end());
+  if (executor_) {
+    executor_->ParallelFor(updating_layers_.size(),
+                           [this, delta_time](size_t i) {
+                             updating_layers_[i]->OnUpdate(delta_time);
+                           });
+  } else {
+    for (auto &layer : updating_layers_) layer->OnUpdate(delta_time);
+  }
+  for (auto &layer : updating_layers_) {
+    layer->SwapSnapshots();
+  }
+
+  ImGui::NewFrame();
+
+  for (auto &layer : layer_stack_) {
+    layer->OnUIRender(frame_arena_);
+  }
+
+  ImGui::Render();
+  ++frame_count_;
+  return ImGui::GetDrawData();
+}
+
+}  // namespace habitify_frontend
@@ -0,0 +1,89 @@
+#ifndef HABITIFY_SRC_FRONTEND_HEADLESS_FRONTEND_H_
+#define HABITIFY_SRC_FRONTEND_HEADLESS_FRONTEND_H_
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/runtime/executor.h"
+#include "src/frontend/frame_arena.h"
+#include "src/frontend/layer_stack.h"
+
+namespace habitify_frontend {
+
+/// HeadlessFrontend builds the same ImGui frames as ImGuiFrontend but without
+/// a window, GLFW or OpenGL. The draw data is generated and then discarded,
+/// which makes it possible to measure the cost of the LayerStack on machines
+/// without a display or GPU. Input and EventBus traffic are replayed from
+/// scripts that are attached to frame numbers. Usage:
+///       HeadlessFrontend frontend;
+///       frontend.SetEventBus(event_bus);
+///       frontend.Init();
+///       frontend.get_layer_stack().PushLayer<PingGui>(event_bus);
+///       frontend.ScheduleInput(10, [](ImGuiIO &io) {
+///         io.AddMouseButtonEvent(0, true);
+///       });
+///       for (int i = 0; i < 100; i++) frontend.RenderFrame();
+class HeadlessFrontend {
+ public:
+  using InputScript = std::function<void(ImGuiIO &)>;
+  using BusScript = std::function<void(::habitify_core::EventBus &)>;
+
+  HeadlessFrontend() = default;
+  ~HeadlessFrontend();
+
+  // This function must be called before Init()
+  void SetEventBus(std::shared_ptr<::habitify_core::EventBus> event_bus) {
+    event_bus_ = event_bus;
+  }
+  /// Optional. The OnUpdate() phase of the layers runs in parallel on the
+  /// executor, which must outlive the frontend. Otherwise it runs inline.
+  void SetExecutor(::habitify_core::Executor *executor) {
+    executor_ = executor;
+  }
+
+  /// Creates the ImGui context and builds the font atlas. Layers can be pushed
+  /// once this returned true.
+  bool Init(int display_w = 445, int display_h = 650);
+  void Shutdown();
+
+  /// Feeds input to ImGui at the start of the specified frame.
+  void ScheduleInput(size_t frame, InputScript input);
+  /// Runs traffic against the EventBus at the start of the specified frame,
+  /// before any Layer is rendered.
+  void ScheduleBusTraffic(size_t frame, BusScript traffic);
+
+  /// Runs the OnUpdate() phase and builds one frame for all layers. Returns
+  /// the draw data which stays valid until the next call.
+  ImDrawData *RenderFrame(float delta_time = 1.0f / 60.0f);
+
+  // Getters
+  inline LayerStack &get_layer_stack() { return layer_stack_; }
+  inline const size_t get_frame_count() { return frame_count_; }
+
+ private:
+  bool is_initialized_ = false;
+  size_t frame_count_ = 0;
+
+  ImGuiIO *io_ = nullptr;
+
+  std::multimap<size_t, InputScript> input_scripts_;
+  std::multimap<size_t, BusScript> bus_scripts_;
+
+  LayerStack layer_stack_;
+  FrameArena frame_arena_;
+  std::shared_ptr<::habitify_core::EventBus> event_bus_;
+
+  ::habitify_core::Executor *executor_ = nullptr;
+  ::habitify_core::Executor::Batch update_batch_;
+  std::vector<std::shared_ptr<Layer>> updating_layers_;
+};
+
+}  // namespace habitify_frontend
+
+#endif  // HABITIFY_SRC_FRONTEND_HEADLESS_FRONTEND_H_
@@ -3,7 +3,12 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <algorithm>
+#include <cstdio>
+
 #include "src/frontend/debug_gui/debug_gui.h"
+#include "src/frontend/habit_heatmap/habit_heatmap_gui.h"
+#include "src/frontend/habit_history/habit_history_gui.h"
 #include "src/frontend/ping/ping_gui.h"
 
 #if defined(_MSC_VER) && (_MSC_VER >= 1900) && \
@@ -16,61 +21,94 @@ static void glfw_error_callback(int error, const char *description) {
 }
 
 namespace habitify_frontend {
-ImGuiFrontend::ImGuiFrontend() {}
-ImGuiFrontend::~ImGuiFrontend() {}
+ImGuiFrontend::ImGuiFrontend()
+    : profiler_(std::make_shared<habitify_debug::FrameProfiler>()) {}
+ImGuiFrontend::~ImGuiFrontend() { *accepts_wakeups_ = false; }
 
 bool ImGuiFrontend::Init() {
   if (!event_bus_) return is_initialized = false;
-  // Setup window
+  // Every phase is timed by its own scope.
   glfwSetErrorCallback(glfw_error_callback);
-  if (!glfwInit()) return is_initialized = false;
+  const char *glsl_version;
+  {
+    // Setup window
+    ::habitify_core::StartupScope window_scope(startup_timeline_.get(),
+                                               "CreateWindow");
+    if (!glfwInit()) return is_initialized = false;
 
     // Decide GL+GLSL versions
 #if defined(IMGUI_IMPL_OPENGL_ES2)
-  // GL ES 2.0 + GLSL 100
-  const char *glsl_version = "#version 100";
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+    // GL ES 2.0 + GLSL 100
+    glsl_version = "#version 100";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
 #else
-  // GL 3.0 + GLSL 130
-  const char *glsl_version = "#version 130";
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
-  // glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+
-  // only glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // 3.0+ only
+    // GL 3.0 + GLSL 130
+    glsl_version = "#version 130";
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    // glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+
+    // only glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // 3.0+ only
 #endif
 
-  // Create window with graphics context
-  window_ = glfwCreateWindow(display_w_, display_h_, "Habitify", NULL, NULL);
-  if (window_ == NULL) return false;
-  glfwMakeContextCurrent(window_);
-  glfwSwapInterval(1);  // Enable vsync
+    // Create window with graphics context
+    window_ = glfwCreateWindow(display_w_, display_h_, "Habitify", NULL, NULL);
+    if (window_ == NULL) return false;
+    glfwMakeContextCurrent(window_);
+    glfwSwapInterval(1);  // Enable vsync
+  }
 
-  // Setup Dear ImGui context
-  IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
+  {
+    // Setup Dear ImGui context
+    ::habitify_core::StartupScope context_scope(startup_timeline_.get(),
+                                                "CreateImGuiContext");
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
 
-  io_ = &ImGui::GetIO();
-  (void)io_;
-  io_->ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
-  io_->ConfigFlags |= ImGuiConfigFlags_DockingEnable;  // Enable Docking
-  io_->ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
+    io_ = &ImGui::GetIO();
+    (void)io_;
+    io_->ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+    io_->ConfigFlags |= ImGuiConfigFlags_DockingEnable;  // Enable Docking
+    io_->ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
 
-  // Setup Platform/Renderer backends
-  ImGui_ImplGlfw_InitForOpenGL(window_, true);
-  ImGui_ImplOpenGL3_Init(glsl_version);
+    // Setup Platform/Renderer backends
+    ImGui_ImplGlfw_InitForOpenGL(window_, true);
+    ImGui_ImplOpenGL3_Init(glsl_version);
 
-  viewport_ = ImGui::GetMainViewport();
+    viewport_ = ImGui::GetMainViewport();
+  }
 
-  // instantiate layers
-  layer_stack_.PushLayer<habitify_debug::DebugGui>();
-  layer_stack_.PushLayer<PingGui>(event_bus_);
+  {
+    // instantiate layers. Layers that are not needed for the first frame are
+    // attached after it.
+    ::habitify_core::StartupScope layers_scope(startup_timeline_.get(),
+                                               "PushLayers");
+    layer_stack_.PushLayer<habitify_debug::DebugGui>(
+        profiler_, startup_timeline_, event_bus_);
+    layer_stack_.PushLayer<PingGui>(event_bus_);
+    layer_stack_.PushLayer<HabitHistoryGui>(event_bus_);
+    deferred_layers_.push_back(layer_stack_.PushLazyLayer<HabitHeatmapGui>(
+        event_bus_, ImVec2((float)display_w_, 0.0f),
+        ImVec2((float)display_w_offset_graph_, (float)display_h_)));
+  }
+
+  *accepts_wakeups_ = true;
+  for (auto &layer : layer_stack_) {
+    RegisterWakeChannels(layer);
+  }
 
   return is_initialized = true;
 }
 
 void ImGuiFrontend::Shutdown() {
+  *accepts_wakeups_ = false;
+  for (const auto &[channel, hook] : wake_channels_) {
+    event_bus_->RemovePublishHook(channel, hook);
+  }
+  wake_channels_.clear();
+  FinishUpdates();
+
   // Cleanup
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
@@ -82,6 +120,105 @@ void ImGuiFrontend::Shutdown() {
   is_initialized = false;
 }
 
+void ImGuiFrontend::WaitForEvents() {
+  if (settle_frames_left_ > 0) {
+    --settle_frames_left_;
+    glfwPollEvents();
+    return;
+  }
+
+  // Results of the last OnUpdate() phase would not be shown until the next
+  // wakeup otherwise.
+  if (FinishUpdates()) {
+    glfwPollEvents();
+    return;
+  }
+
+  auto now = Layer::Clock::now();
+  auto deadline = Layer::Clock::time_point::max();
+  for (auto &layer : layer_stack_) {
+    deadline = std::min(deadline, layer->get_redraw_deadline());
+  }
+  // Keep the text cursor blinking while an input field is active.
+  if (io_->WantTextInput)
+    deadline = std::min(deadline, now + kCursorBlinkInterval);
+
+  // Input events and glfwPostEmptyEvent() wake us up immediately so sleeping
+  // here does not add latency.
+  if (deadline == Layer::Clock::time_point::max())
+    glfwWaitEvents();
+  else if (deadline > now)
+    glfwWaitEventsTimeout(
+        std::chrono::duration<double>(deadline - now).count());
+  else
+    glfwPollEvents();
+
+  settle_frames_left_ = kSettleFrames;
+}
+
+void ImGuiFrontend::RegisterWakeChannels(const std::shared_ptr<Layer> &layer) {
+  for (const auto &channel : layer->get_wake_channels()) {
+    if (wake_channels_.contains(channel)) continue;
+    wake_channels_[channel] =
+        event_bus_->AddPublishHook(channel, [accepts = accepts_wakeups_]() {
+          if (*accepts) glfwPostEmptyEvent();
+        });
+  }
+}
+
+void ImGuiFrontend::ShowDeferredLayer() {
+  if (deferred_layers_.empty()) return;
+  auto layer = deferred_layers_.front();
+  deferred_layers_.erase(deferred_layers_.begin());
+
+  {
+    HAB_PROFILE_SCOPE(profiler_.get(), "AttachDeferredLayer");
+    layer_stack_.ShowLayer(layer);
+  }
+  RegisterWakeChannels(layer);
+  // Render the next frame right away, the layer may have missed events while
+  // the frontend was sleeping.
+  layer->RequestRedraw();
+}
+
+void ImGuiFrontend::FinishFirstFrame() {
+  first_frame_presented_ = true;
+  if (!startup_timeline_) return;
+
+  startup_timeline_->Mark("FirstFrame");
+  auto first_frame = startup_timeline_->Find("FirstFrame");
+  if (first_frame && *first_frame > kFirstFrameBudget) {
+    fprintf(stderr, "First frame took %lld ms, budget is %lld ms:\n%s",
+            (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+                *first_frame)
+                .count(),
+            (long long)kFirstFrameBudget.count(),
+            startup_timeline_->ToString().c_str());
+  }
+}
+
+void ImGuiFrontend::DispatchUpdates(float dt) {
+  updating_layers_.assign(layer_stack_.begin(), layer_stack_.end());
+  if (!executor_) {
+    for (auto &layer : updating_layers_) layer->OnUpdate(dt);
+    return;
+  }
+  executor_->Dispatch(
+      update_batch_, updating_layers_.size(),
+      [this, dt](size_t i) { updating_layers_[i]->OnUpdate(dt); });
+}
+
+bool ImGuiFrontend::FinishUpdates() {
+  if (executor_) executor_->Wait(update_batch_);
+
+  bool swapped = false;
+  for (auto &layer : updating_layers_) {
+    swapped |= layer->SwapSnapshots();
+  }
+  updating_layers_.clear();
+  return swapped;
+}
+
 void ImGuiFrontend::Run() {
   if (!Init()) return;
   while (!glfwWindowShouldClose(window_)) {
@@ -94,28 +231,58 @@ void ImGuiFrontend::Run() {
     // data to your main application, or clear/overwrite your copy of the
     // keyboard data. Generally you may always pass all inputs to dear imgui,
     // and hide them from your application based on those two flags.
-    glfwPollEvents();
+    if (power_saving_)
+      WaitForEvents();
+    else
+      glfwPollEvents();
 
-    // Start the Dear ImGui frame
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
+    // Redraw requests are one-shot. Animating layers renew them each frame.
+    auto now = Layer::Clock::now();
+    for (auto &layer : layer_stack_) {
+      if (layer->get_redraw_deadline() <= now) layer->ClearRedrawDeadline();
+    }
+
+    // Time spent waiting for events is not part of the frame.
+    profiler_->BeginFrame();
+    frame_arena_.Reset();
+
+    {
+      HAB_PROFILE_SCOPE(profiler_.get(), "FinishUpdates");
+      FinishUpdates();
+    }
+
+    if (first_frame_presented_) ShowDeferredLayer();
 
-    ImGui::ShowDemoWindow();
+    {
+      // Start the Dear ImGui frame
+      HAB_PROFILE_SCOPE(profiler_.get(), "NewFrame");
+      ImGui_ImplOpenGL3_NewFrame();
+      ImGui_ImplGlfw_NewFrame();
+      ImGui::NewFrame();
+
+      ImGui::ShowDemoWindow();
+    }
 
     for (auto &layer : layer_stack_) {
-      layer->OnUIRender();
+      HAB_PROFILE_SCOPE(profiler_.get(), layer->GetName());
+      layer->OnUIRender(frame_arena_);
     }
 
-    // Rendering
-    ImGui::Render();
-    glfwGetFramebufferSize(window_, &temp_display_w_, &temp_display_h_);
-    glViewport(0, 0, temp_display_w_, temp_display_h_);
-    glClearColor(clear_color_.x * clear_color_.w,
-                 clear_color_.y * clear_color_.w,
-                 clear_color_.z * clear_color_.w, clear_color_.w);
-    glClear(GL_COLOR_BUFFER_BIT);
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // The next OnUpdate() phase overlaps with rendering and the buffer swap.
+    DispatchUpdates(io_->DeltaTime);
+
+    {
+      // Rendering
+      HAB_PROFILE_SCOPE(profiler_.get(), "Render");
+      ImGui::Render();
+      glfwGetFramebufferSize(window_, &temp_display_w_, &temp_display_h_);
+      glViewport(0, 0, temp_display_w_, temp_display_h_);
+      glClearColor(clear_color_.x * clear_color_.w,
+                   clear_color_.y * clear_color_.w,
+                   clear_color_.z * clear_color_.w, clear_color_.w);
+      glClear(GL_COLOR_BUFFER_BIT);
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
 
     // Update and Render additional Platform Windows
     // (Platform functions may change the current OpenGL context, so we
@@ -123,13 +290,20 @@ void ImGuiFrontend::Run() {
     //  For this specific demo app we could also call
     //  glfwMakeContextCurrent(window) directly)
     if (io_->ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+      HAB_PROFILE_SCOPE(profiler_.get(), "RenderPlatformWindowsDefault");
       GLFWwindow *backup_current_context = glfwGetCurrentContext();
       ImGui::UpdatePlatformWindows();
       ImGui::RenderPlatformWindowsDefault();
       glfwMakeContextCurrent(backup_current_context);
     }
 
-    glfwSwapBuffers(window_);
+    {
+      HAB_PROFILE_SCOPE(profiler_.get(), "SwapBuffers");
+      glfwSwapBuffers(window_);
+    }
+    if (!first_frame_presented_) FinishFirstFrame();
+
+    profiler_->EndFrame();
   }
   Shutdown();
 }
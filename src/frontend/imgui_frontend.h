@@ -3,7 +3,11 @@
 
 #include <imgui.h>
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #define GL_SILENCE_DEPRECATION
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -12,6 +16,10 @@
 #include <GLFW/glfw3.h>  // Will drag system OpenGL headers
 
 #include "src/core/event_bus/event_bus.h"
+#include "src/core/runtime/executor.h"
+#include "src/core/runtime/startup.h"
+#include "src/frontend/debug_gui/frame_profiler.h"
+#include "src/frontend/frame_arena.h"
 #include "src/frontend/layer_stack.h"
 namespace habitify_frontend {
 
@@ -25,15 +33,69 @@ class ImGuiFrontend {
     event_bus_ = event_bus;
   }
 
+  /// Optional. The OnUpdate() phase of the layers runs in parallel on the
+  /// executor, which must outlive the frontend. Otherwise it runs inline.
+  void SetExecutor(::habitify_core::Executor *executor) {
+    executor_ = executor;
+  }
+
+  /// Optional. Init() records its phases and Run() the first presented frame
+  /// on the timeline, which DebugGui then shows.
+  void SetStartupTimeline(
+      std::shared_ptr<::habitify_core::StartupTimeline> timeline) {
+    startup_timeline_ = timeline;
+  }
+
+  /// In power saving mode Run() only renders when there is input, an event on
+  /// a channel one of the layers woke on or a pending redraw request of a
+  /// layer. Otherwise it renders every vsync. Enabled by default.
+  void set_power_saving(bool enabled) { power_saving_ = enabled; }
+
   void Run();
 
  private:
   bool Init();
   void Shutdown();
 
+  /// Blocks until the next frame needs to be rendered. Used instead of
+  /// glfwPollEvents() in power saving mode.
+  void WaitForEvents();
+  /// Registers a publish hook for every channel the layer wants to be woken
+  /// up by.
+  void RegisterWakeChannels(const std::shared_ptr<Layer> &layer);
+  /// Shows the next layer that was deferred until after the first frame.
+  void ShowDeferredLayer();
+  /// Marks the first presented frame and warns if it missed the budget.
+  void FinishFirstFrame();
+
+  /// Starts the OnUpdate() phase of all layers on the executor. It runs
+  /// while the current frame is rendered and presented.
+  void DispatchUpdates(float dt);
+  /// Waits for the running OnUpdate() phase and swaps the snapshots of its
+  /// layers. Returns true if any layer committed new data.
+  bool FinishUpdates();
+
  private:
+  // ImGui needs a couple of frames after each input to settle hover states,
+  // window resizes and docking.
+  static constexpr int kSettleFrames = 3;
+  static constexpr std::chrono::milliseconds kCursorBlinkInterval{500};
+  /// Time from the start of the process to the first presented frame.
+  static constexpr std::chrono::milliseconds kFirstFrameBudget{250};
+
   // flags
   bool is_initialized = false;
+  bool power_saving_ = true;
+  bool first_frame_presented_ = false;
+  // Publish hooks may fire on any thread, even after Shutdown() or the
+  // destruction of the frontend, so they share ownership of the flag.
+  std::shared_ptr<std::atomic<bool>> accepts_wakeups_ =
+      std::make_shared<std::atomic<bool>>(false);
+  int settle_frames_left_ = kSettleFrames;
+  /// Publish hooks that wake up the loop, removed by Shutdown().
+  std::unordered_map<::habitify_core::ChannelIdType,
+                     ::habitify_core::PublishHookId>
+      wake_channels_;
 
   // ImGui Frontend utils
   GLFWwindow *window_;
@@ -52,7 +114,17 @@ class ImGuiFrontend {
   ImGuiStyle *style_ = nullptr;
 
   LayerStack layer_stack_;
+  FrameArena frame_arena_;
   std::shared_ptr<::habitify_core::EventBus> event_bus_;
+  std::shared_ptr<habitify_debug::FrameProfiler> profiler_;
+  std::shared_ptr<::habitify_core::StartupTimeline> startup_timeline_;
+  /// Lazy layers that are shown one per frame after the first frame.
+  std::vector<std::shared_ptr<Layer>> deferred_layers_;
+
+  // OnUpdate() phase
+  ::habitify_core::Executor *executor_ = nullptr;
+  ::habitify_core::Executor::Batch update_batch_;
+  std::vector<std::shared_ptr<Layer>> updating_layers_;
 };
 
 }  // namespace habitify_frontend
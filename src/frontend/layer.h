@@ -1,15 +1,93 @@
 #ifndef HABITIFY_SRC_FRONTEND_LAYER_H_
 #define HABITIFY_SRC_FRONTEND_LAYER_H_
 
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "src/core/event_bus/event.h"
+#include "src/frontend/frame_arena.h"
+
 namespace habitify_frontend {
+template <typename T>
+class Snapshot;
+
+namespace internal {
+/// Type erased interface of Snapshot<T> so that the Layer can swap all of its
+/// snapshots.
+class SnapshotBase {
+ public:
+  virtual ~SnapshotBase() = default;
+  /// Publishes the committed back buffer. Returns false if nothing was
+  /// committed since the last swap.
+  virtual bool Swap() = 0;
+};
+}  // namespace internal
+
 class Layer {
  public:
+  using Clock = std::chrono::steady_clock;
+
   virtual ~Layer() = default;
 
   virtual void OnAttach(){};
   virtual void OnDetach(){};
 
-  virtual void OnUIRender(){};
+  /// Prepares the data that OnUIRender() displays. OnUpdate() runs on the
+  /// Executor of the frontend, in parallel with the OnUpdate() of the other
+  /// layers and with the rendering of the previous frame. It must not call
+  /// ImGui and hands its results to OnUIRender() through Snapshot members.
+  virtual void OnUpdate(float dt){};
+  /// Submits the ImGui widgets of the Layer. Scratch data that is only needed
+  /// for this frame should be allocated from arena instead of the heap.
+  virtual void OnUIRender(FrameArena &arena){};
+
+  /// Name used to identify the Layer in the profiler. Must return a string
+  /// literal.
+  virtual const char *GetName() const { return "Layer"; }
+
+  /// Asks the frontend to render a frame once delay has passed, even if no
+  /// input arrives in the meantime. Animating layers call this every frame.
+  void RequestRedraw(Clock::duration delay = Clock::duration::zero()) {
+    redraw_deadline_ = std::min(redraw_deadline_, Clock::now() + delay);
+  }
+  inline void ClearRedrawDeadline() {
+    redraw_deadline_ = Clock::time_point::max();
+  }
+
+  /// Called by the frontend once OnUpdate() finished and before OnUIRender()
+  /// runs. Returns true if any Snapshot received new data.
+  bool SwapSnapshots() {
+    bool swapped = false;
+    for (auto snapshot : snapshots_) {
+      swapped |= snapshot->Swap();
+    }
+    return swapped;
+  }
+
+  // Getters
+  inline const Clock::time_point &get_redraw_deadline() const {
+    return redraw_deadline_;
+  }
+  inline const std::vector<::habitify_core::ChannelIdType> &get_wake_channels()
+      const {
+    return wake_channels_;
+  }
+
+ protected:
+  /// Wakes the frontend from its power saving mode whenever an event is
+  /// published on channel. Must be called before the Layer is pushed.
+  void WakeOnChannel(const ::habitify_core::ChannelIdType &channel) {
+    wake_channels_.push_back(channel);
+  }
+
+ private:
+  template <typename T>
+  friend class Snapshot;
+
+  Clock::time_point redraw_deadline_ = Clock::time_point::max();
+  std::vector<::habitify_core::ChannelIdType> wake_channels_;
+  std::vector<internal::SnapshotBase *> snapshots_;
 };
 }  // namespace habitify_frontend
 
@@ -48,6 +48,7 @@ void LayerStack::HideLayer(std::shared_ptr<Layer> layer) {
 void LayerStack::ShowLayer(std::shared_ptr<Layer> layer) {
   auto it = std::find(hidden_layers_.begin(), hidden_layers_.end(), layer);
   if (it != hidden_layers_.end()) {
+    if (unattached_layers_.erase(layer.get())) layer->OnAttach();
     layers_.emplace(layers_.begin() + layer_insert_index_, layer);
     layer_insert_index_++;
     hidden_layers_.erase(it);
@@ -60,9 +61,13 @@ void LayerStack::clear() {
     layer.reset();
   }
   for (std::shared_ptr<Layer> layer : hidden_layers_) {
-    layer->OnDetach();
+    if (!unattached_layers_.count(layer.get())) layer->OnDetach();
     layer.reset();
   }
+  layers_.clear();
+  hidden_layers_.clear();
+  unattached_layers_.clear();
+  layer_insert_index_ = 0;
 }
 
 }  // namespace habitify_frontend
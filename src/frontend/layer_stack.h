@@ -2,8 +2,11 @@
 #define HABITIFY_SRC_FRONTEND_LAYER_STACK_H_
 
 #include <memory>
+#include <memory_resource>
+#include <unordered_set>
 #include <vector>
 
+#include "src/core/metrics/memory_tracking.h"
 #include "src/frontend/layer.h"
 
 namespace habitify_frontend {
@@ -18,11 +21,24 @@ class LayerStack {
     static_assert(std::is_base_of<Layer, T>::value,
                   "Pushed type is not subclass of Layer!");
     layers_.emplace(layers_.begin() + layer_insert_index_,
-                    std::make_shared<T>(args...));
+                    MakeLayer<T>(args...));
     (*std::next(layers_.begin(), layer_insert_index_))->OnAttach();
     layer_insert_index_++;
   }
 
+  /// Constructs the layer hidden and without attaching it. The first
+  /// ShowLayer() attaches it, so expensive OnAttach() work can be deferred
+  /// until after the first frame.
+  template <typename T, typename... Args>
+  std::shared_ptr<T> PushLazyLayer(Args... args) {
+    static_assert(std::is_base_of<Layer, T>::value,
+                  "Pushed type is not subclass of Layer!");
+    auto layer = MakeLayer<T>(args...);
+    hidden_layers_.push_back(layer);
+    unattached_layers_.insert(layer.get());
+    return layer;
+  }
+
   void PushLayer(const std::shared_ptr<Layer> &layer);
   void PushOverlay(const std::shared_ptr<Layer> &overlay);
   void PopLayer(std::shared_ptr<Layer> layer);
@@ -56,9 +72,21 @@ class LayerStack {
     return layers_.rend();
   }
 
+ private:
+  /// Layers are accounted to MemoryTag::kFrontend.
+  template <typename T, typename... Args>
+  static std::shared_ptr<T> MakeLayer(Args... args) {
+    return std::allocate_shared<T>(
+        std::pmr::polymorphic_allocator<T>(::habitify_core::GetMemoryResource(
+            ::habitify_core::MemoryTag::kFrontend)),
+        args...);
+  }
+
  private:
   std::vector<std::shared_ptr<Layer>> layers_;
   std::vector<std::shared_ptr<Layer>> hidden_layers_;
+  /// Lazy layers that were never shown.
+  std::unordered_set<Layer *> unattached_layers_;
   unsigned int layer_insert_index_ = 0;
 };
 }  // namespace habitify_frontend
@@ -3,36 +3,39 @@
 #include <imgui.h>
 
 #include <memory>
-#include <string>
 
+#include "src/core/event_bus/channels.h"
 #include "src/core/event_bus/event.h"
 #include "src/core/event_bus/event_bus.h"
 
 namespace habitify_frontend {
 PingGui::PingGui(std::shared_ptr<::habitify_core::EventBus> event_bus)
     : event_bus_(event_bus) {
-  listener_ = event_bus_->SubscribeTo(0);
+  listener_ = event_bus_->SubscribeTo(::habitify_core::channels::kBackendPing);
+  publisher_ = event_bus_->RegisterPublisher<int>(
+      ::habitify_core::channels::kFrontendPing);
+  WakeOnChannel(::habitify_core::channels::kBackendPing);
 }
-void PingGui::OnUIRender() {
+void PingGui::OnUIRender(FrameArena &arena) {
   ImGui::Begin("Ping Service");
 
-  static std::string ping_str;
-  static std::string ping_send_str;
-
-  if (listener_->HasReceivedEvent())
-    ping_str = "Ping Received: " +
-               std::to_string(*listener_->ReadLatest<int>()->GetData<int>());
+  if (listener_->HasReceivedEvent() &&
+      listener_->TryReadLatestValue(received_ping_)) {
+    has_received_ping_ = true;
+  }
 
   if (ImGui::Button("Send Ping")) {
-    publisher_ = event_bus_->RegisterPublisher<int>(1);
-    static int ping_count = 0;
-    habitify_core::Event<int> e(habitify_core::EventType::TEST, 0, &ping_count);
-    ping_count++;
-    ping_send_str = "Sending Ping: " + std::to_string(ping_count);
+    habitify_core::Event<int> e(habitify_core::EventType::TEST, 0,
+                                &sent_pings_);
+    sent_pings_++;
     publisher_->Publish(std::make_unique<const habitify_core::Event<int>>(e));
   }
-  ImGui::Text(ping_send_str.c_str());
-  ImGui::Text(ping_str.c_str());
+  if (sent_pings_ > 0) {
+    ImGui::TextUnformatted(arena.Format("Sending Ping: %d", sent_pings_));
+  }
+  if (has_received_ping_) {
+    ImGui::TextUnformatted(arena.Format("Ping Received: %d", received_ping_));
+  }
   ImGui::End();
 }
 }  // namespace habitify_frontend
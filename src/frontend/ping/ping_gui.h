@@ -12,12 +12,17 @@ class PingGui : public Layer {
   PingGui() = delete;
   PingGui(std::shared_ptr<::habitify_core::EventBus> event_bus);
   ~PingGui() = default;
-  void OnUIRender() override;
+  void OnUIRender(FrameArena &arena) override;
+  const char *GetName() const override { return "PingGui"; }
 
  private:
   std::shared_ptr<::habitify_core::EventBus> event_bus_;
   std::shared_ptr<::habitify_core::Listener> listener_;
   std::shared_ptr<::habitify_core::Publisher<int>> publisher_;
+
+  int sent_pings_ = 0;
+  int received_ping_ = 0;
+  bool has_received_ping_ = false;
 };
 }  // namespace habitify_frontend
 
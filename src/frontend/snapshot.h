@@ -0,0 +1,59 @@
+#ifndef HABITIFY_SRC_FRONTEND_SNAPSHOT_H_
+#define HABITIFY_SRC_FRONTEND_SNAPSHOT_H_
+
+#include "src/frontend/layer.h"
+
+namespace habitify_frontend {
+
+/// Snapshot double buffers the data a Layer prepares in OnUpdate() for its
+/// OnUIRender(). OnUpdate() fills the back buffer and calls Commit(). The
+/// frontend swaps the buffers while neither phase runs, so OnUIRender() always
+/// reads a consistent copy that is immutable even while the next OnUpdate()
+/// already runs. Usage:
+///       class HabitGui : public Layer {
+///         void OnUpdate(float dt) override {
+///           auto &stats = stats_.Write();
+///           ...
+///           stats_.Commit();
+///         }
+///         void OnUIRender(FrameArena &arena) override {
+///           Show(stats_.Read());
+///         }
+///         Snapshot<Stats> stats_{this};
+///       };
+/// NOTE: Write() returns the buffer as it was two commits ago. OnUpdate() may
+/// copy Read() into it first if it only applies changes. Only commit if the
+/// data actually changed, every commit causes another frame to be rendered.
+template <typename T>
+class Snapshot : public internal::SnapshotBase {
+ public:
+  explicit Snapshot(Layer *owner) { owner->snapshots_.push_back(this); }
+  ~Snapshot() = default;
+
+  // Snapshot is registered by address with its Layer and cannot be copied.
+  Snapshot(const Snapshot &) = delete;
+  const Snapshot &operator=(const Snapshot &) = delete;
+
+  /// Only to be used from OnUpdate().
+  inline T &Write() { return buffers_[1 - front_]; }
+  inline void Commit() { committed_ = true; }
+
+  /// Can be used from OnUIRender() and OnUpdate().
+  inline const T &Read() const { return buffers_[front_]; }
+
+  bool Swap() override {
+    if (!committed_) return false;
+    front_ = 1 - front_;
+    committed_ = false;
+    return true;
+  }
+
+ private:
+  T buffers_[2]{};
+  int front_ = 0;
+  bool committed_ = false;
+};
+
+}  // namespace habitify_frontend
+
+#endif  // HABITIFY_SRC_FRONTEND_SNAPSHOT_H_
@@ -0,0 +1,296 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "src/core/engine/sharded_engine.h"
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+ShardedEngine::Options TestOptions() {
+  ShardedEngine::Options options;
+  options.shard_count = 4;
+  options.producer_slots = 2;
+  // Small queues to exercise the back pressure paths
+  options.queue_capacity = 16;
+  options.pin_threads = false;
+  return options;
+}
+
+// Collects responses from all shards until count arrived
+std::vector<UserResponse> Collect(ShardedEngine &engine, size_t count) {
+  std::vector<UserResponse> responses;
+  UserResponse response;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (responses.size() < count &&
+         std::chrono::steady_clock::now() < deadline) {
+    for (size_t shard = 0; shard < engine.get_shard_count(); shard++) {
+      while (engine.PollResponse(shard, response)) {
+        responses.push_back(response);
+      }
+    }
+  }
+  return responses;
+}
+
+TEST(ShardedEngineTest, ConcurrentProducers) {
+  constexpr UserId kUsers = 200;
+  constexpr Day kDays = 10;
+  ShardedEngine engine(TestOptions());
+  engine.Start();
+
+  // Two producers, each owns one slot and half of the users. Responses are
+  // drained meanwhile so that the shards never stall on a full outbound queue.
+  std::vector<UserResponse> responses;
+  std::vector<std::thread> producers;
+  for (size_t slot = 0; slot < 2; slot++) {
+    producers.emplace_back([&engine, slot]() {
+      uint64_t id = 0;
+      for (UserId user = 1 + slot; user <= kUsers; user += 2) {
+        for (Day day = 0; day < kDays; day++) {
+          UserRequest request;
+          request.request_id = ++id;
+          request.user_id = user;
+          request.day = day;
+          while (!engine.Submit(slot, request)) std::this_thread::yield();
+        }
+      }
+    });
+  }
+  responses = Collect(engine, kUsers * kDays);
+  for (auto &producer : producers) producer.join();
+  ASSERT_EQ(responses.size(), kUsers * kDays);
+  for (const auto &response : responses) EXPECT_TRUE(response.changed);
+
+  responses.clear();
+  for (UserId user = 1; user <= kUsers; user++) {
+    UserRequest query;
+    query.user_id = user;
+    query.kind = UserRequest::Kind::kQueryStats;
+    query.day = kDays - 1;
+    // The shards stop taking queries while their answers are not collected
+    while (!engine.Submit(0, query)) {
+      for (const auto &response : Collect(engine, 1)) {
+        responses.push_back(response);
+      }
+    }
+  }
+  for (const auto &response : Collect(engine, kUsers - responses.size())) {
+    responses.push_back(response);
+  }
+  ASSERT_EQ(responses.size(), kUsers);
+  for (const auto &response : responses) {
+    EXPECT_EQ(response.stats.total_completions, kDays);
+    EXPECT_EQ(response.stats.current_streak, kDays);
+  }
+}
+
+TEST(ShardedEngineTest, PartnerCheckInCrossesShards) {
+  ShardedEngine engine(TestOptions());
+  // Find two users on different shards
+  UserId partner = 2;
+  while (engine.ShardOf(partner) == engine.ShardOf(1)) partner++;
+  engine.Start();
+
+  UserRequest request;
+  request.user_id = 1;
+  request.partner_id = partner;
+  request.day = 5;
+  ASSERT_TRUE(engine.Submit(0, request));
+
+  auto responses = Collect(engine, 2);
+  ASSERT_EQ(responses.size(), 2);
+  std::unordered_map<UserId, bool> changed;
+  for (const auto &response : responses) {
+    changed[response.user_id] = response.changed;
+  }
+  EXPECT_TRUE(changed[1]);
+  EXPECT_TRUE(changed[partner]);
+}
+
+TEST(ShardedEngineTest, StopFinishesForwardedCheckIns) {
+  ShardedEngine engine(TestOptions());
+  // The partner's shard starts first, so after the restart the query below
+  // usually runs before a lost forward could be retried.
+  UserId user = 1, partner = 1;
+  while (engine.ShardOf(user) != engine.get_shard_count() - 1) user++;
+  while (engine.ShardOf(partner) != 0) partner++;
+
+  // Both slots fill their queue before the shards run. The forwards to the
+  // partner then overflow its queue as well and are deferred.
+  constexpr Day kDays = 32;
+  for (Day day = 0; day < kDays; day++) {
+    UserRequest request;
+    request.request_id = day + 1;
+    request.user_id = user;
+    request.partner_id = partner;
+    request.day = day;
+    ASSERT_TRUE(engine.Submit(day % 2, request));
+  }
+  engine.Start();
+  engine.Stop();
+
+  // Every forward was applied before the shards exited, so the query sees
+  // them even if it runs first after the restart. The answers that did not
+  // fit are sent once the shards run again.
+  UserRequest query;
+  query.request_id = 1000;
+  query.user_id = partner;
+  query.kind = UserRequest::Kind::kQueryStats;
+  query.day = kDays - 1;
+  ASSERT_TRUE(engine.Submit(0, query));
+  engine.Start();
+
+  auto responses = Collect(engine, 2 * kDays + 1);
+  ASSERT_EQ(responses.size(), 2 * kDays + 1);
+  for (const auto &response : responses) {
+    if (response.request_id != query.request_id) continue;
+    EXPECT_EQ(response.stats.total_completions, kDays);
+    EXPECT_EQ(response.stats.current_streak, kDays);
+  }
+}
+
+TEST(ShardedEngineTest, PartnerCheckInsStayInOrder) {
+  ShardedEngine engine(TestOptions());
+  UserId partner = 2;
+  while (engine.ShardOf(partner) == engine.ShardOf(1)) partner++;
+  engine.Start();
+
+  // Every day is completed and uncompleted again, even days end completed.
+  // The forwards overflow the queue of the partner and are deferred.
+  constexpr Day kDays = 200;
+  size_t submitted = 0;
+  std::thread producer([&engine, &submitted, partner]() {
+    for (Day day = 0; day < kDays; day++) {
+      for (int step = 0; step < (day % 2 == 0 ? 3 : 2); step++) {
+        UserRequest request;
+        request.request_id = ++submitted;
+        request.user_id = 1;
+        request.partner_id = partner;
+        request.day = day;
+        request.completed = step != 1;
+        while (!engine.Submit(0, request)) std::this_thread::yield();
+      }
+    }
+  });
+  constexpr size_t kRequests = kDays / 2 * 5;
+  auto responses = Collect(engine, 2 * kRequests);
+  producer.join();
+  ASSERT_EQ(responses.size(), 2 * kRequests);
+
+  for (UserId user : {UserId(1), partner}) {
+    UserRequest query;
+    query.user_id = user;
+    query.kind = UserRequest::Kind::kQueryStats;
+    query.day = kDays - 1;
+    ASSERT_TRUE(engine.Submit(0, query));
+    responses = Collect(engine, 1);
+    ASSERT_EQ(responses.size(), 1);
+    EXPECT_EQ(responses[0].stats.total_completions, kDays / 2);
+    EXPECT_EQ(responses[0].stats.longest_streak, 1);
+  }
+}
+
+TEST(ShardedEngineTest, StallsWhileAnswersAreNotCollected) {
+  ShardedEngine engine(TestOptions());
+  engine.Start();
+
+  // Without PollResponse() the shard stops once its outbound queue is full
+  // and one answer waits, then the inbound queue fills up.
+  size_t accepted = 0;
+  auto last_accepted = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - last_accepted <
+         std::chrono::milliseconds(100)) {
+    UserRequest request;
+    request.request_id = accepted + 1;
+    request.user_id = 1;
+    request.day = (Day)accepted;
+    if (engine.Submit(0, request)) {
+      accepted++;
+      last_accepted = std::chrono::steady_clock::now();
+    }
+    ASSERT_LE(accepted, 64);
+  }
+  EXPECT_EQ(accepted, 16 + 1 + 16);
+
+  // Collecting the answers lets it continue
+  auto responses = Collect(engine, accepted);
+  EXPECT_EQ(responses.size(), accepted);
+  UserRequest request;
+  request.user_id = 1;
+  request.day = -1;
+  ASSERT_TRUE(engine.Submit(0, request));
+  EXPECT_EQ(Collect(engine, 1).size(), 1);
+}
+
+TEST(EngineBusBridgeTest, RoundTrip) {
+  auto event_bus = EventBus::Create();
+  auto engine = std::make_shared<ShardedEngine>(TestOptions());
+  auto publisher = event_bus->RegisterPublisher<UserRequest>(
+      channels::kUserRequest);
+  auto responses = event_bus->SubscribeTo(channels::kUserResponse);
+  EngineBusBridge bridge(event_bus, engine, 0);
+  engine->Start();
+
+  for (uint64_t id = 1; id <= 50; id++) {
+    auto request = std::make_shared<UserRequest>();
+    request->request_id = id;
+    request->user_id = id;
+    publisher->Publish(std::make_unique<const Event<UserRequest>>(
+        EventType::USER_REQUEST, channels::kUserRequest, request));
+  }
+
+  size_t received = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (received < 50 && std::chrono::steady_clock::now() < deadline) {
+    bridge.Poll();
+    while (auto event = responses->ReadNext<UserResponse>()) {
+      const UserResponse *response = event->GetData<UserResponse>();
+      EXPECT_EQ(response->request_id, response->user_id);
+      received++;
+    }
+  }
+  EXPECT_EQ(received, 50);
+
+  // Neither channel keeps the requests or answers that were read
+  EXPECT_EQ(event_bus->SubscribeTo(channels::kUserRequest)->get_read_index(),
+            49);
+  EXPECT_EQ(event_bus->SubscribeTo(channels::kUserResponse)->get_read_index(),
+            49);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,259 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/event_bus/lock_stats.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+/// Payload of the stress tests. seq counts the events of one publishing
+/// thread on one channel, so every Listener that uses ReadNext() has to see
+/// consecutive values per thread.
+struct Message {
+  uint32_t thread = 0;
+  uint32_t channel = 0;
+  uint64_t seq = 0;
+};
+
+constexpr int kChannels = 8;
+constexpr int kPublisherThreads = 4;
+constexpr int kReaderThreads = 4;
+constexpr uint64_t kEventsPerPublisher = 4000;
+/// Channel 0 folds its events, so its events are dropped while being read.
+constexpr size_t kSnapshotInterval = 64;
+
+void PublishMessage(Publisher<Message> &publisher, Message message) {
+  ASSERT_TRUE(publisher.Publish(std::make_unique<const Event<Message>>(
+      EventType::TEST, (ChannelIdType)message.channel,
+      MakePayload<Message>(message))));
+}
+
+/// A Listener that only uses ReadNext() and checks the order of what it
+/// reads.
+struct OrderedReader {
+  std::shared_ptr<Listener> listener;
+  uint32_t channel = 0;
+  /// Next seq expected per publishing thread, 0 until the first event.
+  uint64_t next_seq[kPublisherThreads] = {};
+  uint64_t read = 0;
+
+  /// Returns false if an event was skipped or repeated.
+  bool Drain() {
+    while (auto event = listener->ReadNext<Message>()) {
+      const Message *message = event->GetData<Message>();
+      if (message->channel != channel) return false;
+      uint64_t &next = next_seq[message->thread];
+      if (next != 0 && message->seq != next) return false;
+      next = message->seq + 1;
+      read++;
+    }
+    return true;
+  }
+};
+
+TEST(EventBusStressTest, RandomSchedulesKeepEveryEventInOrder) {
+  // Publishers register on random channels while Listeners subscribe, so
+  // Channel::RegisterPublisher() refreshes Listeners that are reading.
+  auto event_bus = EventBus::Create();
+  std::atomic<int> publishers_done = 0;
+  std::atomic<bool> failed = false;
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kPublisherThreads; thread++) {
+    threads.emplace_back([&, thread]() {
+      std::mt19937 random(thread);
+      std::uniform_int_distribution<int> channel(0, kChannels - 1);
+      uint64_t seq[kChannels] = {};
+      for (uint64_t i = 0; i < kEventsPerPublisher; i++) {
+        int c = channel(random);
+        auto publisher = event_bus->RegisterPublisher<Message>(c);
+        if (c == 0) {
+          publisher->SetReducer<uint64_t>(
+              [](uint64_t &count, const Message &) { count++; },
+              kSnapshotInterval);
+        }
+        PublishMessage(*publisher, {(uint32_t)thread, (uint32_t)c, ++seq[c]});
+        if (random() % 64 == 0) std::this_thread::yield();
+      }
+      publishers_done++;
+    });
+  }
+
+  std::vector<std::vector<OrderedReader>> readers(kReaderThreads);
+  for (int thread = 0; thread < kReaderThreads; thread++) {
+    threads.emplace_back([&, thread]() {
+      std::mt19937 random(100 + thread);
+      std::uniform_int_distribution<int> channel(0, kChannels - 1);
+      std::vector<std::shared_ptr<Listener>> casual;
+      auto &ordered = readers[thread];
+
+      while (publishers_done < kPublisherThreads && !failed) {
+        switch (random() % 8) {
+          case 0: {
+            // Late subscribers of channel 0 start from its snapshot.
+            int c = channel(random);
+            OrderedReader reader{event_bus->SubscribeTo(c), (uint32_t)c};
+            if (c == 0) reader.listener->ReadSnapshot<uint64_t>();
+            if (ordered.size() < 16) ordered.push_back(std::move(reader));
+            break;
+          }
+          case 1:
+            if (casual.size() < 16)
+              casual.push_back(event_bus->SubscribeTo(channel(random)));
+            break;
+          case 2:
+          case 3:
+          case 4:
+            for (auto &reader : ordered) {
+              if (!reader.Drain()) failed = true;
+            }
+            break;
+          case 5:
+            for (auto &listener : casual) listener->ReadLatest<Message>();
+            break;
+          case 6:
+            for (auto &listener : casual) {
+              Message message;
+              if (listener->TryReadLatestValue(message) &&
+                  message.channel >= kChannels)
+                failed = true;
+            }
+            break;
+          case 7:
+            if (!casual.empty()) {
+              casual[random() % casual.size()]->WaitForEvent(
+                  std::chrono::milliseconds(1));
+            }
+            break;
+        }
+      }
+      // Casual Listeners stop reading, they must not keep events from
+      // being dropped forever. Draining them lets channel 0 trim again.
+      for (auto &listener : casual) listener->ReadLatest<Message>();
+    });
+  }
+
+  for (auto &thread : threads) thread.join();
+  ASSERT_FALSE(failed);
+
+  // Every ordered reader ends at the writer index of its channel.
+  for (auto &thread_readers : readers) {
+    for (auto &reader : thread_readers) {
+      size_t start = reader.listener->get_read_index() - reader.read;
+      ASSERT_TRUE(reader.Drain());
+      auto publisher = event_bus->RegisterPublisher<Message>(reader.channel);
+      EXPECT_EQ(start + reader.read, publisher->get_writer_index());
+    }
+  }
+
+  uint64_t total = 0;
+  for (int c = 0; c < kChannels; c++) {
+    total += event_bus->RegisterPublisher<Message>(c)->get_writer_index();
+  }
+  EXPECT_EQ(total, kPublisherThreads * kEventsPerPublisher);
+}
+
+TEST(EventBusStressTest, ListenersSubscribedDuringRegistrationSeeAll) {
+  // Many Listeners subscribe to channels whose Publisher is registered and
+  // publishes at the same time. None of them may miss the Publisher.
+  constexpr int kRounds = 50;
+  constexpr int kSubscribers = 4;
+  constexpr uint64_t kEvents = 20;
+  constexpr size_t kMaxListeners = 256;
+  auto event_bus = EventBus::Create();
+
+  for (int round = 0; round < kRounds; round++) {
+    std::vector<std::shared_ptr<Listener>> listeners[kSubscribers];
+    std::atomic<bool> started = false;
+    std::atomic<bool> published = false;
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < kSubscribers; thread++) {
+      threads.emplace_back([&, thread]() {
+        while (!started) std::this_thread::yield();
+        while (!published && listeners[thread].size() < kMaxListeners) {
+          listeners[thread].push_back(event_bus->SubscribeTo(round));
+          listeners[thread].back()->ReadNext<Message>();
+        }
+      });
+    }
+    threads.emplace_back([&]() {
+      while (!started) std::this_thread::yield();
+      auto publisher = event_bus->RegisterPublisher<Message>(round);
+      for (uint64_t seq = 1; seq <= kEvents; seq++) {
+        PublishMessage(*publisher, {0, (uint32_t)round, seq});
+      }
+      published = true;
+    });
+    started = true;
+    for (auto &thread : threads) thread.join();
+
+    for (auto &thread_listeners : listeners) {
+      for (auto &listener : thread_listeners) {
+        while (listener->ReadNext<Message>()) {
+        }
+        ASSERT_TRUE(listener->ValidatePublisher());
+        EXPECT_EQ(listener->get_read_index(), kEvents);
+      }
+    }
+  }
+}
+
+TEST(EventBusStressTest, LockStatsCountEveryLock) {
+  auto event_bus = EventBus::Create();
+  auto publisher = event_bus->RegisterPublisher<Message>(0);
+  auto listener = event_bus->SubscribeTo(0);
+  ResetLockStats();
+  PublishMessage(*publisher, {0, 0, 1});
+  listener->ReadNext<Message>();
+
+  std::vector<LockSiteStats> stats = GetLockStats();
+  ASSERT_EQ(stats.size(), (size_t)LockSite::kCount);
+  const LockSiteStats &publisher_stats = stats[(size_t)LockSite::kPublisher];
+  const LockSiteStats &listener_stats = stats[(size_t)LockSite::kListener];
+  if (kLockStatsEnabled) {
+    EXPECT_GE(publisher_stats.acquisitions, 2);
+    EXPECT_EQ(listener_stats.acquisitions, 1);
+    EXPECT_GE(publisher_stats.total_hold_ns, publisher_stats.max_hold_ns);
+  } else {
+    EXPECT_EQ(publisher_stats.acquisitions, 0);
+    EXPECT_EQ(listener_stats.acquisitions, 0);
+  }
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -89,6 +89,194 @@ TEST_F(EventBusTest, PublishAndReceive) {
   EXPECT_EQ(*latest_event_str_->GetData<std::string>(), test_string_);
 }
 
+TEST_F(EventBusTest, ReadNextInOrder) {
+  // ReadNext returns every event once, ReadLatest skips to the newest
+  int values[3] = {1, 2, 3};
+  for (int &value : values) {
+    ASSERT_TRUE(publisher_int_->Publish(
+        std::make_unique<const Event<int>>(EventType::TEST, 0, &value)));
+  }
+
+  EXPECT_EQ(*listener_int_->ReadNext<int>()->GetData<int>(), 1);
+  EXPECT_EQ(*listener_int_->ReadNext<int>()->GetData<int>(), 2);
+  EXPECT_EQ(listener_int_->get_read_index(), 2);
+  EXPECT_EQ(*listener_int_->ReadLatest<int>()->GetData<int>(), 3);
+  EXPECT_FALSE(listener_int_->HasReceivedEvent());
+  EXPECT_EQ(listener_int_->ReadNext<int>(), nullptr);
+}
+
+TEST_F(EventBusTest, PublishHook) {
+  // Hooks are only invoked for publishes on their own channel
+  int hook_calls = 0;
+  PublishHookId hook = event_bus_->AddPublishHook(0, [&]() {
+    hook_calls++;
+    // The event is already readable when the hook runs
+    EXPECT_TRUE(listener_int_->HasReceivedEvent());
+  });
+
+  ASSERT_TRUE(
+      publisher_int_->Publish(std::make_unique<const Event<int>>(event_int_)));
+  ASSERT_TRUE(publisher_str_->Publish(
+      std::make_unique<const Event<std::string>>(event_str_)));
+  EXPECT_EQ(hook_calls, 1);
+
+  // Removed hooks are not invoked anymore, the others still are
+  int other_calls = 0;
+  event_bus_->AddPublishHook(0, [&]() { other_calls++; });
+  EXPECT_FALSE(event_bus_->RemovePublishHook(1, hook));
+  EXPECT_TRUE(event_bus_->RemovePublishHook(0, hook));
+  EXPECT_FALSE(event_bus_->RemovePublishHook(0, hook));
+  ASSERT_TRUE(
+      publisher_int_->Publish(std::make_unique<const Event<int>>(event_int_)));
+  EXPECT_EQ(hook_calls, 1);
+  EXPECT_EQ(other_calls, 1);
+}
+
+TEST_F(EventBusTest, TryReadLatestValue) {
+  // The value is copied when it is published, later writes to the data of
+  // the event do not change it.
+  int value = 0;
+  EXPECT_FALSE(listener_int_->TryReadLatestValue(value));
+
+  int data = 1;
+  ASSERT_TRUE(publisher_int_->Publish(
+      std::make_unique<const Event<int>>(EventType::TEST, 0, &data)));
+  data = 2;
+  ASSERT_TRUE(publisher_int_->Publish(
+      std::make_unique<const Event<int>>(EventType::TEST, 0, &data)));
+  data = 3;
+
+  EXPECT_TRUE(listener_int_->HasReceivedEvent());
+  ASSERT_TRUE(listener_int_->TryReadLatestValue(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_EQ(listener_int_->get_read_index(), 2);
+  EXPECT_FALSE(listener_int_->HasReceivedEvent());
+}
+
+TEST_F(EventBusTest, TryReadLatestValueWithoutData) {
+  // An event without data has no value, but is still marked as read.
+  int value = 5, *no_data = nullptr;
+  ASSERT_TRUE(publisher_int_->Publish(
+      std::make_unique<const Event<int>>(EventType::TEST, 0, no_data)));
+  EXPECT_TRUE(listener_int_->HasReceivedEvent());
+  EXPECT_FALSE(listener_int_->TryReadLatestValue(value));
+  EXPECT_EQ(value, 5);
+  EXPECT_FALSE(listener_int_->HasReceivedEvent());
+
+  // The value of an older event is not reported for a newer empty one.
+  int data = 1;
+  ASSERT_TRUE(publisher_int_->Publish(
+      std::make_unique<const Event<int>>(EventType::TEST, 0, &data)));
+  ASSERT_TRUE(publisher_int_->Publish(
+      std::make_unique<const Event<int>>(EventType::TEST, 0, no_data)));
+  EXPECT_FALSE(listener_int_->TryReadLatestValue(value));
+  EXPECT_EQ(value, 5);
+  EXPECT_EQ(listener_int_->get_read_index(), 3);
+  EXPECT_FALSE(listener_int_->HasReceivedEvent());
+}
+
+TEST_F(EventBusTest, SnapshotOnSubscribe) {
+  // Sums of every 4 events become snapshots, late Listeners can start there
+  ASSERT_TRUE(publisher_int_->SetReducer<int>(
+      [](int& sum, const int& value) { sum += value; }, 4));
+  EXPECT_FALSE(publisher_int_->SetReducer<int>(
+      [](int& sum, const int& value) {}, 4));
+  int values[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  for (int& value : values) {
+    ASSERT_TRUE(publisher_int_->Publish(
+        std::make_unique<const Event<int>>(EventType::TEST, 0, &value)));
+  }
+
+  // Without ReadSnapshot() a late Listener starts at the oldest stored event
+  auto late_listener = event_bus_->SubscribeTo(0);
+  EXPECT_EQ(late_listener->get_read_index(), 0);
+  auto sum = late_listener->ReadSnapshot<int>();
+  ASSERT_NE(sum, nullptr);
+  EXPECT_EQ(*sum, 36);
+  EXPECT_EQ(*late_listener->ReadNext<int>()->GetData<int>(), 9);
+  EXPECT_EQ(*late_listener->ReadNext<int>()->GetData<int>(), 10);
+
+  // Nothing was dropped yet since listener_int_ did not read anything
+  EXPECT_EQ(*listener_int_->ReadNext<int>()->GetData<int>(), 1);
+  listener_int_->ReadLatest<int>();
+
+  // The next snapshot drops the events that everyone has read
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(publisher_int_->Publish(
+        std::make_unique<const Event<int>>(EventType::TEST, 0, &values[i])));
+  }
+  late_listener->set_read_index(9);
+  EXPECT_EQ(late_listener->ReadNext<int>(), nullptr);
+  late_listener->set_read_index(10);
+  EXPECT_EQ(*late_listener->ReadNext<int>()->GetData<int>(), 1);
+  EXPECT_EQ(*late_listener->ReadSnapshot<int>(), 58);
+  EXPECT_EQ(late_listener->get_read_index(), 12);
+}
+
+TEST_F(EventBusTest, DropsReadEventsWithoutReducer) {
+  int values[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  auto slow_listener = event_bus_->SubscribeTo(0);
+  for (int& value : values) {
+    ASSERT_TRUE(publisher_int_->Publish(
+        std::make_unique<const Event<int>>(EventType::TEST, 0, &value)));
+  }
+  EXPECT_EQ(event_bus_->GetUnreadEvents(0), 10);
+  for (int i = 0; i < 6; i++) listener_int_->ReadNext<int>();
+  while (slow_listener->ReadNext<int>()) {
+  }
+  EXPECT_EQ(event_bus_->GetUnreadEvents(0), 4);
+
+  // Nothing after the slowest Listener is dropped
+  listener_int_->set_read_index(6);
+  EXPECT_EQ(*listener_int_->ReadNext<int>()->GetData<int>(), 7);
+  listener_int_->set_read_index(5);
+  EXPECT_EQ(listener_int_->ReadNext<int>(), nullptr);
+
+  // Once every Listener caught up only the latest event is kept
+  listener_int_->set_read_index(7);
+  while (listener_int_->ReadNext<int>()) {
+  }
+  slow_listener->set_read_index(0);
+  EXPECT_EQ(slow_listener->ReadNext<int>(), nullptr);
+  EXPECT_EQ(*listener_int_->ReadLatest<int>()->GetData<int>(), 10);
+
+  // New Listeners start at the oldest stored event
+  auto late_listener = event_bus_->SubscribeTo(0);
+  EXPECT_EQ(late_listener->get_read_index(), 9);
+  EXPECT_EQ(*late_listener->ReadNext<int>()->GetData<int>(), 10);
+
+  // Or at the next one if they ask for it
+  auto next_listener = event_bus_->SubscribeTo(0, SubscribeFrom::kNextEvent);
+  EXPECT_EQ(next_listener->get_read_index(), 10);
+  EXPECT_EQ(next_listener->ReadNext<int>(), nullptr);
+}
+
+TEST_F(EventBusTest, TransientChannelsKeepOnlyTheLatestEvent) {
+  // Without a Listener a channel keeps every event unless it is transient
+  auto kept = event_bus_->RegisterPublisher<int>(2);
+  auto transient = event_bus_->RegisterPublisher<int>(3);
+  transient->SetTransient();
+  int values[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  for (int& value : values) {
+    ASSERT_TRUE(kept->Publish(
+        std::make_unique<const Event<int>>(EventType::TEST, 2, &value)));
+    ASSERT_TRUE(transient->Publish(
+        std::make_unique<const Event<int>>(EventType::TEST, 3, &value)));
+  }
+
+  EXPECT_EQ(event_bus_->GetUnreadEvents(2), 10);
+  EXPECT_EQ(event_bus_->GetUnreadEvents(3), 1);
+
+  auto kept_listener = event_bus_->SubscribeTo(2);
+  EXPECT_EQ(kept_listener->get_read_index(), 0);
+  EXPECT_EQ(*kept_listener->ReadNext<int>()->GetData<int>(), 1);
+
+  auto transient_listener = event_bus_->SubscribeTo(3);
+  EXPECT_EQ(transient_listener->get_read_index(), 9);
+  EXPECT_EQ(*transient_listener->ReadNext<int>()->GetData<int>(), 10);
+  EXPECT_EQ(transient_listener->ReadNext<int>(), nullptr);
+}
+
 TEST_F(EventBusTest, ThreadSafety) {
   // Test threadsafety of the event bus
   std::thread listener_thread([&]() {
@@ -0,0 +1,120 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "src/core/event_bus/static_event_bus.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+using TestBus = StaticEventBus<StaticChannel<0, int, 4>,
+                               StaticChannel<1, std::string>>;
+
+class StaticEventBusTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<TestBus> event_bus_ = std::make_unique<TestBus>();
+};
+
+TEST_F(StaticEventBusTest, ChannelsAreResolvedAtCompileTime) {
+  static_assert(TestBus::IndexOf<0>() == 0);
+  static_assert(TestBus::IndexOf<1>() == 1);
+  static_assert(std::is_same_v<TestBus::ChannelOf<1>::Type, std::string>);
+  static_assert(TestBus::GetChannelCount() == 2);
+
+  auto publisher = event_bus_->RegisterPublisher<1>();
+  auto listener = event_bus_->SubscribeTo<1>();
+  EXPECT_EQ(listener.get_channel_id(), 1);
+  EXPECT_FALSE(listener.HasReceivedEvent());
+
+  std::string value = "test";
+  EXPECT_TRUE(publisher.Publish(std::make_unique<const Event<std::string>>(
+      EventType::TEST, 1, &value)));
+  EXPECT_TRUE(publisher.Publish("next"));
+  EXPECT_EQ(publisher.get_writer_index(), 2);
+
+  std::string read;
+  ASSERT_TRUE(listener.ReadNext(read));
+  EXPECT_EQ(read, "test");
+  ASSERT_TRUE(listener.ReadLatest(read));
+  EXPECT_EQ(read, "next");
+  EXPECT_FALSE(listener.ReadNext(read));
+}
+
+TEST_F(StaticEventBusTest, ListenersThatFallBehindSkipOverwrittenEvents) {
+  auto publisher = event_bus_->RegisterPublisher<0>();
+  auto slow = event_bus_->SubscribeTo<0>();
+  auto fast = event_bus_->SubscribeTo<0>();
+  int hook_calls = 0;
+  PublishHookId hook = event_bus_->AddPublishHook<0>([&]() { hook_calls++; });
+
+  for (int i = 0; i < 6; i++) publisher.Publish(i);
+  EXPECT_EQ(hook_calls, 6);
+
+  int value;
+  ASSERT_TRUE(fast.TryReadLatestValue(value));
+  EXPECT_EQ(value, 5);
+  EXPECT_FALSE(fast.HasReceivedEvent());
+
+  // Capacity is 4, so 0 and 1 were overwritten.
+  ASSERT_TRUE(slow.ReadNext(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_EQ(slow.get_read_index(), 3);
+
+  // Removed hooks are not invoked anymore
+  EXPECT_FALSE(event_bus_->RemovePublishHook<1>(hook));
+  EXPECT_TRUE(event_bus_->RemovePublishHook<0>(hook));
+  EXPECT_FALSE(event_bus_->RemovePublishHook<0>(hook));
+  publisher.Publish(6);
+  EXPECT_EQ(hook_calls, 6);
+}
+
+TEST_F(StaticEventBusTest, ThreadSafety) {
+  auto publisher = event_bus_->RegisterPublisher<0>();
+  auto listener = event_bus_->SubscribeTo<0>();
+
+  std::thread publisher_thread([&]() {
+    for (int i = 1; i <= 1000; i++) publisher.Publish(i);
+  });
+
+  int last = 0, value;
+  while (last < 1000) {
+    if (!listener.WaitForEvent(std::chrono::milliseconds(100))) continue;
+    ASSERT_TRUE(listener.ReadNext(value));
+    // Events may be skipped but never arrive out of order.
+    ASSERT_GT(value, last);
+    last = value;
+  }
+  publisher_thread.join();
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
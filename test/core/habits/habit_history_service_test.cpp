@@ -0,0 +1,143 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_history_service.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+class HabitHistoryServiceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_bus_ = EventBus::Create();
+    history_ = std::make_shared<InMemoryHabitHistory>();
+    for (int i = 0; i < 10000; i++) history_->Append({i, i % 3, 1});
+
+    service_ = std::make_unique<HabitHistoryService>(event_bus_, history_);
+    requests_ = event_bus_->RegisterPublisher<HistoryPageRequest>(
+        channels::kHabitHistoryRequest);
+    pages_ = event_bus_->SubscribeTo(channels::kHabitHistoryPage);
+  }
+
+  void Request(uint64_t id, size_t first_row, size_t count) {
+    auto request = std::make_shared<HistoryPageRequest>(
+        HistoryPageRequest{id, first_row, count});
+    requests_->Publish(std::make_unique<const Event<HistoryPageRequest>>(
+        EventType::HABIT_HISTORY_REQUEST, channels::kHabitHistoryRequest,
+        request));
+  }
+
+  const HistoryPage *LatestPage() {
+    return pages_->ReadLatest<HistoryPage>()->GetData<HistoryPage>();
+  }
+
+ protected:
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<InMemoryHabitHistory> history_;
+  std::unique_ptr<HabitHistoryService> service_;
+  std::shared_ptr<Publisher<HistoryPageRequest>> requests_;
+  std::shared_ptr<Listener> pages_;
+};
+
+TEST_F(HabitHistoryServiceTest, AnswersLatestRequest) {
+  // The first request is superseded before the service gets to it
+  Request(1, 0, 100);
+  Request(2, 5000, 100);
+  EXPECT_TRUE(service_->Poll());
+
+  ASSERT_TRUE(pages_->HasReceivedEvent());
+  const HistoryPage *page = LatestPage();
+  EXPECT_EQ(page->request_id, 2);
+  EXPECT_EQ(page->first_row, 5000);
+  EXPECT_EQ(page->total_rows, 10000);
+  ASSERT_EQ(page->rows.size(), 100);
+  EXPECT_EQ(page->rows.front().day, 5000);
+
+  // Nothing left to do
+  EXPECT_FALSE(service_->Poll());
+}
+
+TEST_F(HabitHistoryServiceTest, ClampsPages) {
+  Request(1, 9990, 100);
+  service_->Poll();
+  EXPECT_EQ(LatestPage()->rows.size(), 10);
+
+  Request(2, 0, HabitHistoryService::kMaxPageRows * 2);
+  service_->Poll();
+  EXPECT_EQ(LatestPage()->rows.size(), HabitHistoryService::kMaxPageRows);
+}
+
+TEST_F(HabitHistoryServiceTest, AnnouncesNewRows) {
+  Request(1, 0, 1);
+  service_->Poll();
+  pages_->ReadLatest<HistoryPage>();
+
+  history_->Append({10000, 0, 1});
+  EXPECT_TRUE(service_->Poll());
+  auto page = LatestPage();
+  EXPECT_EQ(page->request_id, 0);
+  EXPECT_EQ(page->total_rows, 10001);
+}
+
+TEST_F(HabitHistoryServiceTest, DropsPagesOnceRead) {
+  // Scrolling through the history must not keep the pages that were shown
+  for (uint64_t id = 1; id <= 50; id++) {
+    Request(id, id * 100, HabitHistoryService::kMaxPageRows);
+    service_->Poll();
+    while (auto event = pages_->ReadNext<HistoryPage>()) {
+      EXPECT_EQ(event->GetData<HistoryPage>()->request_id, id);
+    }
+  }
+
+  pages_->set_read_index(0);
+  EXPECT_EQ(pages_->ReadNext<HistoryPage>(), nullptr);
+  EXPECT_EQ(LatestPage()->request_id, 50);
+}
+
+TEST_F(HabitHistoryServiceTest, ServesFromThread) {
+  service_->Start();
+  Request(7, 10, 10);
+  // The thread may announce the initial rows before it answers the request
+  const HistoryPage *page = nullptr;
+  while (page == nullptr || page->request_id == 0) {
+    pages_->WaitForEvent(std::chrono::milliseconds(10));
+    if (auto event = pages_->ReadNext<HistoryPage>()) {
+      page = event->GetData<HistoryPage>();
+    }
+  }
+  EXPECT_EQ(page->request_id, 7);
+  service_->Stop();
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
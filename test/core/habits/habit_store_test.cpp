@@ -0,0 +1,235 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/bitset_kernels.h"
+#include "src/core/habits/habit_store.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+TEST(BitsetKernelsTest, MatchBitByBitReference) {
+  std::mt19937_64 rng(42);
+  for (size_t word_count : {0, 1, 3, 4, 9, 33}) {
+    std::vector<uint64_t> words(word_count);
+    for (auto &word : words) {
+      // Mix dense, sparse and full words
+      word = rng() | rng();
+      if (rng() % 4 == 0) word = ~0ull;
+    }
+    auto bit = [&](size_t i) { return (words[i / 64] >> (i % 64)) & 1; };
+    size_t bits = word_count * 64;
+
+    size_t total = 0, longest = 0, run = 0;
+    for (size_t i = 0; i < bits; i++) {
+      total += bit(i);
+      run = bit(i) ? run + 1 : 0;
+      longest = std::max(longest, run);
+    }
+    EXPECT_EQ(kernels::CountBits(words.data(), word_count), total);
+    EXPECT_EQ(kernels::LongestRun(words.data(), word_count), longest);
+
+    for (int i = 0; i < 50 && bits > 0; i++) {
+      size_t first = rng() % bits, last = rng() % (bits + 1);
+      size_t expected = 0;
+      for (size_t b = first; b < last; b++) expected += bit(b);
+      EXPECT_EQ(
+          kernels::CountBitsInRange(words.data(), word_count, first, last),
+          expected);
+
+      // Also ends past the stored words, where every bit is zero.
+      size_t end = rng() % (bits + 129), expected_run = 0;
+      while (expected_run < end && end - 1 - expected_run < bits &&
+             bit(end - 1 - expected_run)) {
+        expected_run++;
+      }
+      EXPECT_EQ(kernels::RunEndingAt(words.data(), word_count, end),
+                expected_run);
+
+      size_t begin = rng() % (bits + 1);
+      expected_run = 0;
+      while (begin + expected_run < bits && bit(begin + expected_run)) {
+        expected_run++;
+      }
+      EXPECT_EQ(kernels::RunStartingAt(words.data(), word_count, begin),
+                expected_run);
+    }
+  }
+}
+
+TEST(HabitTypesTest, TodayIsTheLocalDate) {
+  // 26 hours apart, so the dates differ everywhere and at any time
+  setenv("TZ", "UTC-14", 1);
+  tzset();
+  Day east = Today();
+  setenv("TZ", "UTC+12", 1);
+  tzset();
+  Day west = Today();
+  unsetenv("TZ");
+  tzset();
+
+  EXPECT_GE(east - west, 1);
+  EXPECT_LE(east - west, 2);
+}
+
+TEST(HabitTableTest, Streaks) {
+  HabitTable table;
+  const Day today = 20000;
+  // Completed [today - 99, today - 10] and [today - 4, today - 1]
+  for (Day day = today - 99; day <= today - 10; day++) table.Set(1, day, true);
+  for (Day day = today - 4; day < today; day++) table.Set(1, day, true);
+
+  EXPECT_EQ(table.CountCompletions(1), 94);
+  EXPECT_EQ(table.LongestStreak(1), 90);
+  // Today is still open, so yesterday's streak counts
+  EXPECT_EQ(table.CurrentStreak(1, today), 4);
+  table.Set(1, today, true);
+  EXPECT_EQ(table.CurrentStreak(1, today), 5);
+  EXPECT_EQ(table.CurrentStreak(1, today + 2), 0);
+
+  // Unsetting changes the state once
+  EXPECT_TRUE(table.Set(1, today, false));
+  EXPECT_FALSE(table.Set(1, today, false));
+  EXPECT_EQ(table.CountCompletions(1), 94);
+  EXPECT_EQ(table.CountCompletions(2), 0);
+}
+
+TEST(HabitTableTest, StreakEndsBeforeUnstoredDays) {
+  HabitTable table;
+  for (Day day = 0; day < 512; day++) table.Set(1, day, true);
+  EXPECT_EQ(table.CurrentStreak(1, 512), 512);
+  // The days after the stored ones were never completed
+  EXPECT_EQ(table.CurrentStreak(1, 513), 0);
+  EXPECT_EQ(table.CurrentStreak(1, 512 + 64), 0);
+  EXPECT_EQ(table.CurrentStreak(1, 600), 0);
+}
+
+TEST(HabitTableTest, RebaseKeepsDays) {
+  HabitTable table;
+  table.Set(1, 1000, true);
+  table.Set(2, 10, true);
+  EXPECT_LE(table.get_base_day(), 10);
+  EXPECT_TRUE(table.IsCompleted(1, 1000));
+  EXPECT_TRUE(table.IsCompleted(2, 10));
+  EXPECT_FALSE(table.IsCompleted(1, 10));
+  EXPECT_EQ(table.CountCompletions(1, 0, 2000), 1);
+}
+
+TEST(HabitTableTest, Rates) {
+  HabitTable table;
+  Day monday = DaysFromCivil(2024, 1, 1);
+  // Every other day in January 2024
+  for (Day day = monday; day < monday + 31; day += 2) table.Set(1, day, true);
+
+  std::vector<float> weekly;
+  table.WeeklyRates(1, monday, 2, weekly);
+  ASSERT_EQ(weekly.size(), 2);
+  EXPECT_FLOAT_EQ(weekly[0], 4.0f / 7.0f);
+  EXPECT_FLOAT_EQ(weekly[1], 3.0f / 7.0f);
+
+  std::vector<float> monthly;
+  table.MonthlyRates(1, 2024, 1, 2, monthly);
+  ASSERT_EQ(monthly.size(), 2);
+  EXPECT_FLOAT_EQ(monthly[0], 16.0f / 31.0f);
+  EXPECT_FLOAT_EQ(monthly[1], 0.0f);
+}
+
+TEST(HabitStoreTest, PublishesChangesAndAggregates) {
+  auto event_bus = EventBus::Create();
+  auto checkins = event_bus->SubscribeTo(channels::kHabitCheckIn);
+  auto aggregates = event_bus->SubscribeTo(channels::kHabitAggregates);
+  HabitStore store(event_bus);
+
+  EXPECT_TRUE(store.SetCompleted(1, 100, true));
+  EXPECT_FALSE(store.SetCompleted(1, 100, true));
+  EXPECT_TRUE(store.SetCompleted(2, 100, true));
+  EXPECT_TRUE(store.SetCompleted(2, 101, true));
+
+  // Only the actual changes are announced
+  size_t count = 0;
+  while (auto event = checkins->ReadNext<CheckIn>()) count++;
+  EXPECT_EQ(count, 3);
+
+  store.PublishAggregates();
+  ASSERT_TRUE(aggregates->HasReceivedEvent());
+  auto event = aggregates->ReadLatest<HabitAggregates>();
+  const HabitAggregates *data = event->GetData<HabitAggregates>();
+  EXPECT_EQ(data->habit_count, 2);
+  EXPECT_EQ(data->checkin_count, 3);
+  EXPECT_EQ(data->completions[100 - data->first_day], 2);
+  EXPECT_EQ(data->completions[101 - data->first_day], 1);
+  EXPECT_EQ(data->first_day + (Day)data->completions.size(), 102);
+
+  EXPECT_EQ(store.Read([](const HabitTable &table) {
+              return table.CurrentStreak(2, 101);
+            }),
+            2);
+}
+
+TEST(HabitStoreTest, LateListenerStartsFromSnapshot) {
+  auto event_bus = EventBus::Create();
+  HabitStore store(event_bus);
+  // Enough check-ins for one snapshot, with the earliest day last
+  for (Day day = 1199; day >= 100; day--) {
+    ASSERT_TRUE(store.SetCompleted(day % 3, day, true));
+  }
+  ASSERT_TRUE(store.SetCompleted(1, 50, true));
+  ASSERT_TRUE(store.SetCompleted(1, 50, false));
+
+  auto checkins = event_bus->SubscribeTo(channels::kHabitCheckIn);
+  auto snapshot = checkins->ReadSnapshot<CheckInSnapshot>();
+  ASSERT_NE(snapshot, nullptr);
+  const HabitAggregates &aggregates = snapshot->aggregates;
+  EXPECT_EQ(aggregates.checkin_count, 1024);
+  EXPECT_EQ(aggregates.habit_count, 3);
+  EXPECT_EQ(snapshot->habit_ids, (std::vector<HabitId>{0, 1, 2}));
+  EXPECT_EQ(aggregates.first_day, 1199 - 1023);
+  EXPECT_EQ(aggregates.completions.size(), 1024);
+  EXPECT_EQ(aggregates.completions.front(), 1);
+
+  // Replaying the newer check-ins on top gives the current state
+  CheckInSnapshot current = *snapshot;
+  while (auto event = checkins->ReadNext<CheckIn>()) {
+    FoldCheckIn(current, *event->GetData<CheckIn>());
+  }
+  EXPECT_EQ(current.aggregates.checkin_count, 1102);
+  EXPECT_EQ(current.aggregates.first_day, 50);
+  EXPECT_EQ(current.aggregates.completions[0], 0);
+  EXPECT_EQ(current.aggregates.completions[100 - 50], 1);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,152 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/series_codec.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+std::vector<SeriesPoint> RandomSeries(size_t count, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<SeriesPoint> points;
+  int64_t timestamp = -1000, value = 0;
+  for (size_t i = 0; i < count; i++) {
+    // Mix every bucket size including huge jumps
+    switch (rng() % 5) {
+      case 0: timestamp += 86400; break;
+      case 1: timestamp += rng() % 100; break;
+      case 2: timestamp += rng() % 100000; break;
+      case 3: timestamp += (int64_t)(rng() >> 20); break;
+      default: break;
+    }
+    value = rng() % 3 == 0 ? (int64_t)rng() : value + (int64_t)(rng() % 5) - 2;
+    points.push_back({timestamp, value});
+  }
+  return points;
+}
+
+TEST(SeriesCodecTest, RoundTrip) {
+  auto points = RandomSeries(1000, 7);
+  SeriesEncoder encoder;
+  for (const auto &p : points) {
+    ASSERT_TRUE(encoder.Append(p.timestamp, p.value));
+  }
+  EXPECT_FALSE(encoder.Append(points.back().timestamp - 1, 0));
+  EncodedSeries series = encoder.Finish();
+  EXPECT_EQ(series.get_point_count(), points.size());
+  EXPECT_EQ(series.get_blocks().size(), 8);
+
+  std::vector<SeriesPoint> decoded;
+  series.DecodeRange(INT64_MIN, INT64_MAX, decoded);
+  ASSERT_EQ(decoded.size(), points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    EXPECT_EQ(decoded[i].timestamp, points[i].timestamp);
+    EXPECT_EQ(decoded[i].value, points[i].value);
+  }
+}
+
+TEST(SeriesCodecTest, RangeScan) {
+  auto points = RandomSeries(5000, 11);
+  SeriesEncoder encoder;
+  for (const auto &p : points) encoder.Append(p.timestamp, p.value);
+  EncodedSeries series = encoder.Finish();
+
+  std::mt19937_64 rng(3);
+  int64_t first = points.front().timestamp, last = points.back().timestamp;
+  for (int i = 0; i < 20; i++) {
+    int64_t from = first + (int64_t)(rng() % (uint64_t)(last - first));
+    int64_t to = from + (int64_t)(rng() % (uint64_t)(last - first));
+    size_t expected = 0;
+    for (const auto &p : points) {
+      expected += p.timestamp >= from && p.timestamp < to;
+    }
+
+    std::vector<SeriesPoint> decoded;
+    series.DecodeRange(from, to, decoded);
+    EXPECT_EQ(decoded.size(), expected);
+    for (const auto &p : decoded) {
+      EXPECT_GE(p.timestamp, from);
+      EXPECT_LT(p.timestamp, to);
+    }
+  }
+}
+
+TEST(SeriesCodecTest, SerializeAndRejectCorruptData) {
+  SeriesEncoder encoder;
+  for (const auto &p : RandomSeries(300, 5)) {
+    encoder.Append(p.timestamp, p.value);
+  }
+  EncodedSeries series = encoder.Finish();
+
+  std::vector<uint8_t> wire;
+  series.Serialize(wire);
+  EncodedSeries copy;
+  ASSERT_TRUE(EncodedSeries::Deserialize(wire.data(), wire.size(), copy));
+  EXPECT_EQ(copy.get_point_count(), series.get_point_count());
+  ASSERT_EQ(copy.get_blocks().size(), series.get_blocks().size());
+  EXPECT_EQ(copy.get_blocks().back().last_timestamp,
+            series.get_blocks().back().last_timestamp);
+
+  EXPECT_FALSE(EncodedSeries::Deserialize(wire.data(), wire.size() / 2, copy));
+  wire[0] = 'X';
+  EXPECT_FALSE(EncodedSeries::Deserialize(wire.data(), wire.size(), copy));
+}
+
+TEST(SeriesCodecTest, DailyHistoryIsSmallAndDecodesIntoTable) {
+  // Three years of a daily habit with a missed day now and then
+  std::mt19937_64 rng(1);
+  SeriesEncoder encoder;
+  size_t count = 0;
+  for (Day day = 19000; day < 19000 + 3 * 365; day++) {
+    if (rng() % 10 == 0) continue;
+    encoder.Append(day, 1);
+    count++;
+  }
+  EncodedSeries series = encoder.Finish();
+
+  std::vector<uint8_t> wire;
+  series.Serialize(wire);
+  size_t raw = count * sizeof(SeriesPoint);
+  EXPECT_LT(wire.size() * 10, raw);
+
+  HabitTable table;
+  series.ForEachInRange(19000, 19000 + 365, [&](const SeriesPoint &p) {
+    table.Set(1, (Day)p.timestamp, p.value != 0);
+  });
+  EXPECT_EQ(table.CountCompletions(1),
+            table.CountCompletions(1, 19000, 19000 + 365));
+  EXPECT_GT(table.CountCompletions(1), 300);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,159 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/statistics_service.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+class StatisticsServiceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_bus_ = EventBus::Create();
+    store_ = std::make_unique<HabitStore>(event_bus_);
+    stats_ = event_bus_->SubscribeTo(channels::kHabitStats);
+    service_ = std::make_unique<StatisticsService>(
+        event_bus_, *store_, [this]() { return today_; });
+  }
+
+  // Polls the service and returns the latest stats per habit
+  std::map<HabitId, HabitStats> Poll() {
+    service_->Poll();
+    while (auto event = stats_->ReadNext<HabitStats>()) {
+      const HabitStats *stats = event->GetData<HabitStats>();
+      latest_[stats->habit_id] = *stats;
+    }
+    return latest_;
+  }
+
+  // 2024-01-31, a Wednesday
+  Day today_ = DaysFromCivil(2024, 1, 31);
+  std::shared_ptr<EventBus> event_bus_;
+  std::unique_ptr<HabitStore> store_;
+  std::shared_ptr<Listener> stats_;
+  std::unique_ptr<StatisticsService> service_;
+  std::map<HabitId, HabitStats> latest_;
+};
+
+TEST_F(StatisticsServiceTest, TracksStreaksAndWindows) {
+  // Completed every day of the last 40 days except today
+  for (Day day = today_ - 40; day < today_; day++) {
+    store_->SetCompleted(1, day, true);
+  }
+  HabitStats stats = Poll()[1];
+  EXPECT_EQ(stats.total_completions, 40);
+  EXPECT_EQ(stats.current_streak, 40);
+  EXPECT_EQ(stats.longest_streak, 40);
+  EXPECT_EQ(stats.last_7_days, 6);
+  EXPECT_EQ(stats.last_30_days, 29);
+  EXPECT_EQ(stats.this_week, 2);
+  EXPECT_EQ(stats.this_month, 30);
+
+  store_->SetCompleted(1, today_, true);
+  stats = Poll()[1];
+  EXPECT_EQ(stats.current_streak, 41);
+  EXPECT_EQ(stats.this_week, 3);
+
+  // Nothing changed, nothing is published
+  EXPECT_FALSE(service_->Poll());
+}
+
+TEST_F(StatisticsServiceTest, LateCorrectionsSplitRuns) {
+  for (Day day = today_ - 19; day <= today_; day++) {
+    store_->SetCompleted(1, day, true);
+  }
+  Poll();
+
+  // A correction in the middle of the streak splits it into 9 and 10 days
+  store_->SetCompleted(1, today_ - 10, false);
+  HabitStats stats = Poll()[1];
+  EXPECT_EQ(stats.total_completions, 19);
+  EXPECT_EQ(stats.current_streak, 10);
+  EXPECT_EQ(stats.longest_streak, 10);
+
+  // A late check-in long before the streak does not touch it
+  store_->SetCompleted(1, today_ - 400, true);
+  stats = Poll()[1];
+  EXPECT_EQ(stats.current_streak, 10);
+  EXPECT_EQ(stats.longest_streak, 10);
+
+  // Filling the gap merges the runs again
+  store_->SetCompleted(1, today_ - 10, true);
+  stats = Poll()[1];
+  EXPECT_EQ(stats.current_streak, 20);
+  EXPECT_EQ(stats.longest_streak, 20);
+}
+
+TEST_F(StatisticsServiceTest, WindowsMoveWithTheDay) {
+  store_->SetCompleted(1, today_, true);
+  store_->SetCompleted(2, today_ - 1, true);
+  auto stats = Poll();
+  EXPECT_EQ(stats[1].this_month, 1);
+  EXPECT_EQ(stats[2].current_streak, 1);
+
+  // February starts, the streak of habit 2 is broken after another day
+  today_ += 2;
+  stats = Poll();
+  EXPECT_EQ(stats[1].day, today_);
+  EXPECT_EQ(stats[1].this_month, 0);
+  EXPECT_EQ(stats[1].last_7_days, 1);
+  EXPECT_EQ(stats[1].current_streak, 0);
+  EXPECT_EQ(stats[2].current_streak, 0);
+  EXPECT_EQ(stats[2].longest_streak, 1);
+}
+
+TEST_F(StatisticsServiceTest, LateServiceStartsFromTheStore) {
+  // More check-ins than one snapshot, so the bus dropped the oldest ones
+  service_.reset();
+  for (Day day = today_ - 1499; day <= today_; day++) {
+    ASSERT_TRUE(store_->SetCompleted(1, day, true));
+  }
+  service_ = std::make_unique<StatisticsService>(
+      event_bus_, *store_, [this]() { return today_; });
+  HabitStats stats = Poll()[1];
+  EXPECT_EQ(stats.total_completions, 1500);
+  EXPECT_EQ(stats.longest_streak, 1500);
+  EXPECT_EQ(stats.current_streak, 1500);
+  EXPECT_EQ(stats.last_30_days, 30);
+
+  // Check-ins after the start are applied once on top
+  store_->SetCompleted(1, today_ - 2000, true);
+  stats = Poll()[1];
+  EXPECT_EQ(stats.total_completions, 1501);
+  EXPECT_EQ(stats.longest_streak, 1500);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
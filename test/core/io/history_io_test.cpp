@@ -0,0 +1,366 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_history_service.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/io/history_export.h"
+#include "src/core/io/history_import.h"
+#include "src/core/io/text_scan.h"
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+class HistoryIoTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_bus_ = EventBus::Create();
+    batches_ = event_bus_->SubscribeTo(channels::kHistoryImport);
+  }
+
+  /// Reads all published batches and returns their rows.
+  std::vector<HistoryRow> ReadRows(bool &saw_last) {
+    std::vector<HistoryRow> rows;
+    saw_last = false;
+    while (auto event = batches_->ReadNext<HistoryImportBatch>()) {
+      const HistoryImportBatch *batch = event->GetData<HistoryImportBatch>();
+      EXPECT_FALSE(saw_last);
+      rows.insert(rows.end(), batch->rows.begin(), batch->rows.end());
+      saw_last = batch->last;
+    }
+    return rows;
+  }
+
+  /// Enough rows for several windows of chunks and far more batches than
+  /// may stay unread.
+  static std::string MakeCsv(size_t row_count) {
+    std::string data;
+    for (size_t i = 0; i < row_count; i++) data += "2024-01-01,1,1\n";
+    return data;
+  }
+
+  /// Waits until more than kMaxUnreadBatches are unread on event_bus and the
+  /// count stopped growing, i.e. the importer waits for its Listeners.
+  /// Returns the count.
+  static size_t WaitUntilImportStalls(EventBus &event_bus) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    size_t unread = 0;
+    while (unread <= HistoryImporter::kMaxUnreadBatches &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      unread = event_bus.GetUnreadEvents(channels::kHistoryImport);
+    }
+    for (int stable = 0; stable < 10;) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      size_t now = event_bus.GetUnreadEvents(channels::kHistoryImport);
+      stable = now == unread ? stable + 1 : 0;
+      unread = now;
+    }
+    return unread;
+  }
+
+  Executor executor_{3};
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Listener> batches_;
+};
+
+TEST(TextScanTest, ParsesNumbersAndDates) {
+  uint32_t digits;
+  EXPECT_TRUE(scan::ParseDigits("12345678", digits));
+  EXPECT_EQ(digits, 12345678u);
+  EXPECT_TRUE(scan::ParseDigits("7", digits));
+  EXPECT_EQ(digits, 7u);
+  EXPECT_FALSE(scan::ParseDigits("12a4", digits));
+  EXPECT_FALSE(scan::ParseDigits("", digits));
+
+  int32_t value;
+  EXPECT_TRUE(scan::ParseInt32("-2147483648", value));
+  EXPECT_EQ(value, INT32_MIN);
+  EXPECT_TRUE(scan::ParseInt32("2147483647", value));
+  EXPECT_EQ(value, INT32_MAX);
+  EXPECT_FALSE(scan::ParseInt32("2147483648", value));
+
+  Day day;
+  ASSERT_TRUE(scan::ParseDate("2024-02-29", day));
+  EXPECT_EQ(day, DaysFromCivil(2024, 2, 29));
+  EXPECT_FALSE(scan::ParseDate("2023-02-29", day));
+  EXPECT_FALSE(scan::ParseDate("2023-13-01", day));
+  char formatted[10];
+  scan::FormatDate(DaysFromCivil(1999, 12, 31), formatted);
+  EXPECT_EQ(std::string(formatted, 10), "1999-12-31");
+}
+
+TEST_F(HistoryIoTest, ImportsCsvAndReportsInvalidRows) {
+  HistoryImporter importer(event_bus_, &executor_);
+  ImportReport report = importer.Import(
+      "day,habit_id,value\r\n"
+      "2024-01-01,1,1\r\n"
+      "2024-01-02,2,0\n"
+      "\n"
+      "2024-01-32,3,1\n"
+      "2024-01-03,x,1\n"
+      "2024-01-04,4\n"
+      "2024-01-05,5,-3",
+      HistoryFormat::kCsv);
+
+  EXPECT_TRUE(report.opened);
+  EXPECT_EQ(report.rows, 3);
+  EXPECT_EQ(report.invalid_rows, 3);
+  ASSERT_EQ(report.errors.size(), 3);
+  EXPECT_NE(report.errors[0].find("invalid day"), std::string::npos);
+  EXPECT_NE(report.errors[1].find("invalid habit_id"), std::string::npos);
+  EXPECT_NE(report.errors[2].find("expected 3 fields"), std::string::npos);
+
+  bool saw_last;
+  std::vector<HistoryRow> rows = ReadRows(saw_last);
+  EXPECT_TRUE(saw_last);
+  ASSERT_EQ(rows.size(), 3);
+  EXPECT_EQ(rows[0].day, DaysFromCivil(2024, 1, 1));
+  EXPECT_EQ(rows[1].habit_id, 2);
+  EXPECT_EQ(rows[2].value, -3);
+}
+
+TEST_F(HistoryIoTest, ImportsNdjson) {
+  HistoryRow row;
+  EXPECT_EQ(ParseNdjsonRow(R"({"value": 2, "note": "x", "habit_id": 7,)"
+                           R"( "day": "2024-03-01"})",
+                           row),
+            nullptr);
+  EXPECT_EQ(row.habit_id, 7);
+  EXPECT_EQ(row.value, 2);
+  EXPECT_EQ(row.day, DaysFromCivil(2024, 3, 1));
+  EXPECT_NE(ParseNdjsonRow(R"({"day":"2024-03-01","habit_id":7})", row),
+            nullptr);
+  EXPECT_NE(ParseNdjsonRow(R"({"day":"2024-03-01","habit_id":-1,"value":1})",
+                           row),
+            nullptr);
+
+  HistoryImporter importer(event_bus_, &executor_);
+  ImportReport report =
+      importer.Import("{\"day\":\"2024-03-01\",\"habit_id\":1,\"value\":1}\n"
+                      "not json\n"
+                      "{\"day\":\"2024-03-02\",\"habit_id\":1,\"value\":1}\n",
+                      HistoryFormat::kNdjson);
+  EXPECT_EQ(report.rows, 2);
+  EXPECT_EQ(report.invalid_rows, 1);
+}
+
+TEST_F(HistoryIoTest, ExportRoundTripsThroughFile) {
+  // Enough rows for several chunks and batches.
+  InMemoryHabitHistory history;
+  const size_t row_count = 100000;
+  for (size_t i = 0; i < row_count; i++) {
+    history.Append(HistoryRow{DaysFromCivil(2020, 1, 1) + (Day)(i % 1500),
+                              (HabitId)(i % 97), (int32_t)(i % 3) - 1});
+  }
+
+  for (HistoryFormat format : {HistoryFormat::kCsv, HistoryFormat::kNdjson}) {
+    std::string path = ::testing::TempDir() + "history_io_test.txt";
+    {
+      std::ofstream file(path, std::ios::binary);
+      EXPECT_EQ(ExportHistory(history, file, format), row_count);
+    }
+
+    HistoryImporter importer(event_bus_, &executor_);
+    ImportReport report = importer.ImportFile(path, format);
+    std::remove(path.c_str());
+    EXPECT_TRUE(report.opened);
+    EXPECT_EQ(report.rows, row_count);
+    EXPECT_EQ(report.invalid_rows, 0);
+    EXPECT_EQ(report.batches,
+              row_count / HistoryImporter::kBatchRows + 1);
+
+    bool saw_last;
+    std::vector<HistoryRow> rows = ReadRows(saw_last);
+    EXPECT_TRUE(saw_last);
+    std::pmr::vector<HistoryRow> expected;
+    history.ReadRows(0, row_count, expected);
+    ASSERT_EQ(rows.size(), row_count);
+    for (size_t i = 0; i < row_count; i++) {
+      ASSERT_EQ(rows[i].day, expected[i].day);
+      ASSERT_EQ(rows[i].habit_id, expected[i].habit_id);
+      ASSERT_EQ(rows[i].value, expected[i].value);
+    }
+  }
+
+  HistoryImporter importer(event_bus_);
+  EXPECT_FALSE(importer.ImportFile("/does/not/exist.csv",
+                                   HistoryFormat::kCsv)
+                   .opened);
+}
+
+TEST_F(HistoryIoTest, ServiceAppliesBatches) {
+  InMemoryHabitHistory history;
+  HabitStore store(event_bus_);
+  HistoryImportService service(event_bus_, history, store);
+
+  HistoryImporter importer(event_bus_, &executor_);
+  importer.Import(
+      "2024-01-01,1,1\n"
+      "2024-01-02,1,0\n"
+      "2024-01-03,2,5\n",
+      HistoryFormat::kCsv);
+
+  EXPECT_TRUE(service.Poll());
+  EXPECT_FALSE(service.Poll());
+  EXPECT_EQ(service.get_applied_rows(), 3);
+  EXPECT_EQ(history.GetRowCount(), 3);
+  store.Read([](const HabitTable &table) {
+    EXPECT_TRUE(table.IsCompleted(1, DaysFromCivil(2024, 1, 1)));
+    EXPECT_FALSE(table.IsCompleted(1, DaysFromCivil(2024, 1, 2)));
+    EXPECT_TRUE(table.IsCompleted(2, DaysFromCivil(2024, 1, 3)));
+    return 0;
+  });
+}
+
+TEST_F(HistoryIoTest, ImportWaitsForTheListeners) {
+  const size_t row_count = 600000;
+  std::string data = MakeCsv(row_count);
+
+  std::atomic<bool> done = false;
+  std::thread import([&]() {
+    HistoryImporter importer(event_bus_);
+    importer.Import(data, HistoryFormat::kCsv);
+    done = true;
+  });
+
+  size_t unread = WaitUntilImportStalls(*event_bus_);
+  EXPECT_FALSE(done);
+  EXPECT_GT(unread, HistoryImporter::kMaxUnreadBatches);
+  EXPECT_LT(unread, row_count / HistoryImporter::kBatchRows);
+
+  size_t rows = 0;
+  bool saw_last = false;
+  while (!saw_last) {
+    if (auto event = batches_->ReadNext<HistoryImportBatch>()) {
+      const HistoryImportBatch *batch = event->GetData<HistoryImportBatch>();
+      rows += batch->rows.size();
+      saw_last = batch->last;
+    } else {
+      batches_->WaitForEvent(std::chrono::milliseconds(10));
+    }
+  }
+  import.join();
+  EXPECT_TRUE(done);
+  EXPECT_EQ(rows, row_count);
+}
+
+TEST_F(HistoryIoTest, ImportOnTheOnlyWorkerFeedsTheService) {
+  // The service can only run while the importer waits for it.
+  // Without the fixture's Listener, which would hold every batch.
+  auto event_bus = EventBus::Create();
+  Executor executor(1);
+  InMemoryHabitHistory history;
+  HabitStore store(event_bus);
+  HistoryImportService service(event_bus, history, store);
+  service.Start(executor);
+
+  const size_t row_count = 600000;
+  std::string data = MakeCsv(row_count);
+  std::promise<size_t> imported;
+  executor.Submit([&]() {
+    HistoryImporter importer(event_bus, &executor);
+    imported.set_value(importer.Import(data, HistoryFormat::kCsv).rows);
+  });
+  EXPECT_EQ(imported.get_future().get(), row_count);
+
+  while (service.get_applied_rows() < row_count) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  service.Stop();
+  EXPECT_EQ(history.GetRowCount(), row_count);
+}
+
+TEST_F(HistoryIoTest, StoppedImportLetsTheExecutorShutDown) {
+  auto event_bus = EventBus::Create();
+  Executor executor(2);
+  InMemoryHabitHistory history;
+  HabitStore store(event_bus);
+  // Never started, so its Listener holds every batch.
+  auto service =
+      std::make_unique<HistoryImportService>(event_bus, history, store);
+
+  const size_t row_count = 600000;
+  std::string data = MakeCsv(row_count);
+  std::stop_source stop;
+  std::promise<ImportReport> imported;
+  std::future<ImportReport> report = imported.get_future();
+  executor.Submit([&]() {
+    HistoryImporter importer(event_bus, &executor, stop.get_token());
+    imported.set_value(importer.Import(data, HistoryFormat::kCsv));
+  });
+  WaitUntilImportStalls(*event_bus);
+
+  // What Application does on shutdown.
+  service.reset();
+  stop.request_stop();
+  executor.Shutdown();
+  ImportReport result = report.get();
+  EXPECT_TRUE(result.cancelled);
+  EXPECT_LT(result.rows, row_count);
+  ASSERT_FALSE(result.errors.empty());
+}
+
+TEST_F(HistoryIoTest, ImportWithoutListenerGivesUp) {
+  auto event_bus = EventBus::Create();
+  const size_t row_count = 600000;
+  HistoryImporter importer(event_bus);
+  auto begin = std::chrono::steady_clock::now();
+  ImportReport report = importer.Import(MakeCsv(row_count),
+                                        HistoryFormat::kCsv);
+
+  EXPECT_GE(std::chrono::steady_clock::now() - begin,
+            HistoryImporter::kListenerTimeout);
+  EXPECT_TRUE(report.cancelled);
+  EXPECT_LT(report.rows, row_count);
+  ASSERT_FALSE(report.errors.empty());
+  EXPECT_EQ(report.errors.back(), "no Listener reads the import");
+  // The import still ends with its last batch.
+  auto listener = event_bus->SubscribeTo(channels::kHistoryImport);
+  std::shared_ptr<const Event<HistoryImportBatch>> last;
+  while (auto event = listener->ReadNext<HistoryImportBatch>()) last = event;
+  ASSERT_NE(last, nullptr);
+  EXPECT_TRUE(last->GetData<HistoryImportBatch>()->last);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
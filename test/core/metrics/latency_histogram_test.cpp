@@ -0,0 +1,105 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "src/core/metrics/latency_histogram.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+constexpr uint64_t kMaxValue = 3600ull * 1000 * 1000 * 1000;  // 1h in ns
+
+TEST(LatencyHistogramTest, PercentilesMatchSortedReference) {
+  LatencyHistogram histogram(kMaxValue, 3);
+  std::mt19937_64 random(42);
+  std::lognormal_distribution<double> latency(11.0, 1.5);
+
+  std::vector<uint64_t> values(100000);
+  for (uint64_t &value : values) {
+    value = (uint64_t)latency(random);
+    histogram.Record(value);
+  }
+  std::sort(values.begin(), values.end());
+
+  EXPECT_EQ(histogram.get_total_count(), values.size());
+  EXPECT_EQ(histogram.get_min(), values.front());
+  EXPECT_EQ(histogram.get_max(), values.back());
+  for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+    size_t rank = (size_t)(percentile / 100.0 * values.size() + 0.5);
+    uint64_t expected = values[std::max<size_t>(rank, 1) - 1];
+    uint64_t actual = histogram.ValueAtPercentile(percentile);
+    // Three significant digits
+    EXPECT_NEAR((double)actual, (double)expected, expected * 1e-3 + 1)
+        << "p" << percentile;
+  }
+}
+
+TEST(LatencyHistogramTest, CorrectsCoordinatedOmission) {
+  // A probe every 10 units that stalled once for 1000 units. Without the
+  // correction the stall looks like a single outlier.
+  LatencyHistogram raw(kMaxValue), corrected(kMaxValue);
+  for (int i = 0; i < 99; i++) {
+    raw.Record(10);
+    corrected.RecordCorrected(10, 10);
+  }
+  raw.Record(1000);
+  corrected.RecordCorrected(1000, 10);
+
+  EXPECT_EQ(raw.get_total_count(), 100);
+  EXPECT_EQ(raw.ValueAtPercentile(99.0), 10);
+  // 1000, 990, ..., 20, 10 were missed
+  EXPECT_EQ(corrected.get_total_count(), 199);
+  EXPECT_EQ(corrected.ValueAtPercentile(50.0), 10);
+  EXPECT_EQ(corrected.ValueAtPercentile(75.0), 500);
+  EXPECT_EQ(corrected.get_max(), 1000);
+}
+
+TEST(LatencyHistogramTest, AddsAndClamps) {
+  LatencyHistogram a(1000000, 2), b(1000000, 2);
+  a.Record(5, 3);
+  b.Record(2000000);  // clamped
+  a.Add(b);
+
+  EXPECT_EQ(a.get_total_count(), 4);
+  EXPECT_EQ(a.get_min(), 5);
+  EXPECT_EQ(a.get_max(), 1000000);
+  EXPECT_EQ(a.ValueAtPercentile(50.0), 5);
+  EXPECT_NEAR(a.Mean(), (3 * 5 + 1000000) / 4.0, 1000000 * 0.01 / 4);
+  EXPECT_LE(a.EquivalentRange(1000000), 1000000 / 100);
+
+  a.Reset();
+  EXPECT_EQ(a.get_total_count(), 0);
+  EXPECT_EQ(a.ValueAtPercentile(99.0), 0);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,162 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/metrics/memory_tracking.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+TEST(MemoryTrackingTest, CountsLiveAndPeakBytes) {
+  TrackingMemoryResource resource("test");
+  {
+    std::pmr::vector<uint64_t> a(1000, 0, &resource);
+    std::pmr::vector<uint64_t> b(&resource);
+    b.reserve(500);
+
+    MemoryStats stats = resource.GetStats();
+    EXPECT_STREQ(stats.name, "test");
+    EXPECT_EQ(stats.live_bytes, 1500 * sizeof(uint64_t));
+    EXPECT_EQ(stats.live_allocations, 2);
+    EXPECT_EQ(stats.allocations, 2);
+  }
+
+  // Freed memory stays in the peak and the totals
+  MemoryStats stats = resource.GetStats();
+  EXPECT_EQ(stats.live_bytes, 0);
+  EXPECT_EQ(stats.live_allocations, 0);
+  EXPECT_EQ(stats.peak_bytes, 1500 * sizeof(uint64_t));
+  EXPECT_EQ(stats.allocated_bytes, 1500 * sizeof(uint64_t));
+}
+
+TEST(MemoryTrackingTest, SumsTheCountersOfAllThreads) {
+  constexpr size_t kThreads = 8, kBlocks = 1000, kBlockSize = 256;
+  TrackingMemoryResource resource("test");
+  std::vector<std::vector<void *>> blocks(kThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; t++) {
+    threads.emplace_back([&resource, &blocks, t]() {
+      for (size_t i = 0; i < kBlocks; i++) {
+        blocks[t].push_back(resource.allocate(kBlockSize));
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  threads.clear();
+
+  MemoryStats stats = resource.GetStats();
+  EXPECT_EQ(stats.live_bytes, kThreads * kBlocks * kBlockSize);
+  EXPECT_EQ(stats.live_allocations, kThreads * kBlocks);
+  EXPECT_EQ(stats.peak_bytes, kThreads * kBlocks * kBlockSize);
+
+  // Memory freed by another thread than the one that allocated it
+  for (size_t t = 0; t < kThreads; t++) {
+    threads.emplace_back([&resource, &blocks, t]() {
+      for (void *p : blocks[(t + 1) % kThreads]) {
+        resource.deallocate(p, kBlockSize);
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+
+  stats = resource.GetStats();
+  EXPECT_EQ(stats.live_bytes, 0);
+  EXPECT_EQ(stats.live_allocations, 0);
+  EXPECT_EQ(stats.allocations, kThreads * kBlocks);
+  EXPECT_EQ(stats.allocated_bytes, kThreads * kBlocks * kBlockSize);
+  EXPECT_GE(stats.peak_bytes, kThreads * kBlocks * kBlockSize);
+}
+
+TEST(MemoryTrackingTest, AccountsEventsToTheBus) {
+  constexpr size_t kEvents = 100;
+  auto event_bus = EventBus::Create();
+  auto publisher = event_bus->RegisterPublisher<int>(0);
+  auto listener = event_bus->SubscribeTo(0);
+
+  MemoryStats before = GetMemoryResource(MemoryTag::kEventBus)->GetStats();
+  for (size_t i = 0; i < kEvents; i++) {
+    ASSERT_TRUE(publisher->Publish(std::make_unique<const Event<int>>(
+        EventType::TEST, 0, MakePayload<int>((int)i))));
+  }
+  MemoryStats after = GetMemoryResource(MemoryTag::kEventBus)->GetStats();
+
+  // At least the event, its payload and its control block are retained
+  EXPECT_GE(after.live_allocations - before.live_allocations, 3 * kEvents);
+  EXPECT_GE(after.live_bytes - before.live_bytes,
+            kEvents * (sizeof(Event<int>) + sizeof(int)));
+  EXPECT_EQ(*listener->ReadLatest<int>()->GetData<int>(), (int)kEvents - 1);
+}
+
+TEST(MemoryTrackingTest, AccountsPayloadContainersToTheBus) {
+  constexpr size_t kRows = 10000;
+  TrackingMemoryResource *bus = GetMemoryResource(MemoryTag::kEventBus);
+  size_t before = bus->GetStats().live_bytes;
+
+  auto batch = MakePayload<HistoryImportBatch>();
+  batch->rows.resize(kRows);
+  EXPECT_GE(bus->GetStats().live_bytes - before, kRows * sizeof(HistoryRow));
+
+  // Copies into a payload end up on the bus as well
+  DueReminders due;
+  due.reminders.resize(kRows);
+  before = bus->GetStats().live_bytes;
+  auto copy = MakePayload<DueReminders>(due);
+  EXPECT_EQ(copy->reminders.size(), kRows);
+  EXPECT_GE(bus->GetStats().live_bytes - before, kRows * sizeof(Reminder));
+
+  before = bus->GetStats().live_bytes;
+  batch.reset();
+  EXPECT_GE(before - bus->GetStats().live_bytes, kRows * sizeof(HistoryRow));
+}
+
+TEST(MemoryTrackingTest, WritesJsonPerSubsystem) {
+  std::pmr::vector<int> column(64, 0,
+                               GetMemoryResource(MemoryTag::kStore));
+  std::vector<MemoryStats> stats = GetMemoryStats();
+  ASSERT_EQ(stats.size(), (size_t)MemoryTag::kCount);
+  EXPECT_GE(stats[(size_t)MemoryTag::kStore].live_bytes, 64 * sizeof(int));
+
+  std::ostringstream out;
+  WriteMemoryStatsJson(stats, out);
+  for (const char *name : {"eventbus", "frontend", "store"}) {
+    EXPECT_NE(out.str().find(std::string("\"") + name + "\""),
+              std::string::npos);
+  }
+  EXPECT_NE(out.str().find("\"peak_bytes\""), std::string::npos);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,178 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/query/habit_catalog.h"
+#include "src/core/query/query_service.h"
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+class QueryServiceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_bus_ = EventBus::Create();
+    store_ = std::make_unique<HabitStore>(event_bus_);
+    service_ = std::make_unique<QueryService>(event_bus_, *store_, catalog_,
+                                              &executor_);
+    queries_ = event_bus_->RegisterPublisher<HabitQuery>(channels::kHabitQuery);
+    results_ = event_bus_->SubscribeTo(channels::kHabitQueryResult);
+
+    // 1000 habits of 100 users, every habit is "daily", every other one is
+    // also "health"
+    for (HabitId id = 0; id < 1000; id++) {
+      HabitInfo info{id, (uint64_t)id / 10, {"daily"}};
+      if (id % 2 == 0) info.tags.push_back("health");
+      catalog_.AddHabit(info);
+    }
+  }
+
+  std::vector<HabitId> Select(const std::optional<uint64_t> &user_id,
+                              const std::vector<std::string> &tags,
+                              HabitCatalog::Access &access) {
+    return catalog_.SelectHabits(user_id, tags, &access);
+  }
+
+  Executor executor_{2};
+  std::shared_ptr<EventBus> event_bus_;
+  HabitCatalog catalog_;
+  std::unique_ptr<HabitStore> store_;
+  std::unique_ptr<QueryService> service_;
+  std::shared_ptr<Publisher<HabitQuery>> queries_;
+  std::shared_ptr<Listener> results_;
+};
+
+TEST_F(QueryServiceTest, CatalogChoosesAccessPath) {
+  HabitCatalog::Access access;
+
+  // A single user has few habits, probing the tag bitsets is cheaper
+  EXPECT_EQ(Select(99, {"health"}, access),
+            (std::vector<HabitId>{990, 992, 994, 996, 998}));
+  EXPECT_EQ(access, HabitCatalog::Access::kIndexScan);
+
+  // Two broad tags are intersected word by word
+  auto habits = Select(std::nullopt, {"daily", "health"}, access);
+  EXPECT_EQ(habits.size(), 500);
+  EXPECT_EQ(access, HabitCatalog::Access::kBitsetIntersection);
+  EXPECT_TRUE(std::is_sorted(habits.begin(), habits.end()));
+
+  EXPECT_EQ(Select(std::nullopt, {}, access).size(), 1000);
+  EXPECT_EQ(access, HabitCatalog::Access::kFullScan);
+
+  EXPECT_TRUE(Select(3, {"unknown"}, access).empty());
+  EXPECT_TRUE(Select(1000, {}, access).empty());
+  EXPECT_FALSE(catalog_.AddHabit({0, 0, {}}));
+}
+
+TEST_F(QueryServiceTest, StreamsRowsOfMatchingHabits) {
+  // Every habit completed on every third day over about two years
+  for (HabitId id = 0; id < 1000; id++) {
+    for (Day day = 19000 + id % 3; day < 19700; day += 3) {
+      store_->SetCompleted(id, day, true);
+    }
+  }
+
+  HabitQuery query;
+  query.query_id = 42;
+  query.tags = {"health"};
+  query.first_day = 19100;
+  query.last_day = 19400;
+  ASSERT_TRUE(queries_->Publish(std::make_unique<const Event<HabitQuery>>(
+      EventType::HABIT_QUERY, channels::kHabitQuery, &query)));
+  EXPECT_TRUE(service_->Poll());
+
+  std::vector<std::pair<HabitId, Day>> rows;
+  size_t total_rows = 0;
+  std::vector<uint32_t> sequences;
+  while (auto event = results_->ReadNext<HabitQueryResult>()) {
+    const HabitQueryResult *result = event->GetData<HabitQueryResult>();
+    EXPECT_EQ(result->query_id, 42);
+    EXPECT_LE(result->rows.size(), QueryService::kMaxChunkRows);
+    sequences.push_back(result->sequence);
+    for (const QueryRow &row : result->rows) {
+      rows.emplace_back(row.habit_id, row.day);
+    }
+    if (result->last) total_rows = result->total_rows;
+  }
+  EXPECT_GT(sequences.size(), 2);
+  std::sort(sequences.begin(), sequences.end());
+  for (size_t i = 0; i < sequences.size(); i++) EXPECT_EQ(sequences[i], i);
+
+  std::vector<std::pair<HabitId, Day>> expected;
+  for (HabitId id = 0; id < 1000; id += 2) {
+    for (Day day = query.first_day; day < query.last_day; day++) {
+      if ((day - 19000) % 3 == id % 3) expected.emplace_back(id, day);
+    }
+  }
+  std::sort(rows.begin(), rows.end());
+  EXPECT_EQ(rows, expected);
+  EXPECT_EQ(total_rows, expected.size());
+}
+
+TEST_F(QueryServiceTest, RepeatedQueriesAreCached) {
+  for (HabitId id = 0; id < 100; id++) store_->SetCompleted(id, 19000, true);
+  HabitQuery query;
+  query.user_id = 1;
+  query.first_day = 18990;
+  query.last_day = 19010;
+
+  auto run = [&]() {
+    EXPECT_EQ(service_->Execute(query), 10);
+    while (results_->ReadNext<HabitQueryResult>()) {
+    }
+    return service_->get_cache().GetStats();
+  };
+  ResultCacheStats stats = run();
+  EXPECT_EQ(stats.misses, 10);
+  EXPECT_EQ(stats.entries, 10);
+  stats = run();
+  EXPECT_EQ(stats.hits, 10);
+  EXPECT_EQ(stats.misses, 10);
+
+  // Only the habit that changed is read again
+  store_->SetCompleted(11, 19000, false);
+  EXPECT_EQ(service_->Execute(query), 9);
+  stats = service_->get_cache().GetStats();
+  EXPECT_EQ(stats.invalidations, 1);
+  EXPECT_EQ(stats.hits, 19);
+  EXPECT_EQ(stats.misses, 11);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,150 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/query/result_cache.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+using Rows = std::vector<QueryRow>;
+
+class ResultCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_bus_ = EventBus::Create();
+    checkins_ = event_bus_->RegisterPublisher<CheckIn>(channels::kHabitCheckIn);
+  }
+
+  void PublishCheckIn(HabitId id, Day day) {
+    checkins_->Publish(std::make_unique<const Event<CheckIn>>(
+        EventType::HABIT_CHECK_IN, channels::kHabitCheckIn,
+        MakePayload<CheckIn>(CheckIn{id, day, true})));
+  }
+
+  static std::shared_ptr<const Rows> MakeRows(HabitId id, Day day) {
+    return std::make_shared<const Rows>(Rows{{id, day}});
+  }
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Publisher<CheckIn>> checkins_;
+};
+
+TEST_F(ResultCacheTest, CheckInsOnlyInvalidateTheirRange) {
+  ResultCache cache(event_bus_);
+  uint64_t version = cache.Sync();
+  cache.Insert<Rows>({1, 0, 100, 200}, MakeRows(1, 100), 8, version);
+  cache.Insert<Rows>({1, 0, 200, 300}, MakeRows(1, 200), 8, version);
+  cache.Insert<Rows>({2, 0, 100, 200}, MakeRows(2, 100), 8, version);
+
+  auto rows = cache.Find<Rows>({1, 0, 100, 200});
+  ASSERT_NE(rows, nullptr);
+  EXPECT_EQ((*rows)[0].day, 100);
+  EXPECT_EQ(cache.Find<Rows>({1, 1, 100, 200}), nullptr);
+
+  PublishCheckIn(1, 150);
+  cache.Sync();
+  EXPECT_EQ(cache.Find<Rows>({1, 0, 100, 200}), nullptr);
+  EXPECT_NE(cache.Find<Rows>({1, 0, 200, 300}), nullptr);
+  EXPECT_NE(cache.Find<Rows>({2, 0, 100, 200}), nullptr);
+
+  ResultCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 3);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.invalidations, 1);
+  EXPECT_EQ(stats.entries, 2);
+
+  // Ranges are half-open, a check-in on the end of a range is outside of it
+  PublishCheckIn(1, 200);
+  cache.Sync();
+  EXPECT_EQ(cache.Find<Rows>({1, 0, 200, 300}), nullptr);
+  cache.Insert<Rows>({1, 0, 100, 200}, MakeRows(1, 100), 8, cache.Sync());
+  PublishCheckIn(1, 200);
+  cache.Sync();
+  EXPECT_NE(cache.Find<Rows>({1, 0, 100, 200}), nullptr);
+}
+
+TEST_F(ResultCacheTest, DropsResponsesComputedBeforeACheckIn) {
+  ResultCache cache(event_bus_);
+  uint64_t version = cache.Sync();
+  // The check-in is seen while the response is being computed
+  PublishCheckIn(1, 150);
+  cache.Sync();
+  cache.Insert<Rows>({1, 0, 200, 300}, MakeRows(1, 200), 8, version);
+  EXPECT_EQ(cache.Find<Rows>({1, 0, 200, 300}), nullptr);
+
+  // Other habits are not affected
+  cache.Insert<Rows>({2, 0, 100, 200}, MakeRows(2, 100), 8, version);
+  EXPECT_NE(cache.Find<Rows>({2, 0, 100, 200}), nullptr);
+
+  version = cache.Sync();
+  cache.Insert<Rows>({1, 0, 200, 300}, MakeRows(1, 200), 8, version);
+  EXPECT_NE(cache.Find<Rows>({1, 0, 200, 300}), nullptr);
+}
+
+TEST_F(ResultCacheTest, EvictsLeastRecentlyUsed) {
+  // Room for about four entries per shard
+  ResultCache cache(event_bus_, ResultCache::kShardCount * 1024);
+  uint64_t version = cache.Sync();
+  for (Day day = 0; day < 100; day++) {
+    cache.Insert<Rows>({7, 0, day, day + 1}, MakeRows(7, day), 128, version);
+    // The first entry stays in use
+    EXPECT_NE(cache.Find<Rows>({7, 0, 0, 1}), nullptr);
+  }
+
+  ResultCacheStats stats = cache.GetStats();
+  EXPECT_LE(stats.bytes, stats.capacity_bytes / ResultCache::kShardCount);
+  EXPECT_EQ(stats.entries + stats.evictions, 100);
+  EXPECT_NE(cache.Find<Rows>({7, 0, 99, 100}), nullptr);
+  EXPECT_EQ(cache.Find<Rows>({7, 0, 50, 51}), nullptr);
+
+  // Entries larger than a shard are not cached at all
+  cache.Insert<Rows>({8, 0, 0, 1}, MakeRows(8, 0), 4096, version);
+  EXPECT_EQ(cache.Find<Rows>({8, 0, 0, 1}), nullptr);
+}
+
+TEST_F(ResultCacheTest, PublishesStats) {
+  ResultCache cache(event_bus_);
+  auto listener = event_bus_->SubscribeTo(channels::kResultCacheStats);
+  cache.Find<Rows>({1, 0, 0, 0});
+  cache.PublishStats();
+
+  ResultCacheStats stats;
+  ASSERT_TRUE(listener->TryReadLatestValue(stats));
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.capacity_bytes, ResultCache::kDefaultCapacityBytes);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
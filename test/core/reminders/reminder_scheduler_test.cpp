@@ -0,0 +1,142 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_types.h"
+#include "src/core/reminders/reminder_scheduler.h"
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+using std::chrono::milliseconds;
+using Clock = ReminderScheduler::Clock;
+
+class ReminderSchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_bus_ = EventBus::Create();
+    due_ = event_bus_->SubscribeTo(channels::kRemindersDue);
+  }
+
+  // Ids of all reminders published since the last call
+  std::vector<uint64_t> ReadDue() {
+    std::vector<uint64_t> ids;
+    while (auto event = due_->ReadNext<DueReminders>()) {
+      batches_++;
+      for (const Reminder &reminder :
+           event->GetData<DueReminders>()->reminders) {
+        ids.push_back(reminder.reminder_id);
+      }
+    }
+    return ids;
+  }
+
+  Reminder MakeReminder(uint64_t id, Clock::time_point due_at) {
+    Reminder reminder;
+    reminder.reminder_id = id;
+    reminder.habit_id = 1;
+    reminder.due_at = due_at;
+    return reminder;
+  }
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::shared_ptr<Listener> due_;
+  int batches_ = 0;
+};
+
+TEST_F(ReminderSchedulerTest, PublishesDueRemindersInBatches) {
+  ReminderScheduler::Options options;
+  options.max_batch = 2;
+  ReminderScheduler scheduler(event_bus_, options);
+
+  Clock::time_point start = Clock::now();
+  for (uint64_t id = 0; id < 5; id++) {
+    scheduler.Schedule(MakeReminder(id, start + std::chrono::hours(1)));
+  }
+  TimerHandle cancelled =
+      scheduler.Schedule(MakeReminder(5, start + std::chrono::hours(1)));
+  scheduler.Schedule(MakeReminder(6, start + std::chrono::hours(2)));
+  EXPECT_TRUE(scheduler.Cancel(cancelled));
+  EXPECT_EQ(scheduler.get_pending_count(), 6);
+
+  // Nothing fires early
+  EXPECT_EQ(scheduler.Poll(start + std::chrono::minutes(59)), 0);
+  EXPECT_FALSE(due_->HasReceivedEvent());
+
+  EXPECT_EQ(scheduler.Poll(start + std::chrono::minutes(61)), 5);
+  std::vector<uint64_t> ids = ReadDue();
+  EXPECT_EQ(batches_, 3);
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, (std::vector<uint64_t>{0, 1, 2, 3, 4}));
+  EXPECT_EQ(scheduler.get_pending_count(), 1);
+}
+
+TEST_F(ReminderSchedulerTest, ThreadWakesUpForEarlierReminders) {
+  ReminderScheduler scheduler(event_bus_);
+  scheduler.Start();
+
+  // The thread is sleeping until the later reminder when the earlier one is
+  // scheduled
+  scheduler.Schedule(MakeReminder(1, Clock::now() + std::chrono::hours(1)));
+  std::this_thread::sleep_for(milliseconds(20));
+  Clock::time_point due_at = Clock::now() + milliseconds(30);
+  scheduler.Schedule(MakeReminder(2, due_at));
+
+  ASSERT_TRUE(due_->WaitForEvent(milliseconds(5000)));
+  EXPECT_GE(Clock::now(), due_at);
+  EXPECT_EQ(ReadDue(), std::vector<uint64_t>{2});
+  EXPECT_EQ(scheduler.get_pending_count(), 1);
+  scheduler.Stop();
+}
+
+TEST_F(ReminderSchedulerTest, RunsOnExecutor) {
+  Executor executor(2);
+  ReminderScheduler scheduler(event_bus_);
+  scheduler.Start(executor);
+
+  scheduler.Schedule(MakeReminder(1, Clock::now() + std::chrono::hours(1)));
+  Clock::time_point due_at = Clock::now() + milliseconds(30);
+  scheduler.Schedule(MakeReminder(2, due_at));
+
+  ASSERT_TRUE(due_->WaitForEvent(milliseconds(5000)));
+  EXPECT_GE(Clock::now(), due_at);
+  EXPECT_EQ(ReadDue(), std::vector<uint64_t>{2});
+  scheduler.Stop();
+  EXPECT_EQ(scheduler.get_pending_count(), 1);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "src/core/runtime/executor.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+using std::chrono::milliseconds;
+
+TEST(ExecutorTest, RunsHigherPrioritiesFirst) {
+  Executor executor(1);
+  std::atomic<bool> started = false, release = false;
+  executor.Submit([&]() {
+    started = true;
+    while (!release) std::this_thread::yield();
+  });
+  while (!started) std::this_thread::yield();
+
+  // Only touched by the single worker
+  std::vector<int> order;
+  executor.Submit([&]() { order.push_back(2); }, Executor::Priority::kLow);
+  executor.Submit([&]() { order.push_back(1); });
+  executor.Submit([&]() { order.push_back(0); }, Executor::Priority::kHigh);
+  release = true;
+  executor.Shutdown();
+
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+  EXPECT_FALSE(executor.Submit([]() {}));
+}
+
+TEST(ExecutorTest, ShutdownRunsNestedTasks) {
+  constexpr int kTasks = 1000;
+  Executor executor(4);
+  std::atomic<int> done = 0;
+  executor.Submit([&]() {
+    EXPECT_TRUE(executor.IsWorkerThread());
+    for (int i = 0; i < kTasks; i++) {
+      executor.Submit([&]() { done++; });
+    }
+  });
+  EXPECT_FALSE(executor.IsWorkerThread());
+  executor.Shutdown();
+
+  EXPECT_EQ(done, kTasks);
+  EXPECT_EQ(executor.get_executed_count(), kTasks + 1);
+}
+
+TEST(ExecutorTest, TimersFireAfterTheirDelay) {
+  Executor executor(2);
+  std::promise<void> fired;
+  std::atomic<bool> cancelled_ran = false;
+
+  auto start = Executor::Clock::now();
+  TimerHandle cancelled = executor.SubmitAfter(
+      milliseconds(10), [&]() { cancelled_ran = true; });
+  executor.SubmitAfter(milliseconds(30), [&]() { fired.set_value(); });
+  EXPECT_TRUE(executor.CancelTimer(cancelled));
+
+  auto future = fired.get_future();
+  ASSERT_EQ(future.wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  EXPECT_GE(Executor::Clock::now() - start, milliseconds(30));
+  EXPECT_FALSE(cancelled_ran);
+}
+
+TEST(ExecutorTest, ParallelForRunsEveryIndexOnce) {
+  Executor executor(4);
+  std::vector<std::atomic<int>> runs(1000);
+  executor.ParallelFor(runs.size(), [&](size_t i) { runs[i]++; });
+  for (auto &run : runs) EXPECT_EQ(run.load(), 1);
+
+  // A Batch is reusable once it completed
+  Executor::Batch batch;
+  std::atomic<int> sum = 0;
+  for (int round = 0; round < 100; round++) {
+    executor.Dispatch(batch, 8, [&](size_t i) { sum += (int)i; });
+    executor.Wait(batch);
+    EXPECT_TRUE(batch.IsDone());
+  }
+  EXPECT_EQ(sum.load(), 100 * 28);
+}
+
+TEST(ExecutorTest, NestedParallelForHelps) {
+  // Every worker waits for an inner batch, which only completes because the
+  // waiting workers run indices themselves.
+  Executor executor(2);
+  std::atomic<int> runs = 0;
+  executor.ParallelFor(16, [&](size_t) {
+    executor.ParallelFor(100, [&](size_t) { runs++; });
+  });
+  EXPECT_EQ(runs.load(), 1600);
+}
+
+TEST(ExecutorTest, WaitingTaskRunsPendingTasks) {
+  // The only worker waits for a task that is queued behind it.
+  Executor executor(1);
+  EXPECT_FALSE(executor.RunPendingTask());
+  std::atomic<bool> ran = false;
+  std::promise<void> done;
+  executor.Submit([&]() {
+    executor.Submit([&]() { ran = true; });
+    while (!ran) EXPECT_TRUE(executor.RunPendingTask());
+    EXPECT_FALSE(executor.RunPendingTask());
+    done.set_value();
+  });
+  done.get_future().wait();
+}
+
+TEST(ExecutorTest, BatchCompletesWithoutWorkers) {
+  Executor executor(2);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  for (int i = 0; i < 2; i++) {
+    executor.Submit([released]() { released.wait(); });
+  }
+
+  // Every worker is busy, so Wait() runs all indices
+  int runs = 0;
+  executor.ParallelFor(10, [&](size_t) { runs++; });
+  EXPECT_EQ(runs, 10);
+  release.set_value();
+
+  executor.Shutdown();
+  executor.ParallelFor(10, [&](size_t) { runs++; });
+  EXPECT_EQ(runs, 20);
+}
+
+TEST(ExecutorTest, PollingTaskMergesNotifications) {
+  Executor executor(4);
+  std::atomic<int> polls = 0, concurrent = 0;
+  std::atomic<bool> overlapped = false;
+  PollingTask task(
+      executor,
+      [&]() {
+        if (concurrent++ > 0) overlapped = true;
+        std::this_thread::sleep_for(milliseconds(1));
+        polls++;
+        concurrent--;
+        return false;
+      },
+      milliseconds(20));
+
+  // Notifications before Start() are ignored
+  task.Notify();
+  task.Start();
+  for (int i = 0; i < 1000; i++) task.Notify();
+  std::this_thread::sleep_for(milliseconds(100));
+  task.Stop();
+
+  int after_stop = polls;
+  EXPECT_GE(after_stop, 2);
+  EXPECT_LT(after_stop, 1000);
+  EXPECT_FALSE(overlapped);
+
+  // Neither notifications nor the interval run a stopped task
+  task.Notify();
+  std::this_thread::sleep_for(milliseconds(50));
+  EXPECT_EQ(polls, after_stop);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
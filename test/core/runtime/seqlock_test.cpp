@@ -0,0 +1,80 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "src/core/runtime/seqlock.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+/// Every field holds the same number, so a torn read mixes two of them.
+struct Wide {
+  uint64_t fields[7] = {};
+};
+
+TEST(SeqLockTest, StoresAndLoads) {
+  SeqLock<Wide> lock;
+  EXPECT_EQ(lock.Load().fields[6], 0);
+
+  Wide value;
+  for (uint64_t &field : value.fields) field = 42;
+  lock.Store(value);
+  EXPECT_EQ(lock.Load().fields[0], 42);
+  EXPECT_EQ(lock.Load().fields[6], 42);
+}
+
+TEST(SeqLockTest, ReadersNeverSeeTornValues) {
+  SeqLock<Wide> lock;
+  std::atomic<bool> done = false;
+
+  std::thread writer([&]() {
+    Wide value;
+    for (uint64_t i = 1; i <= 200000; i++) {
+      for (uint64_t &field : value.fields) field = i;
+      lock.Store(value);
+    }
+    done = true;
+  });
+
+  uint64_t last = 0;
+  while (!done) {
+    Wide value = lock.Load();
+    for (uint64_t field : value.fields) ASSERT_EQ(field, value.fields[0]);
+    // A single writer only moves forward.
+    ASSERT_GE(value.fields[0], last);
+    last = value.fields[0];
+  }
+  writer.join();
+  EXPECT_EQ(lock.Load().fields[0], 200000);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+
+#include "src/core/runtime/spsc_queue.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+TEST(SpscQueueTest, BoundedFifo) {
+  SpscQueue<int> queue(3);
+  EXPECT_EQ(queue.get_capacity(), 4);
+
+  for (int i = 0; i < 4; i++) EXPECT_TRUE(queue.TryPush(i));
+  EXPECT_FALSE(queue.TryPush(4));
+
+  int value;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queue.TryPop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.TryPop(value));
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(SpscQueueTest, KeepsOrderAcrossThreads) {
+  constexpr uint64_t kCount = 200000;
+  SpscQueue<uint64_t> queue(64);
+
+  std::thread producer([&]() {
+    for (uint64_t i = 0; i < kCount; i++) {
+      while (!queue.TryPush(i)) std::this_thread::yield();
+    }
+  });
+
+  uint64_t expected = 0, value;
+  while (expected < kCount) {
+    if (!queue.TryPop(value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(value, expected);
+    expected++;
+  }
+  producer.join();
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
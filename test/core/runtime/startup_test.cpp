@@ -0,0 +1,115 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/core/runtime/executor.h"
+#include "src/core/runtime/startup.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+TEST(StartupGraphTest, RunsStepsAfterTheirDependencies) {
+  Executor executor(4);
+  auto timeline = std::make_shared<StartupTimeline>();
+  StartupGraph startup(timeline);
+
+  std::mutex mux;
+  std::vector<std::string> order;
+  auto step = [&](const char *name) {
+    return [&, name]() {
+      std::lock_guard<std::mutex> lock(mux);
+      order.push_back(name);
+    };
+  };
+  auto a = startup.AddStep("A", step("A"));
+  auto b = startup.AddStep("B", step("B"), {a});
+  auto c = startup.AddStep("C", step("C"), {a});
+  startup.AddStep("D", step("D"), {b, c});
+  startup.Start(executor);
+  startup.Wait();
+
+  EXPECT_TRUE(startup.IsDone());
+  ASSERT_EQ(order.size(), 4);
+  EXPECT_EQ(order.front(), "A");
+  EXPECT_EQ(order.back(), "D");
+
+  // Every step shows up on the timeline
+  auto spans = timeline->GetSpans();
+  ASSERT_EQ(spans.size(), 4);
+  EXPECT_EQ(spans.front().name, "A");
+  EXPECT_TRUE(timeline->Find("D").has_value());
+  EXPECT_FALSE(timeline->Find("E").has_value());
+  executor.Shutdown();
+}
+
+TEST(StartupGraphTest, RunsIndependentStepsInParallel) {
+  constexpr int kSteps = 3;
+  Executor executor(kSteps);
+  StartupGraph startup;
+
+  // Every step waits for all others to start, which only finishes if they run
+  // at the same time
+  std::atomic<int> started = 0;
+  for (int i = 0; i < kSteps; i++) {
+    startup.AddStep("Step", [&]() {
+      started++;
+      while (started < kSteps) std::this_thread::yield();
+    });
+  }
+  startup.Start(executor);
+  startup.Wait();
+
+  EXPECT_EQ(started, kSteps);
+  executor.Shutdown();
+}
+
+TEST(StartupTimelineTest, RecordsScopesAndMarks) {
+  StartupTimeline timeline;
+  {
+    StartupScope scope(&timeline, "Init");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  timeline.Mark("FirstFrame");
+
+  auto spans = timeline.GetSpans();
+  ASSERT_EQ(spans.size(), 2);
+  EXPECT_GE(spans[0].end - spans[0].begin, std::chrono::milliseconds(2));
+  EXPECT_EQ(spans[1].begin, spans[1].end);
+  EXPECT_LE(spans[0].end, spans[1].begin);
+  EXPECT_NE(timeline.ToString().find("FirstFrame"), std::string::npos);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,170 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "src/core/runtime/timer_wheel.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+TEST(TimerWheelTest, FiresInDeadlineOrder) {
+  TimerWheel<int> wheel(100);
+  wheel.Schedule(100 + 5000, 3);
+  wheel.Schedule(100 + 70, 2);
+  wheel.Schedule(100 + 3, 1);
+  TimerHandle cancelled = wheel.Schedule(100 + 70, 4);
+  wheel.Schedule(50, 0);  // already due
+  EXPECT_EQ(wheel.get_size(), 5);
+
+  EXPECT_TRUE(wheel.Cancel(cancelled));
+  EXPECT_FALSE(wheel.Cancel(cancelled));
+
+  std::vector<int> fired;
+  auto collect = [&](int &value) { fired.push_back(value); };
+  EXPECT_EQ(wheel.Advance(100 + 69, collect), 2);
+  EXPECT_EQ(wheel.NextExpiry(), 100 + 70);
+  EXPECT_EQ(wheel.Advance(1000000, collect), 2);
+  EXPECT_EQ(fired, (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(wheel.get_size(), 0);
+  EXPECT_EQ(wheel.NextExpiry(), TimerWheel<int>::kNever);
+}
+
+TEST(TimerWheelTest, ReusesNodesAndRejectsStaleHandles) {
+  TimerWheel<int> wheel;
+  TimerHandle first = wheel.Schedule(10, 1);
+  wheel.Advance(10, [](int &) {});
+  EXPECT_FALSE(wheel.Cancel(first));
+
+  // Rescheduling from the callback keeps a single node alive
+  uint64_t now = 10;
+  int fired = 0;
+  wheel.Schedule(now + 1, 0);
+  for (int i = 0; i < 1000; i++) {
+    now += 1 + (uint64_t)i * 37;
+    wheel.Advance(now, [&](int &value) {
+      fired++;
+      wheel.Schedule(now + 1 + (uint64_t)(i + 1) * 37, value + 1);
+    });
+  }
+  EXPECT_EQ(fired, 1000);
+  EXPECT_EQ(wheel.get_capacity(), 1);
+
+  // The node of the first timer was reused, the old handle stays invalid
+  EXPECT_EQ(first.index, 0);
+  EXPECT_FALSE(wheel.Cancel(first));
+}
+
+TEST(TimerWheelTest, CancelsFromTheCallback) {
+  // All timers are due at the same tick, the first one cancels the others
+  for (uint64_t deadline : {uint64_t(5), uint64_t(100)}) {
+    TimerWheel<int> wheel(10);
+    std::vector<TimerHandle> handles;
+    for (int i = 1; i <= 3; i++) handles.push_back(wheel.Schedule(deadline, i));
+
+    std::vector<int> fired;
+    size_t count = wheel.Advance(1000, [&](int &value) {
+      fired.push_back(value);
+      for (TimerHandle handle : handles) wheel.Cancel(handle);
+    });
+    EXPECT_EQ(count, 1);
+    ASSERT_EQ(fired.size(), 1);
+    EXPECT_NE(fired[0], 0);
+    EXPECT_EQ(wheel.get_size(), 0);
+    for (TimerHandle handle : handles) EXPECT_FALSE(wheel.Cancel(handle));
+
+    // The released nodes are reused without corrupting the wheel
+    for (int i = 1; i <= 3; i++) wheel.Schedule(2000 + i, i);
+    EXPECT_EQ(wheel.get_size(), 3);
+    EXPECT_EQ(wheel.get_capacity(), 3);
+    fired.clear();
+    wheel.Advance(3000, [&](int &value) { fired.push_back(value); });
+    EXPECT_EQ(fired, (std::vector<int>{1, 2, 3}));
+  }
+}
+
+TEST(TimerWheelTest, MatchesSortedReference) {
+  std::mt19937_64 random(7);
+  TimerWheel<uint64_t> wheel;
+  // deadline and id of every pending timer
+  std::multimap<uint64_t, uint64_t> reference;
+  std::map<uint64_t, std::pair<TimerHandle, uint64_t>> handles;
+  uint64_t now = 0, next_id = 0;
+
+  for (int round = 0; round < 2000; round++) {
+    for (int i = 0; i < 20; i++) {
+      // Mix near and far deadlines to exercise every level
+      uint64_t range = uint64_t(1) << (random() % 40);
+      uint64_t deadline = now + random() % range;
+      uint64_t id = next_id++;
+      handles[id] = {wheel.Schedule(deadline, id), deadline};
+      reference.emplace(deadline, id);
+    }
+    for (int i = 0; i < 5 && !handles.empty(); i++) {
+      auto it = handles.lower_bound(random() % next_id);
+      if (it == handles.end()) continue;
+      ASSERT_TRUE(wheel.Cancel(it->second.first));
+      auto range = reference.equal_range(it->second.second);
+      for (auto ref = range.first; ref != range.second; ref++) {
+        if (ref->second == it->first) {
+          reference.erase(ref);
+          break;
+        }
+      }
+      handles.erase(it);
+    }
+
+    uint64_t step = uint64_t(1) << (random() % 24);
+    now += random() % step;
+    std::vector<std::pair<uint64_t, uint64_t>> fired, expected;
+    wheel.Advance(now, [&](uint64_t &id) {
+      fired.emplace_back(handles[id].second, id);
+      handles.erase(id);
+    });
+    while (!reference.empty() && reference.begin()->first <= now) {
+      expected.emplace_back(*reference.begin());
+      reference.erase(reference.begin());
+    }
+
+    // Timers fire by deadline, equal deadlines in any order
+    ASSERT_TRUE(std::is_sorted(
+        fired.begin(), fired.end(),
+        [](const auto &a, const auto &b) { return a.first < b.first; }));
+    std::sort(fired.begin(), fired.end());
+    ASSERT_EQ(fired, expected);
+    ASSERT_EQ(wheel.get_size(), reference.size());
+  }
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
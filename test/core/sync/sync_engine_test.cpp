@@ -0,0 +1,166 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "src/core/event_bus/channels.h"
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/sync/habit_crdt.h"
+#include "src/core/sync/sync_engine.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+
+void Exchange(HabitReplica &a, HabitReplica &b) {
+  HabitDelta to_b = a.MakeDelta(b.get_version());
+  HabitDelta to_a = b.MakeDelta(a.get_version());
+  b.Merge(to_b);
+  a.Merge(to_a);
+}
+
+TEST(HabitReplicaTest, ConcurrentEditsConverge) {
+  HabitReplica phone(1), laptop(2);
+  ASSERT_TRUE(phone.SetCompleted(7, 100, true));
+  ASSERT_TRUE(phone.SetCompleted(7, 101, true));
+  EXPECT_FALSE(phone.SetCompleted(7, 101, true));
+  Exchange(phone, laptop);
+  EXPECT_TRUE(laptop.IsCompleted(7, 100));
+
+  // The laptop removes day 100 while the phone adds it again. The phone did
+  // not observe the remove, so its add wins. Day 101 is removed on one side
+  // only.
+  laptop.SetCompleted(7, 100, false);
+  phone.SetCompleted(7, 100, false);
+  phone.SetCompleted(7, 100, true);
+  laptop.SetCompleted(7, 101, false);
+  phone.SetCompleted(7, 102, true);
+
+  std::vector<HabitReplica::Change> changes;
+  laptop.Merge(phone.MakeDelta(laptop.get_version()), &changes);
+  phone.Merge(laptop.MakeDelta(phone.get_version()));
+  for (HabitReplica *replica : {&phone, &laptop}) {
+    EXPECT_TRUE(replica->IsCompleted(7, 100));
+    EXPECT_FALSE(replica->IsCompleted(7, 101));
+    EXPECT_TRUE(replica->IsCompleted(7, 102));
+  }
+  // Only the days whose state changed on the laptop are reported.
+  ASSERT_EQ(changes.size(), 2);
+  EXPECT_EQ(changes[0].day, 100);
+  EXPECT_TRUE(changes[0].completed);
+  EXPECT_EQ(changes[1].day, 102);
+}
+
+TEST(HabitReplicaTest, DeltasScaleWithTheChange) {
+  HabitReplica phone(1), laptop(2), tablet(3);
+  for (Day day = 0; day < 1000; day++) phone.SetCompleted(1, day, true);
+  Exchange(phone, laptop);
+  EXPECT_EQ(laptop.get_version().Get(1), 1000);
+
+  laptop.SetCompleted(1, 5, false);
+  HabitDelta delta = laptop.MakeDelta(phone.get_version());
+  ASSERT_EQ(delta.ops.size(), 1);
+  EXPECT_EQ(phone.Merge(delta), 1);
+  EXPECT_EQ(phone.Merge(delta), 0);
+  EXPECT_FALSE(phone.IsCompleted(1, 5));
+
+  // The remove reaches the tablet before the add it observed.
+  HabitDelta from_laptop = laptop.MakeDelta(tablet.get_version());
+  std::stable_partition(
+      from_laptop.ops.begin(), from_laptop.ops.end(),
+      [](const SyncOp &op) { return op.dot.replica == 2; });
+  EXPECT_EQ(tablet.Merge(from_laptop), 1001);
+  EXPECT_FALSE(tablet.IsCompleted(1, 5));
+  EXPECT_TRUE(tablet.IsCompleted(1, 6));
+}
+
+TEST(SyncEngineTest, MergedChangesArePublishedAsCheckIns) {
+  auto phone_bus = EventBus::Create();
+  auto laptop_bus = EventBus::Create();
+  HabitStore phone_store(phone_bus), laptop_store(laptop_bus);
+  SyncEngine phone(phone_bus, phone_store, 1);
+  SyncEngine laptop(laptop_bus, laptop_store, 2);
+  auto laptop_checkins = laptop_bus->SubscribeTo(channels::kHabitCheckIn);
+
+  phone_store.SetCompleted(3, 200, true);
+  phone_store.SetCompleted(3, 201, true);
+  EXPECT_TRUE(phone.Poll());
+  EXPECT_EQ(laptop.Merge(phone.MakeDelta(laptop.GetVersion())), 2);
+
+  auto event = laptop_checkins->ReadNext<CheckIn>();
+  ASSERT_NE(event, nullptr);
+  EXPECT_EQ(event->GetData<CheckIn>()->day, 200);
+  EXPECT_TRUE(laptop_store.Read([](const HabitTable &table) {
+    return table.IsCompleted(3, 201);
+  }));
+
+  // The echo of the merged changes is not synced back as a new operation.
+  EXPECT_FALSE(laptop.Poll());
+  EXPECT_TRUE(laptop.MakeDelta(phone.GetVersion()).ops.empty());
+
+  laptop_store.SetCompleted(3, 200, false);
+  EXPECT_EQ(phone.Merge(laptop.MakeDelta(phone.GetVersion())), 1);
+  EXPECT_FALSE(phone_store.Read([](const HabitTable &table) {
+    return table.IsCompleted(3, 200);
+  }));
+}
+
+TEST(SyncEngineTest, ConcurrentMergesKeepTheStoreInSync) {
+  constexpr Day kDays = 2000;
+  for (int round = 0; round < 20; round++) {
+    auto bus = EventBus::Create();
+    HabitStore store(bus);
+    SyncEngine laptop(bus, store, 2);
+
+    // The tablet removes every day the phone added, so merging the adds after
+    // the removes changes nothing while the other order adds and removes.
+    HabitReplica phone(1), tablet(3);
+    for (Day day = 0; day < kDays; day++) phone.SetCompleted(1, day, true);
+    HabitDelta adds = phone.MakeDelta(VersionVector());
+    tablet.Merge(adds);
+    for (Day day = 0; day < kDays; day++) tablet.SetCompleted(1, day, false);
+    HabitDelta removes = tablet.MakeDelta(VersionVector());
+
+    std::thread merge_adds([&]() { laptop.Merge(adds); });
+    std::thread merge_removes([&]() { laptop.Merge(removes); });
+    merge_adds.join();
+    merge_removes.join();
+
+    // The echo of the merged changes matches the replica.
+    EXPECT_FALSE(laptop.Poll());
+    size_t completed = store.Read(
+        [](const HabitTable &table) { return table.CountCompletions(1); });
+    EXPECT_EQ(completed, 0);
+  }
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,122 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "src/frontend/debug_gui/frame_profiler.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+using ::habitify_debug::FrameProfiler;
+
+TEST(FrameProfilerTest, KeepsTheLatestFrames) {
+  FrameProfiler profiler;
+  std::vector<FrameProfiler::Frame> frames;
+  profiler.ReadFrames(frames);
+  EXPECT_TRUE(frames.empty());
+
+  for (size_t i = 0; i < FrameProfiler::kFrameCapacity + 10; i++) {
+    profiler.BeginFrame();
+    {
+      HAB_PROFILE_SCOPE(&profiler, "Outer");
+      HAB_PROFILE_SCOPE(&profiler, "Inner");
+    }
+    profiler.EndFrame();
+  }
+
+  profiler.ReadFrames(frames, 4);
+  ASSERT_EQ(frames.size(), 4);
+  for (size_t i = 0; i < frames.size(); i++) {
+    EXPECT_EQ(frames[i].index, FrameProfiler::kFrameCapacity + 6 + i);
+    ASSERT_EQ(frames[i].zone_count, 2);
+    EXPECT_EQ(frames[i].zones[0].depth, 0);
+    EXPECT_EQ(frames[i].zones[1].depth, 1);
+    EXPECT_LE(frames[i].zones[1].end_ns, frames[i].zones[0].end_ns);
+  }
+}
+
+TEST(FrameProfilerTest, EndFrameClosesOpenZones) {
+  FrameProfiler profiler;
+  profiler.BeginFrame();
+  profiler.BeginZone("Outer");
+  profiler.BeginZone("Inner");
+  profiler.EndFrame();
+  // A scope that ends after the frame is ignored.
+  profiler.EndZone();
+
+  std::vector<FrameProfiler::Frame> frames;
+  profiler.ReadFrames(frames);
+  ASSERT_EQ(frames.size(), 1);
+  const FrameProfiler::Frame &frame = frames[0];
+  ASSERT_EQ(frame.zone_count, 2);
+  for (size_t i = 0; i < frame.zone_count; i++) {
+    EXPECT_GE(frame.zones[i].end_ns, frame.zones[i].start_ns);
+    EXPECT_LE(frame.zones[i].end_ns, frame.end_ns);
+  }
+
+  // The next frame starts at depth 0 again.
+  profiler.BeginFrame();
+  profiler.BeginZone("Next");
+  profiler.EndZone();
+  profiler.EndFrame();
+  profiler.ReadFrames(frames);
+  ASSERT_EQ(frames.size(), 2);
+  ASSERT_EQ(frames[1].zone_count, 1);
+  EXPECT_EQ(frames[1].zones[0].depth, 0);
+}
+
+TEST(FrameProfilerTest, ReadsWhileFramesAreWritten) {
+  FrameProfiler profiler;
+  std::atomic<bool> done = false;
+  std::thread writer([&]() {
+    for (size_t i = 0; i < 20000; i++) {
+      profiler.BeginFrame();
+      // The zone count depends on the index.
+      for (size_t zone = 0; zone < i % 8; zone++) {
+        HAB_PROFILE_SCOPE(&profiler, "Zone");
+      }
+      profiler.EndFrame();
+    }
+    done = true;
+  });
+
+  std::vector<FrameProfiler::Frame> frames;
+  while (!done) {
+    profiler.ReadFrames(frames);
+    for (size_t i = 0; i < frames.size(); i++) {
+      ASSERT_EQ(frames[i].zone_count, frames[i].index % 8);
+      if (i > 0) ASSERT_GT(frames[i].index, frames[i - 1].index);
+    }
+  }
+  writer.join();
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
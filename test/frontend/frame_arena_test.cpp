@@ -0,0 +1,116 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+
+#include "src/frontend/frame_arena.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+using ::habitify_frontend::FrameArena;
+
+bool IsAligned(const void *p, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+TEST(FrameArenaTest, AlignedAllocationsAcrossBlocks) {
+  FrameArena arena(256, std::pmr::new_delete_resource());
+  EXPECT_EQ(arena.get_heap_allocations(), 1);
+
+  void *a = arena.allocate(1, 1);
+  void *b = arena.allocate(8, 16);
+  EXPECT_TRUE(IsAligned(b, 16));
+  EXPECT_GE(static_cast<char *>(b), static_cast<char *>(a) + 1);
+
+  // Does not fit into the rest of the first block
+  EXPECT_NE(arena.allocate(200, 1), nullptr);
+  void *c = arena.allocate(64, 64);
+  EXPECT_TRUE(IsAligned(c, 64));
+  EXPECT_EQ(arena.get_heap_allocations(), 2);
+  std::memset(c, 0xab, 64);
+
+  // Larger than a whole block
+  void *d = arena.allocate(1000, 32);
+  EXPECT_TRUE(IsAligned(d, 32));
+  std::memset(d, 0xcd, 1000);
+  EXPECT_EQ(arena.get_heap_allocations(), 3);
+  EXPECT_GE(arena.get_capacity(), 256 + 1000);
+}
+
+TEST(FrameArenaTest, FormatLongerThanTheRestOfTheBlock) {
+  FrameArena arena(64, std::pmr::new_delete_resource());
+  const char *first = arena.Format("%d of %d", 3, 7);
+  EXPECT_STREQ(first, "3 of 7");
+  EXPECT_EQ(arena.get_bytes_used(), 7);
+
+  std::string long_text(100, 'x');
+  const char *text = arena.Format("[%s]", long_text.c_str());
+  EXPECT_EQ(std::strlen(text), 102);
+  EXPECT_EQ(std::string(text), "[" + long_text + "]");
+  EXPECT_EQ(arena.get_heap_allocations(), 2);
+
+  // The first string is still intact
+  EXPECT_STREQ(arena.Format("%s", "next"), "next");
+  EXPECT_STREQ(first, "3 of 7");
+}
+
+TEST(FrameArenaTest, ResetMergesBlocks) {
+  FrameArena arena(128, std::pmr::new_delete_resource());
+  auto frame = [&arena]() {
+    for (int i = 0; i < 20; i++) {
+      std::memset(arena.allocate(48, 16), 0, 48);
+      arena.Format("item %d", i);
+    }
+    auto values = arena.MakeVector<int>();
+    values.assign(100, 1);
+  };
+
+  frame();
+  size_t capacity = arena.get_capacity();
+  size_t allocations = arena.get_heap_allocations();
+  ASSERT_GT(allocations, 2);
+
+  // All blocks become one that holds a whole frame
+  arena.Reset();
+  EXPECT_EQ(arena.get_bytes_used(), 0);
+  EXPECT_EQ(arena.get_capacity(), capacity);
+  EXPECT_EQ(arena.get_heap_allocations(), allocations + 1);
+
+  for (int i = 0; i < 5; i++) {
+    frame();
+    arena.Reset();
+  }
+  EXPECT_EQ(arena.get_capacity(), capacity);
+  EXPECT_EQ(arena.get_heap_allocations(), allocations + 1);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
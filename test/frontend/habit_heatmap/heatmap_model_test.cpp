@@ -0,0 +1,156 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "src/core/event_bus/event_bus.h"
+#include "src/core/habits/habit_store.h"
+#include "src/core/habits/habit_types.h"
+#include "src/frontend/habit_heatmap/heatmap_model.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+using ::habitify_frontend::HeatmapData;
+using ::habitify_frontend::HeatmapModel;
+
+// A Wednesday, the week starts at day 998
+constexpr Day kToday = 1000;
+
+class HeatmapModelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    event_bus_ = EventBus::Create();
+    store_ = std::make_unique<HabitStore>(event_bus_);
+    model_ = std::make_unique<HeatmapModel>(event_bus_);
+  }
+
+  uint16_t Completions(Day day) const {
+    const HeatmapData &data = model_->get_data();
+    return data.completions[day - data.grid_start];
+  }
+  uint8_t Level(Day day) const {
+    const HeatmapData &data = model_->get_data();
+    return data.levels[day - data.grid_start];
+  }
+  float WeekRate(Day day) const {
+    const HeatmapData &data = model_->get_data();
+    return data.week_rates[(day - data.grid_start) / 7];
+  }
+
+  std::shared_ptr<EventBus> event_bus_;
+  std::unique_ptr<HabitStore> store_;
+  std::unique_ptr<HeatmapModel> model_;
+};
+
+TEST_F(HeatmapModelTest, CoversAYearUpToToday) {
+  model_->Attach(kToday);
+  EXPECT_TRUE(model_->Update(kToday));
+  EXPECT_FALSE(model_->Update(kToday));
+
+  const HeatmapData &data = model_->get_data();
+  EXPECT_EQ(Weekday(data.grid_start), 0);
+  EXPECT_LE(data.grid_start, kToday - (Day)(HeatmapModel::kMinWeeks * 7) + 1);
+  EXPECT_EQ(data.completions.size(), data.week_count * 7);
+  EXPECT_EQ(data.levels.size(), data.week_count * 7);
+  EXPECT_EQ(data.week_rates.size(), data.week_count);
+  EXPECT_EQ(data.DayOf(data.completions.size() - 1), 1004);
+  EXPECT_EQ(Level(kToday), 0);
+  EXPECT_EQ(Level(kToday + 1), HeatmapData::kFuture);
+}
+
+TEST_F(HeatmapModelTest, AppliesCheckInsOnTopOfAggregates) {
+  model_->Attach(kToday);
+  ASSERT_TRUE(store_->SetCompleted(1, 998, true));
+  ASSERT_TRUE(store_->SetCompleted(2, 998, true));
+  ASSERT_TRUE(store_->SetCompleted(1, 999, true));
+  ASSERT_TRUE(model_->Update(kToday));
+  EXPECT_EQ(Completions(998), 2);
+  EXPECT_EQ(Completions(999), 1);
+  // Two completions are the most so far, so they get the darkest level
+  EXPECT_EQ(Level(998), HeatmapData::kLevels - 1);
+  EXPECT_EQ(Level(999), 2);
+  EXPECT_FLOAT_EQ(WeekRate(kToday), 3.0f / (3 * 2));
+
+  // Aggregates replace the counts, the check-ins after them are replayed
+  store_->PublishAggregates();
+  ASSERT_TRUE(store_->SetCompleted(1, 998, false));
+  uint64_t version = model_->get_data().version;
+  ASSERT_TRUE(model_->Update(kToday));
+  EXPECT_GT(model_->get_data().version, version);
+  EXPECT_EQ(Completions(998), 1);
+  EXPECT_EQ(Completions(999), 1);
+  EXPECT_FLOAT_EQ(WeekRate(kToday), 2.0f / (3 * 2));
+
+  // Past midnight the next day is shown
+  EXPECT_EQ(Level(kToday + 1), HeatmapData::kFuture);
+  ASSERT_TRUE(model_->Update(kToday + 1));
+  EXPECT_EQ(Level(kToday + 1), 0);
+  EXPECT_FLOAT_EQ(WeekRate(kToday), 2.0f / (4 * 2));
+}
+
+TEST_F(HeatmapModelTest, ReportsTheChangedCells) {
+  model_->Attach(kToday);
+  ASSERT_TRUE(model_->Update(kToday));
+  EXPECT_TRUE(model_->get_data().refresh_all);
+
+  // Two check-ins of the same day keep the scale, only their cell changed
+  ASSERT_TRUE(store_->SetCompleted(1, 998, true));
+  ASSERT_TRUE(store_->SetCompleted(2, 998, true));
+  ASSERT_TRUE(model_->Update(kToday));
+  EXPECT_TRUE(model_->get_data().refresh_all);
+  ASSERT_TRUE(store_->SetCompleted(1, 990, true));
+  ASSERT_TRUE(model_->Update(kToday));
+  const HeatmapData &data = model_->get_data();
+  EXPECT_FALSE(data.refresh_all);
+  ASSERT_EQ(data.dirty_cells.size(), 1);
+  EXPECT_EQ(data.DayOf(data.dirty_cells[0]), 990);
+
+  // The next day changes every cell after today
+  ASSERT_TRUE(model_->Update(kToday + 1));
+  EXPECT_TRUE(model_->get_data().refresh_all);
+  EXPECT_TRUE(model_->get_data().dirty_cells.empty());
+}
+
+TEST_F(HeatmapModelTest, GrowsTheGrid) {
+  model_->Attach(kToday);
+  model_->Update(kToday);
+  Day grid_start = model_->get_data().grid_start;
+
+  ASSERT_TRUE(store_->SetCompleted(1, 5, true));
+  ASSERT_TRUE(store_->SetCompleted(1, 999, true));
+  ASSERT_TRUE(model_->Update(kToday));
+  const HeatmapData &data = model_->get_data();
+  EXPECT_EQ(data.grid_start, 5 - Weekday(5));
+  EXPECT_LT(data.grid_start, grid_start);
+  EXPECT_EQ(Completions(5), 1);
+  EXPECT_EQ(Completions(999), 1);
+  EXPECT_EQ(Level(5), HeatmapData::kLevels - 1);
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
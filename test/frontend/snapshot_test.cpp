@@ -0,0 +1,89 @@
+// Habitify - Habit tracking and creating platform
+// Copyright (C) 2023  Simon Pauly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+//(at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contact via <https://github.com/SPauly/Habitify>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "src/core/runtime/executor.h"
+#include "src/frontend/layer.h"
+#include "src/frontend/snapshot.h"
+
+namespace habitify_core {
+namespace habitify_testing {
+namespace {
+using ::habitify_frontend::Layer;
+using ::habitify_frontend::Snapshot;
+
+/// Counts its updates and commits every other one.
+class CountingLayer : public Layer {
+ public:
+  void OnUpdate(float dt) override {
+    updates_++;
+    if (updates_ % 2 != 0) return;
+    count_.Write() = updates_;
+    count_.Commit();
+  }
+
+  int updates_ = 0;
+  Snapshot<int> count_{this};
+};
+
+TEST(SnapshotTest, SwapsCommittedData) {
+  CountingLayer layer;
+  layer.OnUpdate(0.0f);
+  EXPECT_FALSE(layer.SwapSnapshots());
+  EXPECT_EQ(layer.count_.Read(), 0);
+
+  layer.OnUpdate(0.0f);
+  // Only the swap publishes the committed data
+  EXPECT_EQ(layer.count_.Read(), 0);
+  EXPECT_TRUE(layer.SwapSnapshots());
+  EXPECT_EQ(layer.count_.Read(), 2);
+  EXPECT_FALSE(layer.SwapSnapshots());
+  EXPECT_EQ(layer.count_.Read(), 2);
+}
+
+TEST(SnapshotTest, LayersUpdateInParallel) {
+  // Runs the phases like the frontends do
+  Executor executor(4);
+  std::vector<std::shared_ptr<CountingLayer>> layers;
+  for (int i = 0; i < 16; i++) {
+    layers.push_back(std::make_shared<CountingLayer>());
+  }
+
+  for (int frame = 1; frame <= 10; frame++) {
+    executor.ParallelFor(layers.size(),
+                         [&](size_t i) { layers[i]->OnUpdate(0.0f); });
+    for (auto &layer : layers) {
+      EXPECT_EQ(layer->SwapSnapshots(), frame % 2 == 0);
+      EXPECT_EQ(layer->count_.Read(), frame - frame % 2);
+    }
+  }
+}
+
+}  // namespace
+
+}  // namespace habitify_testing
+
+}  // namespace habitify_core
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}